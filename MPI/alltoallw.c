@@ -6,8 +6,25 @@
  * Evaluate performane of all-to-many personalized communication implemented
  * with MPI_Alltoallw() and MPI_Issend()/MPI_Irecv().
  *
+ * Command-line option '-p' adds persistent point-to-point communication using
+ * MPI_Ssend_init()/MPI_Recv_init(). The requests are created once, before
+ * the first run, and started by MPI_Startall() in each iteration. Option
+ * '-k num' uses instead the partitioned communication of MPI 4.0,
+ * MPI_Psend_init()/MPI_Precv_init(), with num partitions per message. As a
+ * partitioned send matches a single partitioned receive, separate receive
+ * requests are created for each iteration in this case.
+ *
+ * Command-line option '-t' adds a two-level topology-aware implementation.
+ * Processes on the same compute node, found by MPI_Comm_split_type() with
+ * MPI_COMM_TYPE_SHARED, copy their messages into a shared-memory window
+ * allocated by the node leader, the process of rank 0 on the node. The node
+ * leader then sends one combined message per receiver by MPI_Issend(), and
+ * each receiver receives one message per compute node into its receive
+ * buffer, using an indexed datatype. The number of messages per iteration is
+ * reduced from about nprocs x num_recvers to nnodes x num_recvers.
+ *
  * To compile:
- *   % mpicc -O2 alltoallw.c -o alltoallw
+ *   % mpicc -O2 -I.. alltoallw.c ../bench_util.c -o alltoallw -lm
  *
  * Usage:
  *   % ./alltoallw -h
@@ -19,6 +36,20 @@
  *      [-r num] every ratio processes is a receiver (default: 1)
  *      [-l num] receive amount per iteration (default: 8 MB)
  *      [-g num] gap between 2 consecutive send/recv buffers (default: 4 int)
+ *      [-W num] number of untimed warmup runs (default: 0)
+ *      [-N num] number of timed repetitions (default: 1)
+ *      [-o file] append results as a line of JSON to file
+ *      [-p] also use persistent MPI_Ssend_init/Recv_init (default: no)
+ *      [-k num] use partitioned MPI_Psend_init/Precv_init with num
+ *               partitions per message instead of -p, requires MPI 4.0
+ *      [-t] also use two-level intra-node aggregation (default: no)
+ *      [-L list] sweep over receive amounts per iteration, overwrites -l
+ *      [-R list] sweep over receiver ratios, overwrites -r
+ *                list is comma-separated values or ranges lo:hi[:factor],
+ *                with optional suffix k, m, or g, e.g. 64k:8m:4,16m
+ *
+ * In the sweep mode, all configurations are run in one job and a table of
+ * latency and bandwidth of all implementations is printed at the end.
  *
  * Example run command and output on screen:
  *   % mpiexec -n 2048 ./alltoallw -n 253 -r 32
@@ -41,18 +72,11 @@
 
 #include <mpi.h>
 
+#include "bench_util.h"
+
 static int verbose;
 static int debug;
 
-#define ERR \
-    if (err != MPI_SUCCESS) { \
-        int errorStringLen; \
-        char errorString[MPI_MAX_ERROR_STRING]; \
-        MPI_Error_string(err, errorString, &errorStringLen); \
-        printf("Error at line %d: %s\n",__LINE__,errorString); \
-        goto err_out; \
-    }
-
 /* initilized the contents of send buffer */
 void initialize_send_buf(int  ntimes,
                          int  num_recvers,
@@ -119,16 +143,18 @@ err_out:
 }
 
 /* all-to-many personalized communication by calling MPI_Alltoallw() */
-void run_alltoallw(int  ntimes,
-                   int  ratio,
-                   int  is_receiver,
-                   int  len,
-                   int  gap,
-                   int *sendBuf,
-                   int *recvBuf)
+int run_alltoallw(int          ntimes,
+                  int          ratio,
+                  int          is_receiver,
+                  int          len,
+                  int          gap,
+                  int         *sendBuf,
+                  int          *recvBuf,
+                  bench_timer  *timer,
+                  bench_record *rec)
 {
     int *sendPtr;
-    int i, j, err, nprocs, rank, num_recvers, bucket_len;
+    int i, j, err, nerrs=0, nprocs, rank, num_recvers, bucket_len;
     int *sendCounts, *recvCounts, *sendDisps, *recvDisps;
     MPI_Datatype *sendTypes, *recvTypes;
     double start_t, end_t, timing[10], maxt[10];
@@ -137,6 +163,7 @@ void run_alltoallw(int  ntimes,
     if (ntimes % 10) bucket_len++;
 
     MPI_Barrier(MPI_COMM_WORLD);
+    bench_timer_start(timer);
     timing[0] = MPI_Wtime();
 
     MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
@@ -202,31 +229,36 @@ void run_alltoallw(int  ntimes,
     end_t = MPI_Wtime();
     timing[9] = end_t - start_t;
     timing[0] = end_t - timing[0]; /* end-to-end time */
+    bench_timer_stop(timer);
 
 err_out:
     free(sendTypes);
     free(sendCounts);
     free(sendDisps);
 
-    MPI_Reduce(&timing, &maxt, 10, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    bench_max_timings(timing, maxt, 10, MPI_COMM_WORLD);
+    bench_record_buckets(rec, timer, maxt, 10);
     if (rank == 0) {
         printf("Time for using MPI_alltoallw    = %.2f sec\n", maxt[0]);
         for (i=1; i<10; i++)
             printf("\tTime bucket[%d] = %.2f sec\n", i, maxt[i]);
     }
+    return nerrs;
 }
 
 /* all-to-many personalized communication by calling MPI_Issend/Irecv() */
-void run_async_send_recv(int  ntimes,
-                         int  ratio,
-                         int  is_receiver,
-                         int  len,
-                         int  gap,
-                         int *sendBuf,
-                         int *recvBuf)
+int run_async_send_recv(int          ntimes,
+                        int          ratio,
+                        int          is_receiver,
+                        int          len,
+                        int          gap,
+                        int         *sendBuf,
+                        int          *recvBuf,
+                        bench_timer  *timer,
+                        bench_record *rec)
 {
     int *sendPtr, *recvPtr;
-    int i, j, err, nprocs, rank, nreqs, num_recvers, bucket_len;
+    int i, j, err, nerrs=0, nprocs, rank, nreqs, num_recvers, bucket_len;
     MPI_Request *reqs;
     MPI_Status *st;
     double start_t, end_t, timing[10], maxt[10];
@@ -235,6 +267,7 @@ void run_async_send_recv(int  ntimes,
     if (ntimes % 10) bucket_len++;
 
     MPI_Barrier(MPI_COMM_WORLD);
+    bench_timer_start(timer);
     timing[0] = MPI_Wtime();
 
     MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
@@ -291,17 +324,610 @@ void run_async_send_recv(int  ntimes,
     end_t = MPI_Wtime();
     timing[9] = end_t - start_t;
     timing[0] = end_t - timing[0]; /* end-to-end time */
+    bench_timer_stop(timer);
 
 err_out:
     free(st);
     free(reqs);
 
-    MPI_Reduce(&timing, &maxt, 10, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    bench_max_timings(timing, maxt, 10, MPI_COMM_WORLD);
+    bench_record_buckets(rec, timer, maxt, 10);
     if (rank == 0) {
         printf("Time for using MPI_Issend/Irecv = %.2f sec\n", maxt[0]);
         for (i=1; i<10; i++)
             printf("\tTime bucket[%d] = %.2f sec\n", i, maxt[i]);
     }
+    return nerrs;
+}
+
+/* persistent point-to-point requests, created once before the first run */
+typedef struct {
+    int          nparts;    /* number of partitions, 0 for non-partitioned */
+    int          nrecvs;    /* number of receive requests per iteration */
+    int          nsends;    /* number of send requests per iteration */
+    MPI_Request *recv_reqs; /* [nrecvs], or [ntimes][nrecvs] if partitioned */
+    MPI_Request *send_reqs; /* [ntimes][nsends] */
+} persist_reqs;
+
+/* create persistent requests of all iterations */
+int init_persistent(int           ntimes,
+                    int           ratio,
+                    int           is_receiver,
+                    int           len,
+                    int           gap,
+                    int          *sendBuf,
+                    int          *recvBuf,
+                    int           nparts,
+                    persist_reqs *pr)
+{
+    int *sendPtr, *recvPtr;
+    int i, j, k, err, nerrs=0, nprocs, rank, num_recvers, nrecv_sets;
+
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    num_recvers = nprocs/ ratio;
+
+    pr->nparts = nparts;
+    pr->nrecvs = (is_receiver) ? nprocs - 1 : 0;
+    pr->nsends = (rank % ratio == 0) ? num_recvers - 1 : num_recvers;
+
+    /* a partitioned receive cannot be matched with more than one send */
+    nrecv_sets = (nparts > 0) ? ntimes : 1;
+    pr->recv_reqs = (MPI_Request*) malloc(sizeof(MPI_Request) *
+                                          (pr->nrecvs * nrecv_sets + 1));
+    pr->send_reqs = (MPI_Request*) malloc(sizeof(MPI_Request) *
+                                          (pr->nsends * ntimes + 1));
+
+    /* Only receivers create recv requests */
+    for (k=0, i=0; i<nrecv_sets; i++) {
+        recvPtr = recvBuf;
+        for (j=0; is_receiver && j<nprocs; j++) {
+            if (rank != j) { /* skip recv from self */
+#if MPI_VERSION >= 4
+                if (nparts > 0)
+                    err = MPI_Precv_init(recvPtr, nparts, len / nparts,
+                                         MPI_INT, j, 0, MPI_COMM_WORLD,
+                                         MPI_INFO_NULL, &pr->recv_reqs[k++]);
+                else
+#endif
+                    err = MPI_Recv_init(recvPtr, len, MPI_INT, j, 0,
+                                        MPI_COMM_WORLD, &pr->recv_reqs[k++]);
+                ERR
+            }
+            recvPtr += len + gap;
+        }
+    }
+
+    /* all ranks create send requests, each iteration uses its own buffer */
+    k = 0;
+    sendPtr = sendBuf;
+    for (i=0; i<ntimes; i++) {
+        for (j=0; j<nprocs; j++) {
+            if (j % ratio) continue; /* j is not a receiver */
+            if (rank != j) { /* skip send to self */
+#if MPI_VERSION >= 4
+                if (nparts > 0)
+                    err = MPI_Psend_init(sendPtr, nparts, len / nparts,
+                                         MPI_INT, j, 0, MPI_COMM_WORLD,
+                                         MPI_INFO_NULL, &pr->send_reqs[k++]);
+                else
+#endif
+                    err = MPI_Ssend_init(sendPtr, len, MPI_INT, j, 0,
+                                         MPI_COMM_WORLD, &pr->send_reqs[k++]);
+                ERR
+            }
+            sendPtr += len + gap;
+        }
+    }
+
+err_out:
+    return nerrs;
+}
+
+/* free persistent requests of all iterations */
+void free_persistent(int           ntimes,
+                     persist_reqs *pr)
+{
+    int i, nrecv_sets = (pr->nparts > 0) ? ntimes : 1;
+
+    for (i=0; i<pr->nrecvs * nrecv_sets; i++)
+        MPI_Request_free(&pr->recv_reqs[i]);
+    for (i=0; i<pr->nsends * ntimes; i++)
+        MPI_Request_free(&pr->send_reqs[i]);
+    free(pr->recv_reqs);
+    free(pr->send_reqs);
+}
+
+/* all-to-many personalized communication by starting persistent requests */
+int run_persistent_send_recv(int           ntimes,
+                             int           is_receiver,
+                             int           len,
+                             int           gap,
+                             int          *recvBuf,
+                             persist_reqs  *pr,
+                             bench_timer   *timer,
+                             bench_record  *rec)
+{
+    int i, err, nerrs=0, rank, bucket_len;
+    MPI_Request *recv_reqs, *send_reqs;
+    double start_t, end_t, timing[10], maxt[10];
+    const char *label = (pr->nparts > 0) ? "MPI_Psend_init/Precv_init"
+                                         : "MPI_Ssend_init/Recv_init";
+
+    bucket_len = ntimes / 10;
+    if (ntimes % 10) bucket_len++;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    bench_timer_start(timer);
+    timing[0] = MPI_Wtime();
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    start_t = MPI_Wtime();
+    for (i=0; i<ntimes; i++) {
+        if (debug && is_receiver)
+            initialize_recv_buf(len, gap, recvBuf);
+
+        recv_reqs = pr->recv_reqs + ((pr->nparts > 0) ? i * pr->nrecvs : 0);
+        send_reqs = pr->send_reqs + i * pr->nsends;
+
+        err = MPI_Startall(pr->nrecvs, recv_reqs); ERR
+        err = MPI_Startall(pr->nsends, send_reqs); ERR
+#if MPI_VERSION >= 4
+        if (pr->nparts > 0) {
+            int j;
+            /* all partitions are ready right away */
+            for (j=0; j<pr->nsends; j++) {
+                err = MPI_Pready_range(0, pr->nparts - 1, send_reqs[j]); ERR
+            }
+        }
+#endif
+        err = MPI_Waitall(pr->nsends, send_reqs, MPI_STATUSES_IGNORE); ERR
+        err = MPI_Waitall(pr->nrecvs, recv_reqs, MPI_STATUSES_IGNORE); ERR
+
+        if (debug && is_receiver)
+            check_recv_buf((char*)label, len, gap, recvBuf);
+
+        if (i > 0 && i % bucket_len == 0) {
+            end_t = MPI_Wtime();
+            timing[i / bucket_len] = end_t - start_t;
+            start_t = end_t;
+        }
+    }
+    end_t = MPI_Wtime();
+    timing[9] = end_t - start_t;
+    timing[0] = end_t - timing[0]; /* end-to-end time */
+    bench_timer_stop(timer);
+
+err_out:
+    bench_max_timings(timing, maxt, 10, MPI_COMM_WORLD);
+    bench_record_buckets(rec, timer, maxt, 10);
+    if (rank == 0) {
+        printf("Time for using %s = %.2f sec\n", label, maxt[0]);
+        for (i=1; i<10; i++)
+            printf("\tTime bucket[%d] = %.2f sec\n", i, maxt[i]);
+    }
+    return nerrs;
+}
+
+/* two-level communication: intra-node aggregation then inter-node messages */
+typedef struct {
+    MPI_Comm      node_comm;  /* processes on the same compute node */
+    MPI_Win       win;        /* shared-memory window of node leader */
+    int          *win_buf;    /* window of node leader, receiver-major */
+    int           node_rank;  /* rank in node_comm, 0 is the node leader */
+    int           nnodes;     /* number of compute nodes */
+    int           nsends;     /* number of receivers */
+    int          *send_off;   /* [nsends] offset on window to each receiver */
+    int          *send_cnt;   /* [nsends] number of messages to each receiver */
+    int          *slot_off;   /* [nsends] offset of this process's message */
+    int           nrecvs;     /* number of node leaders to receive from */
+    int          *recv_src;   /* [nrecvs] ranks of node leaders */
+    MPI_Datatype *recv_types; /* [nrecvs] layout in the receive buffer */
+    MPI_Request  *reqs;       /* [nrecvs + nsends] */
+} two_level_comm;
+
+/* create node communicator, shared-memory window, and receive datatypes */
+int init_two_level(int             ratio,
+                   int             is_receiver,
+                   int             len,
+                   int             gap,
+                   two_level_comm *tl)
+{
+    int i, j, k, err, nerrs=0, nprocs, rank, node_size, my_leader, on_node;
+    int *owner, *disps, total;
+    MPI_Aint win_size;
+
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    tl->node_comm  = MPI_COMM_NULL;
+    tl->win        = MPI_WIN_NULL;
+    tl->nrecvs     = 0;
+    tl->nsends     = nprocs / ratio;
+    tl->send_off   = (int*) malloc(sizeof(int) * tl->nsends * 3);
+    tl->send_cnt   = tl->send_off + tl->nsends;
+    tl->slot_off   = tl->send_cnt + tl->nsends;
+    tl->recv_src   = (int*) malloc(sizeof(int) * nprocs);
+    tl->recv_types = (MPI_Datatype*) malloc(sizeof(MPI_Datatype) * nprocs);
+    tl->reqs = (MPI_Request*) malloc(sizeof(MPI_Request) * (nprocs + tl->nsends));
+
+    owner = (int*) malloc(sizeof(int) * nprocs * 2);
+    disps = owner + nprocs;
+
+    /* ranks in node_comm are in the same order as in MPI_COMM_WORLD */
+    err = MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank,
+                              MPI_INFO_NULL, &tl->node_comm); ERR
+    MPI_Comm_rank(tl->node_comm, &tl->node_rank);
+    MPI_Comm_size(tl->node_comm, &node_size);
+
+    /* owner[i] is the rank of node leader of process i */
+    my_leader = rank;
+    err = MPI_Bcast(&my_leader, 1, MPI_INT, 0, tl->node_comm); ERR
+    err = MPI_Allgather(&my_leader, 1, MPI_INT, owner, 1, MPI_INT,
+                        MPI_COMM_WORLD); ERR
+    tl->nnodes = 0;
+    for (i=0; i<nprocs; i++)
+        if (owner[i] == i) tl->nnodes++;
+
+    /* messages to receiver j from all processes on this node are stored
+     * contiguously on the window, in the order of their ranks, skipping the
+     * message of receiver j to itself
+     */
+    total = 0;
+    for (j=0; j<tl->nsends; j++) {
+        int recver = j * ratio;
+        on_node = (owner[recver] == my_leader);
+        tl->send_off[j] = total * len;
+        tl->send_cnt[j] = node_size - on_node;
+        if (recver == rank)
+            tl->slot_off[j] = -1;
+        else
+            tl->slot_off[j] = (total + tl->node_rank -
+                               ((on_node && recver < rank) ? 1 : 0)) * len;
+        total += tl->send_cnt[j];
+    }
+
+    win_size = (tl->node_rank == 0) ? (MPI_Aint)total * len * sizeof(int) : 0;
+    err = MPI_Win_allocate_shared(win_size, sizeof(int), MPI_INFO_NULL,
+                                  tl->node_comm, &tl->win_buf, &tl->win); ERR
+    if (tl->node_rank > 0) {
+        MPI_Aint size;
+        int disp_unit;
+        err = MPI_Win_shared_query(tl->win, 0, &size, &disp_unit,
+                                   &tl->win_buf); ERR
+    }
+
+    /* a receiver receives one message from each node leader, which contains
+     * the messages of all processes on that node, except itself
+     */
+    if (is_receiver) {
+        for (k=0; k<nprocs; k++) {
+            if (owner[k] != k) continue; /* k is not a node leader */
+            j = 0;
+            for (i=k; i<nprocs; i++)
+                if (owner[i] == k && i != rank)
+                    disps[j++] = i * (len + gap);
+            if (j == 0) continue;
+            err = MPI_Type_create_indexed_block(j, len, disps, MPI_INT,
+                                                &tl->recv_types[tl->nrecvs]);
+            ERR
+            err = MPI_Type_commit(&tl->recv_types[tl->nrecvs]); ERR
+            tl->recv_src[tl->nrecvs++] = k;
+        }
+    }
+
+    /* start the access epoch used by the first iteration */
+    err = MPI_Win_fence(0, tl->win); ERR
+
+err_out:
+    free(owner);
+    return nerrs;
+}
+
+/* free node communicator, shared-memory window, and receive datatypes */
+void free_two_level(two_level_comm *tl)
+{
+    int i;
+
+    for (i=0; i<tl->nrecvs; i++)
+        MPI_Type_free(&tl->recv_types[i]);
+    if (tl->win != MPI_WIN_NULL) MPI_Win_free(&tl->win);
+    if (tl->node_comm != MPI_COMM_NULL) MPI_Comm_free(&tl->node_comm);
+    free(tl->send_off);
+    free(tl->recv_src);
+    free(tl->recv_types);
+    free(tl->reqs);
+}
+
+/* all-to-many personalized communication by aggregating messages of each
+ * compute node on the shared-memory window of node leader
+ */
+int run_two_level_send_recv(int             ntimes,
+                            int             ratio,
+                            int             is_receiver,
+                            int             len,
+                            int             gap,
+                            int            *sendBuf,
+                            int            *recvBuf,
+                            two_level_comm *tl,
+                            bench_timer    *timer,
+                            bench_record   *rec)
+{
+    int *sendPtr;
+    int i, j, err, nerrs=0, rank, nreqs, bucket_len;
+    double start_t, end_t, timing[10], maxt[10];
+
+    bucket_len = ntimes / 10;
+    if (ntimes % 10) bucket_len++;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    bench_timer_start(timer);
+    timing[0] = MPI_Wtime();
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    start_t = MPI_Wtime();
+    sendPtr = sendBuf;
+    for (i=0; i<ntimes; i++) {
+        if (debug && is_receiver)
+            initialize_recv_buf(len, gap, recvBuf);
+
+        /* Only receivers post recv requests, one per compute node */
+        nreqs = 0;
+        for (j=0; j<tl->nrecvs; j++) {
+            err = MPI_Irecv(recvBuf, 1, tl->recv_types[j], tl->recv_src[j], 0,
+                            MPI_COMM_WORLD, &tl->reqs[nreqs++]);
+            ERR
+        }
+
+        /* all ranks copy their messages to the window of node leader */
+        for (j=0; j<tl->nsends; j++) {
+            if (tl->slot_off[j] >= 0)
+                memcpy(tl->win_buf + tl->slot_off[j], sendPtr + j * (len + gap),
+                       sizeof(int) * len);
+        }
+        sendPtr += tl->nsends * (len + gap);
+        err = MPI_Win_fence(0, tl->win); ERR
+
+        /* node leader sends one combined message to each receiver */
+        if (tl->node_rank == 0) {
+            for (j=0; j<tl->nsends; j++) {
+                if (tl->send_cnt[j] == 0) continue;
+                err = MPI_Issend(tl->win_buf + tl->send_off[j],
+                                 tl->send_cnt[j] * len, MPI_INT, j * ratio, 0,
+                                 MPI_COMM_WORLD, &tl->reqs[nreqs++]);
+                ERR
+            }
+        }
+
+        err = MPI_Waitall(nreqs, tl->reqs, MPI_STATUSES_IGNORE); ERR
+
+        /* window can be overwritten once the node leader completes sends */
+        err = MPI_Win_fence(0, tl->win); ERR
+
+        if (debug && is_receiver)
+            check_recv_buf("two-level", len, gap, recvBuf);
+
+        if (i > 0 && i % bucket_len == 0) {
+            end_t = MPI_Wtime();
+            timing[i / bucket_len] = end_t - start_t;
+            start_t = end_t;
+        }
+    }
+    end_t = MPI_Wtime();
+    timing[9] = end_t - start_t;
+    timing[0] = end_t - timing[0]; /* end-to-end time */
+    bench_timer_stop(timer);
+
+err_out:
+    bench_max_timings(timing, maxt, 10, MPI_COMM_WORLD);
+    bench_record_buckets(rec, timer, maxt, 10);
+    if (rank == 0) {
+        printf("Time for using two-level Issend = %.2f sec\n", maxt[0]);
+        for (i=1; i<10; i++)
+            printf("\tTime bucket[%d] = %.2f sec\n", i, maxt[i]);
+    }
+    return nerrs;
+}
+
+/*----< run_config() >-------------------------------------------------------*/
+/* run all implementations for one configuration of receiver ratio and
+ * receive amount per iteration, and add their timings to the sweep table
+ */
+static int
+run_config(int          ntimes,
+           int          ratio,
+           int          block_len,
+           int          gap,
+           int          persistent,
+           int          nparts,
+           int          two_level,
+           int          nwarmup,
+           int          nreps,
+           const char  *out_file,
+           bench_sweep *sweep)
+{
+    int i, rank, nprocs, nerrs=0, len, num_recvers, is_receiver;
+    int *sendBuf=NULL, *recvBuf=NULL;
+    double amnt, setup_t;
+    bench_timer t_alltoallw, t_issend, t_persist, t_two_level;
+    persist_reqs preqs;
+    two_level_comm tl;
+    bench_record rec;
+
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* set the number of receivers */
+    if (ratio <= 0 || ratio > nprocs) ratio = 1;
+    num_recvers = nprocs / ratio;
+
+    /* set whether this rank has non-zero data to receive */
+    is_receiver = (rank % ratio == 0) ? 1 : 0;
+
+    /* per message size */
+    len = block_len / sizeof(int) / nprocs;
+
+    if (nparts > 0) {
+#if MPI_VERSION < 4
+        if (rank == 0)
+            printf("Error: partitioned communication requires MPI 4.0 or later\n");
+        return 1;
+#endif
+        if (len % nparts) {
+            if (rank == 0)
+                printf("Error: message length %d ints is not a multiple of %d partitions\n",
+                       len, nparts);
+            return 1;
+        }
+    }
+
+    if (verbose && rank == 0)
+        printf("nprocs=%d ntimes=%d block_len=%d num_recvers=%d len=%d gap=%d\n",
+               nprocs, ntimes, block_len, num_recvers, len, gap);
+
+    if (verbose && is_receiver)
+        printf("rank %2d is_receiver\n", rank);
+
+    if (verbose) fflush(stdout);
+
+    if (rank == 0) {
+        printf("number of MPI processes         = %d\n", nprocs);
+        printf("number of iterations            = %d\n", ntimes);
+        printf("numbe of receivers              = %d\n", num_recvers);
+        printf("individual message length       = %zd bytes\n",len*sizeof(int));
+        printf("send/recv buffer gap            = %d int(s)\n",gap);
+        printf("Recv amount per iteration       = %d bytes\n",block_len);
+    }
+
+    /* allocate and initialize send buffer */
+    sendBuf = (int*) malloc(sizeof(int) * (len + gap) * ntimes * num_recvers);
+    initialize_send_buf(ntimes, num_recvers, len, gap, sendBuf);
+
+    if (is_receiver)
+        /* receive buffer is reused every iteration */
+        recvBuf = (int*) malloc(sizeof(int) * (len + gap) * nprocs);
+
+    bench_record_init(&rec, MPI_COMM_WORLD, "alltoallw");
+    bench_record_int(&rec, "ntimes", ntimes);
+    bench_record_int(&rec, "ratio", ratio);
+    bench_record_int(&rec, "num_recvers", num_recvers);
+    bench_record_int(&rec, "block_len", block_len);
+    bench_record_int(&rec, "msg_len", len*sizeof(int));
+    bench_record_int(&rec, "gap", gap);
+    bench_record_int(&rec, "persistent", persistent);
+    bench_record_int(&rec, "nparts", nparts);
+    bench_record_int(&rec, "two_level", two_level);
+
+    bench_timer_init(&t_alltoallw, "MPI_alltoallw", nwarmup, nreps);
+    bench_timer_init(&t_issend, "MPI_Issend/Irecv", nwarmup, nreps);
+    bench_timer_init(&t_persist, (nparts > 0) ? "MPI_Psend_init/Precv_init"
+                     : "MPI_Ssend_init/Recv_init", nwarmup, nreps);
+    bench_timer_init(&t_two_level, "two-level MPI_Issend/Irecv", nwarmup,
+                     nreps);
+
+    if (persistent) {
+        /* create persistent requests once, reused by all runs */
+        MPI_Barrier(MPI_COMM_WORLD);
+        setup_t = MPI_Wtime();
+        nerrs += init_persistent(ntimes, ratio, is_receiver, len, gap, sendBuf,
+                                 recvBuf, nparts, &preqs);
+        setup_t = MPI_Wtime() - setup_t;
+        MPI_Allreduce(MPI_IN_PLACE, &setup_t, 1, MPI_DOUBLE, MPI_MAX,
+                      MPI_COMM_WORLD);
+        if (rank == 0)
+            printf("Time for persistent request setup = %.4f sec\n", setup_t);
+        bench_record_double(&rec, "persistent_setup", setup_t);
+        if (nerrs > 0) goto err_out;
+    }
+
+    if (two_level) {
+        /* create node communicator and shared-memory window once */
+        MPI_Barrier(MPI_COMM_WORLD);
+        setup_t = MPI_Wtime();
+        nerrs += init_two_level(ratio, is_receiver, len, gap, &tl);
+        setup_t = MPI_Wtime() - setup_t;
+        MPI_Allreduce(MPI_IN_PLACE, &setup_t, 1, MPI_DOUBLE, MPI_MAX,
+                      MPI_COMM_WORLD);
+        if (rank == 0) {
+            printf("number of compute nodes         = %d\n", tl.nnodes);
+            printf("messages per iteration: direct  = %d\n",
+                   (nprocs - 1) * num_recvers);
+            printf("messages per iteration: 2-level = %d\n",
+                   tl.nnodes * num_recvers);
+            printf("Time for two-level setup        = %.4f sec\n", setup_t);
+        }
+        bench_record_double(&rec, "two_level_setup", setup_t);
+        bench_record_int(&rec, "nnodes_two_level", tl.nnodes);
+        bench_record_int(&rec, "msgs_direct", (long long)(nprocs - 1) * num_recvers);
+        bench_record_int(&rec, "msgs_two_level", (long long)tl.nnodes * num_recvers);
+        if (nerrs > 0) goto err_out;
+    }
+
+    for (i=0; i<nwarmup+nreps; i++) {
+        /* perform all-to-many communication */
+        MPI_Barrier(MPI_COMM_WORLD);
+        nerrs += run_alltoallw(ntimes, ratio, is_receiver, len, gap, sendBuf,
+                               recvBuf, &t_alltoallw, &rec);
+
+        /* perform all-to-many communication */
+        MPI_Barrier(MPI_COMM_WORLD);
+        nerrs += run_async_send_recv(ntimes, ratio, is_receiver, len, gap,
+                                     sendBuf, recvBuf, &t_issend, &rec);
+
+        if (persistent) {
+            /* perform all-to-many communication */
+            MPI_Barrier(MPI_COMM_WORLD);
+            nerrs += run_persistent_send_recv(ntimes, is_receiver, len, gap,
+                                              recvBuf, &preqs, &t_persist,
+                                              &rec);
+        }
+
+        if (two_level) {
+            /* perform all-to-many communication */
+            MPI_Barrier(MPI_COMM_WORLD);
+            nerrs += run_two_level_send_recv(ntimes, ratio, is_receiver, len,
+                                             gap, sendBuf, recvBuf, &tl,
+                                             &t_two_level, &rec);
+        }
+    }
+    if (persistent) free_persistent(ntimes, &preqs);
+    if (two_level) free_two_level(&tl);
+
+    /* total amount received by all receivers in all iterations */
+    amnt = (double)len * sizeof(int) * (nprocs - 1) * num_recvers * ntimes;
+    bench_timer_report(&t_alltoallw, MPI_COMM_WORLD, amnt, &rec);
+    bench_timer_report(&t_issend, MPI_COMM_WORLD, amnt, &rec);
+    if (persistent)
+        bench_timer_report(&t_persist, MPI_COMM_WORLD, amnt, &rec);
+    if (two_level)
+        bench_timer_report(&t_two_level, MPI_COMM_WORLD, amnt, &rec);
+    if (bench_record_write(&rec, out_file)) nerrs++;
+
+    /* add a row for each implementation to the sweep table */
+    len *= sizeof(int);
+    bench_sweep_add(sweep, &t_alltoallw, MPI_COMM_WORLD, ratio, len, ntimes,
+                    amnt);
+    bench_sweep_add(sweep, &t_issend, MPI_COMM_WORLD, ratio, len, ntimes, amnt);
+    if (persistent)
+        bench_sweep_add(sweep, &t_persist, MPI_COMM_WORLD, ratio, len, ntimes,
+                        amnt);
+    if (two_level)
+        bench_sweep_add(sweep, &t_two_level, MPI_COMM_WORLD, ratio, len,
+                        ntimes, amnt);
+
+err_out:
+    bench_timer_free(&t_alltoallw);
+    bench_timer_free(&t_issend);
+    bench_timer_free(&t_persist);
+    bench_timer_free(&t_two_level);
+    bench_record_free(&rec);
+
+    if (recvBuf != NULL) free(recvBuf);
+    free(sendBuf);
+
+    return nerrs;
 }
 
 /*----< usage() >------------------------------------------------------------*/
@@ -313,20 +939,32 @@ static void usage (char *argv0) {
        [-n num] number of iterations (default: 1)\n\
        [-r num] every ratio processes is a receiver (default: 1)\n\
        [-l num] receive amount per iteration (default: 8 MB)\n\
-       [-g num] gap between 2 consecutive send/recv buffers (default: 4 int)\n";
-    fprintf (stderr, help, argv0);
+       [-g num] gap between 2 consecutive send/recv buffers (default: 4 int)\n\
+       [-W num] number of untimed warmup runs (default: %d)\n\
+       [-N num] number of timed repetitions (default: %d)\n\
+       [-o file] append results as a line of JSON to file\n\
+       [-p] also use persistent MPI_Ssend_init/Recv_init (default: no)\n\
+       [-k num] use partitioned MPI_Psend_init/Precv_init with num\n\
+                partitions per message instead of -p, requires MPI 4.0\n\
+       [-t] also use two-level intra-node aggregation (default: no)\n\
+       [-L list] sweep over receive amounts per iteration, overwrites -l\n\
+       [-R list] sweep over receiver ratios, overwrites -r\n\
+                 list is comma-separated values or ranges lo:hi[:factor],\n\
+                 with optional suffix k, m, or g, e.g. 64k:8m:4,16m\n";
+    fprintf (stderr, help, argv0, BENCH_NWARMUP, BENCH_NREPS);
 }
 
 /*----< main() >------------------------------------------------------------*/
 int main(int argc, char **argv) {
     extern int optind;
     extern char *optarg;
-    int i, rank, nprocs;
-    int len, gap, block_len, ntimes, ratio, num_recvers, is_receiver;
-    int *sendBuf, *recvBuf=NULL;
+    int i, j, rank, nerrs=0, nwarmup, nreps, nsizes, nratios;
+    int gap, block_len, ntimes, ratio, persistent, nparts, two_level;
+    long long *sizes=NULL, *ratios=NULL;
+    char *out_file=NULL, *size_list=NULL, *ratio_list=NULL;
+    bench_sweep sweep;
 
     MPI_Init(&argc, &argv);
-    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
     verbose = 0;
@@ -335,9 +973,14 @@ int main(int argc, char **argv) {
     ratio = 1;
     block_len = 8 * 1024 * 1024;
     gap = 4;
+    persistent = 0;
+    nparts = 0;
+    two_level = 0;
+    nwarmup = BENCH_NWARMUP;
+    nreps = BENCH_NREPS;
 
     /* command-line arguments */
-    while ((i = getopt (argc, argv, "hvdn:r:l:g:")) != EOF)
+    while ((i = getopt (argc, argv, "hvdptn:r:l:g:W:N:o:k:L:R:")) != EOF)
         switch (i) {
             case 'v':
                 verbose = 1;
@@ -357,63 +1000,79 @@ int main(int argc, char **argv) {
             case 'g':
                 gap = atoi(optarg);
                 break;
+            case 'W':
+                nwarmup = atoi(optarg);
+                break;
+            case 'N':
+                nreps = atoi(optarg);
+                break;
+            case 'o':
+                out_file = strdup(optarg);
+                break;
+            case 'p':
+                persistent = 1;
+                break;
+            case 'k':
+                nparts = atoi(optarg);
+                persistent = 1;
+                break;
+            case 't':
+                two_level = 1;
+                break;
+            case 'L':
+                size_list = optarg;
+                break;
+            case 'R':
+                ratio_list = optarg;
+                break;
             case 'h':
             default:
                 if (rank == 0) usage(argv[0]);
                 goto err_out;
         }
 
-    /* set the number of receivers */
-    if (ratio <= 0 || ratio > nprocs) ratio = 1;
-    num_recvers = nprocs / ratio;
-
-    /* set whether this rank has non-zero data to receive */
-    is_receiver = (rank % ratio == 0) ? 1 : 0;
-
-    /* per message size */
-    len = block_len / sizeof(int) / nprocs;
-
-    if (verbose && rank == 0)
-        printf("nprocs=%d ntimes=%d block_len=%d num_recvers=%d len=%d gap=%d\n",
-               nprocs, ntimes, block_len, num_recvers, len, gap);
-
-    if (verbose && is_receiver)
-        printf("rank %2d is_receiver\n", rank);
-
-    if (verbose) fflush(stdout);
-
-    if (rank == 0) {
-        printf("number of MPI processes         = %d\n", nprocs);
-        printf("number of iterations            = %d\n", ntimes);
-        printf("numbe of receivers              = %d\n", num_recvers);
-        printf("individual message length       = %zd bytes\n",len*sizeof(int));
-        printf("send/recv buffer gap            = %d int(s)\n",gap);
-        printf("Recv amount per iteration       = %d bytes\n",block_len);
+    /* a single configuration unless lists are given */
+    if (size_list != NULL) {
+        nsizes = bench_parse_list(size_list, &sizes);
+    }
+    else {
+        nsizes = 1;
+        sizes = (long long*) malloc(sizeof(long long));
+        sizes[0] = block_len;
+    }
+    if (ratio_list != NULL) {
+        nratios = bench_parse_list(ratio_list, &ratios);
+    }
+    else {
+        nratios = 1;
+        ratios = (long long*) malloc(sizeof(long long));
+        ratios[0] = ratio;
+    }
+    if (nsizes <= 0 || nratios <= 0) {
+        if (rank == 0)
+            printf("Error: invalid list of command-line option '%s'\n",
+                   (nsizes <= 0) ? "-L" : "-R");
+        nerrs++;
+        goto err_out;
     }
 
-    /* allocate and initialize send buffer */
-    sendBuf = (int*) malloc(sizeof(int) * (len + gap) * ntimes * num_recvers);
-    initialize_send_buf(ntimes, num_recvers, len, gap, sendBuf);
-
-    if (is_receiver)
-        /* receive buffer is reused every iteration */
-        recvBuf = (int*) malloc(sizeof(int) * (len + gap) * nprocs);
-
-    /* perform all-to-many communication */
-    MPI_Barrier(MPI_COMM_WORLD);
-    run_alltoallw(ntimes, ratio, is_receiver, len, gap, sendBuf, recvBuf);
-
-    /* perform all-to-many communication */
-    MPI_Barrier(MPI_COMM_WORLD);
-    run_async_send_recv(ntimes, ratio, is_receiver, len, gap, sendBuf, recvBuf);
-
-    if (is_receiver)
-        free(recvBuf);
-    free(sendBuf);
+    memset(&sweep, 0, sizeof(bench_sweep));
+    for (i=0; i<nratios; i++) {
+        for (j=0; j<nsizes; j++) {
+            nerrs += run_config(ntimes, ratios[i], sizes[j], gap, persistent,
+                                nparts, two_level, nwarmup, nreps, out_file,
+                                &sweep);
+            if (nerrs > 0) break;
+        }
+        if (nerrs > 0) break;
+    }
+    if (rank == 0 && nsizes * nratios > 1) bench_sweep_print(&sweep);
+    bench_sweep_free(&sweep);
 
 err_out:
+    if (sizes != NULL) free(sizes);
+    if (ratios != NULL) free(ratios);
+    if (out_file != NULL) free(out_file);
     MPI_Finalize();
-    return 0;
+    return (nerrs > 0);
 }
-
-
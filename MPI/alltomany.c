@@ -9,12 +9,33 @@
  * Command-line option '-s' uses MPI_Issend/MPI_Irecv/MPI_Waitall
  * The default is to use MPI_Isend/MPI_Irecv/MPI_Waitall
  *
+ * Command-line option '-p' creates the send and receive requests once as
+ *     persistent requests, MPI_Send_init (or MPI_Ssend_init when '-s' is set)
+ *     and MPI_Recv_init, and calls MPI_Startall/MPI_Waitall in each iteration.
+ * Command-line option '-k num' uses instead the partitioned communication of
+ *     MPI 4.0, MPI_Psend_init/MPI_Precv_init with num partitions per message.
+ * Command-line option '-t' uses a two-level topology-aware engine. Processes
+ *     on the same compute node, found by MPI_Comm_split_type with
+ *     MPI_COMM_TYPE_SHARED, copy their outgoing messages into a shared-memory
+ *     window allocated by the node leader, i.e. the process of rank 0 on the
+ *     node. The node leader then sends one combined message per receiver,
+ *     using MPI_Isend (or MPI_Issend when '-s' is set). Each receiver
+ *     receives one message per compute node. This reduces the number of
+ *     messages per iteration from nprocs x num_recvers to nnodes x
+ *     num_recvers, similar to the I/O aggregators in ROMIO.
+ *
  * Command-line option '-n' sets the number of iterations
  * Command-line option '-m' sets the maximal number of receivers
  * Command-line option '-r' can be used to set the number of receivers.  For
  *     example, when running 128 MPI processes per compute node, setting '-r
  *     128' will pick one receiver per compute node.
  * Command-line option '-l' can be used to set the message size.
+ * Command-line options '-W' and '-N' set the numbers of untimed warmup runs
+ *     and timed repetitions of all iterations.
+ * Command-line option '-o' appends the results as a line of JSON to a file.
+ * Command-line options '-L' and '-R' sweep over lists of message sizes and
+ *     receiver ratios, running all configurations in one job and printing a
+ *     table of latency and bandwidth at the end.
  *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
@@ -25,88 +46,188 @@
 
 #include <mpi.h>
 
-#define ERR \
-    if (err != MPI_SUCCESS) { \
-        int errorStringLen; \
-        char errorString[MPI_MAX_ERROR_STRING]; \
-        MPI_Error_string(err, errorString, &errorStringLen); \
-        printf("Error at line %d: %s\n",__LINE__,errorString); \
-        nerrs++; \
-        goto err_out; \
-    }
+#include "bench_util.h"
+
 #define STRINGIFY(x) #x
 #define TOSTRING(x) STRINGIFY(x)
 
-/*----< usage() >------------------------------------------------------------*/
-static void usage (char *argv0) {
-    char *help = "Usage: %s [OPTION]\n\
-       [-h] Print this help message\n\
-       [-v] Verbose mode (default: no)\n\
-       [-a] use MPI_alltoallv (default: MPI_Isend/Irecv)\n\
-       [-s] use MPI_Issend (default: MPI_Isend/Irecv)\n\
-       [-n num] number of iterations (default: 1)\n\
-       [-m num] number of receivers (default: total number of processes / ratio)\n\
-       [-r ratio] ratio of number of receivers to all processes (default: 1)\n\
-       [-l len] individual message size (default: 48)\n";
-    fprintf (stderr, help, argv0);
-}
+/* command-line options selecting the implementation */
+static int verbose, use_alltoall, use_issend, persistent, nparts, two_level;
 
-/*----< main() >------------------------------------------------------------*/
-int main(int argc, char **argv) {
-    extern int optind;
-    extern char *optarg;
-    int i, j, rank, nprocs, err, nerrs=0, verbose, len, ntimes, ratio;
-    int use_alltoall, use_issend, is_recver, num_recvers, *recver_rank;
-    int max_num_recvers;
-    char *buf;
-    double timing, maxt;
+/*----< run_two_level() >----------------------------------------------------*/
+/* Two-level all-to-many communication. Each process copies its messages to
+ * all receivers into a shared-memory window of its node leader, laid out in
+ * receiver-major order, so the messages of all processes on a node to the
+ * same receiver are contiguous and can be sent by the node leader as one
+ * message. Run nruns times all ntimes iterations.
+ */
+static int
+run_two_level(int           ntimes,
+              int           len,
+              int           num_recvers,
+              const int    *recver_rank,
+              int           is_recver,
+              int           nruns,
+              bench_timer  *timer,
+              bench_record *rec)
+{
+    int i, j, k, r, err, nerrs=0, rank, nprocs, node_rank, node_size;
+    int my_leader, nleaders, nreqs, *leaders=NULL, *leader_size=NULL;
+    int *owner=NULL;
+    char *s_buf=NULL, *r_buf=NULL, *win_buf, *ptr;
+    MPI_Aint win_size;
+    MPI_Comm node_comm=MPI_COMM_NULL;
+    MPI_Win win=MPI_WIN_NULL;
+    MPI_Request *reqs=NULL;
 
-    MPI_Init(&argc, &argv);
     MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    verbose = 0;
-    use_alltoall = 0;
-    use_issend = 0;
-    len = 48;
-    ntimes = 1;
-    ratio = 1;
-    max_num_recvers = nprocs;
+    /* processes on the same compute node */
+    err = MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank,
+                              MPI_INFO_NULL, &node_comm); ERR
+    MPI_Comm_rank(node_comm, &node_rank);
+    MPI_Comm_size(node_comm, &node_size);
 
-    /* command-line arguments */
-    while ((i = getopt (argc, argv, "hvasl:n:r:m:")) != EOF)
-        switch (i) {
-            case 'v':
-                verbose = 1;
-                break;
-            case 's':
-                use_issend = 1;
-                break;
-            case 'a':
-                use_alltoall = 1;
-                break;
-            case 'l':
-                len = atoi(optarg);
-                break;
-            case 'n':
-                ntimes = atoi(optarg);
-                break;
-            case 'r':
-                ratio = atoi(optarg);
-                break;
-            case 'm':
-                max_num_recvers = atoi(optarg);
-                break;
-            case 'h':
-            default:
-                if (rank == 0) usage(argv[0]);
-                goto err_out;
+    /* node leader allocates the window for messages of all local processes
+     * and all receivers
+     */
+    win_size = (node_rank == 0) ? (MPI_Aint)num_recvers * node_size * len : 0;
+    err = MPI_Win_allocate_shared(win_size, 1, MPI_INFO_NULL, node_comm,
+                                  &win_buf, &win); ERR
+    if (node_rank > 0) {
+        MPI_Aint size;
+        int disp_unit;
+        err = MPI_Win_shared_query(win, 0, &size, &disp_unit, &win_buf); ERR
+    }
+
+    /* find all node leaders and their numbers of local processes */
+    my_leader = rank;
+    err = MPI_Bcast(&my_leader, 1, MPI_INT, 0, node_comm); ERR
+    owner = (int*) malloc(sizeof(int) * nprocs * 3);
+    leaders = owner + nprocs;
+    leader_size = leaders + nprocs;
+    err = MPI_Allgather(&my_leader, 1, MPI_INT, owner, 1, MPI_INT,
+                        MPI_COMM_WORLD); ERR
+    for (i=0; i<nprocs; i++) leader_size[i] = 0;
+    for (i=0; i<nprocs; i++) leader_size[owner[i]]++;
+    nleaders = 0;
+    for (i=0; i<nprocs; i++)
+        if (leader_size[i] > 0) {
+            leader_size[nleaders] = leader_size[i];
+            leaders[nleaders++] = i;
         }
 
-    if (use_alltoall == 1 && use_issend == 1) {
+    if (rank == 0) {
+        printf("number of compute nodes         = %d\n", nleaders);
+        printf("messages per iteration: direct  = %d\n", nprocs * num_recvers);
+        printf("messages per iteration: 2-level = %d\n", nleaders * num_recvers);
+    }
+    bench_record_int(rec, "nnodes_two_level", nleaders);
+    bench_record_int(rec, "msgs_direct", (long long)nprocs * num_recvers);
+    bench_record_int(rec, "msgs_two_level", (long long)nleaders * num_recvers);
+
+    s_buf = (char*) malloc((size_t)num_recvers * len);
+    for (i=0; i<num_recvers * len; i++) s_buf[i] = (char)rank;
+    if (is_recver) r_buf = (char*) malloc((size_t)nprocs * len);
+    reqs = (MPI_Request*) malloc(sizeof(MPI_Request) * (nleaders + num_recvers));
+
+    err = MPI_Win_fence(0, win); ERR
+
+    for (r=0; r<nruns; r++) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(timer);
+        for (i=0; i<ntimes; i++) {
+            nreqs = 0;
+
+            /* receivers post one recv request per compute node */
+            if (is_recver) {
+                ptr = r_buf;
+                for (k=0; k<nleaders; k++) {
+                    err = MPI_Irecv(ptr, leader_size[k] * len, MPI_BYTE,
+                                    leaders[k], 0, MPI_COMM_WORLD,
+                                    &reqs[nreqs++]);
+                    ERR
+                    ptr += leader_size[k] * len;
+                }
+            }
+
+            /* copy messages into the window of node leader */
+            for (j=0; j<num_recvers; j++)
+                memcpy(win_buf + ((size_t)j * node_size + node_rank) * len,
+                       s_buf + (size_t)j * len, len);
+            err = MPI_Win_fence(0, win); ERR
+
+            /* node leader sends one combined message per receiver */
+            if (node_rank == 0) {
+                for (j=0; j<num_recvers; j++) {
+                    ptr = win_buf + (size_t)j * node_size * len;
+                    if (use_issend)
+                        err = MPI_Issend(ptr, node_size * len, MPI_BYTE,
+                                         recver_rank[j], 0, MPI_COMM_WORLD,
+                                         &reqs[nreqs++]);
+                    else
+                        err = MPI_Isend(ptr, node_size * len, MPI_BYTE,
+                                        recver_rank[j], 0, MPI_COMM_WORLD,
+                                        &reqs[nreqs++]);
+                    ERR
+                }
+            }
+
+            err = MPI_Waitall(nreqs, reqs, MPI_STATUSES_IGNORE); ERR
+
+            /* window can be overwritten once node leader completes sends */
+            err = MPI_Win_fence(0, win); ERR
+        }
+        bench_timer_stop(timer);
+    }
+
+err_out:
+    if (reqs != NULL) free(reqs);
+    if (r_buf != NULL) free(r_buf);
+    if (s_buf != NULL) free(s_buf);
+    if (owner != NULL) free(owner);
+    if (win != MPI_WIN_NULL) MPI_Win_free(&win);
+    if (node_comm != MPI_COMM_NULL) MPI_Comm_free(&node_comm);
+    return nerrs;
+}
+
+/*----< run_config() >-------------------------------------------------------*/
+/* run all iterations for one configuration of message size and receiver
+ * ratio, and add the timing to the sweep table
+ */
+static int
+run_config(int          len,
+           int          ntimes,
+           int          ratio,
+           int          max_num_recvers,
+           int          nwarmup,
+           int          nreps,
+           const char  *out_file,
+           bench_sweep *sweep)
+{
+    int i, j, r, rank, nprocs, err, nerrs=0, is_recver, num_recvers;
+    int *recver_rank;
+    char *buf;
+    double wb;
+    bench_timer timer;
+    bench_record rec;
+
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (nparts > 0) {
+#if MPI_VERSION < 4
         if (rank == 0)
-            printf("Error: command-line options '-a' and '-s' cannot be both set\n");
-        goto err_out;
+            printf("Error: partitioned communication requires MPI 4.0 or later\n");
+        return 1;
+#endif
+        if (len % nparts) {
+            if (rank == 0)
+                printf("Error: message size %d is not a multiple of %d partitions\n",
+                       len, nparts);
+            return 1;
+        }
     }
 
     is_recver = 0;
@@ -116,6 +237,15 @@ int main(int argc, char **argv) {
     if (rank == 0) {
         if (use_alltoall)
             printf("---- Using MPI_Alltoallv\n");
+        else if (two_level)
+            printf("---- Using two-level shared memory + MPI_%s/Irecv\n",
+                   (use_issend) ? "Issend" : "Isend");
+        else if (nparts > 0)
+            printf("---- Using MPI_Psend_init/Precv_init, %d partitions\n",
+                   nparts);
+        else if (persistent)
+            printf("---- Using MPI_%s_init/Recv_init\n",
+                   (use_issend) ? "Ssend" : "Send");
         else if (use_issend)
             printf("---- Using MPI_Issend/Irecv\n");
         else
@@ -143,46 +273,151 @@ int main(int argc, char **argv) {
     }
     if (verbose && rank == 0) printf("\n");
     if (verbose) fflush(stdout);
-    MPI_Barrier(MPI_COMM_WORLD);
-    timing = MPI_Wtime();
+
+    bench_record_init(&rec, MPI_COMM_WORLD, "alltomany");
+    bench_record_int(&rec, "len", len);
+    bench_record_int(&rec, "ntimes", ntimes);
+    bench_record_int(&rec, "ratio", ratio);
+    bench_record_int(&rec, "num_recvers", num_recvers);
+    bench_record_int(&rec, "persistent", persistent);
+    bench_record_int(&rec, "nparts", nparts);
+    bench_record_int(&rec, "two_level", two_level);
+
+    bench_timer_init(&timer, (use_alltoall) ? "MPI_Alltoallv" :
+                     (two_level && use_issend) ? "two-level MPI_Issend/Irecv" :
+                     (two_level) ? "two-level MPI_Isend/Irecv" :
+                     (nparts > 0) ? "MPI_Psend_init/Precv_init" :
+                     (persistent && use_issend) ? "MPI_Ssend_init/Recv_init" :
+                     (persistent) ? "MPI_Send_init/Recv_init" :
+                     (use_issend) ? "MPI_Issend/Irecv" : "MPI_Isend/Irecv",
+                     nwarmup, nreps);
 
     buf = (char*) malloc((nprocs + num_recvers) * len);
 
-    if (use_alltoall == 0) {
+    if (two_level) {
+        nerrs += run_two_level(ntimes, len, num_recvers, recver_rank,
+                               is_recver, nwarmup+nreps, &timer, &rec);
+    }
+    else if (persistent) {
+        int nreqs=0;
+#if MPI_VERSION >= 4
+        int nrecvs;  /* number of receive requests, before the sends */
+#endif
+        char *ptr = buf;
+        double setup_t;
+        MPI_Request *reqs;
+
+        reqs = (MPI_Request*) calloc(nprocs + num_recvers, sizeof(MPI_Request));
+
+        /* create persistent requests once, reused by all iterations */
+        MPI_Barrier(MPI_COMM_WORLD);
+        setup_t = MPI_Wtime();
+        if (is_recver) {
+            for (j=0; j<nprocs; j++) {
+#if MPI_VERSION >= 4
+                if (nparts > 0)
+                    err = MPI_Precv_init(ptr, nparts, len / nparts, MPI_BYTE,
+                                         j, 0, MPI_COMM_WORLD, MPI_INFO_NULL,
+                                         &reqs[nreqs++]);
+                else
+#endif
+                    err = MPI_Recv_init(ptr, len, MPI_BYTE, j, 0,
+                                        MPI_COMM_WORLD, &reqs[nreqs++]);
+                ERR
+                ptr += len;
+            }
+        }
+#if MPI_VERSION >= 4
+        nrecvs = nreqs;
+#endif
+
+        for (j=0; j<num_recvers; j++) {
+#if MPI_VERSION >= 4
+            if (nparts > 0)
+                err = MPI_Psend_init(ptr, nparts, len / nparts, MPI_BYTE,
+                                     recver_rank[j], 0, MPI_COMM_WORLD,
+                                     MPI_INFO_NULL, &reqs[nreqs++]);
+            else
+#endif
+            if (use_issend)
+                err = MPI_Ssend_init(ptr, len, MPI_BYTE, recver_rank[j], 0,
+                                     MPI_COMM_WORLD, &reqs[nreqs++]);
+            else
+                err = MPI_Send_init(ptr, len, MPI_BYTE, recver_rank[j], 0,
+                                    MPI_COMM_WORLD, &reqs[nreqs++]);
+            ERR
+            ptr += len;
+        }
+        setup_t = MPI_Wtime() - setup_t;
+        MPI_Allreduce(MPI_IN_PLACE, &setup_t, 1, MPI_DOUBLE, MPI_MAX,
+                      MPI_COMM_WORLD);
+        if (rank == 0)
+            printf("Time for persistent request setup = %.4f sec\n", setup_t);
+        bench_record_double(&rec, "persistent_setup", setup_t);
+
+        for (r=0; r<nwarmup+nreps; r++) {
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&timer);
+            for (i=0; i<ntimes; i++) {
+                err = MPI_Startall(nreqs, reqs);
+                ERR
+#if MPI_VERSION >= 4
+                /* all partitions of send buffers are ready right away */
+                for (j=nrecvs; nparts>0 && j<nreqs; j++) {
+                    err = MPI_Pready_range(0, nparts - 1, reqs[j]);
+                    ERR
+                }
+#endif
+                err = MPI_Waitall(nreqs, reqs, MPI_STATUSES_IGNORE);
+                ERR
+            }
+            bench_timer_stop(&timer);
+        }
+
+        for (j=0; j<nreqs; j++)
+            MPI_Request_free(&reqs[j]);
+        free(reqs);
+    }
+    else if (use_alltoall == 0) {
         MPI_Request *reqs;
         MPI_Status *st;
 
         reqs = (MPI_Request*) calloc(nprocs + num_recvers, sizeof(MPI_Request));
         st = (MPI_Status*)malloc(sizeof(MPI_Status) * (nprocs + num_recvers));
 
-        for (i=0; i<ntimes; i++) {
-            int nreqs=0;
-            char *ptr = buf;
+        for (r=0; r<nwarmup+nreps; r++) {
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&timer);
+            for (i=0; i<ntimes; i++) {
+                int nreqs=0;
+                char *ptr = buf;
 
-            /* post recv requests */
-            if (is_recver) {
-                for (j=0; j<nprocs; j++) {
-                    err = MPI_Irecv(ptr, len, MPI_BYTE, j, 0, MPI_COMM_WORLD,
-                                    &reqs[nreqs++]);
+                /* post recv requests */
+                if (is_recver) {
+                    for (j=0; j<nprocs; j++) {
+                        err = MPI_Irecv(ptr, len, MPI_BYTE, j, 0, MPI_COMM_WORLD,
+                                        &reqs[nreqs++]);
+                        ERR
+                        ptr += len;
+                    }
+                }
+
+                /* post send requests */
+                for (j=0; j<num_recvers; j++) {
+                    if (use_issend)
+                        err = MPI_Issend(ptr, len, MPI_BYTE, recver_rank[j], 0,
+                                         MPI_COMM_WORLD, &reqs[nreqs++]);
+                    else
+                        err = MPI_Isend(ptr, len, MPI_BYTE, recver_rank[j], 0,
+                                        MPI_COMM_WORLD, &reqs[nreqs++]);
                     ERR
                     ptr += len;
                 }
-            }
 
-            /* post send requests */
-            for (j=0; j<num_recvers; j++) {
-                if (use_issend)
-                    err = MPI_Issend(ptr, len, MPI_BYTE, recver_rank[j], 0,
-                                     MPI_COMM_WORLD, &reqs[nreqs++]);
-                else
-                    err = MPI_Isend(ptr, len, MPI_BYTE, recver_rank[j], 0,
-                                    MPI_COMM_WORLD, &reqs[nreqs++]);
+                err = MPI_Waitall(nreqs, reqs, st);
                 ERR
-                ptr += len;
             }
-
-            err = MPI_Waitall(nreqs, reqs, st);
-            ERR
+            bench_timer_stop(&timer);
         }
         free(st);
         free(reqs);
@@ -210,11 +445,16 @@ int main(int argc, char **argv) {
         }
         s_buf = r_buf + nprocs * len;
 
-        for (i=0; i<ntimes; i++) {
-            err = MPI_Alltoallv(s_buf, sendCounts, sdispls, MPI_BYTE,
-                                r_buf, recvCounts, rdispls, MPI_BYTE,
-                                MPI_COMM_WORLD);
-            ERR
+        for (r=0; r<nwarmup+nreps; r++) {
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&timer);
+            for (i=0; i<ntimes; i++) {
+                err = MPI_Alltoallv(s_buf, sendCounts, sdispls, MPI_BYTE,
+                                    r_buf, recvCounts, rdispls, MPI_BYTE,
+                                    MPI_COMM_WORLD);
+                ERR
+            }
+            bench_timer_stop(&timer);
         }
         free(sendCounts);
         free(sdispls);
@@ -222,19 +462,189 @@ int main(int argc, char **argv) {
     free(buf);
     free(recver_rank);
 
-    timing = MPI_Wtime() - timing;
-    MPI_Reduce(&timing, &maxt, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
-    if (rank == 0) {
-        double wb = (double)len * nprocs * ntimes * num_recvers;
-        wb /= 1048576.0; /* in MB */
-        printf("Total message amount: %.2f MiB\n", wb);
-        printf("Max time:             %.2f sec\n", maxt);
-        printf("Comm bandwidth:       %.2f MiB/sec\n", wb / maxt);
+    wb = (double)len * nprocs * ntimes * num_recvers;
+    if (rank == 0)
+        printf("Total message amount: %.2f MiB\n", wb / 1048576.0);
+    bench_timer_report(&timer, MPI_COMM_WORLD, wb, &rec);
+    if (bench_record_write(&rec, out_file)) nerrs++;
+
+    /* add a row to the sweep table */
+    bench_sweep_add(sweep, &timer, MPI_COMM_WORLD, ratio, len, ntimes, wb);
+    bench_timer_free(&timer);
+    bench_record_free(&rec);
+
+err_out:
+    return nerrs;
+}
+
+/*----< usage() >------------------------------------------------------------*/
+static void usage (char *argv0) {
+    char *help = "Usage: %s [OPTION]\n\
+       [-h] Print this help message\n\
+       [-v] Verbose mode (default: no)\n\
+       [-a] use MPI_alltoallv (default: MPI_Isend/Irecv)\n\
+       [-s] use MPI_Issend (default: MPI_Isend/Irecv)\n\
+       [-p] use persistent requests for MPI_Isend/Issend/Irecv (default: no)\n\
+       [-t] use two-level intra-node aggregation then inter-node messages\n\
+       [-k num] use partitioned MPI_Psend_init/Precv_init with num\n\
+                partitions per message, requires MPI 4.0 (default: no)\n\
+       [-n num] number of iterations (default: 1)\n\
+       [-m num] number of receivers (default: total number of processes / ratio)\n\
+       [-r ratio] ratio of number of receivers to all processes (default: 1)\n\
+       [-l len] individual message size (default: 48)\n\
+       [-W num] number of untimed warmup runs (default: %d)\n\
+       [-N num] number of timed repetitions (default: %d)\n\
+       [-o file] append results as a line of JSON to file\n\
+       [-L list] sweep over message sizes, overwrites -l\n\
+       [-R list] sweep over receiver ratios, overwrites -r\n\
+                 list is comma-separated values or ranges lo:hi[:factor],\n\
+                 with optional suffix k, m, or g, e.g. 16:64k:4,1m\n";
+    fprintf (stderr, help, argv0, BENCH_NWARMUP, BENCH_NREPS);
+}
+
+/*----< main() >------------------------------------------------------------*/
+int main(int argc, char **argv) {
+    extern int optind;
+    extern char *optarg;
+    int i, j, rank, nprocs, nerrs=0, len, ntimes, ratio, max_num_recvers;
+    int nwarmup, nreps, nsizes, nratios;
+    long long *sizes=NULL, *ratios=NULL;
+    char *out_file=NULL, *size_list=NULL, *ratio_list=NULL;
+    bench_sweep sweep;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    verbose = 0;
+    use_alltoall = 0;
+    use_issend = 0;
+    persistent = 0;
+    nparts = 0;
+    two_level = 0;
+    len = 48;
+    ntimes = 1;
+    ratio = 1;
+    max_num_recvers = nprocs;
+    nwarmup = BENCH_NWARMUP;
+    nreps = BENCH_NREPS;
+
+    /* command-line arguments */
+    while ((i = getopt (argc, argv, "hvasptl:n:r:m:W:N:o:k:L:R:")) != EOF)
+        switch (i) {
+            case 'v':
+                verbose = 1;
+                break;
+            case 's':
+                use_issend = 1;
+                break;
+            case 'a':
+                use_alltoall = 1;
+                break;
+            case 'p':
+                persistent = 1;
+                break;
+            case 't':
+                two_level = 1;
+                break;
+            case 'k':
+                nparts = atoi(optarg);
+                persistent = 1;
+                break;
+            case 'l':
+                len = atoi(optarg);
+                break;
+            case 'n':
+                ntimes = atoi(optarg);
+                break;
+            case 'r':
+                ratio = atoi(optarg);
+                break;
+            case 'm':
+                max_num_recvers = atoi(optarg);
+                break;
+            case 'W':
+                nwarmup = atoi(optarg);
+                break;
+            case 'N':
+                nreps = atoi(optarg);
+                break;
+            case 'o':
+                out_file = strdup(optarg);
+                break;
+            case 'L':
+                size_list = optarg;
+                break;
+            case 'R':
+                ratio_list = optarg;
+                break;
+            case 'h':
+            default:
+                if (rank == 0) usage(argv[0]);
+                goto err_out;
+        }
+
+    if (use_alltoall == 1 && use_issend == 1) {
+        if (rank == 0)
+            printf("Error: command-line options '-a' and '-s' cannot be both set\n");
+        goto err_out;
+    }
+
+    if (use_alltoall == 1 && persistent == 1) {
+        if (rank == 0)
+            printf("Error: command-line options '-a' and '-p' cannot be both set\n");
+        goto err_out;
+    }
+
+    if (two_level == 1 && (use_alltoall == 1 || persistent == 1)) {
+        if (rank == 0)
+            printf("Error: command-line option '-t' cannot be used with '-a', '-p', or '-k'\n");
+        goto err_out;
+    }
+
+    /* a single configuration unless lists are given */
+    if (size_list != NULL) {
+        nsizes = bench_parse_list(size_list, &sizes);
+    }
+    else {
+        nsizes = 1;
+        sizes = (long long*) malloc(sizeof(long long));
+        sizes[0] = len;
+    }
+    if (ratio_list != NULL) {
+        nratios = bench_parse_list(ratio_list, &ratios);
+    }
+    else {
+        nratios = 1;
+        ratios = (long long*) malloc(sizeof(long long));
+        ratios[0] = ratio;
+    }
+    if (nsizes <= 0 || nratios <= 0) {
+        if (rank == 0)
+            printf("Error: invalid list of command-line option '%s'\n",
+                   (nsizes <= 0) ? "-L" : "-R");
+        nerrs++;
+        goto err_out;
+    }
+
+    memset(&sweep, 0, sizeof(bench_sweep));
+    for (i=0; i<nratios; i++) {
+        for (j=0; j<nsizes; j++) {
+            nerrs += run_config(sizes[j], ntimes, ratios[i], max_num_recvers,
+                                nwarmup, nreps, out_file, &sweep);
+            if (nerrs > 0) break;
+        }
+        if (nerrs > 0) break;
     }
+    if (rank == 0 && nsizes * nratios > 1) bench_sweep_print(&sweep);
+    bench_sweep_free(&sweep);
 
 err_out:
+    if (sizes != NULL) free(sizes);
+    if (ratios != NULL) free(ratios);
+    if (out_file != NULL) free(out_file);
     MPI_Finalize();
-    return 0;
+    return (nerrs > 0);
 }
 
 
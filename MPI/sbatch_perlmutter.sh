@@ -57,7 +57,8 @@ for ntime in $(seq 1 ${NTIMES}) ; do
    echo "---- iteration $ntime -----------------------------------------------"
    echo ""
 
-   CMD_OPTS="-n 253 -r 32"
+   # option -t also runs the two-level intra-node aggregation implementation
+   CMD_OPTS="-n 253 -r 32 -t"
 
    CMD="srun -n $NP ${EXE} $CMD_OPTS"
    echo "CMD=$CMD"
@@ -0,0 +1,98 @@
+#!/bin/bash  -l
+#SBATCH --constraint=cpu
+#SBATCH --qos=regular
+#SBATCH -t 00:30:00
+
+#SBATCH --nodes=16
+#SBATCH --job-name=alltoallw_scaling
+#SBATCH -o qout.%x.%j
+#SBATCH -e qout.%x.%j
+#------------------------------------------------------------------------#
+# Strong/weak scaling study of alltoallw in a single job allocation.
+#
+# For each node count of 1, 2, 4, ... up to the number of nodes allocated,
+# runs alltoallw in sweep mode over the receive amounts SIZES and the
+# receiver ratios RATIOS, and appends the results as JSON lines to OUT_FILE.
+#
+#   MODE=strong  the receive amount per iteration is fixed, so the message
+#                size shrinks when the number of processes grows
+#   MODE=weak    the receive amount per iteration grows proportionally to
+#                the number of nodes, so the message size is fixed
+#
+# Example:
+#   % MODE=weak SIZES=1m,8m RATIOS=32,128 sbatch sbatch_scaling.sh
+#------------------------------------------------------------------------#
+cd $PWD
+
+if test "x$SLURM_NTASKS_PER_NODE" = x ; then
+   SLURM_NTASKS_PER_NODE=128
+fi
+
+MODE=${MODE:-strong}
+SIZES=${SIZES:-1m,2m,4m,8m}
+RATIOS=${RATIOS:-32,128}
+NTIMES=${NTIMES:-253}
+OUT_FILE=${OUT_FILE:-alltoallw_${MODE}_${SLURM_JOB_ID}.json}
+
+export FI_MR_CACHE_MONITOR=kdreg2
+export FI_CXI_RX_MATCH_MODE=software
+export MPICH_OFI_NIC_POLICY=NUMA
+
+echo "------------------------------------------------------"
+echo "---- Running on Perlmutter CPU nodes ----"
+echo "---- SLURM_JOB_NAME          = $SLURM_JOB_NAME"
+echo "---- SLURM_JOB_NUM_NODES     = $SLURM_JOB_NUM_NODES"
+echo "---- SLURM_NTASKS_PER_NODE   = $SLURM_NTASKS_PER_NODE"
+echo "---- SLURM_JOB_ID            = $SLURM_JOB_ID"
+echo "---- MODE                    = $MODE"
+echo "---- SIZES                   = $SIZES"
+echo "---- RATIOS                  = $RATIOS"
+echo "---- OUT_FILE                = $OUT_FILE"
+echo "------------------------------------------------------"
+echo ""
+
+# For fast executable loading on Cori and Perlmutter
+EXE_FILE=alltoallw
+EXE=/tmp/${USER}_${EXE_FILE}
+sbcast ${EXE_FILE} ${EXE}
+
+# convert a size with optional suffix k, m, or g into bytes
+to_bytes() {
+   case $1 in
+      *[kK]) echo $(( ${1%?} * 1024 )) ;;
+      *[mM]) echo $(( ${1%?} * 1024 * 1024 )) ;;
+      *[gG]) echo $(( ${1%?} * 1024 * 1024 * 1024 )) ;;
+      *)     echo $1 ;;
+   esac
+}
+
+NODES=1
+while test $NODES -le $SLURM_JOB_NUM_NODES ; do
+   NP=$(($NODES * $SLURM_NTASKS_PER_NODE))
+
+   # in weak scaling, SIZES are the receive amounts of a single node
+   LIST=$SIZES
+   if test "x$MODE" = xweak ; then
+      LIST=
+      for size in ${SIZES//,/ } ; do
+         LIST="${LIST:+$LIST,}$(( $(to_bytes $size) * $NODES ))"
+      done
+   fi
+
+   date
+   echo "---- nodes $NODES, processes $NP -----------------------------------"
+   echo ""
+
+   CMD_OPTS="-n $NTIMES -L $LIST -R $RATIOS -t -o $OUT_FILE"
+
+   CMD="srun -N $NODES -n $NP ${EXE} $CMD_OPTS"
+   echo "CMD=$CMD"
+   $CMD
+
+   echo ""
+   echo "====================================================================="
+
+   NODES=$(($NODES * 2))
+done
+
+date
@@ -13,6 +13,14 @@ for f in ${check_PROGRAMS} ; do
     if test "$f" = "alltomany" ; then
        OPTS=
     fi
+    if test "$f" = "trace_convert" ; then
+       # convert the provided trace into the version 2 format
+       gunzip -c trace_1024p_253n.dat.gz > trace_test_v1.dat
+       OPTS="trace_test_v1.dat trace_test_v2.dat"
+    fi
+    if test "$f" = "trace_alltomany" ; then
+       OPTS="-N 1 trace_test_v2.dat"
+    fi
     CMD="${MPIRUN} ./$f ${OPTS}"
     echo "==========================================================="
     echo "    Parallel testing on 4 MPI processes"
@@ -23,4 +31,22 @@ for f in ${check_PROGRAMS} ; do
     echo "==========================================================="
 done
 
+# capture the communication of alltomany and replay it
+CMD="${MPIRUN} env LD_PRELOAD=./libtrace_capture.so TRACE_CAPTURE_WAITALL=1 TRACE_CAPTURE_FILE=trace_test_capture.dat ./alltomany -n 5"
+echo "==========================================================="
+echo "    $CMD"
+echo ""
+${CMD}
+CMD="${MPIRUN} ./trace_alltomany -N 1 trace_test_capture.dat"
+echo ""
+echo "    $CMD"
+echo ""
+${CMD}
+# replay the 4-process trace on 2 processes
+CMD="mpiexec ${MPIRUN_OPTS} -n 2 ./trace_alltomany -N 1 -m fold trace_test_capture.dat"
+echo ""
+echo "    $CMD"
+echo ""
+${CMD}
+echo "==========================================================="
 
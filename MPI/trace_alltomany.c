@@ -4,20 +4,66 @@
  * See COPYRIGHT notice in top-level directory.
  *
  * Evaluate performane of all-to-many personalized communication implemented
- * with MPI_Alltoallw() and MPI_Issend()/MPI_Irecv(). The communication pattern
- * uses a trace from one of PnetCDF's benchmark programs, WRF-IO, running the
- * following commands on 8 CPU nodes, 128 MPI processes each.
+ * with MPI_Issend()/MPI_Irecv(), MPI_Alltoallw(), MPI_Alltoallv(),
+ * MPI_Neighbor_alltoallv(), and the MPI-4 persistent collectives
+ * MPI_Alltoallw_init() and MPI_Neighbor_alltoallv_init(). The communication
+ * pattern uses a trace from one of PnetCDF's benchmark programs, WRF-IO,
+ * running the following commands on 8 CPU nodes, 128 MPI processes each.
  *    srun -n 1024 wrf_io -l 5200 -w 7600 output.nc
  * It also used Lustre striping count 8, striping size 8 MB, MPI-IO hints of
  * cb_nodes 32 and cb_buffer_size 16 MB.
  *
  * To compile:
- *   % mpicc -O2 trace_alltomany.c -o trace_alltomany
+ *   % mpicc -O2 -I.. trace_alltomany.c trace_util.c ../bench_util.c -o trace_alltomany -lm
+ * To read compressed trace files, add -DHAVE_ZLIB and -lz.
  *
- * Usage: this program requires an input file as the argument.
+ * Usage: trace_alltomany [-W num] [-N num] [-o file] [-e list] [-m mode]
+ *                        trace_file
+ *        [-W num] number of untimed warmup runs (default: 0)
+ *        [-N num] number of timed repetitions (default: 3)
+ *        [-o file] append results as a line of JSON to file
+ *        [-e list] comma-separated list of engines to run, from issend,
+ *                  alltoallw, alltoallv, neighbor, alltoallw_init, and
+ *                  neighbor_init (default: all supported by the MPI library)
+ *        [-m mode] how to map the traced processes onto the processes of the
+ *                  replay, 'truncate', 'fold', or 'expand' (default:
+ *                  truncate, see below)
+ *
+ *        The arguments of all collective calls are built from the trace once
+ *        before the timed runs. Engines 'neighbor' and 'neighbor_init' use a
+ *        distributed graph communicator created by
+ *        MPI_Dist_graph_create_adjacent(), whose sources and destinations are
+ *        the union of the peers of all iterations. The persistent requests of
+ *        engines 'alltoallw_init' and 'neighbor_init' are created once, before
+ *        the first run, and the setup time is reported separately. They are
+ *        available only when the MPI library supports MPI standard 4.0.
+ *
+ *        This program requires an input file as the argument, in either
+ *        trace file format described in trace_util.h. The numbers of
+ *        processes and iterations are read from the file, and each process
+ *        reads only its own block, using MPI_File_read_at_all().
  *        A trace file 'trace_1024p_253n.dat.gz' is provided. Run command
- *        'gunzip trace_1024p_253n.dat.gz' before using it.
- *        This program can run with 1024 or less number of MPI processes.
+ *        'gunzip trace_1024p_253n.dat.gz' before using it, and optionally
+ *        convert it into the indexed and compressed version 2 format by
+ *        program trace_convert.
+ *
+ *        The number of MPI processes of a replay can differ from that of the
+ *        trace, e.g. 1024. Let P be the number of traced processes and M the
+ *        number of MPI processes running this program.
+ *        * 'truncate' requires M <= P. Process i replays traced process i,
+ *          and messages from and to traced processes >= M are dropped.
+ *        * 'fold' requires M <= P. Traced processes are block-mapped, traced
+ *          process t onto process t*M/P, and all messages of the traced
+ *          processes mapped onto the same process are merged, so the total
+ *          amount of the trace is kept. Messages between traced processes
+ *          mapped onto the same process become messages to self.
+ *        * 'expand' requires M to be a multiple of P. The trace is replayed
+ *          by M/P groups of P consecutive processes, each group replaying the
+ *          whole trace. The amount per receiver, and per compute node when
+ *          running the same number of processes per node, is kept, and the
+ *          total amount grows M/P times.
+ *        The amounts of the trace and of the replay are reported, as well as
+ *        the percentage of the traced amount dropped in mode 'truncate'.
  *
  * Example run command and output on screen:
  *   % mpiexec -n 1024 ./trace_alltomany
@@ -51,27 +97,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <assert.h>
-
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <fcntl.h>
+#include <limits.h>
 #include <unistd.h>
-#include <errno.h>
 
 #include <mpi.h>
 
-#define NTIMES 253
-#define NPROCS 1024
+#include "bench_util.h"
+#include "trace_util.h"
 
-#define ERR \
-    if (err != MPI_SUCCESS) { \
-        int errorStringLen; \
-        char errorString[MPI_MAX_ERROR_STRING]; \
-        MPI_Error_string(err, errorString, &errorStringLen); \
-        printf("Error at line %d: %s\n",__LINE__,errorString); \
-        goto err_out; \
-    }
+#define NREPS  3
 
 typedef struct {
     int nprocs;  /* number of peers with non-zero amount */
@@ -79,116 +113,277 @@ typedef struct {
     int *amnts;  /* amounts of peers with non-zero amount */
 } trace;
 
-/* all-to-many personalized communication by calling MPI_Alltoallw() */
-void run_alltoallw(int     ntimes,
-                   trace  *sender,
-                   trace  *recver,
-                   char  **sendBuf,
-                   char  **recvBuf)
-{
-    int i, j, err, nprocs, rank, bucket_len;
-    int *sendCounts, *recvCounts, *sendDisps, *recvDisps;
-    MPI_Datatype *sendTypes, *recvTypes;
-    MPI_Offset amnt, sum_amnt;
-    double start_t, end_t, timing[10], maxt[10];
+/* modes of mapping the traced processes onto the processes of the replay */
+#define REMAP_TRUNCATE 0
+#define REMAP_FOLD     1
+#define REMAP_EXPAND   2
+#define NREMAPS        3
 
-    for (i=0; i<10; i++) timing[i]=0;
-    bucket_len = ntimes / 10;
-    if (ntimes % 10) bucket_len++;
+/* names used in command-line option -m */
+static const char *remap_names[NREMAPS] = {"truncate", "fold", "expand"};
 
-    MPI_Barrier(MPI_COMM_WORLD);
-    timing[0] = MPI_Wtime();
+/* a peer and its amount, used when merging the lists of traced processes */
+typedef struct {
+    int       peer;
+    long long amnt;
+} peer_amnt;
+
+/* communication engines */
+#define ENGINE_ISSEND         0
+#define ENGINE_ALLTOALLW      1
+#define ENGINE_ALLTOALLV      2
+#define ENGINE_NEIGHBOR       3
+#define ENGINE_ALLTOALLW_INIT 4
+#define ENGINE_NEIGHBOR_INIT  5
+#define NENGINES              6
+
+/* names used in command-line option -e */
+static const char *engine_names[NENGINES] = {"issend", "alltoallw",
+    "alltoallv", "neighbor", "alltoallw_init", "neighbor_init"};
+
+/* names used when reporting */
+static const char *engine_labels[NENGINES] = {"MPI_Issend/Irecv",
+    "MPI_alltoallw", "MPI_Alltoallv", "MPI_Neighbor_alltoallv",
+    "MPI_Alltoallw_init", "MPI_Neighbor_alltoallv_init"};
+
+/* Arguments of the collective calls of all iterations, built from the trace
+ * once before the timed runs, so the timings include communication only.
+ */
+typedef struct {
+    int           ntimes;
+    int           nprocs;
+    int          *sendCounts;    /* [ntimes][nprocs] */
+    int          *sendDisps;     /* [ntimes][nprocs] */
+    int          *recvCounts;    /* [ntimes][nprocs] */
+    int          *recvDisps;     /* [ntimes][nprocs] */
+    MPI_Datatype *types;         /* [nprocs] all MPI_BYTE */
+    MPI_Comm      graph_comm;    /* union of peers of all iterations */
+    int           indegree;      /* number of peers sending to this rank */
+    int           outdegree;     /* number of peers this rank sends to */
+    int          *nbrSendCounts; /* [ntimes][outdegree] */
+    int          *nbrSendDisps;  /* [ntimes][outdegree] */
+    int          *nbrRecvCounts; /* [ntimes][indegree] */
+    int          *nbrRecvDisps;  /* [ntimes][indegree] */
+    MPI_Offset    amnt;          /* amount received in all iterations */
+} pattern;
+
+/*----< build_pattern() >----------------------------------------------------*/
+/* Collective call. Build the arguments of all collective engines from the
+ * trace, including a distributed graph communicator whose sources and
+ * destinations are the union of the peers of all iterations.
+ */
+static int
+build_pattern(int      ntimes,
+              trace   *sender,
+              trace   *recver,
+              pattern *pat)
+{
+    int i, j, k, err, nerrs=0, nprocs, disp, peer, *sources, *dests, *weights;
+    int *src_idx, *dst_idx;
+    size_t len;
 
     MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    sendTypes = (MPI_Datatype*) malloc(sizeof(MPI_Datatype) * nprocs * 2);
-    recvTypes = sendTypes + nprocs;
-    for (i=0; i<nprocs * 2; i++) sendTypes[i] = MPI_BYTE;
+    memset(pat, 0, sizeof(pattern));
+    pat->ntimes     = ntimes;
+    pat->nprocs     = nprocs;
+    pat->graph_comm = MPI_COMM_NULL;
 
-    sendCounts = (int*) malloc(sizeof(int) * nprocs * 4);
-    recvCounts = sendCounts + nprocs;
-    sendDisps  = recvCounts + nprocs;
-    recvDisps  = sendDisps  + nprocs;
+    pat->types = (MPI_Datatype*) malloc(sizeof(MPI_Datatype) * nprocs);
+    for (i=0; i<nprocs; i++) pat->types[i] = MPI_BYTE;
+
+    len = (size_t)ntimes * nprocs;
+    pat->sendCounts = (int*) calloc(len * 4, sizeof(int));
+    pat->sendDisps  = pat->sendCounts + len;
+    pat->recvCounts = pat->sendDisps  + len;
+    pat->recvDisps  = pat->recvCounts + len;
+
+    /* mark peers of all iterations */
+    src_idx = (int*) malloc(sizeof(int) * nprocs * 2);
+    dst_idx = src_idx + nprocs;
+    for (i=0; i<nprocs*2; i++) src_idx[i] = -1;
 
-    start_t = MPI_Wtime();
-    amnt = 0;
     for (j=0; j<ntimes; j++) {
-        int disp, peer;
-        /* set up sendcounts and sdispls arguments of MPI_Alltoallw() */
-        for (i=0; i<nprocs*4; i++)
-            sendCounts[i] = 0;
+        int *sendCounts = pat->sendCounts + (size_t)j * nprocs;
+        int *sendDisps  = pat->sendDisps  + (size_t)j * nprocs;
+        int *recvCounts = pat->recvCounts + (size_t)j * nprocs;
+        int *recvDisps  = pat->recvDisps  + (size_t)j * nprocs;
 
         disp = 0;
         for (i=0; i<sender[j].nprocs; i++) {
             peer = sender[j].ranks[i];
-            if (peer >= nprocs) continue;
             sendCounts[peer] = sender[j].amnts[i];
             sendDisps[peer] = disp;
             disp += sendCounts[peer];
+            dst_idx[peer] = 0;
         }
         disp = 0;
         for (i=0; i<recver[j].nprocs; i++) {
             peer = recver[j].ranks[i];
-            if (peer >= nprocs) continue;
             recvCounts[peer] = recver[j].amnts[i];
             recvDisps[peer] = disp;
             disp += recvCounts[peer];
+            src_idx[peer] = 0;
         }
-        amnt += disp;
+        pat->amnt += disp;
+    }
 
-        err = MPI_Alltoallw(sendBuf[j], sendCounts, sendDisps, sendTypes,
-                            recvBuf[j], recvCounts, recvDisps, recvTypes,
-                            MPI_COMM_WORLD); ERR
+    /* neighbors are in increasing order of ranks. Weights of 1 are passed
+     * instead of MPI_UNWEIGHTED, which gcc warns of reading as an array of
+     * size 0 (-Wstringop-overread).
+     */
+    sources = (int*) malloc(sizeof(int) * nprocs * 3);
+    dests   = sources + nprocs;
+    weights = dests + nprocs;
+    for (i=0; i<nprocs; i++) weights[i] = 1;
+    for (i=0; i<nprocs; i++) {
+        if (src_idx[i] == 0) {
+            src_idx[i] = pat->indegree;
+            sources[pat->indegree++] = i;
+        }
+        if (dst_idx[i] == 0) {
+            dst_idx[i] = pat->outdegree;
+            dests[pat->outdegree++] = i;
+        }
+    }
 
-        /* record timing */
-        if (j > 0 && j % bucket_len == 0) {
-            end_t = MPI_Wtime();
-            timing[j / bucket_len] = end_t - start_t;
-            start_t = end_t;
+    err = MPI_Dist_graph_create_adjacent(MPI_COMM_WORLD,
+                                         pat->indegree, sources, weights,
+                                         pat->outdegree, dests, weights,
+                                         MPI_INFO_NULL, 0, &pat->graph_comm);
+    ERR
+
+    /* counts and displacements of neighborhood collectives */
+    len = (size_t)ntimes * pat->outdegree;
+    pat->nbrSendCounts = (int*) malloc(sizeof(int) * (len * 2 + 1));
+    pat->nbrSendDisps  = pat->nbrSendCounts + len;
+    len = (size_t)ntimes * pat->indegree;
+    pat->nbrRecvCounts = (int*) malloc(sizeof(int) * (len * 2 + 1));
+    pat->nbrRecvDisps  = pat->nbrRecvCounts + len;
+
+    for (j=0; j<ntimes; j++) {
+        size_t full = (size_t)j * nprocs;
+        size_t out  = (size_t)j * pat->outdegree;
+        size_t in   = (size_t)j * pat->indegree;
+
+        for (k=0; k<pat->outdegree; k++) {
+            pat->nbrSendCounts[out + k] = pat->sendCounts[full + dests[k]];
+            pat->nbrSendDisps[out + k]  = pat->sendDisps[full + dests[k]];
+        }
+        for (k=0; k<pat->indegree; k++) {
+            pat->nbrRecvCounts[in + k] = pat->recvCounts[full + sources[k]];
+            pat->nbrRecvDisps[in + k]  = pat->recvDisps[full + sources[k]];
         }
     }
-    end_t = MPI_Wtime();
-    timing[9] = end_t - start_t;
-    timing[0] = end_t - timing[0]; /* end-to-end time */
 
 err_out:
-    free(sendTypes);
-    free(sendCounts);
+    free(sources);
+    free(src_idx);
+    return nerrs;
+}
 
-    MPI_Reduce(&timing, &maxt, 10, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
-    MPI_Reduce(&amnt, &sum_amnt, 1, MPI_OFFSET, MPI_SUM, 0, MPI_COMM_WORLD);
-    if (rank == 0) {
-        printf("Comm amount using MPI_alltoallw    = %.2f MB\n",
-               (float)sum_amnt/1048576.0);
-        printf("Time for using MPI_alltoallw       = %.2f sec\n", maxt[0]);
-        for (i=1; i<10; i++)
-            printf("\tTime bucket[%d] = %.2f sec\n", i, maxt[i]);
-        fflush(stdout);
+/*----< free_pattern() >-----------------------------------------------------*/
+static void
+free_pattern(pattern *pat)
+{
+    if (pat->graph_comm != MPI_COMM_NULL) MPI_Comm_free(&pat->graph_comm);
+    if (pat->nbrSendCounts != NULL) free(pat->nbrSendCounts);
+    if (pat->nbrRecvCounts != NULL) free(pat->nbrRecvCounts);
+    if (pat->sendCounts != NULL) free(pat->sendCounts);
+    if (pat->types != NULL) free(pat->types);
+}
+
+/*----< init_persistent() >--------------------------------------------------*/
+/* Collective call. Create *reqs, a persistent collective request for each
+ * iteration of engine ENGINE_ALLTOALLW_INIT or ENGINE_NEIGHBOR_INIT. The
+ * requests are created once and started in all runs. Persistent collectives
+ * are available in MPI standard 4.0 and later.
+ */
+static int
+init_persistent(int           engine,
+                char        **sendBuf,
+                char        **recvBuf,
+                pattern      *pat,
+                MPI_Request **reqs)
+{
+    int j, nerrs=0;
+
+    *reqs = (MPI_Request*) malloc(sizeof(MPI_Request) * pat->ntimes);
+    for (j=0; j<pat->ntimes; j++) (*reqs)[j] = MPI_REQUEST_NULL;
+
+#if MPI_VERSION >= 4
+    for (j=0; j<pat->ntimes; j++) {
+        int err;
+        size_t full, out, in;
+        full = (size_t)j * pat->nprocs;
+        out  = (size_t)j * pat->outdegree;
+        in   = (size_t)j * pat->indegree;
+        if (engine == ENGINE_ALLTOALLW_INIT)
+            err = MPI_Alltoallw_init(sendBuf[j], pat->sendCounts + full,
+                                     pat->sendDisps + full, pat->types,
+                                     recvBuf[j], pat->recvCounts + full,
+                                     pat->recvDisps + full, pat->types,
+                                     MPI_COMM_WORLD, MPI_INFO_NULL,
+                                     &(*reqs)[j]);
+        else
+            err = MPI_Neighbor_alltoallv_init(sendBuf[j],
+                                     pat->nbrSendCounts + out,
+                                     pat->nbrSendDisps + out, MPI_BYTE,
+                                     recvBuf[j], pat->nbrRecvCounts + in,
+                                     pat->nbrRecvDisps + in, MPI_BYTE,
+                                     pat->graph_comm, MPI_INFO_NULL,
+                                     &(*reqs)[j]);
+        ERR
     }
+err_out:
+#else
+    (void)engine; (void)sendBuf; (void)recvBuf; /* unused before MPI 4.0 */
+#endif
+    return nerrs;
+}
+
+/*----< free_persistent() >--------------------------------------------------*/
+static void
+free_persistent(int           ntimes,
+                MPI_Request **reqs)
+{
+    int j;
+
+    if (*reqs == NULL) return;
+    for (j=0; j<ntimes; j++)
+        if ((*reqs)[j] != MPI_REQUEST_NULL) MPI_Request_free(&(*reqs)[j]);
+    free(*reqs);
+    *reqs = NULL;
 }
 
-/* all-to-many personalized communication by calling MPI_Issend/Irecv() */
-void run_async_send_recv(int    ntimes,
-                         trace  *sender,
-                         trace  *recver,
-                         char  **sendBuf,
-                         char  **recvBuf)
+/*----< run_engine() >-------------------------------------------------------*/
+/* All-to-many personalized communication of all iterations using engine.
+ * preqs[ntimes] are the persistent requests of a persistent engine.
+ */
+static int
+run_engine(int           engine,
+           int           ntimes,
+           trace        *sender,
+           trace        *recver,
+           char        **sendBuf,
+           char        **recvBuf,
+           pattern      *pat,
+           MPI_Request  *preqs,
+           bench_timer  *timer,
+           bench_record *rec)
 {
     char *sendPtr, *recvPtr;
-    int i, j, err, nprocs, rank, nreqs, bucket_len;
+    int i, j, err, nerrs=0, nprocs, rank, nreqs, bucket_len;
+    size_t full, out, in;
     MPI_Request *reqs;
     MPI_Status *st;
-    MPI_Offset amnt, sum_amnt;
+    MPI_Offset sum_amnt;
     double start_t, end_t, timing[10], maxt[10];
 
     for (i=0; i<10; i++) timing[i]=0;
     bucket_len = ntimes / 10;
     if (ntimes % 10) bucket_len++;
 
-    MPI_Barrier(MPI_COMM_WORLD);
-    timing[0] = MPI_Wtime();
-
     MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
@@ -196,35 +391,70 @@ void run_async_send_recv(int    ntimes,
     reqs = (MPI_Request*) malloc(sizeof(MPI_Request) * 2 * nprocs);
     st = (MPI_Status*) malloc(sizeof(MPI_Status) * 2 * nprocs);
 
+    MPI_Barrier(MPI_COMM_WORLD);
+    bench_timer_start(timer);
+    timing[0] = MPI_Wtime();
+
     start_t = MPI_Wtime();
-    amnt = 0;
     for (j=0; j<ntimes; j++) {
-        nreqs = 0;
-
-        /* receivers */
-        recvPtr = recvBuf[j];
-        for (i=0; i<recver[j].nprocs; i++) {
-            if (recver[j].ranks[i] >= nprocs) continue;
-            err = MPI_Irecv(recvPtr, recver[j].amnts[i], MPI_BYTE,
-                            recver[j].ranks[i], 0, MPI_COMM_WORLD,
-                            &reqs[nreqs++]);
-            ERR
-            recvPtr += recver[j].amnts[i];
-            amnt += recver[j].amnts[i];
+        full = (size_t)j * nprocs;
+        out  = (size_t)j * pat->outdegree;
+        in   = (size_t)j * pat->indegree;
+
+        switch (engine) {
+            case ENGINE_ISSEND:
+                nreqs = 0;
+
+                /* receivers */
+                recvPtr = recvBuf[j];
+                for (i=0; i<recver[j].nprocs; i++) {
+                    err = MPI_Irecv(recvPtr, recver[j].amnts[i], MPI_BYTE,
+                                    recver[j].ranks[i], 0, MPI_COMM_WORLD,
+                                    &reqs[nreqs++]);
+                    ERR
+                    recvPtr += recver[j].amnts[i];
+                }
+                /* senders */
+                sendPtr = sendBuf[j];
+                for (i=0; i<sender[j].nprocs; i++) {
+                    err = MPI_Issend(sendPtr, sender[j].amnts[i], MPI_BYTE,
+                                     sender[j].ranks[i], 0, MPI_COMM_WORLD,
+                                     &reqs[nreqs++]);
+                    ERR
+                    sendPtr += sender[j].amnts[i];
+                }
+
+                err = MPI_Waitall(nreqs, reqs, st); ERR
+                break;
+            case ENGINE_ALLTOALLW:
+                err = MPI_Alltoallw(sendBuf[j], pat->sendCounts + full,
+                                    pat->sendDisps + full, pat->types,
+                                    recvBuf[j], pat->recvCounts + full,
+                                    pat->recvDisps + full, pat->types,
+                                    MPI_COMM_WORLD); ERR
+                break;
+            case ENGINE_ALLTOALLV:
+                err = MPI_Alltoallv(sendBuf[j], pat->sendCounts + full,
+                                    pat->sendDisps + full, MPI_BYTE,
+                                    recvBuf[j], pat->recvCounts + full,
+                                    pat->recvDisps + full, MPI_BYTE,
+                                    MPI_COMM_WORLD); ERR
+                break;
+            case ENGINE_NEIGHBOR:
+                err = MPI_Neighbor_alltoallv(sendBuf[j],
+                                    pat->nbrSendCounts + out,
+                                    pat->nbrSendDisps + out, MPI_BYTE,
+                                    recvBuf[j], pat->nbrRecvCounts + in,
+                                    pat->nbrRecvDisps + in, MPI_BYTE,
+                                    pat->graph_comm); ERR
+                break;
+            default: /* persistent collectives */
+                err = MPI_Start(&preqs[j]); ERR
+                err = MPI_Wait(&preqs[j], MPI_STATUS_IGNORE); ERR
+                break;
         }
-        /* senders */
-        sendPtr = sendBuf[j];
-        for (i=0; i<sender[j].nprocs; i++) {
-            if (sender[j].ranks[i] >= nprocs) continue;
-            err = MPI_Issend(sendPtr, sender[j].amnts[i], MPI_BYTE,
-                             sender[j].ranks[i], 0, MPI_COMM_WORLD,
-                             &reqs[nreqs++]);
-            ERR
-            sendPtr += sender[j].amnts[i];
-        }
-
-        err = MPI_Waitall(nreqs, reqs, st); ERR
 
+        /* record timing */
         if (j > 0 && j % bucket_len == 0) {
             end_t = MPI_Wtime();
             timing[j / bucket_len] = end_t - start_t;
@@ -234,119 +464,425 @@ void run_async_send_recv(int    ntimes,
     end_t = MPI_Wtime();
     timing[9] = end_t - start_t;
     timing[0] = end_t - timing[0]; /* end-to-end time */
+    bench_timer_stop(timer);
 
 err_out:
     free(st);
     free(reqs);
 
-    MPI_Reduce(&timing, &maxt, 10, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
-    MPI_Reduce(&amnt, &sum_amnt, 1, MPI_OFFSET, MPI_SUM, 0, MPI_COMM_WORLD);
+    bench_max_timings(timing, maxt, 10, MPI_COMM_WORLD);
+    bench_record_buckets(rec, timer, maxt, 10);
+    MPI_Reduce(&pat->amnt, &sum_amnt, 1, MPI_OFFSET, MPI_SUM, 0,
+               MPI_COMM_WORLD);
     if (rank == 0) {
-        printf("Comm amount using MPI_Issend/Irecv = %.2f MB\n",
+        /* align '=' of engines with short names */
+        const char *label = engine_labels[engine];
+        int pad = 17 - (int)strlen(label);
+        if (pad < 1) pad = 1;
+        printf("Comm amount using %s%*s= %.2f MB\n", label, pad, "",
                (float)sum_amnt/1048576.0);
-        printf("Time for using MPI_Issend/Irecv    = %.2f sec\n", maxt[0]);
+        printf("Time for using %s%*s= %.2f sec\n", label, pad + 3, "",
+               maxt[0]);
         for (i=1; i<10; i++)
             printf("\tTime bucket[%d] = %.2f sec\n", i, maxt[i]);
         fflush(stdout);
     }
+    return nerrs;
+}
+
+/*----< parse_engines() >----------------------------------------------------*/
+/* set use[e] to 1 for engine e in the comma-separated list of engine names.
+ * Return the number of unrecognized names.
+ */
+static int
+parse_engines(const char *list,
+              int        *use,
+              int         rank)
+{
+    int e, nerrs=0;
+    char *str, *name;
+
+    for (e=0; e<NENGINES; e++) use[e] = 0;
+
+    str = strdup(list);
+    for (name=strtok(str, ","); name!=NULL; name=strtok(NULL, ",")) {
+        for (e=0; e<NENGINES; e++)
+            if (strcmp(name, engine_names[e]) == 0) break;
+        if (e < NENGINES)
+            use[e] = 1;
+        else {
+            if (rank == 0) printf("Error: unknown engine '%s'\n", name);
+            nerrs++;
+        }
+    }
+    free(str);
+    return nerrs;
+}
+
+/*----< parse_block() >------------------------------------------------------*/
+/* Set the send and receive lists of all iterations of a trace block in
+ * sender[ntimes] and recver[ntimes], which point into the block.
+ */
+static void
+parse_block(int    ntimes,
+            int   *block,
+            trace *sender,
+            trace *recver)
+{
+    int i, *nonzero_nprocs, *ptr=block;
+
+    /* populate sender communication pattern */
+    nonzero_nprocs = ptr;
+    ptr += ntimes;
+    for (i=0; i<ntimes; i++) {
+        sender[i].nprocs = nonzero_nprocs[i];
+        sender[i].ranks  = ptr;
+        ptr += nonzero_nprocs[i];
+        sender[i].amnts  = ptr;
+        ptr += nonzero_nprocs[i];
+    }
+
+    /* populate receiver communication pattern */
+    nonzero_nprocs = ptr;
+    ptr += ntimes;
+    for (i=0; i<ntimes; i++) {
+        recver[i].nprocs = nonzero_nprocs[i];
+        recver[i].ranks  = ptr;
+        ptr += nonzero_nprocs[i];
+        recver[i].amnts  = ptr;
+        ptr += nonzero_nprocs[i];
+    }
+}
+
+/*----< read_blocks() >------------------------------------------------------*/
+/* Collective call. Read nblocks blocks starting from block first into
+ * (*blocks)[nblocks] and set the send and receive lists of their iterations
+ * in (*sender)[nblocks][ntimes] and (*recver)[nblocks][ntimes].
+ */
+static int
+read_blocks(trace_file   *tf,
+            int           first,
+            int           nblocks,
+            int        ***blocks,
+            trace       **sender,
+            trace       **recver)
+{
+    int b, nerrs, ntimes=tf->hdr.ntimes, *nints;
+
+    *blocks = (int**) calloc(nblocks + 1, sizeof(int*));
+    nints   = (int*) malloc(sizeof(int) * (nblocks + 1));
+    *sender = (trace*) malloc(sizeof(trace) * ((size_t)nblocks * ntimes + 1));
+    *recver = (trace*) malloc(sizeof(trace) * ((size_t)nblocks * ntimes + 1));
+
+    nerrs = trace_file_read(tf, first, nblocks, *blocks, nints);
+    if (nerrs == 0)
+        for (b=0; b<nblocks; b++)
+            parse_block(ntimes, (*blocks)[b], *sender + (size_t)b * ntimes,
+                        *recver + (size_t)b * ntimes);
+    free(nints);
+    return nerrs;
+}
+
+/*----< free_blocks() >------------------------------------------------------*/
+static void
+free_blocks(int     nblocks,
+            int   **blocks,
+            trace  *sender,
+            trace  *recver)
+{
+    int b;
+    for (b=0; b<nblocks; b++)
+        if (blocks[b] != NULL) free(blocks[b]);
+    free(blocks);
+    free(sender);
+    free(recver);
+}
+
+/*----< map_rank() >---------------------------------------------------------*/
+/* Return the rank of the process replaying traced process peer, a peer of a
+ * traced process hosted by this process, or -1 if it is not replayed.
+ */
+static int
+map_rank(int mode,
+         int peer,
+         int trace_nprocs,
+         int nprocs,
+         int rank)
+{
+    switch (mode) {
+        case REMAP_FOLD:
+            /* block mapping of trace_nprocs onto nprocs processes */
+            return (int)((long long)peer * nprocs / trace_nprocs);
+        case REMAP_EXPAND:
+            /* peer in the same replica of the trace as this process */
+            return peer + rank / trace_nprocs * trace_nprocs;
+        default:
+            return (peer < nprocs) ? peer : -1;
+    }
+}
+
+/*----< cmp_peer() >---------------------------------------------------------*/
+static int
+cmp_peer(const void *a, const void *b)
+{
+    int pa = ((const peer_amnt*)a)->peer;
+    int pb = ((const peer_amnt*)b)->peer;
+    return (pa > pb) - (pa < pb);
+}
+
+/*----< merge_lists() >------------------------------------------------------*/
+/* Merge the lists of nblocks traced processes hosted by this process,
+ * lists[nblocks][ntimes], into one list per iteration, out[ntimes], with
+ * peers mapped by map_rank(). The amounts of peers mapped to the same process
+ * are summed, so no traffic is lost. The merged lists point into *buf, which
+ * is allocated here. Return the number of errors.
+ */
+static int
+merge_lists(int          mode,
+            int          ntimes,
+            int          nblocks,
+            const trace *lists,
+            int          trace_nprocs,
+            trace       *out,
+            int        **buf)
+{
+    int i, j, b, n, k, nerrs=0, nprocs, rank, max_n=0;
+    size_t total=0, off=0;
+    peer_amnt *tmp;
+
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* the number of entries of all hosted lists is an upper bound */
+    for (j=0; j<ntimes; j++) {
+        n = 0;
+        for (b=0; b<nblocks; b++) n += lists[(size_t)b * ntimes + j].nprocs;
+        if (n > max_n) max_n = n;
+        total += n;
+    }
+    *buf = (int*) malloc(sizeof(int) * (total * 2 + 1));
+    tmp = (peer_amnt*) malloc(sizeof(peer_amnt) * (max_n + 1));
+
+    for (j=0; j<ntimes; j++) {
+        n = 0;
+        for (b=0; b<nblocks; b++) {
+            const trace *l = lists + (size_t)b * ntimes + j;
+            for (i=0; i<l->nprocs; i++) {
+                int peer = map_rank(mode, l->ranks[i], trace_nprocs, nprocs,
+                                    rank);
+                if (peer < 0) continue;
+                tmp[n].peer = peer;
+                tmp[n].amnt = l->amnts[i];
+                n++;
+            }
+        }
+
+        /* peers are in increasing order of ranks, with duplicates summed */
+        qsort(tmp, n, sizeof(peer_amnt), cmp_peer);
+        for (k=0, i=0; i<n; i++) {
+            if (k > 0 && tmp[k-1].peer == tmp[i].peer)
+                tmp[k-1].amnt += tmp[i].amnt;
+            else
+                tmp[k++] = tmp[i];
+        }
+
+        out[j].nprocs = k;
+        out[j].ranks  = *buf + off * 2;
+        out[j].amnts  = out[j].ranks + k;
+        for (i=0; i<k; i++) {
+            if (tmp[i].amnt > INT_MAX) {
+                printf("Error: rank %d iteration %d amount %lld to peer %d exceeds INT_MAX\n",
+                       rank, j, tmp[i].amnt, tmp[i].peer);
+                nerrs++;
+                break;
+            }
+            out[j].ranks[i] = tmp[i].peer;
+            out[j].amnts[i] = (int)tmp[i].amnt;
+        }
+        off += k;
+    }
+    free(tmp);
+    return nerrs;
 }
 
 /*----< main() >------------------------------------------------------------*/
 int main(int argc, char **argv) {
-    int i, j, fd, rank, nprocs, ntimes;
-    char **sendBuf, **recvBuf;
+    extern int optind;
+    extern char *optarg;
+    int i, j, e, rank, nprocs, ntimes, nerrs=0, nwarmup, nreps, mode;
+    int trace_nprocs, first, nblocks, **blocks, *send_ints, *recv_ints;
+    int use[NENGINES];
+    char **sendBuf, **recvBuf, *out_file=NULL, *engines=NULL;
+    double amnt, trace_amnt, setup_t;
+    bench_timer timers[NENGINES];
+    MPI_Request *preqs[NENGINES];
+    bench_record rec;
+    pattern pat;
+    trace_file tf;
+    trace *blk_send, *blk_recv;
 
     MPI_Init(&argc, &argv);
     MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    if (argc != 2) {
+    nwarmup = BENCH_NWARMUP;
+    nreps = NREPS;
+    mode = REMAP_TRUNCATE;
+
+    /* command-line arguments */
+    while ((i = getopt (argc, argv, "hW:N:o:e:m:")) != EOF)
+        switch (i) {
+            case 'W':
+                nwarmup = atoi(optarg);
+                break;
+            case 'N':
+                nreps = atoi(optarg);
+                break;
+            case 'o':
+                out_file = strdup(optarg);
+                break;
+            case 'e':
+                engines = strdup(optarg);
+                break;
+            case 'm':
+                for (mode=0; mode<NREMAPS; mode++)
+                    if (strcmp(optarg, remap_names[mode]) == 0) break;
+                if (mode == NREMAPS) {
+                    if (rank == 0) printf("Error: unknown mode '%s'\n", optarg);
+                    nerrs++;
+                    goto err_out;
+                }
+                break;
+            case 'h':
+            default:
+                if (rank == 0)
+                    printf("Usage: %s [-W num] [-N num] [-o file] [-e list] [-m mode] trace_file\n",
+                           argv[0]);
+                goto err_out;
+        }
+
+    /* by default, run all engines supported by the MPI library */
+    if (engines != NULL) {
+        if (parse_engines(engines, use, rank) > 0) {
+            nerrs++;
+            goto err_out;
+        }
+    }
+    else {
+        for (e=0; e<NENGINES; e++) use[e] = 1;
+#if MPI_VERSION < 4
+        use[ENGINE_ALLTOALLW_INIT] = use[ENGINE_NEIGHBOR_INIT] = 0;
+#endif
+    }
+#if MPI_VERSION < 4
+    if (use[ENGINE_ALLTOALLW_INIT] || use[ENGINE_NEIGHBOR_INIT]) {
+        if (rank == 0)
+            printf("Error: persistent collectives require MPI 4.0 or later\n");
+        nerrs++;
+        goto err_out;
+    }
+#endif
+
+    if (argv[optind] == NULL) {
         if (rank == 0) printf("Input trace file is required\n");
         goto err_out;
     }
 
-    if (nprocs > NPROCS) {
-        if (rank == 0) printf("Number of MPI processes must be <= %d\n",NPROCS);
+    nerrs += trace_file_open(MPI_COMM_WORLD, argv[optind], &tf);
+    if (nerrs > 0) goto err_out;
+
+    trace_nprocs = tf.hdr.nprocs;
+    ntimes = tf.hdr.ntimes;
+    if (mode == REMAP_EXPAND && nprocs % trace_nprocs != 0) {
+        if (rank == 0)
+            printf("Error: -m expand requires a multiple of %d processes\n",
+                   trace_nprocs);
+        trace_file_close(&tf);
+        nerrs++;
+        goto err_out;
+    }
+    if (mode != REMAP_EXPAND && nprocs > trace_nprocs) {
+        if (rank == 0)
+            printf("Error: number of MPI processes must be <= %d, or use -m expand\n",
+                   trace_nprocs);
+        trace_file_close(&tf);
+        nerrs++;
         goto err_out;
     }
 
-    ntimes = NTIMES;
     if (rank == 0) {
         printf("number of MPI processes         = %d\n", nprocs);
+        printf("number of traced MPI processes  = %d\n", trace_nprocs);
         printf("number of iterations            = %d\n", ntimes);
+        printf("trace file format version       = %d\n", tf.hdr.version);
+        printf("replay mode                     = %s\n", remap_names[mode]);
     }
 
-    if ((fd = open(argv[1], O_RDONLY, 0600)) == -1) {
-        printf("Error! open() failed %s (error: %s)\n",argv[1],strerror(errno));
-        goto err_out;
-    }
-
-    /* trace file was generated using 1024 MPI processes, running 253
-     * iterations. nprocs can be less than 1024
+    /* Blocks of traced processes mapped onto this process in fold mode. They
+     * are read in all modes to sum up the amount of the whole trace.
      */
-    /* read nprocs */
-    int in_nprocs;
-    read(fd, &in_nprocs, sizeof(int));
-    assert(in_nprocs == NPROCS);
-
-    /* read ntimes */
-    int in_ntimes;
-    read(fd, &in_ntimes, sizeof(int));
-    assert(in_ntimes == NTIMES);
-
-    /* read block_lens[NPROCS] */
-    int *block_lens = (int*) malloc(sizeof(int) * NPROCS);
-    read(fd, block_lens, sizeof(int) * NPROCS);
-
-    /* read block 'rank' */
-    int *file_block = (int*) malloc(sizeof(int) * block_lens[rank]);
-    off_t off=0;
-    for (i=0; i<rank; i++) off += block_lens[i];
-    off *= sizeof(int);
-    lseek(fd, off, SEEK_CUR);
-    read(fd, file_block, sizeof(int) * block_lens[rank]);
-
-    free(block_lens);
-
-    /* close input file */
-    close(fd);
-
-    /* allocate buffer for storing pairwise communication amounts */
-    trace *sender = (trace*) malloc(sizeof(trace) * NTIMES);
-    trace *recver = (trace*) malloc(sizeof(trace) * NTIMES);
-
-    int *nonzero_nprocs, *ptr=file_block;
-
-    /* populate sender communication pattern */
-    nonzero_nprocs = ptr;
-    ptr += NTIMES;
-    for (i=0; i<NTIMES; i++) {
-        sender[i].nprocs = nonzero_nprocs[i];
-        sender[i].ranks  = ptr;
-        ptr += nonzero_nprocs[i];
-        sender[i].amnts  = ptr;
-        ptr += nonzero_nprocs[i];
+    first = (int)(((long long)rank * trace_nprocs + nprocs - 1) / nprocs);
+    nblocks = (int)(((long long)(rank + 1) * trace_nprocs + nprocs - 1) /
+                    nprocs) - first;
+    nerrs += read_blocks(&tf, first, nblocks, &blocks, &blk_send, &blk_recv);
+    trace_amnt = 0;
+    if (nerrs == 0)
+        for (i=0; i<nblocks*ntimes; i++)
+            for (j=0; j<blk_send[i].nprocs; j++)
+                trace_amnt += blk_send[i].amnts[j];
+
+    /* in other modes, each process replays a single traced process */
+    if (mode != REMAP_FOLD) {
+        free_blocks(nblocks, blocks, blk_send, blk_recv);
+        first = (mode == REMAP_EXPAND) ? rank % trace_nprocs : rank;
+        nblocks = 1;
+        nerrs += read_blocks(&tf, first, nblocks, &blocks, &blk_send,
+                             &blk_recv);
     }
+    trace_file_close(&tf);
+    MPI_Allreduce(MPI_IN_PLACE, &nerrs, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    if (nerrs > 0) {
+        free_blocks(nblocks, blocks, blk_send, blk_recv);
+        goto err_out;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &trace_amnt, 1, MPI_DOUBLE, MPI_SUM,
+                  MPI_COMM_WORLD);
+
+    /* merge the lists of the hosted traced processes, with peers remapped */
+    trace *sender = (trace*) malloc(sizeof(trace) * ntimes);
+    trace *recver = (trace*) malloc(sizeof(trace) * ntimes);
+    nerrs += merge_lists(mode, ntimes, nblocks, blk_send, trace_nprocs,
+                         sender, &send_ints);
+    nerrs += merge_lists(mode, ntimes, nblocks, blk_recv, trace_nprocs,
+                         recver, &recv_ints);
+    free_blocks(nblocks, blocks, blk_send, blk_recv);
+    MPI_Allreduce(MPI_IN_PLACE, &nerrs, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    if (nerrs > 0) goto err_out;
+
+    /* total amount received by all processes in all iterations of a run */
+    amnt = 0;
+    for (i=0; i<ntimes; i++)
+        for (j=0; j<recver[i].nprocs; j++)
+            amnt += recver[i].amnts[j];
+    MPI_Allreduce(MPI_IN_PLACE, &amnt, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
 
-    /* populate receiver communication pattern */
-    nonzero_nprocs = ptr;
-    ptr += NTIMES;
-    for (i=0; i<NTIMES; i++) {
-        recver[i].nprocs = nonzero_nprocs[i];
-        recver[i].ranks  = ptr;
-        ptr += nonzero_nprocs[i];
-        recver[i].amnts  = ptr;
-        ptr += nonzero_nprocs[i];
+    if (rank == 0) {
+        printf("traced comm amount per run      = %.2f MB\n",
+               trace_amnt/1048576.0);
+        printf("replayed comm amount per run    = %.2f MB (%.2f%% of traced)\n",
+               amnt/1048576.0, (trace_amnt > 0) ? 100.0*amnt/trace_amnt : 0);
+        if (amnt < trace_amnt)
+            printf("Warning: %.2f%% of the traced amount is dropped, use -m fold to keep it\n",
+                   100.0*(trace_amnt-amnt)/trace_amnt);
+        fflush(stdout);
     }
 
     /* allocate send and receive message buffers */
     sendBuf = (char**) malloc(sizeof(char*) * ntimes);
     for (i=0; i<ntimes; i++) {
         size_t amnt=0;
-        for (j=0; j<sender[i].nprocs; j++) {
-            if (sender[i].ranks[j] >= nprocs) break;
+        for (j=0; j<sender[i].nprocs; j++)
             amnt += sender[i].amnts[j];
-        }
         sendBuf[i] = (amnt == 0) ? NULL : (char*) malloc(amnt);
         for (j=0; j<amnt; j++) sendBuf[i][j] = (rank+j)%128;
     }
@@ -356,26 +892,77 @@ int main(int argc, char **argv) {
     size_t recv_amnt = 0;
     for (i=0; i<ntimes; i++) {
         size_t amnt=0;
-        for (j=0; j<recver[i].nprocs; j++) {
-            if (recver[i].ranks[j] >= nprocs) break;
+        for (j=0; j<recver[i].nprocs; j++)
             amnt += recver[i].amnts[j];
-        }
         if (amnt > recv_amnt) recv_amnt = amnt;
     }
     recvBuf[0] = (recv_amnt == 0) ? NULL : (char*) malloc(recv_amnt);
     for (i=1; i<ntimes; i++) recvBuf[i] = recvBuf[0];
 
-    for (i=0; i<3; i++) {
+    bench_record_init(&rec, MPI_COMM_WORLD, "trace_alltomany");
+    bench_record_str(&rec, "trace_file", argv[optind]);
+    bench_record_int(&rec, "ntimes", ntimes);
+    bench_record_int(&rec, "trace_nprocs", trace_nprocs);
+    bench_record_int(&rec, "trace_version", tf.hdr.version);
+    bench_record_str(&rec, "replay_mode", remap_names[mode]);
+    bench_record_double(&rec, "trace_bytes", trace_amnt);
+    bench_record_double(&rec, "effective_bytes", amnt);
+
+    /* build arguments of collective calls of all iterations */
+    nerrs += build_pattern(ntimes, sender, recver, &pat);
+    if (nerrs > 0) goto err_out;
+    if (rank == 0 && use[ENGINE_NEIGHBOR] + use[ENGINE_NEIGHBOR_INIT] > 0) {
+        printf("graph communicator degrees of rank 0 = in %d, out %d\n",
+               pat.indegree, pat.outdegree);
+        fflush(stdout);
+    }
+
+    for (e=0; e<NENGINES; e++)
+        bench_timer_init(&timers[e], engine_labels[e], nwarmup, nreps);
 
-        /* perform all-to-many communication */
-        MPI_Barrier(MPI_COMM_WORLD);
-        run_async_send_recv(ntimes, sender, recver, sendBuf, recvBuf);
+    /* create persistent requests once, reused by all runs */
+    for (e=0; e<NENGINES; e++) {
+        preqs[e] = NULL;
+        if (!use[e]) continue;
+        if (e != ENGINE_ALLTOALLW_INIT && e != ENGINE_NEIGHBOR_INIT) continue;
 
-        /* perform all-to-many communication */
         MPI_Barrier(MPI_COMM_WORLD);
-        run_alltoallw(ntimes, sender, recver, sendBuf, recvBuf);
+        setup_t = MPI_Wtime();
+        nerrs += init_persistent(e, sendBuf, recvBuf, &pat, &preqs[e]);
+        setup_t = MPI_Wtime() - setup_t;
+        MPI_Allreduce(MPI_IN_PLACE, &setup_t, 1, MPI_DOUBLE, MPI_MAX,
+                      MPI_COMM_WORLD);
+        if (rank == 0)
+            printf("Time for %s setup = %.4f sec\n", engine_labels[e],
+                   setup_t);
+        bench_record_double(&rec, (e == ENGINE_ALLTOALLW_INIT) ?
+                            "alltoallw_init_setup" :
+                            "neighbor_alltoallv_init_setup", setup_t);
+    }
+    if (nerrs > 0) goto err_out;
+
+    for (i=0; i<nwarmup+nreps; i++) {
+        for (e=0; e<NENGINES; e++) {
+            if (!use[e]) continue;
+
+            /* perform all-to-many communication */
+            MPI_Barrier(MPI_COMM_WORLD);
+            nerrs += run_engine(e, ntimes, sender, recver, sendBuf, recvBuf,
+                                &pat, preqs[e], &timers[e], &rec);
+        }
+    }
+
+    for (e=0; e<NENGINES; e++)
+        free_persistent(ntimes, &preqs[e]);
 
+    for (e=0; e<NENGINES; e++) {
+        if (use[e])
+            bench_timer_report(&timers[e], MPI_COMM_WORLD, amnt, &rec);
+        bench_timer_free(&timers[e]);
     }
+    free_pattern(&pat);
+    if (bench_record_write(&rec, out_file)) nerrs++;
+    bench_record_free(&rec);
 
     for (i=0; i<ntimes; i++) if (sendBuf[i] != NULL) free(sendBuf[i]);
     free(sendBuf);
@@ -383,10 +970,13 @@ int main(int argc, char **argv) {
     free(recvBuf);
     free(sender);
     free(recver);
-    free(file_block);
+    free(send_ints);
+    free(recv_ints);
 
 err_out:
+    if (engines != NULL) free(engines);
+    if (out_file != NULL) free(out_file);
     MPI_Finalize();
-    return 0;
+    return (nerrs > 0);
 }
 
@@ -0,0 +1,530 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Copyright (C) 2026, Northwestern University
+ * See COPYRIGHT notice in top-level directory.
+ *
+ * A PMPI library capturing all-to-many communication patterns of an
+ * application into a trace file that can be replayed by trace_alltomany.c.
+ * It is used by preloading it into an unmodified application, e.g.
+ *   % mpiexec -n 1024 env LD_PRELOAD=./libtrace_capture.so ./wrf_io ...
+ * and, at MPI_Finalize(), writes a version 2 trace file (see trace_util.h).
+ *
+ * The amount of every message sent by the following calls is recorded.
+ *     MPI_Alltoallw, MPI_Alltoallv, MPI_Send, MPI_Ssend, MPI_Isend, MPI_Issend
+ * Only the send side is recorded. The receive side is built at
+ * MPI_Finalize() by exchanging the records among processes, so both sides
+ * of a message are always consistent, even for receives posted with
+ * MPI_ANY_SOURCE. Peers are stored as ranks in MPI_COMM_WORLD.
+ *
+ * Messages are grouped into iterations. An iteration ends at each call to
+ * MPI_Alltoallw and MPI_Alltoallv, at the beginning and the end of each call
+ * to MPI_File_write_all and MPI_File_write_at_all, and at each call to
+ * MPI_Pcontrol(2). Thus, the messages of the two-phase exchange inside a
+ * collective write form their own iterations, provided the MPI-IO library
+ * calls the MPI communication functions through the profiling interface.
+ * Otherwise, e.g. Open MPI 4.1, a warning is printed at the end. As all
+ * processes must have the same number of iterations, an application using
+ * only point-to-point communication should call MPI_Pcontrol(2)
+ * collectively. Otherwise, an error is printed and no trace is written, as
+ * the replay would pair iterations that do not correspond. Alternatively,
+ * setting environment variable TRACE_CAPTURE_WAITALL=1 makes each call to
+ * MPI_Waitall end an iteration, which can be used when all processes call
+ * MPI_Waitall the same number of times. Iterations without any message in
+ * all processes are dropped.
+ *
+ * MPI_Pcontrol(0) and MPI_Pcontrol(1) disable and enable the capture.
+ *
+ * Environment variables:
+ *     TRACE_CAPTURE_FILE    name of output trace file
+ *                           (default: trace_capture.dat)
+ *     TRACE_CAPTURE_ZLIB    set to 1 to compress blocks, requires zlib
+ *     TRACE_CAPTURE_WAITALL set to 1 to end an iteration at each MPI_Waitall
+ *
+ * To compile:
+ *   % mpicc -O2 -fPIC -shared -I.. trace_capture.c trace_util.c \
+ *           ../bench_util.c -o libtrace_capture.so
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <limits.h>
+
+#include <mpi.h>
+
+#include "bench_util.h"
+#include "trace_util.h"
+
+/* a message sent in an iteration */
+typedef struct {
+    int       iter;  /* iteration ID */
+    int       peer;  /* destination rank in MPI_COMM_WORLD */
+    long long amnt;  /* number of bytes */
+} msg_rec;
+
+static int      enabled = 1;  /* 0 when disabled by MPI_Pcontrol(0) */
+static int      active  = 1;  /* 0 when writing the trace at MPI_Finalize */
+static int      by_waitall;   /* end an iteration at each MPI_Waitall */
+static int      niters;       /* number of iterations ended so far */
+static int      in_write;     /* inside a collective write */
+static int      nwrites;      /* number of collective writes */
+static int      nwrite_msgs;  /* number of messages inside collective writes */
+static int      nrecs, nalloc;
+static msg_rec *recs;
+
+/*----< add_msg() >----------------------------------------------------------*/
+static void
+add_msg(int peer, long long amnt)
+{
+    if (!enabled || amnt == 0 || peer < 0) return;
+
+    if (nrecs == nalloc) {
+        nalloc = (nalloc == 0) ? 1024 : nalloc * 2;
+        recs = (msg_rec*) realloc(recs, sizeof(msg_rec) * nalloc);
+    }
+    recs[nrecs].iter = niters;
+    recs[nrecs].peer = peer;
+    recs[nrecs].amnt = amnt;
+    nrecs++;
+    if (in_write) nwrite_msgs++;
+}
+
+/*----< end_iteration() >----------------------------------------------------*/
+static void
+end_iteration(void)
+{
+    niters++;
+}
+
+/*----< world_ranks() >------------------------------------------------------*/
+/* translate ranks 0, 1, ..., n-1 of intra-communicator comm into the ranks in
+ * MPI_COMM_WORLD. Return NULL if comm is an inter-communicator.
+ */
+static int *
+world_ranks(MPI_Comm comm, int *n)
+{
+    int i, flag, *ranks, *wranks;
+    MPI_Group group, world_group;
+
+    PMPI_Comm_test_inter(comm, &flag);
+    if (flag) return NULL;
+
+    PMPI_Comm_size(comm, n);
+    wranks = (int*) malloc(sizeof(int) * (*n) * 2);
+    ranks = wranks + *n;
+    for (i=0; i<*n; i++) ranks[i] = i;
+    if (comm == MPI_COMM_WORLD) {
+        memcpy(wranks, ranks, sizeof(int) * (*n));
+        return wranks;
+    }
+    PMPI_Comm_group(comm, &group);
+    PMPI_Comm_group(MPI_COMM_WORLD, &world_group);
+    PMPI_Group_translate_ranks(group, *n, ranks, world_group, wranks);
+    PMPI_Group_free(&group);
+    PMPI_Group_free(&world_group);
+    return wranks;
+}
+
+/*----< add_p2p() >----------------------------------------------------------*/
+static void
+add_p2p(int count, MPI_Datatype datatype, int dest, MPI_Comm comm)
+{
+    int flag, size, wrank;
+    MPI_Group group, world_group;
+
+    if (!active || !enabled || dest == MPI_PROC_NULL) return;
+    PMPI_Comm_test_inter(comm, &flag);
+    if (flag) return;
+
+    PMPI_Type_size(datatype, &size);
+    wrank = dest;
+    if (comm != MPI_COMM_WORLD) {
+        PMPI_Comm_group(comm, &group);
+        PMPI_Comm_group(MPI_COMM_WORLD, &world_group);
+        PMPI_Group_translate_ranks(group, 1, &dest, world_group, &wrank);
+        PMPI_Group_free(&group);
+        PMPI_Group_free(&world_group);
+    }
+    add_msg(wrank, (long long)count * size);
+}
+
+/*----< MPI_Send() >---------------------------------------------------------*/
+int
+MPI_Send(const void *buf, int count, MPI_Datatype datatype, int dest,
+         int tag, MPI_Comm comm)
+{
+    add_p2p(count, datatype, dest, comm);
+    return PMPI_Send(buf, count, datatype, dest, tag, comm);
+}
+
+/*----< MPI_Ssend() >--------------------------------------------------------*/
+int
+MPI_Ssend(const void *buf, int count, MPI_Datatype datatype, int dest,
+          int tag, MPI_Comm comm)
+{
+    add_p2p(count, datatype, dest, comm);
+    return PMPI_Ssend(buf, count, datatype, dest, tag, comm);
+}
+
+/*----< MPI_Isend() >--------------------------------------------------------*/
+int
+MPI_Isend(const void *buf, int count, MPI_Datatype datatype, int dest,
+          int tag, MPI_Comm comm, MPI_Request *request)
+{
+    add_p2p(count, datatype, dest, comm);
+    return PMPI_Isend(buf, count, datatype, dest, tag, comm, request);
+}
+
+/*----< MPI_Issend() >-------------------------------------------------------*/
+int
+MPI_Issend(const void *buf, int count, MPI_Datatype datatype, int dest,
+           int tag, MPI_Comm comm, MPI_Request *request)
+{
+    add_p2p(count, datatype, dest, comm);
+    return PMPI_Issend(buf, count, datatype, dest, tag, comm, request);
+}
+
+/*----< MPI_Waitall() >------------------------------------------------------*/
+int
+MPI_Waitall(int count, MPI_Request array_of_requests[],
+            MPI_Status array_of_statuses[])
+{
+    int err = PMPI_Waitall(count, array_of_requests, array_of_statuses);
+    if (active && by_waitall) end_iteration();
+    return err;
+}
+
+/*----< MPI_Alltoallv() >----------------------------------------------------*/
+int
+MPI_Alltoallv(const void *sendbuf, const int sendcounts[],
+              const int sdispls[], MPI_Datatype sendtype, void *recvbuf,
+              const int recvcounts[], const int rdispls[],
+              MPI_Datatype recvtype, MPI_Comm comm)
+{
+    int i, n, size, *wranks;
+
+    if (active) {
+        end_iteration();
+        wranks = world_ranks(comm, &n);
+        if (wranks != NULL) {
+            /* with MPI_IN_PLACE, the amounts to send equal those to receive */
+            if (sendbuf == MPI_IN_PLACE) {
+                sendcounts = recvcounts;
+                sendtype = recvtype;
+            }
+            PMPI_Type_size(sendtype, &size);
+            for (i=0; i<n; i++)
+                add_msg(wranks[i], (long long)sendcounts[i] * size);
+            free(wranks);
+        }
+        end_iteration();
+    }
+    return PMPI_Alltoallv(sendbuf, sendcounts, sdispls, sendtype, recvbuf,
+                          recvcounts, rdispls, recvtype, comm);
+}
+
+/*----< MPI_Alltoallw() >----------------------------------------------------*/
+int
+MPI_Alltoallw(const void *sendbuf, const int sendcounts[],
+              const int sdispls[], const MPI_Datatype sendtypes[],
+              void *recvbuf, const int recvcounts[], const int rdispls[],
+              const MPI_Datatype recvtypes[], MPI_Comm comm)
+{
+    int i, n, size, *wranks;
+
+    if (active) {
+        end_iteration();
+        wranks = world_ranks(comm, &n);
+        if (wranks != NULL) {
+            const int *counts = sendcounts;
+            const MPI_Datatype *types = sendtypes;
+
+            /* with MPI_IN_PLACE, the amounts to send equal those to receive */
+            if (sendbuf == MPI_IN_PLACE) {
+                counts = recvcounts;
+                types = recvtypes;
+            }
+            for (i=0; i<n; i++) {
+                if (counts[i] == 0) continue;
+                PMPI_Type_size(types[i], &size);
+                add_msg(wranks[i], (long long)counts[i] * size);
+            }
+            free(wranks);
+        }
+        end_iteration();
+    }
+    return PMPI_Alltoallw(sendbuf, sendcounts, sdispls, sendtypes, recvbuf,
+                          recvcounts, rdispls, recvtypes, comm);
+}
+
+/*----< MPI_File_write_all() >-----------------------------------------------*/
+int
+MPI_File_write_all(MPI_File fh, const void *buf, int count,
+                   MPI_Datatype datatype, MPI_Status *status)
+{
+    int err;
+
+    if (active) {
+        end_iteration();
+        in_write = 1;
+        nwrites++;
+    }
+    err = PMPI_File_write_all(fh, buf, count, datatype, status);
+    if (active) {
+        in_write = 0;
+        end_iteration();
+    }
+    return err;
+}
+
+/*----< MPI_File_write_at_all() >--------------------------------------------*/
+int
+MPI_File_write_at_all(MPI_File fh, MPI_Offset offset, const void *buf,
+                      int count, MPI_Datatype datatype, MPI_Status *status)
+{
+    int err;
+
+    if (active) {
+        end_iteration();
+        in_write = 1;
+        nwrites++;
+    }
+    err = PMPI_File_write_at_all(fh, offset, buf, count, datatype, status);
+    if (active) {
+        in_write = 0;
+        end_iteration();
+    }
+    return err;
+}
+
+/*----< MPI_Pcontrol() >-----------------------------------------------------*/
+/* The level is also passed to the profiling layer below this library. The
+ * variable arguments cannot be forwarded and are dropped.
+ */
+int
+MPI_Pcontrol(const int level, ...)
+{
+    if (level == 0) enabled = 0;
+    else if (level == 1) enabled = 1;
+    else if (level == 2 && active) end_iteration();
+    return PMPI_Pcontrol(level);
+}
+
+/*----< MPI_Init() >---------------------------------------------------------*/
+int
+MPI_Init(int *argc, char ***argv)
+{
+    char *env = getenv("TRACE_CAPTURE_WAITALL");
+    by_waitall = (env != NULL && atoi(env) == 1);
+    return PMPI_Init(argc, argv);
+}
+
+/*----< MPI_Init_thread() >--------------------------------------------------*/
+int
+MPI_Init_thread(int *argc, char ***argv, int required, int *provided)
+{
+    char *env = getenv("TRACE_CAPTURE_WAITALL");
+    by_waitall = (env != NULL && atoi(env) == 1);
+    return PMPI_Init_thread(argc, argv, required, provided);
+}
+
+/*----< compare_msg() >------------------------------------------------------*/
+/* order messages by iteration and then by peer */
+static int
+compare_msg(const void *a, const void *b)
+{
+    const msg_rec *x = (const msg_rec*)a, *y = (const msg_rec*)b;
+
+    if (x->iter != y->iter) return (x->iter < y->iter) ? -1 : 1;
+    if (x->peer != y->peer) return (x->peer < y->peer) ? -1 : 1;
+    return 0;
+}
+
+/*----< merge_msgs() >-------------------------------------------------------*/
+/* sort messages and merge those of the same iteration and peer */
+static int
+merge_msgs(msg_rec *msgs, int n)
+{
+    int i, m = 0;
+
+    qsort(msgs, n, sizeof(msg_rec), compare_msg);
+    for (i=0; i<n; i++) {
+        if (m > 0 && msgs[m-1].iter == msgs[i].iter &&
+                     msgs[m-1].peer == msgs[i].peer)
+            msgs[m-1].amnt += msgs[i].amnt;
+        else
+            msgs[m++] = msgs[i];
+    }
+    return m;
+}
+
+/*----< fill_block() >-------------------------------------------------------*/
+/* fill counts[ntimes], then ranks and amounts of each iteration, of sorted
+ * messages msgs[n] into block and return the number of ints filled
+ */
+static int
+fill_block(const msg_rec *msgs, int n, const int *new_iter, int ntimes,
+           int *block, int *nclamped)
+{
+    int i, j, k, *counts = block, *ptr = block + ntimes;
+
+    for (j=0; j<ntimes; j++) counts[j] = 0;
+    for (i=0; i<n; i++)
+        if (new_iter[msgs[i].iter] >= 0) counts[new_iter[msgs[i].iter]]++;
+
+    i = 0;
+    for (j=0; j<ntimes; j++) {
+        /* skip messages of dropped iterations */
+        while (i < n && new_iter[msgs[i].iter] < j) i++;
+        for (k=0; k<counts[j]; k++) ptr[k] = msgs[i+k].peer;
+        ptr += counts[j];
+        for (k=0; k<counts[j]; k++) {
+            long long amnt = msgs[i+k].amnt;
+            if (amnt > INT_MAX) {
+                amnt = INT_MAX;
+                (*nclamped)++;
+            }
+            ptr[k] = (int)amnt;
+        }
+        ptr += counts[j];
+        i += counts[j];
+    }
+    return ptr - block;
+}
+
+/*----< write_trace() >------------------------------------------------------*/
+/* Collective call. Build the receive side of all messages and write the
+ * trace file.
+ */
+static int
+write_trace(void)
+{
+    int i, j, rank, nprocs, nerrs=0, flags, min_iters, max_iters, ntimes;
+    int nrecvs, nclamped=0, nints, *block, *new_iter, *keep;
+    int *scounts, *sdispls, *rcounts, *rdispls, *sbuf, *rbuf;
+    char *path, *env;
+    msg_rec *rrecs;
+
+    PMPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    PMPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* close the last iteration */
+    end_iteration();
+    PMPI_Allreduce(&niters, &min_iters, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    PMPI_Allreduce(&niters, &max_iters, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    if (min_iters != max_iters) {
+        /* iterations of different processes do not correspond */
+        if (rank == 0)
+            printf("Error: trace_capture: numbers of iterations differ among processes (%d to %d), no trace is written\n",
+                   min_iters, max_iters);
+        return 1;
+    }
+
+    /* the communication inside MPI-IO may not go through PMPI */
+    PMPI_Allreduce(MPI_IN_PLACE, &nwrite_msgs, 1, MPI_INT, MPI_SUM,
+                   MPI_COMM_WORLD);
+    if (rank == 0 && nwrites > 0 && nwrite_msgs == 0)
+        printf("Warning: trace_capture: no message captured inside %d collective writes, as the MPI-IO library does not call MPI communication functions through the profiling interface\n",
+               nwrites);
+
+    nrecs = merge_msgs(recs, nrecs);
+
+    /* drop iterations without any message in all processes */
+    keep = (int*) calloc(max_iters * 2 + 1, sizeof(int));
+    new_iter = keep + max_iters;
+    for (i=0; i<nrecs; i++) keep[recs[i].iter] = 1;
+    PMPI_Allreduce(MPI_IN_PLACE, keep, max_iters, MPI_INT, MPI_MAX,
+                   MPI_COMM_WORLD);
+    ntimes = 0;
+    for (i=0; i<max_iters; i++)
+        new_iter[i] = (keep[i]) ? ntimes++ : -1;
+
+    /* send (iteration, amount) of each message to its destination */
+    scounts = (int*) calloc(nprocs * 4, sizeof(int));
+    sdispls = scounts + nprocs;
+    rcounts = sdispls + nprocs;
+    rdispls = rcounts + nprocs;
+    for (i=0; i<nrecs; i++) scounts[recs[i].peer] += 3;
+    PMPI_Alltoall(scounts, 1, MPI_INT, rcounts, 1, MPI_INT, MPI_COMM_WORLD);
+    for (i=1; i<nprocs; i++) {
+        sdispls[i] = sdispls[i-1] + scounts[i-1];
+        rdispls[i] = rdispls[i-1] + rcounts[i-1];
+    }
+    sbuf = (int*) malloc(sizeof(int) * (nrecs * 3 + 1));
+    rbuf = (int*) malloc(sizeof(int) * (rdispls[nprocs-1] +
+                                        rcounts[nprocs-1] + 1));
+    for (i=0; i<nrecs; i++) {
+        int *ptr = sbuf + sdispls[recs[i].peer];
+        ptr[0] = recs[i].iter;
+        /* amounts are sent as two ints to avoid overflow */
+        ptr[1] = (int)(recs[i].amnt >> 31);
+        ptr[2] = (int)(recs[i].amnt & INT_MAX);
+        sdispls[recs[i].peer] += 3;
+    }
+    for (i=0; i<nprocs; i++) sdispls[i] -= scounts[i];
+    PMPI_Alltoallv(sbuf, scounts, sdispls, MPI_INT, rbuf, rcounts, rdispls,
+                   MPI_INT, MPI_COMM_WORLD);
+
+    nrecvs = 0;
+    for (i=0; i<nprocs; i++) nrecvs += rcounts[i] / 3;
+    rrecs = (msg_rec*) malloc(sizeof(msg_rec) * (nrecvs + 1));
+    nrecvs = 0;
+    for (i=0; i<nprocs; i++) {
+        for (j=0; j<rcounts[i]; j+=3) {
+            int *ptr = rbuf + rdispls[i] + j;
+            rrecs[nrecvs].iter = ptr[0];
+            rrecs[nrecvs].peer = i;
+            rrecs[nrecvs].amnt = ((long long)ptr[1] << 31) + ptr[2];
+            nrecvs++;
+        }
+    }
+    nrecvs = merge_msgs(rrecs, nrecvs);
+
+    /* block contains send side and then receive side */
+    block = (int*) malloc(sizeof(int) * (2 * ntimes + 2 * (nrecs + nrecvs) + 1));
+    nints = fill_block(recs, nrecs, new_iter, ntimes, block, &nclamped);
+    nints += fill_block(rrecs, nrecvs, new_iter, ntimes, block + nints,
+                        &nclamped);
+    if (nclamped > 0)
+        printf("Warning: trace_capture: rank %d has %d messages larger than %d bytes\n",
+               rank, nclamped, INT_MAX);
+
+    path = getenv("TRACE_CAPTURE_FILE");
+    if (path == NULL) path = "trace_capture.dat";
+    env = getenv("TRACE_CAPTURE_ZLIB");
+    flags = (env != NULL && atoi(env) == 1) ? TRACE_ZLIB : 0;
+
+    if (ntimes == 0) {
+        if (rank == 0)
+            printf("Warning: trace_capture: no message was captured\n");
+    }
+    else {
+        nerrs += trace_file_write(MPI_COMM_WORLD, path, nprocs, ntimes, flags,
+                                  rank, 1, &block, &nints);
+        if (nerrs == 0 && rank == 0)
+            printf("trace_capture: wrote %s, %d processes, %d iterations\n",
+                   path, nprocs, ntimes);
+    }
+
+    free(block);
+    free(rrecs);
+    free(rbuf);
+    free(sbuf);
+    free(scounts);
+    free(keep);
+    return nerrs;
+}
+
+/*----< MPI_Finalize() >-----------------------------------------------------*/
+int
+MPI_Finalize(void)
+{
+    /* communication of writing the trace is not captured */
+    active = 0;
+    write_trace();
+    if (recs != NULL) free(recs);
+    recs = NULL;
+    return PMPI_Finalize();
+}
@@ -0,0 +1,114 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Copyright (C) 2026, Northwestern University
+ * See COPYRIGHT notice in top-level directory.
+ *
+ * Convert a trace file of all-to-many communication pattern, of version 1 or
+ * 2, into the version 2 format, which contains a header and a per-block
+ * index, so trace_alltomany.c can read the block of each process directly.
+ * See trace_util.h for the file formats. The blocks are partitioned among
+ * the MPI processes running this program, which read and write them using
+ * collective MPI-IO.
+ *
+ * To compile:
+ *   % mpicc -O2 -I.. trace_convert.c trace_util.c ../bench_util.c -o trace_convert -lm
+ * To enable the compression, add -DHAVE_ZLIB and -lz.
+ *
+ * Usage: trace_convert [-z] in_file out_file
+ *        [-z] compress each block with zlib
+ *
+ * Example run command, converting the trace provided:
+ *   % gunzip -c trace_1024p_253n.dat.gz > trace_1024p_253n.dat
+ *   % mpiexec -n 4 ./trace_convert -z trace_1024p_253n.dat trace_1024p_253n.v2
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <mpi.h>
+
+#include "bench_util.h"
+#include "trace_util.h"
+
+/*----< main() >------------------------------------------------------------*/
+int main(int argc, char **argv) {
+    extern int optind;
+    int i, rank, nprocs, nerrs=0, flags, first, nblocks, **blocks, *nints;
+    trace_file tf;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    flags = 0;
+
+    /* command-line arguments */
+    while ((i = getopt (argc, argv, "hz")) != EOF)
+        switch (i) {
+            case 'z':
+                flags |= TRACE_ZLIB;
+                break;
+            case 'h':
+            default:
+                if (rank == 0)
+                    printf("Usage: %s [-z] in_file out_file\n", argv[0]);
+                goto err_out;
+        }
+
+    if (argc - optind != 2) {
+        if (rank == 0)
+            printf("Usage: %s [-z] in_file out_file\n", argv[0]);
+        nerrs++;
+        goto err_out;
+    }
+
+    nerrs += trace_file_open(MPI_COMM_WORLD, argv[optind], &tf);
+    if (nerrs > 0) goto err_out;
+
+    if (rank == 0) {
+        printf("input trace file                = %s\n", argv[optind]);
+        printf("input file format version       = %d\n", tf.hdr.version);
+        printf("number of traced MPI processes  = %d\n", tf.hdr.nprocs);
+        printf("number of iterations            = %d\n", tf.hdr.ntimes);
+    }
+
+    /* block partition of trace blocks among processes */
+    nblocks = tf.hdr.nprocs / nprocs;
+    first = nblocks * rank;
+    if (rank < tf.hdr.nprocs % nprocs) {
+        nblocks++;
+        first += rank;
+    }
+    else
+        first += tf.hdr.nprocs % nprocs;
+
+    blocks = (int**) malloc(sizeof(int*) * (nblocks + 1));
+    nints = (int*) malloc(sizeof(int) * (nblocks + 1));
+
+    nerrs += trace_file_read(&tf, first, nblocks, blocks, nints);
+    trace_file_close(&tf);
+    MPI_Allreduce(MPI_IN_PLACE, &nerrs, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    if (nerrs > 0) goto err_out;
+
+    nerrs += trace_file_write(MPI_COMM_WORLD, argv[optind+1], tf.hdr.nprocs,
+                              tf.hdr.ntimes, flags, first, nblocks, blocks,
+                              nints);
+
+    if (nerrs == 0 && rank == 0) {
+        printf("output trace file               = %s\n", argv[optind+1]);
+        printf("output file format version      = %d\n", TRACE_VERSION);
+        printf("compressed blocks               = %s\n",
+               (flags & TRACE_ZLIB) ? "yes" : "no");
+    }
+
+    for (i=0; i<nblocks; i++) free(blocks[i]);
+    free(blocks);
+    free(nints);
+
+err_out:
+    MPI_Finalize();
+    return (nerrs > 0);
+}
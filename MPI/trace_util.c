@@ -0,0 +1,336 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Copyright (C) 2026, Northwestern University
+ * See COPYRIGHT notice in top-level directory.
+ *
+ * Reading and writing trace files of all-to-many communication patterns,
+ * using collective MPI-IO. See trace_util.h for the file formats.
+ *
+ * Compressed trace files require zlib, enabled by defining HAVE_ZLIB, e.g.
+ *   % mpicc -DHAVE_ZLIB -c trace_util.c
+ * and linking with -lz.
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include <mpi.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "bench_util.h"
+#include "trace_util.h"
+
+/* size of header of version 2 trace files */
+#define HEADER_SIZE (8 + 4 * sizeof(int))
+
+/*----< trace_file_open() >--------------------------------------------------*/
+/* Collective call. Open trace file path and read its header. For version 1
+ * files, the block lengths are also read to calculate the block offsets.
+ */
+int
+trace_file_open(MPI_Comm    comm,
+                const char *path,
+                trace_file *tf)
+{
+    int i, err, nerrs=0, rank, *ibuf, *block_lens=NULL;
+    char hbuf[HEADER_SIZE];
+
+    MPI_Comm_rank(comm, &rank);
+
+    tf->v1_offs = NULL;
+    err = MPI_File_open(comm, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &tf->fh);
+    if (err != MPI_SUCCESS) {
+        if (rank == 0) bench_print_error(err, path, __LINE__);
+        return 1;
+    }
+
+    /* a version 1 file starts with nprocs and ntimes */
+    memset(hbuf, 0, HEADER_SIZE);
+    err = MPI_File_read_at_all(tf->fh, 0, hbuf, HEADER_SIZE, MPI_BYTE,
+                               MPI_STATUS_IGNORE);
+    CHECK_MPI_ERROR("MPI_File_read_at_all")
+
+    if (memcmp(hbuf, TRACE_MAGIC, 8) == 0) {
+        ibuf = (int*)(hbuf + 8);
+        tf->hdr.version = ibuf[0];
+        tf->hdr.nprocs  = ibuf[1];
+        tf->hdr.ntimes  = ibuf[2];
+        tf->hdr.flags   = ibuf[3];
+        if (tf->hdr.version != TRACE_VERSION) {
+            if (rank == 0)
+                printf("Error: unsupported trace file version %d\n",
+                       tf->hdr.version);
+            nerrs++;
+            goto err_out;
+        }
+    }
+    else {
+        ibuf = (int*)hbuf;
+        tf->hdr.version = 1;
+        tf->hdr.nprocs  = ibuf[0];
+        tf->hdr.ntimes  = ibuf[1];
+        tf->hdr.flags   = 0;
+    }
+
+    if (tf->hdr.nprocs <= 0 || tf->hdr.ntimes <= 0) {
+        if (rank == 0)
+            printf("Error: invalid trace file %s (nprocs=%d ntimes=%d)\n",
+                   path, tf->hdr.nprocs, tf->hdr.ntimes);
+        nerrs++;
+        goto err_out;
+    }
+
+#ifndef HAVE_ZLIB
+    if (tf->hdr.flags & TRACE_ZLIB) {
+        if (rank == 0)
+            printf("Error: trace file %s is compressed, which requires zlib\n",
+                   path);
+        nerrs++;
+        goto err_out;
+    }
+#endif
+
+    if (tf->hdr.version == 1) {
+        /* offset of a block is the sum of lengths of all blocks before it */
+        block_lens = (int*) malloc(sizeof(int) * tf->hdr.nprocs);
+        err = MPI_File_read_at_all(tf->fh, 2 * sizeof(int), block_lens,
+                                   tf->hdr.nprocs, MPI_INT, MPI_STATUS_IGNORE);
+        CHECK_MPI_ERROR("MPI_File_read_at_all")
+
+        tf->v1_offs = (MPI_Offset*) malloc(sizeof(MPI_Offset) *
+                                           (tf->hdr.nprocs + 1));
+        tf->v1_offs[0] = sizeof(int) * (2 + (MPI_Offset)tf->hdr.nprocs);
+        for (i=0; i<tf->hdr.nprocs; i++)
+            tf->v1_offs[i+1] = tf->v1_offs[i] + sizeof(int) *
+                               (MPI_Offset)block_lens[i];
+    }
+
+err_out:
+    if (block_lens != NULL) free(block_lens);
+    if (nerrs > 0) trace_file_close(tf);
+    return nerrs;
+}
+
+/*----< trace_file_read() >--------------------------------------------------*/
+/* Collective call. Each process reads nblocks blocks starting from block
+ * first, which can be zero. The blocks are allocated and returned in
+ * blocks[nblocks], and their numbers of ints in nints[nblocks]. Since the
+ * blocks are stored contiguously in the file, each process makes a single
+ * call to MPI_File_read_at_all().
+ */
+int
+trace_file_read(trace_file *tf,
+                int         first,
+                int         nblocks,
+                int       **blocks,
+                int        *nints)
+{
+    int i, err, nerrs=0;
+    char *buf=NULL;
+    MPI_Offset start, span;
+    trace_index *idx;
+
+    if (first < 0 || nblocks < 0 || first + nblocks > tf->hdr.nprocs) {
+        printf("Error: blocks %d to %d are out of range of %d blocks\n",
+               first, first + nblocks - 1, tf->hdr.nprocs);
+        nblocks = 0;
+        nerrs++;
+    }
+
+    /* find the offsets and lengths of all blocks to read */
+    idx = (trace_index*) calloc(nblocks + 1, sizeof(trace_index));
+    if (tf->hdr.version == 1) {
+        for (i=0; i<nblocks; i++) {
+            idx[i].offset  = tf->v1_offs[first + i];
+            idx[i].len     = tf->v1_offs[first + i + 1] - idx[i].offset;
+            idx[i].raw_len = idx[i].len;
+        }
+    }
+    else {
+        err = MPI_File_read_at_all(tf->fh, HEADER_SIZE + (MPI_Offset)first *
+                                   sizeof(trace_index), idx,
+                                   nblocks * sizeof(trace_index), MPI_BYTE,
+                                   MPI_STATUS_IGNORE);
+        CHECK_MPI_ERROR("MPI_File_read_at_all")
+    }
+
+    start = (nblocks > 0) ? idx[0].offset : 0;
+    span = (nblocks > 0) ? idx[nblocks-1].offset + idx[nblocks-1].len - start
+                         : 0;
+    if (span > INT_MAX) {
+        printf("Error: blocks %d to %d are larger than 2 GiB\n", first,
+               first + nblocks - 1);
+        span = 0;
+        nerrs++;
+    }
+
+    buf = (char*) malloc(span + 1);
+    err = MPI_File_read_at_all(tf->fh, start, buf, (int)span, MPI_BYTE,
+                               MPI_STATUS_IGNORE);
+    CHECK_MPI_ERROR("MPI_File_read_at_all")
+    if (nerrs > 0) goto err_out;
+
+    for (i=0; i<nblocks; i++) {
+        char *ptr = buf + (idx[i].offset - start);
+
+        nints[i] = idx[i].raw_len / sizeof(int);
+        blocks[i] = (int*) malloc(idx[i].raw_len + 1);
+#ifdef HAVE_ZLIB
+        if (tf->hdr.flags & TRACE_ZLIB) {
+            uLongf raw_len = idx[i].raw_len;
+            if (uncompress((Bytef*)blocks[i], &raw_len, (Bytef*)ptr,
+                           idx[i].len) != Z_OK || raw_len != idx[i].raw_len) {
+                printf("Error: failed to uncompress block %d\n", first + i);
+                nerrs++;
+            }
+            continue;
+        }
+#endif
+        memcpy(blocks[i], ptr, idx[i].raw_len);
+    }
+
+err_out:
+    if (buf != NULL) free(buf);
+    free(idx);
+    return nerrs;
+}
+
+/*----< trace_file_close() >-------------------------------------------------*/
+void
+trace_file_close(trace_file *tf)
+{
+    if (tf->fh != MPI_FILE_NULL) MPI_File_close(&tf->fh);
+    if (tf->v1_offs != NULL) free(tf->v1_offs);
+    tf->v1_offs = NULL;
+}
+
+/*----< trace_file_write() >-------------------------------------------------*/
+/* Collective call. Create a version 2 trace file of nprocs blocks of ntimes
+ * iterations. Each process writes nblocks blocks starting from block first,
+ * given in blocks[nblocks] of nints[nblocks] ints. The ranges of blocks must
+ * be in the increasing order of process ranks and cover all nprocs blocks.
+ * When flags contains TRACE_ZLIB, blocks are compressed by zlib.
+ */
+int
+trace_file_write(MPI_Comm    comm,
+                 const char *path,
+                 int         nprocs,
+                 int         ntimes,
+                 int         flags,
+                 int         first,
+                 int         nblocks,
+                 int       **blocks,
+                 const int  *nints)
+{
+    int i, err, nerrs=0, rank;
+    char *buf=NULL, *ptr;
+    long long local_len, base;
+    MPI_File fh=MPI_FILE_NULL;
+    trace_index *idx;
+
+    MPI_Comm_rank(comm, &rank);
+
+#ifndef HAVE_ZLIB
+    if (flags & TRACE_ZLIB) {
+        if (rank == 0)
+            printf("Error: compressed trace files require zlib\n");
+        return 1;
+    }
+#endif
+
+    idx = (trace_index*) malloc(sizeof(trace_index) * (nblocks + 1));
+
+    /* compress blocks into a contiguous buffer */
+    local_len = 0;
+    for (i=0; i<nblocks; i++) {
+        idx[i].raw_len = sizeof(int) * (long long)nints[i];
+#ifdef HAVE_ZLIB
+        if (flags & TRACE_ZLIB)
+            local_len += compressBound(idx[i].raw_len);
+        else
+#endif
+            local_len += idx[i].raw_len;
+    }
+    if (local_len > INT_MAX) {
+        printf("Error: blocks %d to %d are larger than 2 GiB\n", first,
+               first + nblocks - 1);
+        nerrs++;
+        nblocks = 0;
+        local_len = 0;
+    }
+    buf = (char*) malloc(local_len + 1);
+    ptr = buf;
+    for (i=0; i<nblocks; i++) {
+#ifdef HAVE_ZLIB
+        if (flags & TRACE_ZLIB) {
+            uLongf len = compressBound(idx[i].raw_len);
+            if (compress2((Bytef*)ptr, &len, (Bytef*)blocks[i],
+                          idx[i].raw_len, Z_BEST_COMPRESSION) != Z_OK) {
+                printf("Error: failed to compress block %d\n", first + i);
+                nerrs++;
+            }
+            idx[i].len = len;
+        }
+        else
+#endif
+        {
+            memcpy(ptr, blocks[i], idx[i].raw_len);
+            idx[i].len = idx[i].raw_len;
+        }
+        ptr += idx[i].len;
+    }
+    local_len = ptr - buf;
+
+    /* blocks are stored in the order of process ranks after the index */
+    base = 0;
+    MPI_Exscan(&local_len, &base, 1, MPI_LONG_LONG, MPI_SUM, comm);
+    if (rank == 0) base = 0;
+    base += HEADER_SIZE + sizeof(trace_index) * (long long)nprocs;
+    for (i=0; i<nblocks; i++) {
+        idx[i].offset = base;
+        base += idx[i].len;
+    }
+    base -= local_len;
+
+    err = MPI_File_open(comm, path, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                        MPI_INFO_NULL, &fh);
+    CHECK_MPI_ERROR(path)
+    err = MPI_File_set_size(fh, 0);
+    CHECK_MPI_ERROR("MPI_File_set_size")
+
+    if (rank == 0) {
+        char hbuf[HEADER_SIZE];
+        int *ibuf = (int*)(hbuf + 8);
+
+        memcpy(hbuf, TRACE_MAGIC, 8);
+        ibuf[0] = TRACE_VERSION;
+        ibuf[1] = nprocs;
+        ibuf[2] = ntimes;
+        ibuf[3] = flags;
+        err = MPI_File_write_at(fh, 0, hbuf, HEADER_SIZE, MPI_BYTE,
+                                MPI_STATUS_IGNORE);
+        CHECK_ERR(MPI_File_write_at)
+    }
+
+    err = MPI_File_write_at_all(fh, HEADER_SIZE + (MPI_Offset)first *
+                                sizeof(trace_index), idx,
+                                nblocks * sizeof(trace_index), MPI_BYTE,
+                                MPI_STATUS_IGNORE);
+    CHECK_ERR(MPI_File_write_at_all)
+
+    err = MPI_File_write_at_all(fh, base, buf, (int)local_len, MPI_BYTE,
+                                MPI_STATUS_IGNORE);
+    CHECK_ERR(MPI_File_write_at_all)
+
+err_out:
+    if (fh != MPI_FILE_NULL) MPI_File_close(&fh);
+    if (buf != NULL) free(buf);
+    free(idx);
+    return nerrs;
+}
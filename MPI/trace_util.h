@@ -0,0 +1,74 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Copyright (C) 2026, Northwestern University
+ * See COPYRIGHT notice in top-level directory.
+ *
+ * Reading and writing trace files of all-to-many communication patterns.
+ *
+ * A trace contains one block per MPI process of the traced run. Block i
+ * describes the messages sent and received by process i in all iterations,
+ * as an array of ints:
+ *     nsend[ntimes], then for each iteration j: ranks[nsend[j]], amnts[nsend[j]]
+ *     nrecv[ntimes], then for each iteration j: ranks[nrecv[j]], amnts[nrecv[j]]
+ * where ranks are the peers with non-zero amounts, in an increasing order.
+ *
+ * Two file formats are supported. Version 1, e.g. trace_1024p_253n.dat, is
+ *     int nprocs, int ntimes, int block_lens[nprocs], blocks
+ * where block_lens are the numbers of ints of the blocks. Version 2 adds a
+ * header and a per-block index, so a process can read its block directly,
+ * and optionally compresses each block with zlib.
+ *     char magic[8] = TRACE_MAGIC
+ *     int  version, nprocs, ntimes, flags
+ *     trace_index index[nprocs]
+ *     blocks
+ * All integers are stored in the native byte order.
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef TRACE_UTIL_H
+#define TRACE_UTIL_H
+
+#include <mpi.h>
+
+#define TRACE_MAGIC   "A2MTRACE"
+#define TRACE_VERSION 2
+
+/* flags of version 2 trace files */
+#define TRACE_ZLIB 1 /* blocks are compressed by zlib */
+
+typedef struct {
+    int version;  /* file format version, 1 or 2 */
+    int nprocs;   /* number of processes of the traced run */
+    int ntimes;   /* number of iterations */
+    int flags;    /* TRACE_ZLIB, version 2 only */
+} trace_header;
+
+/* index entry of a block in a version 2 trace file */
+typedef struct {
+    long long offset;   /* file offset of block */
+    long long len;      /* size of block in file, in bytes */
+    long long raw_len;  /* size of block when uncompressed, in bytes */
+} trace_index;
+
+typedef struct {
+    MPI_File      fh;
+    trace_header  hdr;
+    MPI_Offset   *v1_offs;  /* [nprocs+1] block offsets, version 1 only */
+} trace_file;
+
+extern int
+trace_file_open(MPI_Comm comm, const char *path, trace_file *tf);
+
+extern int
+trace_file_read(trace_file *tf, int first, int nblocks, int **blocks,
+                int *nints);
+
+extern void
+trace_file_close(trace_file *tf);
+
+extern int
+trace_file_write(MPI_Comm comm, const char *path, int nprocs, int ntimes,
+                 int flags, int first, int nblocks, int **blocks,
+                 const int *nints);
+
+#endif
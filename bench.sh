@@ -0,0 +1,118 @@
+#!/bin/bash
+#
+# Copyright (C) 2026, Northwestern University
+# See COPYRIGHT notice in top-level directory.
+#
+#------------------------------------------------------------------------#
+# Performance suite run by "make bench", after the programs are rebuilt
+# with optimization. The programs nvars, ghost_cell, tests/pio_noncontig,
+# tests/large_dtype, MPI/alltoallw, and MPI/trace_alltomany are run for each
+# number of processes in BENCH_NPROCS and each problem size in BENCH_SIZES,
+# and each run appends its results as one line of JSON to BENCH_OUT. Result
+# files of two MPI libraries, or two versions of one, are compared by
+# bench_compare.py.
+#
+#   BENCH_NPROCS   space-separated numbers of processes (default: 4)
+#   BENCH_SIZES    space-separated sizes small, medium, or large
+#                  (default: small)
+#   BENCH_OUT      result file, appended to (default: bench_results.json)
+#   BENCH_NWARMUP  number of untimed warmup runs (default: 1)
+#   BENCH_NREPS    number of timed repetitions (default: 5)
+#   BENCH_FILE     file written and read by the I/O programs
+#                  (default: bench_testfile)
+#   MPIRUN         MPI launcher (default: mpiexec), with options MPIRUN_OPTS
+#
+# Example:
+#   % make bench BENCH_NPROCS="4 16" BENCH_SIZES="small medium"
+#   % ./bench_compare.py mpich.json cray_mpich.json
+#------------------------------------------------------------------------#
+
+# Exit immediately if a command, or any command of a pipeline, exits with a
+# non-zero status.
+set -e
+set -o pipefail
+
+BENCH_NPROCS=${BENCH_NPROCS:-4}
+BENCH_SIZES=${BENCH_SIZES:-small}
+BENCH_OUT=${BENCH_OUT:-bench_results.json}
+BENCH_NWARMUP=${BENCH_NWARMUP:-1}
+BENCH_NREPS=${BENCH_NREPS:-5}
+BENCH_FILE=${BENCH_FILE:-bench_testfile}
+MPIRUN=${MPIRUN:-mpiexec}
+
+# the trace replayed by trace_alltomany, converted once into version 2
+TRACE=MPI/trace_bench_v2.dat
+if test -x MPI/trace_alltomany -a -x MPI/trace_convert -a ! -f $TRACE ; then
+   gunzip -c MPI/trace_1024p_253n.dat.gz > MPI/trace_bench_v1.dat
+   ${MPIRUN} ${MPIRUN_OPTS} -n 1 MPI/trace_convert MPI/trace_bench_v1.dat $TRACE
+   rm -f MPI/trace_bench_v1.dat
+fi
+
+RUNS="W=$BENCH_NWARMUP N=$BENCH_NREPS"
+COMMON="-W $BENCH_NWARMUP -N $BENCH_NREPS -o $BENCH_OUT"
+
+run() {
+   prog=$1
+   shift
+   if test ! -x $prog ; then
+      echo "---- skip $prog, not built"
+      return
+   fi
+   CMD="${MPIRUN} ${MPIRUN_OPTS} -n $NP $prog $*"
+   echo "==========================================================="
+   echo "    $CMD"
+   echo ""
+   ${CMD}
+   echo "==========================================================="
+}
+
+for size in $BENCH_SIZES ; do
+   # parameters of each program for the problem size
+   case $size in
+      small)  NVARS="-n 10 -l 32"
+              GHOST="-l 64 -n 4"
+              PIO="-k 8 -c 4096 -n 2"
+              LARGE="-n 10 -l 256"
+              A2AW="-n 10 -l 1048576 -r 4" ;;
+      medium) NVARS="-n 100 -l 64"
+              GHOST="-l 512 -n 8"
+              PIO="-k 58 -c 65536 -n 16"
+              LARGE="-n 100 -l 1024"
+              A2AW="-n 50 -l 8388608 -r 32" ;;
+      large)  NVARS="-n 1100 -l 128"
+              GHOST="-l 2048 -n 8"
+              PIO="-k 58 -c 1048576 -n 64"
+              LARGE="-n 1100 -l 2048"
+              A2AW="-n 20 -l 33554432 -r 128" ;;
+      *)      echo "Error: unknown size '$size' in BENCH_SIZES"
+              exit 1 ;;
+   esac
+
+   for NP in $BENCH_NPROCS ; do
+      echo "---- size $size, processes $NP, $RUNS, results in $BENCH_OUT"
+
+      run ./nvars $NVARS -r $COMMON -f $BENCH_FILE
+      run ./ghost_cell -q $GHOST $COMMON $BENCH_FILE
+      run tests/pio_noncontig $PIO $COMMON -f $BENCH_FILE
+      run tests/large_dtype $LARGE $COMMON -f $BENCH_FILE
+      # option -l of alltoallw is a plain number of bytes, a message length
+      # of 0 bytes means the suite passed it wrongly
+      run MPI/alltoallw $A2AW $COMMON | tee $BENCH_FILE.log
+      if grep -q "message length *= 0 bytes" $BENCH_FILE.log ; then
+         echo "Error: MPI/alltoallw ran with 0-byte messages, check A2AW"
+         exit 1
+      fi
+
+      # the messages of the 1024-process trace among the first NP processes
+      # are replayed, or, when NP is a multiple of 1024, the trace is
+      # expanded onto NP processes. Mode fold would keep the total amount,
+      # too large for a few processes.
+      MODE=truncate
+      if test $NP -gt 1024 -a $((NP % 1024)) -eq 0 ; then MODE=expand ; fi
+      if test -f $TRACE ; then
+         run MPI/trace_alltomany -m $MODE $COMMON $TRACE
+      fi
+   done
+done
+
+rm -f $BENCH_FILE $BENCH_FILE.log
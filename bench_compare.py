@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2026, Northwestern University
+# See COPYRIGHT notice in top-level directory.
+#
+#------------------------------------------------------------------------#
+# Compare two result files of the performance suite, e.g. written by
+# "make bench" built with two MPI libraries or two ROMIO versions, and flag
+# the regressions of the new results against the base results.
+#
+# Each line of a result file is a JSON record of one run of a program,
+# written by command-line option '-o' of the programs. Records of the two
+# files are matched by the program name, the number of processes, and the
+# integer and string parameters, e.g. the numbers of variables and the
+# local array sizes, as the other parameters are results. For each timer of
+# matched records, the median time of the timed runs is compared, using the
+# median among the records of a file when the suite is run more than once.
+# A timer is a regression when its time grows by more than the threshold and
+# by more than the minimum difference, which ignores the noise of very short
+# timers.
+#
+# Usage:
+#   % ./bench_compare.py [-t percent] [-m sec] [-a] base.json new.json
+#       -t percent  threshold of the time increase (default: 10)
+#       -m sec      minimum time difference to be flagged (default: 0.0001)
+#       -a          print all timers, not only the regressions and
+#                   improvements
+#
+# Exit status is 1 if any regression is found, or if a record or a timer of
+# the base results is missing from the new results, e.g. a program crashed
+# or was not built, so the comparison can gate an upgrade of the MPI library.
+#------------------------------------------------------------------------#
+
+import getopt
+import json
+import statistics
+import sys
+
+
+def load(path):
+    """Return the records of a result file grouped by their keys, and the
+    MPI libraries found in the file."""
+    groups, libraries = {}, []
+    with open(path) as fp:
+        for num, line in enumerate(fp, 1):
+            line = line.strip()
+            if not line:
+                continue
+            try:
+                rec = json.loads(line)
+            except ValueError:
+                print("Warning: %s:%d is not a JSON record, skipped"
+                      % (path, num))
+                continue
+            params = tuple(sorted(
+                (k, v) for k, v in rec.get("params", {}).items()
+                if isinstance(v, (int, str)) and not isinstance(v, bool)))
+            key = (rec.get("program", "?"), rec.get("nprocs", 0), params)
+            groups.setdefault(key, []).append(rec)
+            lib = rec.get("mpi_library", "unknown")
+            if lib not in libraries:
+                libraries.append(lib)
+    return groups, libraries
+
+
+def medians(records):
+    """Return the median time of each timer among the records."""
+    times = {}
+    for rec in records:
+        for t in rec.get("timings", []):
+            times.setdefault(t["name"], []).append(t["time"]["median"])
+    return {name: statistics.median(v) for name, v in times.items()}
+
+
+def describe(key):
+    program, nprocs, params = key
+    return "%s -n %d %s" % (program, nprocs,
+                            " ".join("%s=%s" % p for p in params))
+
+
+def usage():
+    print("Usage: %s [-t percent] [-m sec] [-a] base.json new.json"
+          % sys.argv[0])
+    sys.exit(2)
+
+
+def main():
+    threshold, min_diff, show_all = 10.0, 1e-4, False
+    try:
+        opts, args = getopt.getopt(sys.argv[1:], "ht:m:a")
+    except getopt.GetoptError:
+        usage()
+    for opt, val in opts:
+        if opt == "-t":
+            threshold = float(val)
+        elif opt == "-m":
+            min_diff = float(val)
+        elif opt == "-a":
+            show_all = True
+        else:
+            usage()
+    if len(args) != 2:
+        usage()
+
+    base, base_libs = load(args[0])
+    new, new_libs = load(args[1])
+    print("base: %s (%s)" % (args[0], "; ".join(base_libs)))
+    print("new:  %s (%s)" % (args[1], "; ".join(new_libs)))
+
+    nregs = nimps = ntimers = nmiss = 0
+    for key in sorted(base, key=describe):
+        if key not in new:
+            print("---- %s: not in new results  MISSING" % describe(key))
+            nmiss += 1
+            continue
+        old_t, new_t = medians(base[key]), medians(new[key])
+        lines = []
+        for name in old_t:
+            if name not in new_t:
+                lines.append("     %-40s not in new results  MISSING" % name)
+                nmiss += 1
+                continue
+            ntimers += 1
+            diff = new_t[name] - old_t[name]
+            change = 100.0 * diff / old_t[name] if old_t[name] > 0 else 0.0
+            flag = ""
+            if abs(diff) > min_diff and change > threshold:
+                flag = "REGRESSION"
+                nregs += 1
+            elif abs(diff) > min_diff and change < -threshold:
+                flag = "improved"
+                nimps += 1
+            if flag or show_all:
+                lines.append("     %-40s %12.6f %12.6f %+8.1f%%  %s"
+                             % (name, old_t[name], new_t[name], change, flag))
+        if lines:
+            print("---- %s" % describe(key))
+            print("     %-40s %12s %12s %9s" % ("timer", "base (sec)",
+                                                "new (sec)", "change"))
+            for line in lines:
+                print(line)
+    for key in sorted(new, key=describe):
+        if key not in base:
+            print("---- %s: not in base results" % describe(key))
+
+    print("%d timers compared, %d regressions and %d improvements beyond "
+          "%.1f%%, %d missing from new results"
+          % (ntimers, nregs, nimps, threshold, nmiss))
+    return 1 if nregs > 0 or nmiss > 0 else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,2259 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Copyright (C) 2026, Northwestern University
+ * See COPYRIGHT notice in top-level directory.
+ *
+ * Implementation of the common benchmark utilities declared in bench_util.h.
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <math.h>
+#include <limits.h> /* LLONG_MAX */
+#include <sys/resource.h> /* getrusage() */
+
+#include <mpi.h>
+
+#include "bench_util.h"
+
+/* GPU runtime calls used by the bench_mem_*() functions */
+#if defined(BENCH_USE_CUDA)
+#include <cuda_runtime.h>
+#define BENCH_USE_GPU
+#define GPU_RUNTIME            "CUDA"
+#define gpuError_t             cudaError_t
+#define gpuSuccess             cudaSuccess
+#define gpuGetErrorString      cudaGetErrorString
+#define gpuGetDeviceCount      cudaGetDeviceCount
+#define gpuSetDevice           cudaSetDevice
+#define gpuMalloc              cudaMalloc
+#define gpuFree                cudaFree
+#define gpuMallocHost(ptr, sz) cudaMallocHost(ptr, sz)
+#define gpuFreeHost            cudaFreeHost
+#define gpuMemcpy              cudaMemcpy
+#define gpuMemcpy2D            cudaMemcpy2D
+#define gpuMemcpyDefault       cudaMemcpyDefault
+#define gpuMemset              cudaMemset
+#define gpuDeviceSynchronize   cudaDeviceSynchronize
+#elif defined(BENCH_USE_HIP)
+#include <hip/hip_runtime.h>
+#define BENCH_USE_GPU
+#define GPU_RUNTIME            "HIP"
+#define gpuError_t             hipError_t
+#define gpuSuccess             hipSuccess
+#define gpuGetErrorString      hipGetErrorString
+#define gpuGetDeviceCount      hipGetDeviceCount
+#define gpuSetDevice           hipSetDevice
+#define gpuMalloc              hipMalloc
+#define gpuFree                hipFree
+#define gpuMallocHost(ptr, sz) hipHostMalloc(ptr, sz, 0)
+#define gpuFreeHost            hipHostFree
+#define gpuMemcpy              hipMemcpy
+#define gpuMemcpy2D            hipMemcpy2D
+#define gpuMemcpyDefault       hipMemcpyDefault
+#define gpuMemset              hipMemset
+#define gpuDeviceSynchronize   hipDeviceSynchronize
+#endif
+
+#ifdef BENCH_USE_GPU
+#define GPU_CHECK(call) { \
+    gpuError_t gerr = (call); \
+    if (gerr != gpuSuccess) { \
+        printf("Error at line %d when calling %s: %s\n", __LINE__, #call, \
+               gpuGetErrorString(gerr)); \
+        return 1; \
+    } \
+}
+#endif
+
+/*----< bench_print_error() >------------------------------------------------*/
+void
+bench_print_error(int err, const char *fname, int line)
+{
+    int errorStringLen;
+    char errorString[MPI_MAX_ERROR_STRING];
+
+    MPI_Error_string(err, errorString, &errorStringLen);
+    if (fname == NULL)
+        printf("Error at line %d: %s\n", line, errorString);
+    else
+        printf("Error at line %d when calling %s: %s\n", line, fname,
+               errorString);
+}
+
+/*----< bench_timer_init() >-------------------------------------------------*/
+int
+bench_timer_init(bench_timer *t,
+                 const char  *name,
+                 int          nwarmup,
+                 int          nreps)
+{
+    t->name    = name;
+    t->nwarmup = (nwarmup < 0) ? 0 : nwarmup;
+    t->nreps   = (nreps <= 0) ? 1 : nreps;
+    t->nruns   = 0;
+    t->start   = 0.0;
+    t->samples = (double*) calloc(t->nreps, sizeof(double));
+
+    return (t->samples == NULL) ? 1 : 0;
+}
+
+/*----< bench_timer_start() >------------------------------------------------*/
+void
+bench_timer_start(bench_timer *t)
+{
+    t->start = MPI_Wtime();
+}
+
+/*----< bench_timer_stop() >-------------------------------------------------*/
+/* Record the time elapsed since bench_timer_start() and return it. Warmup
+ * runs are not recorded.
+ */
+double
+bench_timer_stop(bench_timer *t)
+{
+    int rep;
+    double elapsed = MPI_Wtime() - t->start;
+
+    rep = t->nruns - t->nwarmup;
+    if (rep >= 0 && rep < t->nreps)
+        t->samples[rep] = elapsed;
+    t->nruns++;
+
+    return elapsed;
+}
+
+/*----< bench_timer_free() >-------------------------------------------------*/
+void
+bench_timer_free(bench_timer *t)
+{
+    if (t->samples != NULL) free(t->samples);
+    t->samples = NULL;
+}
+
+static int
+cmp_double(const void *a, const void *b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+/*----< bench_stats_compute() >----------------------------------------------*/
+/* Compute min, median, max, mean, and standard deviation of samples[]. Note
+ * samples[] is sorted in place.
+ */
+void
+bench_stats_compute(double      *samples,
+                    int          nsamples,
+                    bench_stats *st)
+{
+    int i;
+    double sum, var;
+
+    memset(st, 0, sizeof(bench_stats));
+    st->nsamples = nsamples;
+    if (nsamples <= 0) return;
+
+    qsort(samples, nsamples, sizeof(double), cmp_double);
+
+    st->min = samples[0];
+    st->max = samples[nsamples-1];
+    if (nsamples % 2)
+        st->median = samples[nsamples/2];
+    else
+        st->median = (samples[nsamples/2-1] + samples[nsamples/2]) / 2.0;
+
+    sum = 0.0;
+    for (i=0; i<nsamples; i++) sum += samples[i];
+    st->mean = sum / nsamples;
+
+    var = 0.0;
+    for (i=0; i<nsamples; i++)
+        var += (samples[i] - st->mean) * (samples[i] - st->mean);
+    st->stddev = sqrt(var / nsamples);
+}
+
+/*----< bench_timer_reduce() >-----------------------------------------------*/
+/* Collective call. Gather the timings of all processes to root. On root, 'op'
+ * contains the statistics of the per-repetition timings, each of which is the
+ * maximum among all processes, i.e. the time of a collective operation, and
+ * 'ranks' contains the statistics of the timings of all processes and all
+ * repetitions, and rep_max[nreps] contains the per-repetition timings (max
+ * among all processes). Any of 'op', 'ranks', and 'rep_max' can be NULL.
+ */
+int
+bench_timer_reduce(const bench_timer *t,
+                   MPI_Comm           comm,
+                   int                root,
+                   bench_stats       *op,
+                   bench_stats       *ranks,
+                   double            *rep_max)
+{
+    int i, j, err, rank, nprocs, nreps = t->nreps;
+    double *all=NULL, *maxt=NULL;
+
+    MPI_Comm_size(comm, &nprocs);
+    MPI_Comm_rank(comm, &rank);
+
+    if (rank == root)
+        all = (double*) malloc(sizeof(double) * nreps * nprocs);
+
+    err = MPI_Gather(t->samples, nreps, MPI_DOUBLE, all, nreps, MPI_DOUBLE,
+                     root, comm);
+    if (err != MPI_SUCCESS || rank != root) goto err_out;
+
+    /* time of each repetition is the max among all processes */
+    maxt = (double*) malloc(sizeof(double) * nreps);
+    for (i=0; i<nreps; i++) {
+        maxt[i] = all[i];
+        for (j=1; j<nprocs; j++)
+            if (all[j*nreps+i] > maxt[i]) maxt[i] = all[j*nreps+i];
+    }
+    if (rep_max != NULL) memcpy(rep_max, maxt, sizeof(double) * nreps);
+    if (op != NULL)    bench_stats_compute(maxt, nreps, op);
+    if (ranks != NULL) bench_stats_compute(all, nreps * nprocs, ranks);
+
+err_out:
+    if (maxt != NULL) free(maxt);
+    if (all  != NULL) free(all);
+    return err;
+}
+
+static void record_timer(bench_record*, const bench_timer*, double,
+                         const bench_stats*, const bench_stats*, const double*);
+static void record_phase(bench_record*, const char*, const double*, int, int);
+
+/*----< bench_timer_report() >-----------------------------------------------*/
+/* Collective call. Root process 0 prints the timing statistics of the timer
+ * and the bandwidth calculated from amnt, the total number of bytes accessed
+ * by all processes in one repetition. Bandwidth is skipped when amnt <= 0.
+ * When rec is not NULL, the statistics are also added to the record.
+ */
+int
+bench_timer_report(const bench_timer *t,
+                   MPI_Comm           comm,
+                   double             amnt,
+                   bench_record      *rec)
+{
+    int err, rank;
+    bench_stats op, ranks;
+    double *rep_max;
+
+    MPI_Comm_rank(comm, &rank);
+
+    rep_max = (double*) malloc(sizeof(double) * t->nreps);
+    err = bench_timer_reduce(t, comm, 0, &op, &ranks, rep_max);
+    if (err == MPI_SUCCESS && rank == 0 && rec != NULL)
+        record_timer(rec, t, amnt, &op, &ranks, rep_max);
+    free(rep_max);
+    if (err != MPI_SUCCESS || rank != 0) return err;
+
+    printf("---- %s: %d warmup, %d timed runs", t->name, t->nwarmup,
+           t->nreps);
+    if (amnt > 0)
+        printf(", %.2f MiB per run", amnt / 1048576.0);
+    printf("\n");
+    printf("     time (max of ranks) min=%.6f median=%.6f max=%.6f stddev=%.6f sec\n",
+           op.min, op.median, op.max, op.stddev);
+    printf("     time (all ranks)    min=%.6f median=%.6f max=%.6f stddev=%.6f sec\n",
+           ranks.min, ranks.median, ranks.max, ranks.stddev);
+    if (amnt > 0 && op.min > 0.0)
+        printf("     bandwidth           min=%.2f median=%.2f max=%.2f MiB/sec\n",
+               amnt / 1048576.0 / op.max, amnt / 1048576.0 / op.median,
+               amnt / 1048576.0 / op.min);
+    fflush(stdout);
+
+    return err;
+}
+
+/*----< bench_percentile() >-------------------------------------------------*/
+/* value at fraction q of sorted[n], 0 <= q <= 1, linearly interpolated */
+double
+bench_percentile(const double *sorted,
+                 int           n,
+                 double        q)
+{
+    double pos = q * (n - 1);
+    int lo = (int) pos;
+
+    if (lo >= n - 1) return sorted[n-1];
+    return sorted[lo] + (pos - lo) * (sorted[lo+1] - sorted[lo]);
+}
+
+/*----< bench_phases_report() >----------------------------------------------*/
+/* Collective call. t[nphases] are the timers of consecutive phases of an
+ * operation, all run the same number of times. Root process 0 prints a table
+ * of the phases. Column 'op' is the median of the per-repetition timings of a
+ * phase, each of which is the max among all processes, and column '%' is its
+ * share of the sum of all phases. The remaining columns are the distribution
+ * among processes of the median timing of each process: min, 25th percentile,
+ * median, 75th percentile, max, and the rank of the slowest process, which
+ * show whether a phase is dominated by a few slow processes. When rec is not
+ * NULL, the statistics of each phase are also added to the record.
+ */
+int
+bench_phases_report(const bench_timer *t,
+                    int                nphases,
+                    MPI_Comm           comm,
+                    bench_record      *rec)
+{
+    int i, j, err=MPI_SUCCESS, rank, nprocs, slowest;
+    double *local=NULL, *per_rank=NULL, *sorted=NULL, *rep_max=NULL, total;
+    bench_stats *op=NULL, ranks, st;
+
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nprocs);
+
+    local = (double*) malloc(sizeof(double) * t[0].nreps);
+    op    = (bench_stats*) malloc(sizeof(bench_stats) * nphases);
+    if (rank == 0) {
+        per_rank = (double*) malloc(sizeof(double) * nprocs * nphases);
+        sorted   = (double*) malloc(sizeof(double) * nprocs);
+        rep_max  = (double*) malloc(sizeof(double) * t[0].nreps);
+    }
+
+    for (i=0; i<nphases; i++) {
+        /* median timing of this process */
+        memcpy(local, t[i].samples, sizeof(double) * t[i].nreps);
+        bench_stats_compute(local, t[i].nreps, &st);
+        err = MPI_Gather(&st.median, 1, MPI_DOUBLE,
+                         (rank == 0) ? per_rank + i * nprocs : NULL, 1,
+                         MPI_DOUBLE, 0, comm);
+        if (err != MPI_SUCCESS) goto err_out;
+
+        err = bench_timer_reduce(&t[i], comm, 0, &op[i], &ranks, rep_max);
+        if (err != MPI_SUCCESS) goto err_out;
+        if (rank == 0 && rec != NULL)
+            record_timer(rec, &t[i], 0, &op[i], &ranks, rep_max);
+    }
+    if (rank != 0) goto err_out;
+
+    total = 0.0;
+    for (i=0; i<nphases; i++) total += op[i].median;
+
+    printf("---- phase breakdown: %d warmup, %d timed runs, time in sec\n",
+           t[0].nwarmup, t[0].nreps);
+    printf("     %-20s %10s %5s | per-rank median: %10s %10s %10s %10s %10s %7s\n",
+           "phase", "op", "%", "min", "p25", "median", "p75", "max",
+           "slowest");
+    for (i=0; i<nphases; i++) {
+        double *pr = per_rank + i * nprocs;
+
+        slowest = 0;
+        for (j=1; j<nprocs; j++)
+            if (pr[j] > pr[slowest]) slowest = j;
+
+        if (rec != NULL) record_phase(rec, t[i].name, pr, nprocs, slowest);
+
+        memcpy(sorted, pr, sizeof(double) * nprocs);
+        qsort(sorted, nprocs, sizeof(double), cmp_double);
+        printf("     %-20s %10.6f %5.1f | %16s %10.6f %10.6f %10.6f %10.6f %10.6f %7d\n",
+               t[i].name, op[i].median,
+               (total > 0.0) ? 100.0 * op[i].median / total : 0.0, "",
+               sorted[0], bench_percentile(sorted, nprocs, 0.25),
+               bench_percentile(sorted, nprocs, 0.5),
+               bench_percentile(sorted, nprocs, 0.75), sorted[nprocs-1],
+               slowest);
+    }
+    fflush(stdout);
+
+err_out:
+    if (rep_max  != NULL) free(rep_max);
+    if (sorted   != NULL) free(sorted);
+    if (per_rank != NULL) free(per_rank);
+    if (op       != NULL) free(op);
+    if (local    != NULL) free(local);
+    return err;
+}
+
+/*----< bench_max_timings() >------------------------------------------------*/
+/* Collective call. maxt[] on root process 0 is the element-wise maximum of
+ * timing[] among all processes.
+ */
+void
+bench_max_timings(double   *timing,
+                  double   *maxt,
+                  int       n,
+                  MPI_Comm  comm)
+{
+    MPI_Reduce(timing, maxt, n, MPI_DOUBLE, MPI_MAX, 0, comm);
+}
+
+/*----< append() >-----------------------------------------------------------*/
+/* append a formatted string to *str, which is reallocated as needed */
+static void
+append(char **str, const char *fmt, ...)
+{
+    int len, add;
+    va_list ap;
+
+    len = (*str == NULL) ? 0 : strlen(*str);
+
+    va_start(ap, fmt);
+    add = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+
+    *str = (char*) realloc(*str, len + add + 1);
+
+    va_start(ap, fmt);
+    vsnprintf(*str + len, add + 1, fmt, ap);
+    va_end(ap);
+}
+
+/*----< append_sep() >-------------------------------------------------------*/
+/* append a JSON member separator if *str is not empty */
+static void
+append_sep(char **str)
+{
+    if (*str != NULL && (*str)[0] != '\0') append(str, ",");
+}
+
+/*----< append_json_str() >--------------------------------------------------*/
+/* append val as a JSON string, escaping the special characters */
+static void
+append_json_str(char **str, const char *val)
+{
+    const char *c;
+
+    append(str, "\"");
+    for (c=val; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\')
+            append(str, "\\%c", *c);
+        else if ((unsigned char)*c < 0x20)
+            append(str, "\\u%04x", (unsigned char)*c);
+        else
+            append(str, "%c", *c);
+    }
+    append(str, "\"");
+}
+
+/*----< append_json_double() >-----------------------------------------------*/
+/* JSON has no representation of inf or nan */
+static void
+append_json_double(char **str, double val)
+{
+    if (isfinite(val))
+        append(str, "%.9g", val);
+    else
+        append(str, "null");
+}
+
+static void
+append_stats(char **str, const char *key, const bench_stats *st)
+{
+    append(str, ",\"%s\":{\"min\":", key);
+    append_json_double(str, st->min);
+    append(str, ",\"median\":");
+    append_json_double(str, st->median);
+    append(str, ",\"max\":");
+    append_json_double(str, st->max);
+    append(str, ",\"mean\":");
+    append_json_double(str, st->mean);
+    append(str, ",\"stddev\":");
+    append_json_double(str, st->stddev);
+    append(str, "}");
+}
+
+/*----< record_timer() >-----------------------------------------------------*/
+static void
+record_timer(bench_record      *rec,
+             const bench_timer *t,
+             double             amnt,
+             const bench_stats *op,
+             const bench_stats *ranks,
+             const double      *rep_max)
+{
+    int i;
+
+    append_sep(&rec->timings);
+    append(&rec->timings, "{\"name\":");
+    append_json_str(&rec->timings, t->name);
+    append(&rec->timings, ",\"nwarmup\":%d,\"nreps\":%d,\"amount\":%.0f",
+           t->nwarmup, t->nreps, (amnt > 0) ? amnt : 0);
+    append_stats(&rec->timings, "time", op);
+    append_stats(&rec->timings, "time_all_ranks", ranks);
+    append(&rec->timings, ",\"bandwidth_MiBps\":");
+    if (amnt > 0 && op->median > 0.0)
+        append_json_double(&rec->timings, amnt / 1048576.0 / op->median);
+    else
+        append(&rec->timings, "null");
+    append(&rec->timings, ",\"samples\":[");
+    for (i=0; i<t->nreps; i++) {
+        if (i > 0) append(&rec->timings, ",");
+        append_json_double(&rec->timings, rep_max[i]);
+    }
+    append(&rec->timings, "]}");
+}
+
+/*----< record_phase() >-----------------------------------------------------*/
+/* per_rank[nprocs] are the median timings of all processes, not sorted */
+static void
+record_phase(bench_record *rec,
+             const char   *name,
+             const double *per_rank,
+             int           nprocs,
+             int           slowest)
+{
+    double *sorted;
+
+    sorted = (double*) malloc(sizeof(double) * nprocs);
+    memcpy(sorted, per_rank, sizeof(double) * nprocs);
+    qsort(sorted, nprocs, sizeof(double), cmp_double);
+
+    append_sep(&rec->phases);
+    append(&rec->phases, "{\"name\":");
+    append_json_str(&rec->phases, name);
+    append(&rec->phases, ",\"min\":");
+    append_json_double(&rec->phases, sorted[0]);
+    append(&rec->phases, ",\"p25\":");
+    append_json_double(&rec->phases, bench_percentile(sorted, nprocs, 0.25));
+    append(&rec->phases, ",\"median\":");
+    append_json_double(&rec->phases, bench_percentile(sorted, nprocs, 0.5));
+    append(&rec->phases, ",\"p75\":");
+    append_json_double(&rec->phases, bench_percentile(sorted, nprocs, 0.75));
+    append(&rec->phases, ",\"max\":");
+    append_json_double(&rec->phases, sorted[nprocs-1]);
+    append(&rec->phases, ",\"slowest_rank\":%d}", slowest);
+
+    free(sorted);
+}
+
+/*----< bench_record_init() >------------------------------------------------*/
+/* Collective call. Create a result record for program and add the number of
+ * processes, the number of compute nodes, and the MPI library version.
+ */
+int
+bench_record_init(bench_record *rec,
+                  MPI_Comm      comm,
+                  const char   *program)
+{
+    int err, nprocs, local_rank, nnodes, version, subversion, len;
+    char lib_version[MPI_MAX_LIBRARY_VERSION_STRING], *nl, stamp[32];
+    time_t now;
+    MPI_Comm node_comm;
+
+    memset(rec, 0, sizeof(bench_record));
+    MPI_Comm_rank(comm, &rec->rank);
+    MPI_Comm_size(comm, &nprocs);
+
+    /* count the compute nodes, i.e. processes with rank 0 on each node */
+    err = MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL,
+                              &node_comm);
+    if (err != MPI_SUCCESS) return err;
+    MPI_Comm_rank(node_comm, &local_rank);
+    MPI_Comm_free(&node_comm);
+    local_rank = (local_rank == 0) ? 1 : 0;
+    err = MPI_Allreduce(&local_rank, &nnodes, 1, MPI_INT, MPI_SUM, comm);
+    if (err != MPI_SUCCESS) return err;
+
+    if (rec->rank != 0) return MPI_SUCCESS;
+
+    MPI_Get_version(&version, &subversion);
+    MPI_Get_library_version(lib_version, &len);
+    /* keep only the first line of library version string */
+    if ((nl = strchr(lib_version, '\n')) != NULL) *nl = '\0';
+
+    now = time(NULL);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+    append(&rec->head, "\"program\":");
+    append_json_str(&rec->head, program);
+    append(&rec->head, ",\"timestamp\":");
+    append_json_str(&rec->head, stamp);
+    append(&rec->head, ",\"nprocs\":%d,\"nnodes\":%d", nprocs, nnodes);
+    append(&rec->head, ",\"mpi_version\":\"%d.%d\",\"mpi_library\":",
+           version, subversion);
+    append_json_str(&rec->head, lib_version);
+
+    return MPI_SUCCESS;
+}
+
+/*----< bench_record_int() >-------------------------------------------------*/
+void
+bench_record_int(bench_record *rec,
+                 const char   *key,
+                 long long     val)
+{
+    if (rec == NULL || rec->rank != 0) return;
+    append_sep(&rec->params);
+    append_json_str(&rec->params, key);
+    append(&rec->params, ":%lld", val);
+}
+
+/*----< bench_record_double() >----------------------------------------------*/
+void
+bench_record_double(bench_record *rec,
+                    const char   *key,
+                    double        val)
+{
+    if (rec == NULL || rec->rank != 0) return;
+    append_sep(&rec->params);
+    append_json_str(&rec->params, key);
+    append(&rec->params, ":");
+    append_json_double(&rec->params, val);
+}
+
+/*----< bench_record_str() >-------------------------------------------------*/
+void
+bench_record_str(bench_record *rec,
+                 const char   *key,
+                 const char   *val)
+{
+    if (rec == NULL || rec->rank != 0) return;
+    append_sep(&rec->params);
+    append_json_str(&rec->params, key);
+    append(&rec->params, ":");
+    append_json_str(&rec->params, (val == NULL) ? "" : val);
+}
+
+/*----< bench_record_hints() >-----------------------------------------------*/
+/* Add all MPI-IO hints in effect on file fh, as obtained from
+ * MPI_File_get_info(). Hints added previously are replaced.
+ */
+int
+bench_record_hints(bench_record *rec,
+                   MPI_File      fh)
+{
+    int i, err, nkeys, flag;
+    char key[MPI_MAX_INFO_KEY+1], value[MPI_MAX_INFO_VAL+1];
+    MPI_Info info_used;
+
+    if (rec == NULL || rec->rank != 0) return MPI_SUCCESS;
+
+    err = MPI_File_get_info(fh, &info_used);
+    if (err != MPI_SUCCESS) return err;
+
+    if (rec->hints != NULL) rec->hints[0] = '\0';
+
+    err = MPI_Info_get_nkeys(info_used, &nkeys);
+    if (err != MPI_SUCCESS) goto err_out;
+
+    for (i=0; i<nkeys; i++) {
+        err = MPI_Info_get_nthkey(info_used, i, key);
+        if (err != MPI_SUCCESS) goto err_out;
+        err = MPI_Info_get(info_used, key, MPI_MAX_INFO_VAL, value, &flag);
+        if (err != MPI_SUCCESS) goto err_out;
+        if (!flag) continue;
+
+        append_sep(&rec->hints);
+        append_json_str(&rec->hints, key);
+        append(&rec->hints, ":");
+        append_json_str(&rec->hints, value);
+    }
+
+err_out:
+    MPI_Info_free(&info_used);
+    return err;
+}
+
+/*----< bench_record_buckets() >---------------------------------------------*/
+/* Add the timings maxt[n] of a run of timer t, where maxt[] is typically
+ * obtained from bench_max_timings(). This must be called after
+ * bench_timer_stop() is called for the run. Warmup runs are ignored.
+ */
+void
+bench_record_buckets(bench_record      *rec,
+                     const bench_timer *t,
+                     const double      *maxt,
+                     int                n)
+{
+    int i, run;
+
+    if (rec == NULL || rec->rank != 0) return;
+
+    run = t->nruns - 1 - t->nwarmup;
+    if (run < 0) return;
+
+    append_sep(&rec->buckets);
+    append(&rec->buckets, "{\"name\":");
+    append_json_str(&rec->buckets, t->name);
+    append(&rec->buckets, ",\"run\":%d,\"times\":[", run);
+    for (i=0; i<n; i++) {
+        if (i > 0) append(&rec->buckets, ",");
+        append_json_double(&rec->buckets, maxt[i]);
+    }
+    append(&rec->buckets, "]}");
+}
+
+/*----< bench_record_write() >-----------------------------------------------*/
+/* Root process appends the record as one line of JSON to file path. Nothing
+ * is written when path is NULL.
+ */
+int
+bench_record_write(bench_record *rec,
+                   const char   *path)
+{
+    FILE *fp;
+
+    if (path == NULL || rec->rank != 0) return 0;
+
+    if ((fp = fopen(path, "a")) == NULL) {
+        printf("Error: failed to open result file %s\n", path);
+        return 1;
+    }
+
+#define MEMBERS(s) (((s) == NULL) ? "" : (s))
+    fprintf(fp, "{%s,\"params\":{%s},\"hints\":{%s},\"timings\":[%s],\"buckets\":[%s],\"phases\":[%s],\"pvars\":[%s]}\n",
+            MEMBERS(rec->head), MEMBERS(rec->params), MEMBERS(rec->hints),
+            MEMBERS(rec->timings), MEMBERS(rec->buckets),
+            MEMBERS(rec->phases), MEMBERS(rec->pvars));
+#undef MEMBERS
+
+    fclose(fp);
+    return 0;
+}
+
+/*----< bench_record_free() >------------------------------------------------*/
+void
+bench_record_free(bench_record *rec)
+{
+    if (rec->head    != NULL) free(rec->head);
+    if (rec->params  != NULL) free(rec->params);
+    if (rec->hints   != NULL) free(rec->hints);
+    if (rec->timings != NULL) free(rec->timings);
+    if (rec->buckets != NULL) free(rec->buckets);
+    if (rec->phases  != NULL) free(rec->phases);
+    if (rec->pvars   != NULL) free(rec->pvars);
+    memset(rec, 0, sizeof(bench_record));
+}
+
+/*----< match_prefixes() >---------------------------------------------------*/
+/* return 1 if name starts with any of the comma-separated prefixes */
+static int
+match_prefixes(const char *name, const char *prefixes)
+{
+    const char *p = prefixes, *end;
+    size_t len;
+
+    while (*p != '\0') {
+        end = strchr(p, ',');
+        len = (end == NULL) ? strlen(p) : (size_t)(end - p);
+        if (len > 0 && strncmp(name, p, len) == 0) return 1;
+        if (end == NULL) break;
+        p = end + 1;
+    }
+    return 0;
+}
+
+/*----< read_pvar() >--------------------------------------------------------*/
+/* read the current value of the i-th variable as a double */
+static double
+read_pvar(bench_pvars *pv, int i)
+{
+    union {
+        int                ival;
+        unsigned           uval;
+        unsigned long      ulval;
+        unsigned long long ullval;
+        double             dval;
+        MPI_Count          cval;
+    } buf;
+    MPI_Datatype dtype = pv->dtypes[i];
+
+    memset(&buf, 0, sizeof(buf));
+    if (MPI_T_pvar_read(pv->session, pv->handles[i], &buf) != MPI_SUCCESS)
+        return 0.0;
+
+    if (dtype == MPI_INT)                return (double) buf.ival;
+    if (dtype == MPI_UNSIGNED)           return (double) buf.uval;
+    if (dtype == MPI_UNSIGNED_LONG)      return (double) buf.ulval;
+    if (dtype == MPI_UNSIGNED_LONG_LONG) return (double) buf.ullval;
+    if (dtype == MPI_COUNT)              return (double) buf.cval;
+    return buf.dval;
+}
+
+/*----< bench_pvars_init() >-------------------------------------------------*/
+/* Initialize the MPI tool information interface and allocate handles of all
+ * performance variables whose names start with any of the comma-separated
+ * prefixes. No variable is collected when prefixes is NULL or empty.
+ */
+int
+bench_pvars_init(bench_pvars *pv,
+                 const char  *prefixes)
+{
+    int i, err, num, provided, count;
+    int name_len, desc_len, verbosity, var_class, bind, readonly, continuous;
+    int atomic;
+    char name[256], desc[1024];
+    MPI_Datatype dtype;
+    MPI_T_enum enumtype;
+    MPI_T_pvar_handle handle;
+
+    memset(pv, 0, sizeof(bench_pvars));
+    if (prefixes == NULL || *prefixes == '\0') return MPI_SUCCESS;
+
+    err = MPI_T_init_thread(MPI_THREAD_SINGLE, &provided);
+    if (err != MPI_SUCCESS) return err;
+
+    err = MPI_T_pvar_get_num(&num);
+    if (err != MPI_SUCCESS) {
+        MPI_T_finalize();
+        return err;
+    }
+
+    /* bench_pvars_free() checks names to tell whether MPI_T is initialized */
+    pv->names   = (char**) malloc(sizeof(char*) * (num + 1));
+    pv->classes = (int*) malloc(sizeof(int) * (num + 1));
+    pv->dtypes  = (MPI_Datatype*) malloc(sizeof(MPI_Datatype) * (num + 1));
+    pv->begin   = (double*) calloc(num + 1, sizeof(double));
+    pv->delta   = (double*) calloc(num + 1, sizeof(double));
+    pv->handles = (MPI_T_pvar_handle*)
+                  malloc(sizeof(MPI_T_pvar_handle) * (num + 1));
+
+    err = MPI_T_pvar_session_create(&pv->session);
+    if (err != MPI_SUCCESS) {
+        pv->session = MPI_T_PVAR_SESSION_NULL;
+        goto err_out;
+    }
+
+    for (i=0; i<num; i++) {
+        name_len = sizeof(name);
+        desc_len = sizeof(desc);
+        err = MPI_T_pvar_get_info(i, name, &name_len, &verbosity, &var_class,
+                                  &dtype, &enumtype, desc, &desc_len, &bind,
+                                  &readonly, &continuous, &atomic);
+        if (err != MPI_SUCCESS) continue;
+
+        if (bind != MPI_T_BIND_NO_OBJECT) continue;
+        if (var_class != MPI_T_PVAR_CLASS_COUNTER &&
+            var_class != MPI_T_PVAR_CLASS_TIMER &&
+            var_class != MPI_T_PVAR_CLASS_AGGREGATE) continue;
+        if (dtype != MPI_INT && dtype != MPI_UNSIGNED &&
+            dtype != MPI_UNSIGNED_LONG && dtype != MPI_UNSIGNED_LONG_LONG &&
+            dtype != MPI_COUNT && dtype != MPI_DOUBLE) continue;
+        if (!match_prefixes(name, prefixes)) continue;
+
+        err = MPI_T_pvar_handle_alloc(pv->session, i, NULL, &handle, &count);
+        if (err != MPI_SUCCESS) continue;
+        if (count != 1) {
+            MPI_T_pvar_handle_free(pv->session, &handle);
+            continue;
+        }
+        if (!continuous &&
+            MPI_T_pvar_start(pv->session, handle) != MPI_SUCCESS) {
+            MPI_T_pvar_handle_free(pv->session, &handle);
+            continue;
+        }
+
+        pv->names[pv->npvars]   = strdup(name);
+        pv->classes[pv->npvars] = var_class;
+        pv->dtypes[pv->npvars]  = dtype;
+        pv->handles[pv->npvars] = handle;
+        pv->npvars++;
+    }
+    err = MPI_SUCCESS;
+
+err_out:
+    if (err != MPI_SUCCESS) bench_pvars_free(pv);
+    return err;
+}
+
+/*----< bench_pvars_start() >------------------------------------------------*/
+void
+bench_pvars_start(bench_pvars *pv)
+{
+    int i;
+    for (i=0; i<pv->npvars; i++)
+        pv->begin[i] = read_pvar(pv, i);
+}
+
+/*----< bench_pvars_stop() >-------------------------------------------------*/
+/* accumulate the changes of all variables since bench_pvars_start() */
+void
+bench_pvars_stop(bench_pvars *pv)
+{
+    int i;
+    for (i=0; i<pv->npvars; i++)
+        pv->delta[i] += read_pvar(pv, i) - pv->begin[i];
+    pv->nruns++;
+}
+
+/*----< bench_pvars_report() >-----------------------------------------------*/
+/* Collective call. Root process 0 prints the min, mean, and max among all
+ * processes of the change of each variable per run. All processes must have
+ * collected the same variables, which is the case when they run the same MPI
+ * library.
+ */
+int
+bench_pvars_report(const bench_pvars *pv,
+                   MPI_Comm           comm,
+                   bench_record      *rec)
+{
+    int i, err, rank, nprocs, nvars[2], nruns;
+    double *per_run=NULL, *vmin=NULL, *vmax=NULL, *vsum=NULL;
+    const char *cname;
+
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nprocs);
+
+    /* check whether all processes collected the same number of variables */
+    nvars[0] = pv->npvars;
+    nvars[1] = -pv->npvars;
+    err = MPI_Allreduce(MPI_IN_PLACE, nvars, 2, MPI_INT, MPI_MAX, comm);
+    if (err != MPI_SUCCESS) return err;
+    if (nvars[0] != -nvars[1]) {
+        if (rank == 0)
+            printf("Warning: processes collected different MPI_T performance variables\n");
+        return MPI_SUCCESS;
+    }
+    if (nvars[0] == 0) {
+        if (rank == 0)
+            printf("---- MPI_T performance variables: none matched\n");
+        return MPI_SUCCESS;
+    }
+
+    nruns = (pv->nruns > 0) ? pv->nruns : 1;
+    per_run = (double*) malloc(sizeof(double) * pv->npvars * 4);
+    vmin = per_run + pv->npvars;
+    vmax = vmin + pv->npvars;
+    vsum = vmax + pv->npvars;
+    for (i=0; i<pv->npvars; i++) per_run[i] = pv->delta[i] / nruns;
+
+    err = MPI_Reduce(per_run, vmin, pv->npvars, MPI_DOUBLE, MPI_MIN, 0, comm);
+    if (err != MPI_SUCCESS) goto err_out;
+    err = MPI_Reduce(per_run, vmax, pv->npvars, MPI_DOUBLE, MPI_MAX, 0, comm);
+    if (err != MPI_SUCCESS) goto err_out;
+    err = MPI_Reduce(per_run, vsum, pv->npvars, MPI_DOUBLE, MPI_SUM, 0, comm);
+    if (err != MPI_SUCCESS) goto err_out;
+    if (rank != 0) goto err_out;
+
+    printf("---- MPI_T performance variables: change per run over %d runs\n",
+           pv->nruns);
+    printf("     %-40s %-9s %14s %14s %14s\n", "name", "class", "min", "mean",
+           "max");
+    for (i=0; i<pv->npvars; i++) {
+        cname = (pv->classes[i] == MPI_T_PVAR_CLASS_COUNTER) ? "counter" :
+                (pv->classes[i] == MPI_T_PVAR_CLASS_TIMER) ? "timer" :
+                "aggregate";
+        printf("     %-40s %-9s %14.6g %14.6g %14.6g\n", pv->names[i], cname,
+               vmin[i], vsum[i] / nprocs, vmax[i]);
+
+        if (rec == NULL) continue;
+        append_sep(&rec->pvars);
+        append(&rec->pvars, "{\"name\":");
+        append_json_str(&rec->pvars, pv->names[i]);
+        append(&rec->pvars, ",\"class\":\"%s\",\"min\":", cname);
+        append_json_double(&rec->pvars, vmin[i]);
+        append(&rec->pvars, ",\"mean\":");
+        append_json_double(&rec->pvars, vsum[i] / nprocs);
+        append(&rec->pvars, ",\"max\":");
+        append_json_double(&rec->pvars, vmax[i]);
+        append(&rec->pvars, "}");
+    }
+    fflush(stdout);
+
+err_out:
+    free(per_run);
+    return err;
+}
+
+/*----< bench_pvars_free() >-------------------------------------------------*/
+void
+bench_pvars_free(bench_pvars *pv)
+{
+    int i, initialized = (pv->names != NULL);
+
+    for (i=0; i<pv->npvars; i++) {
+        MPI_T_pvar_handle_free(pv->session, &pv->handles[i]);
+        free(pv->names[i]);
+    }
+    if (initialized && pv->session != MPI_T_PVAR_SESSION_NULL)
+        MPI_T_pvar_session_free(&pv->session);
+    if (pv->names   != NULL) free(pv->names);
+    if (pv->classes != NULL) free(pv->classes);
+    if (pv->dtypes  != NULL) free(pv->dtypes);
+    if (pv->begin   != NULL) free(pv->begin);
+    if (pv->delta   != NULL) free(pv->delta);
+    if (pv->handles != NULL) free(pv->handles);
+    if (initialized) MPI_T_finalize();
+    memset(pv, 0, sizeof(bench_pvars));
+}
+
+/*----< parse_size() >-------------------------------------------------------*/
+/* parse a non-negative integer with optional suffix k, m, or g (powers of
+ * 1024). Return the position after it, or NULL if str is not a number.
+ */
+static const char *
+parse_size(const char *str, long long *val)
+{
+    char *end;
+
+    *val = strtoll(str, &end, 10);
+    if (end == str || *val < 0) return NULL;
+    switch (*end) {
+        case 'k': case 'K': *val <<= 10; end++; break;
+        case 'm': case 'M': *val <<= 20; end++; break;
+        case 'g': case 'G': *val <<= 30; end++; break;
+    }
+    return end;
+}
+
+/*----< bench_parse_list() >-------------------------------------------------*/
+/* Parse a comma-separated list of values, each of which is either a single
+ * value or a geometric range "lo:hi[:factor]" of lo, lo*factor, ... up to
+ * hi, where factor defaults to 2. Values may have suffix k, m, or g, e.g.
+ * "4k:1m:4,8m". On success, *vals is allocated and the number of values is
+ * returned. Otherwise, -1 is returned.
+ */
+int
+bench_parse_list(const char *str, long long **vals)
+{
+    int n=0, nalloc=16;
+    long long lo, hi, factor, v;
+    const char *p = str;
+
+    *vals = (long long*) malloc(sizeof(long long) * nalloc);
+    while (p != NULL && *p != '\0') {
+        p = parse_size(p, &lo);
+        if (p == NULL) break;
+        hi = lo;
+        factor = 2;
+        if (*p == ':') {
+            p = parse_size(p + 1, &hi);
+            if (p != NULL && *p == ':') p = parse_size(p + 1, &factor);
+            if (p == NULL || hi < lo || factor < 2 || lo == 0) break;
+        }
+        for (v=lo; v<=hi; v*=factor) {
+            if (n == nalloc) {
+                nalloc *= 2;
+                *vals = (long long*) realloc(*vals, sizeof(long long) * nalloc);
+            }
+            (*vals)[n++] = v;
+            if (v == hi) break;
+        }
+        if (*p == ',') p++;
+        else if (*p != '\0') break;
+        else return n;
+    }
+    free(*vals);
+    *vals = NULL;
+    return -1;
+}
+
+/*----< bench_sweep_add() >--------------------------------------------------*/
+/* Collective call. Root process 0 adds to the sweep table a row of the
+ * statistics of timer t, measured for one configuration of message size
+ * size and receiver ratio ratio, in which each run consists of niters
+ * iterations and accesses amnt bytes in total.
+ */
+int
+bench_sweep_add(bench_sweep       *sw,
+                const bench_timer *t,
+                MPI_Comm           comm,
+                int                ratio,
+                long long          size,
+                int                niters,
+                double             amnt)
+{
+    int err, rank;
+    bench_stats op;
+    bench_sweep_row *row;
+
+    MPI_Comm_rank(comm, &rank);
+
+    err = bench_timer_reduce(t, comm, 0, &op, NULL, NULL);
+    if (err != MPI_SUCCESS || rank != 0) return err;
+
+    if (sw->nrows == sw->nalloc) {
+        sw->nalloc = (sw->nalloc == 0) ? 16 : sw->nalloc * 2;
+        sw->rows = (bench_sweep_row*) realloc(sw->rows,
+                   sizeof(bench_sweep_row) * sw->nalloc);
+    }
+    row = sw->rows + sw->nrows++;
+    row->engine = strdup(t->name);
+    row->ratio  = ratio;
+    row->size   = size;
+    row->niters = niters;
+    row->amnt   = amnt;
+    row->min    = op.min;
+    row->median = op.median;
+
+    return err;
+}
+
+/*----< bench_sweep_print() >------------------------------------------------*/
+/* Root process prints the sweep table, one row per configuration and timer.
+ * Latency is the median time per iteration and bandwidth is calculated from
+ * the median time. Among the rows of the same configuration, the fastest one
+ * is marked by '*'.
+ */
+void
+bench_sweep_print(const bench_sweep *sw)
+{
+    int i, j, first, best;
+    const bench_sweep_row *row;
+
+    if (sw->nrows == 0) return;
+
+    printf("---- sweep results, '*' marks the fastest of each configuration\n");
+    printf("%6s %12s  %-32s %12s %12s %12s\n", "ratio", "msg_bytes",
+           "engine", "latency(us)", "median(s)", "MiB/sec");
+    for (first=0; first<sw->nrows; first=j) {
+        /* rows of the same configuration are added consecutively */
+        best = first;
+        for (j=first; j<sw->nrows; j++) {
+            if (sw->rows[j].ratio != sw->rows[first].ratio ||
+                sw->rows[j].size  != sw->rows[first].size) break;
+            if (sw->rows[j].median < sw->rows[best].median) best = j;
+        }
+        for (i=first; i<j; i++) {
+            row = sw->rows + i;
+            printf("%6d %12lld %c%-32s %12.2f %12.6f %12.2f\n", row->ratio,
+                   row->size, (i == best && j - first > 1) ? '*' : ' ',
+                   row->engine, row->median / row->niters * 1.0e6,
+                   row->median, (row->median > 0.0) ?
+                   row->amnt / 1048576.0 / row->median : 0.0);
+        }
+    }
+    fflush(stdout);
+}
+
+/*----< bench_sweep_free() >-------------------------------------------------*/
+void
+bench_sweep_free(bench_sweep *sw)
+{
+    int i;
+
+    for (i=0; i<sw->nrows; i++)
+        free(sw->rows[i].engine);
+    if (sw->rows != NULL) free(sw->rows);
+    memset(sw, 0, sizeof(bench_sweep));
+}
+
+/*----< bench_peak_rss() >---------------------------------------------------*/
+/* Collective call. Return on root process 0 the maximum among all processes
+ * of their peak resident set sizes in bytes so far, obtained from
+ * getrusage(). Other processes return their own peak.
+ */
+double
+bench_peak_rss(MPI_Comm comm)
+{
+    double rss, max_rss;
+    struct rusage usage;
+
+    rss = 0.0;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        rss = (double)usage.ru_maxrss * 1024.0; /* ru_maxrss is in KiB */
+
+    max_rss = rss;
+    MPI_Reduce(&rss, &max_rss, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+    return max_rss;
+}
+
+/*----< bench_hints_load() >-------------------------------------------------*/
+/* Collective call. Root process 0 reads the hint file path, which has one
+ * hint per line, a key followed by its value, the same format as the file
+ * pointed by environment variable ROMIO_HINTS of ROMIO. Blank lines and text
+ * after '#' are ignored. The hints are set into *info on all processes, which
+ * is created if it is MPI_INFO_NULL, replacing the hints of the same keys
+ * already set. Nothing is done when path is NULL. Return 0 on success.
+ */
+int
+bench_hints_load(const char *path,
+                 MPI_Comm    comm,
+                 MPI_Info   *info)
+{
+    int rank, err=0;
+    long len=-1;
+    char *text=NULL, *line, *next, *key, *val, *end;
+    FILE *fp;
+
+    if (path == NULL) return 0;
+
+    MPI_Comm_rank(comm, &rank);
+
+    if (rank == 0 && (fp = fopen(path, "r")) != NULL) {
+        if (fseek(fp, 0, SEEK_END) == 0) len = ftell(fp);
+        rewind(fp);
+        if (len >= 0) {
+            text = (char*) malloc(len + 1);
+            if (fread(text, 1, len, fp) != (size_t)len) len = -1;
+        }
+        fclose(fp);
+    }
+    MPI_Bcast(&len, 1, MPI_LONG, 0, comm);
+    if (len < 0) {
+        if (rank == 0) printf("Error: failed to read hint file %s\n", path);
+        if (text != NULL) free(text);
+        return 1;
+    }
+    if (rank != 0) text = (char*) malloc(len + 1);
+    MPI_Bcast(text, len, MPI_CHAR, 0, comm);
+    text[len] = '\0';
+
+    if (*info == MPI_INFO_NULL) MPI_Info_create(info);
+
+    for (line=text; line != NULL; line=next) {
+        next = strchr(line, '\n');
+        if (next != NULL) *next++ = '\0';
+        if ((end = strchr(line, '#')) != NULL) *end = '\0';
+
+        /* key is the first word and value is the rest of the line */
+        key = line + strspn(line, " \t\r");
+        if (*key == '\0') continue;
+        val = key + strcspn(key, " \t\r");
+        if (*val != '\0') *val++ = '\0';
+        val += strspn(val, " \t\r");
+        end = val + strlen(val);
+        while (end > val && strchr(" \t\r", end[-1]) != NULL) *--end = '\0';
+
+        if (*val == '\0') {
+            if (rank == 0)
+                printf("Warning: hint %s has no value in hint file %s\n", key,
+                       path);
+            continue;
+        }
+        err = MPI_Info_set(*info, key, val);
+        if (err != MPI_SUCCESS) break;
+    }
+    free(text);
+    return err;
+}
+
+/*----< bench_hints_print() >------------------------------------------------*/
+/* Root process 0 of comm prints all MPI-IO hints in effect on file fh, as
+ * obtained from MPI_File_get_info(), in the format of print_mpi_io_hints.c.
+ */
+int
+bench_hints_print(MPI_File fh,
+                  MPI_Comm comm)
+{
+    int i, err, rank, nkeys, flag, valuelen;
+    char key[MPI_MAX_INFO_KEY+1], value[MPI_MAX_INFO_VAL+1];
+    MPI_Info info_used;
+
+    MPI_Comm_rank(comm, &rank);
+    if (rank != 0) return MPI_SUCCESS;
+
+    err = MPI_File_get_info(fh, &info_used);
+    if (err != MPI_SUCCESS) return err;
+
+    err = MPI_Info_get_nkeys(info_used, &nkeys);
+    if (err != MPI_SUCCESS) goto err_out;
+    printf("MPI File Info: nkeys = %d\n", nkeys);
+
+    for (i=0; i<nkeys; i++) {
+        err = MPI_Info_get_nthkey(info_used, i, key);
+        if (err != MPI_SUCCESS) goto err_out;
+        err = MPI_Info_get_valuelen(info_used, key, &valuelen, &flag);
+        if (err != MPI_SUCCESS) goto err_out;
+        err = MPI_Info_get(info_used, key, MPI_MAX_INFO_VAL, value, &flag);
+        if (err != MPI_SUCCESS) goto err_out;
+        printf("MPI File Info: [%2d] key = %27s, flag = %d, valuelen = %d value = %s\n",
+               i, key, flag, valuelen, value);
+    }
+
+err_out:
+    MPI_Info_free(&info_used);
+    return err;
+}
+
+/*----< bench_gpu_init() >---------------------------------------------------*/
+/* Collective call. Select the GPU device of this process, the local rank of
+ * the process on its compute node modulo the number of devices. Return 0 on
+ * success and 1 if no device is found or the programs are not built with
+ * GPU support.
+ */
+int
+bench_gpu_init(MPI_Comm comm)
+{
+    int rank, err=0;
+#ifdef BENCH_USE_GPU
+    int local_rank, ndevices=0;
+    gpuError_t gerr;
+    MPI_Comm node_comm;
+
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL,
+                        &node_comm);
+    MPI_Comm_rank(node_comm, &local_rank);
+    MPI_Comm_free(&node_comm);
+
+    gerr = gpuGetDeviceCount(&ndevices);
+    if (gerr == gpuSuccess && ndevices > 0)
+        gerr = gpuSetDevice(local_rank % ndevices);
+    if (gerr != gpuSuccess || ndevices == 0) {
+        printf("Error: no %s GPU device found (%s)\n", GPU_RUNTIME,
+               (gerr != gpuSuccess) ? gpuGetErrorString(gerr) : "0 devices");
+        err = 1;
+    }
+#else
+    err = 1;
+#endif
+    MPI_Allreduce(MPI_IN_PLACE, &err, 1, MPI_INT, MPI_MAX, comm);
+
+    MPI_Comm_rank(comm, &rank);
+#ifndef BENCH_USE_GPU
+    if (rank == 0)
+        printf("Error: GPU buffers require building with ENABLE_GPU=cuda or ENABLE_GPU=hip\n");
+#endif
+    return err;
+}
+
+/*----< bench_mem_alloc() >--------------------------------------------------*/
+/* Allocate size bytes of memory of kind BENCH_MEM_XXX. Return NULL if
+ * failed.
+ */
+void*
+bench_mem_alloc(size_t size,
+                int    kind)
+{
+    void *ptr=NULL;
+
+    if (kind == BENCH_MEM_HOST) return malloc(size);
+#ifdef BENCH_USE_GPU
+    gpuError_t gerr;
+
+    if (kind == BENCH_MEM_DEVICE)
+        gerr = gpuMalloc(&ptr, size);
+    else
+        gerr = gpuMallocHost(&ptr, size);
+    if (gerr != gpuSuccess) {
+        printf("Error: failed to allocate %zd bytes of %s memory (%s)\n",
+               size, (kind == BENCH_MEM_DEVICE) ? "device" : "pinned",
+               gpuGetErrorString(gerr));
+        ptr = NULL;
+    }
+#endif
+    return ptr;
+}
+
+/*----< bench_mem_free() >---------------------------------------------------*/
+void
+bench_mem_free(void *ptr,
+               int   kind)
+{
+    if (ptr == NULL) return;
+    if (kind == BENCH_MEM_HOST) {
+        free(ptr);
+        return;
+    }
+#ifdef BENCH_USE_GPU
+    if (kind == BENCH_MEM_DEVICE)
+        gpuFree(ptr);
+    else
+        gpuFreeHost(ptr);
+#endif
+}
+
+/*----< bench_mem_copy() >---------------------------------------------------*/
+/* Copy size bytes between any kinds of memory, the direction inferred from
+ * the addresses by the GPU runtime. Return 0 when the copy has completed.
+ */
+int
+bench_mem_copy(void       *dst,
+               const void *src,
+               size_t      size)
+{
+#ifdef BENCH_USE_GPU
+    GPU_CHECK(gpuMemcpy(dst, src, size, gpuMemcpyDefault))
+    GPU_CHECK(gpuDeviceSynchronize())
+#else
+    memcpy(dst, src, size);
+#endif
+    return 0;
+}
+
+/*----< bench_mem_copy2d() >-------------------------------------------------*/
+/* Copy height rows of width bytes each, spitch bytes apart in src, into rows
+ * dpitch bytes apart in dst. For device memory, the copy is done by the GPU,
+ * e.g. to pack the interior of a buffer with ghost cells on the device.
+ * Return 0 when the copy has completed.
+ */
+int
+bench_mem_copy2d(void       *dst,
+                 size_t      dpitch,
+                 const void *src,
+                 size_t      spitch,
+                 size_t      width,
+                 size_t      height)
+{
+#ifdef BENCH_USE_GPU
+    GPU_CHECK(gpuMemcpy2D(dst, dpitch, src, spitch, width, height,
+                          gpuMemcpyDefault))
+    GPU_CHECK(gpuDeviceSynchronize())
+#else
+    size_t i;
+    for (i=0; i<height; i++)
+        memcpy((char*)dst + i * dpitch, (const char*)src + i * spitch, width);
+#endif
+    return 0;
+}
+
+/*----< bench_mem_set() >----------------------------------------------------*/
+/* Set size bytes of memory of kind BENCH_MEM_XXX to byte c. Return 0 on
+ * success.
+ */
+int
+bench_mem_set(void   *ptr,
+              int     c,
+              size_t  size,
+              int     kind)
+{
+#ifdef BENCH_USE_GPU
+    if (kind == BENCH_MEM_DEVICE) {
+        GPU_CHECK(gpuMemset(ptr, c, size))
+        GPU_CHECK(gpuDeviceSynchronize())
+        return 0;
+    }
+#else
+    (void)kind; /* host memory only */
+#endif
+    memset(ptr, c, size);
+    return 0;
+}
+
+/*----< fill_ints() >--------------------------------------------------------*/
+static void
+fill_ints(int *ptr, size_t n, int val)
+{
+    size_t i;
+
+    if (val == 0 || val == -1) {
+        memset(ptr, val & 0xff, sizeof(int) * n);
+        return;
+    }
+    for (i=0; i<n; i++)
+        ptr[i] = val;
+}
+
+/*----< row_mismatch() >-----------------------------------------------------*/
+/* Return the index of the first of n ints not equal to val, or -1. The ints
+ * are compared without branches first, so the loop can be vectorized.
+ */
+static long long
+row_mismatch(const int *ptr, size_t n, int val)
+{
+    size_t i;
+    int diff = 0;
+
+    for (i=0; i<n; i++)
+        diff |= ptr[i] ^ val;
+    if (diff == 0) return -1;
+    for (i=0; i<n; i++)
+        if (ptr[i] != val) break;
+    return (long long)i;
+}
+
+/*----< bench_verify_mode() >------------------------------------------------*/
+/* Return BENCH_VERIFY_XXX of name "none", "elem", or "crc", or -1 if name is
+ * not any of them.
+ */
+int
+bench_verify_mode(const char *name)
+{
+    if (strcmp(name, "none") == 0) return BENCH_VERIFY_NONE;
+    if (strcmp(name, "elem") == 0) return BENCH_VERIFY_ELEM;
+    if (strcmp(name, "crc")  == 0) return BENCH_VERIFY_CRC;
+    return -1;
+}
+
+/*----< bench_fill_block() >-------------------------------------------------*/
+/* Fill nslabs 2D slabs, one after another, each of (ny+2*ng) x (nx+2*ng)
+ * ints, of which the interior ny x nx ints are set to val and the ng ghost
+ * cells on both ends of each dimension to ghost. Rows are filled in parallel
+ * when built with OpenMP.
+ */
+void
+bench_fill_block(int *buf,
+                 int  nslabs,
+                 int  ny,
+                 int  nx,
+                 int  ng,
+                 int  val,
+                 int  ghost)
+{
+    long long r, nrows = (long long)nslabs * (ny + 2 * ng);
+    size_t xlen = nx + 2 * ng;
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (r=0; r<nrows; r++) {
+        int *row = buf + r * xlen;
+        int y = (int)(r % (ny + 2 * ng));
+        if (y < ng || y >= ny + ng)
+            fill_ints(row, xlen, ghost);
+        else {
+            fill_ints(row, ng, ghost);
+            fill_ints(row + ng, nx, val);
+            fill_ints(row + ng + nx, ng, ghost);
+        }
+    }
+}
+
+/*----< bench_verify_block() >-----------------------------------------------*/
+/* Check nslabs slabs filled by bench_fill_block(). Return the index of the
+ * first int not expected, or -1 if all are expected.
+ */
+long long
+bench_verify_block(const int *buf,
+                   int        nslabs,
+                   int        ny,
+                   int        nx,
+                   int        ng,
+                   int        val,
+                   int        ghost)
+{
+    long long r, bad = LLONG_MAX, nrows = (long long)nslabs * (ny + 2 * ng);
+    size_t xlen = nx + 2 * ng;
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) reduction(min:bad)
+#endif
+    for (r=0; r<nrows; r++) {
+        const int *row = buf + r * xlen;
+        int y = (int)(r % (ny + 2 * ng));
+        long long i;
+        if (y < ng || y >= ny + ng)
+            i = row_mismatch(row, xlen, ghost);
+        else {
+            i = row_mismatch(row, ng, ghost);
+            if (i < 0 && (i = row_mismatch(row + ng, nx, val)) >= 0)
+                i += ng;
+            if (i < 0 && (i = row_mismatch(row + ng + nx, ng, ghost)) >= 0)
+                i += ng + nx;
+        }
+        if (i >= 0 && r * (long long)xlen + i < bad)
+            bad = r * (long long)xlen + i;
+    }
+    return (bad == LLONG_MAX) ? -1 : bad;
+}
+
+/*----< bench_verify_rows() >------------------------------------------------*/
+/* Check nrows rows of nx ints, stride ints apart, are all val. Return the
+ * index relative to buf of the first int not expected, or -1.
+ */
+long long
+bench_verify_rows(const int *buf,
+                  long long  nrows,
+                  size_t     stride,
+                  int        nx,
+                  int        val)
+{
+    long long r, bad = LLONG_MAX;
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) reduction(min:bad)
+#endif
+    for (r=0; r<nrows; r++) {
+        long long i = row_mismatch(buf + r * stride, nx, val);
+        if (i >= 0 && r * (long long)stride + i < bad)
+            bad = r * (long long)stride + i;
+    }
+    return (bad == LLONG_MAX) ? -1 : bad;
+}
+
+/* The byte pattern of tests/large_dtype.c, byte i of the data of process
+ * rank is (rank + i) % BENCH_PATTERN_PERIOD. Two periods are kept, so a
+ * piece of up to one period starting at any phase is contiguous.
+ */
+#define BENCH_PATTERN_PERIOD 128
+#define PATTERN_BLOCK        1048576
+
+static void
+pattern_init(char *pattern)
+{
+    int i;
+    for (i=0; i<2*BENCH_PATTERN_PERIOD; i++)
+        pattern[i] = (char)(i % BENCH_PATTERN_PERIOD);
+}
+
+/*----< bench_fill_pattern() >-----------------------------------------------*/
+/* Set buf[i] = (start + i) % 128 for i in [0, n), by copying pieces of the
+ * pattern. Blocks of 1 MiB are filled in parallel when built with OpenMP.
+ */
+void
+bench_fill_pattern(char   *buf,
+                   size_t  n,
+                   size_t  start)
+{
+    char pattern[2*BENCH_PATTERN_PERIOD];
+    long long b, nblocks = (n + PATTERN_BLOCK - 1) / PATTERN_BLOCK;
+
+    pattern_init(pattern);
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (b=0; b<nblocks; b++) {
+        size_t i = b * PATTERN_BLOCK, end = i + PATTERN_BLOCK;
+        if (end > n) end = n;
+        while (i < end) {
+            size_t phase = (start + i) % BENCH_PATTERN_PERIOD;
+            size_t len = BENCH_PATTERN_PERIOD;
+            if (len > end - i) len = end - i;
+            memcpy(buf + i, pattern + phase, len);
+            i += len;
+        }
+    }
+}
+
+/*----< bench_verify_pattern() >---------------------------------------------*/
+/* Check buf[i] == (start + i) % 128 for i in [0, n). Return the index of the
+ * first byte not expected, or -1.
+ */
+long long
+bench_verify_pattern(const char *buf,
+                     size_t      n,
+                     size_t      start)
+{
+    char pattern[2*BENCH_PATTERN_PERIOD];
+    long long b, bad = LLONG_MAX, nblocks = (n + PATTERN_BLOCK - 1) /
+                                            PATTERN_BLOCK;
+
+    pattern_init(pattern);
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) reduction(min:bad)
+#endif
+    for (b=0; b<nblocks; b++) {
+        size_t i = b * PATTERN_BLOCK, end = i + PATTERN_BLOCK, k;
+        if (end > n) end = n;
+        while (i < end) {
+            size_t phase = (start + i) % BENCH_PATTERN_PERIOD;
+            size_t len = BENCH_PATTERN_PERIOD;
+            if (len > end - i) len = end - i;
+            if (memcmp(buf + i, pattern + phase, len) != 0) {
+                for (k=0; buf[i+k] == pattern[phase+k]; k++) ;
+                if ((long long)(i + k) < bad) bad = i + k;
+                break;
+            }
+            i += len;
+        }
+    }
+    return (bad == LLONG_MAX) ? -1 : bad;
+}
+
+/* table of CRC-32C (Castagnoli), reflected polynomial 0x82F63B78, for the
+ * slicing-by-8 algorithm
+ */
+static unsigned int crc_table[8][256];
+static int crc_ready;
+
+static void
+crc_init(void)
+{
+    unsigned int i, j, c;
+
+    for (i=0; i<256; i++) {
+        c = i;
+        for (j=0; j<8; j++)
+            c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+        crc_table[0][i] = c;
+    }
+    for (i=0; i<256; i++)
+        for (j=1; j<8; j++)
+            crc_table[j][i] = (crc_table[j-1][i] >> 8) ^
+                              crc_table[0][crc_table[j-1][i] & 0xff];
+    crc_ready = 1;
+}
+
+/*----< bench_crc32c() >-----------------------------------------------------*/
+/* Update CRC-32C crc, 0 to start, with size bytes of buf and return it. The
+ * first call must not be made concurrently by threads.
+ */
+unsigned int
+bench_crc32c(unsigned int  crc,
+             const void   *buf,
+             size_t        size)
+{
+    const unsigned char *p = (const unsigned char*) buf;
+
+    if (!crc_ready) crc_init();
+    crc = ~crc;
+    while (size >= 8) {
+        unsigned int lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;  /* little endian */
+        crc = crc_table[7][lo & 0xff] ^ crc_table[6][(lo >> 8) & 0xff] ^
+              crc_table[5][(lo >> 16) & 0xff] ^ crc_table[4][lo >> 24] ^
+              crc_table[3][hi & 0xff] ^ crc_table[2][(hi >> 8) & 0xff] ^
+              crc_table[1][(hi >> 16) & 0xff] ^ crc_table[0][hi >> 24];
+        p += 8;
+        size -= 8;
+    }
+    while (size-- > 0)
+        crc = (crc >> 8) ^ crc_table[0][(crc ^ *p++) & 0xff];
+    return ~crc;
+}
+
+/*----< bench_rows_crc() >---------------------------------------------------*/
+/* Set crcs[s] to the CRC-32C of the ny rows of nx ints, stride ints apart, of
+ * slab s, for s in [0, nslabs), where slab s starts at buf + s * slab_stride.
+ * The checksum only depends on the contents of the rows, so the same slab
+ * stored in a local buffer with ghost cells and in a global array of the file
+ * has the same checksum. Slabs are checksummed in parallel when built with
+ * OpenMP.
+ */
+void
+bench_rows_crc(const int    *buf,
+               int           nslabs,
+               size_t        slab_stride,
+               int           ny,
+               size_t        stride,
+               int           nx,
+               unsigned int *crcs)
+{
+    int s;
+
+    if (!crc_ready) crc_init();
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (s=0; s<nslabs; s++) {
+        int y;
+        unsigned int crc = 0;
+        for (y=0; y<ny; y++)
+            crc = bench_crc32c(crc, buf + s * slab_stride + y * stride,
+                               sizeof(int) * nx);
+        crcs[s] = crc;
+    }
+}
+
+/* a walk over the contiguous blocks of a file view, in the order of the
+ * typemap. Adjacent blocks are merged before calling fn, and the walk stops
+ * after remain bytes or when fn returns nonzero.
+ */
+typedef struct {
+    MPI_Offset off;        /* start of the pending block */
+    MPI_Offset len;        /* length of the pending block */
+    MPI_Offset remain;     /* bytes left to be walked */
+    int (*fn)(MPI_Offset off, MPI_Offset len, void *arg);
+    void *arg;
+} type_walk;
+
+static int walk_type(type_walk *w, MPI_Datatype dtype, MPI_Offset disp);
+
+/*----< walk_emit() >--------------------------------------------------------*/
+static int
+walk_emit(type_walk  *w,
+          MPI_Offset  off,
+          MPI_Offset  len)
+{
+    int ret;
+
+    if (len > w->remain) len = w->remain;
+    if (len == 0) return (w->remain == 0);
+
+    if (w->len > 0 && w->off + w->len == off)
+        w->len += len;
+    else {
+        if (w->len > 0 && (ret = w->fn(w->off, w->len, w->arg)) != 0)
+            return ret;
+        w->off = off;
+        w->len = len;
+    }
+    w->remain -= len;
+    return (w->remain == 0);
+}
+
+/*----< walk_blocks() >------------------------------------------------------*/
+/* walk count consecutive elements of dtype, the first one at disp */
+static int
+walk_blocks(type_walk    *w,
+            MPI_Datatype  dtype,
+            MPI_Offset    disp,
+            MPI_Offset    count)
+{
+    int size, ret=0;
+    MPI_Offset i;
+    MPI_Aint lb, extent, true_lb, true_extent;
+
+    MPI_Type_size(dtype, &size);
+    MPI_Type_get_extent(dtype, &lb, &extent);
+    MPI_Type_get_true_extent(dtype, &true_lb, &true_extent);
+
+    /* elements without holes are one block */
+    if (size == true_extent && true_extent == extent && true_lb == lb)
+        return walk_emit(w, disp + lb, count * size);
+
+    for (i=0; i<count && ret==0; i++)
+        ret = walk_type(w, dtype, disp + i * extent);
+    return ret;
+}
+
+/*----< walk_subarray() >----------------------------------------------------*/
+static int
+walk_subarray(type_walk    *w,
+              int           ndims,
+              const int    *ints,
+              MPI_Datatype  oldtype,
+              MPI_Offset    disp)
+{
+    int d, ret=0, sizes[32], subsizes[32], starts[32], idx[32];
+    MPI_Offset stride[32], off;
+    MPI_Aint lb, extent;
+
+    if (ndims > 32) return -1;
+
+    /* reorder the dimensions of Fortran order, so the last is the fastest */
+    for (d=0; d<ndims; d++) {
+        int k = (ints[1 + 3 * ndims] == MPI_ORDER_C) ? d : ndims - 1 - d;
+        sizes[d]    = ints[1 + k];
+        subsizes[d] = ints[1 + ndims + k];
+        starts[d]   = ints[1 + 2 * ndims + k];
+        if (subsizes[d] == 0) return 0;
+        idx[d] = 0;
+    }
+    MPI_Type_get_extent(oldtype, &lb, &extent);
+    stride[ndims-1] = extent;
+    for (d=ndims-2; d>=0; d--) stride[d] = stride[d+1] * sizes[d+1];
+
+    /* one run of the fastest dimension per iteration */
+    while (ret == 0) {
+        off = disp;
+        for (d=0; d<ndims; d++) off += (starts[d] + idx[d]) * stride[d];
+        ret = walk_blocks(w, oldtype, off, subsizes[ndims-1]);
+
+        for (d=ndims-2; d>=0; d--) {
+            if (++idx[d] < subsizes[d]) break;
+            idx[d] = 0;
+        }
+        if (d < 0) break;
+    }
+    return ret;
+}
+
+/*----< walk_type() >--------------------------------------------------------*/
+/* walk the typemap of dtype displaced by disp. Return nonzero when the walk
+ * stops, or -1 if dtype is built by a constructor not supported, e.g. darray.
+ */
+static int
+walk_type(type_walk    *w,
+          MPI_Datatype  dtype,
+          MPI_Offset    disp)
+{
+    int i, ni, na, nt, combiner, size, ret=0, *ints;
+    MPI_Aint lb, extent, *addrs;
+    MPI_Datatype *types;
+
+    MPI_Type_get_envelope(dtype, &ni, &na, &nt, &combiner);
+    if (combiner == MPI_COMBINER_NAMED) {
+        MPI_Type_size(dtype, &size);
+        return walk_emit(w, disp, size);
+    }
+
+    ints  = (int*)          malloc(sizeof(int)          * (ni + 1));
+    addrs = (MPI_Aint*)     malloc(sizeof(MPI_Aint)     * (na + 1));
+    types = (MPI_Datatype*) malloc(sizeof(MPI_Datatype) * (nt + 1));
+    MPI_Type_get_contents(dtype, ni, na, nt, ints, addrs, types);
+    if (nt > 0) MPI_Type_get_extent(types[0], &lb, &extent);
+
+    switch (combiner) {
+        case MPI_COMBINER_DUP:
+        case MPI_COMBINER_RESIZED:
+            ret = walk_type(w, types[0], disp);
+            break;
+        case MPI_COMBINER_CONTIGUOUS:
+            ret = walk_blocks(w, types[0], disp, ints[0]);
+            break;
+        case MPI_COMBINER_VECTOR:
+        case MPI_COMBINER_HVECTOR:
+            for (i=0; i<ints[0] && ret==0; i++) {
+                MPI_Offset stride = (combiner == MPI_COMBINER_VECTOR) ?
+                                    (MPI_Offset)ints[2] * extent : addrs[0];
+                ret = walk_blocks(w, types[0], disp + i * stride, ints[1]);
+            }
+            break;
+        case MPI_COMBINER_INDEXED:
+        case MPI_COMBINER_HINDEXED:
+            for (i=0; i<ints[0] && ret==0; i++) {
+                MPI_Offset d = (combiner == MPI_COMBINER_INDEXED) ?
+                               (MPI_Offset)ints[1 + ints[0] + i] * extent :
+                               addrs[i];
+                ret = walk_blocks(w, types[0], disp + d, ints[1 + i]);
+            }
+            break;
+        case MPI_COMBINER_INDEXED_BLOCK:
+        case MPI_COMBINER_HINDEXED_BLOCK:
+            for (i=0; i<ints[0] && ret==0; i++) {
+                MPI_Offset d = (combiner == MPI_COMBINER_INDEXED_BLOCK) ?
+                               (MPI_Offset)ints[2 + i] * extent : addrs[i];
+                ret = walk_blocks(w, types[0], disp + d, ints[1]);
+            }
+            break;
+        case MPI_COMBINER_STRUCT:
+            for (i=0; i<ints[0] && ret==0; i++)
+                ret = walk_blocks(w, types[i], disp + addrs[i], ints[1 + i]);
+            break;
+        case MPI_COMBINER_SUBARRAY:
+            ret = walk_subarray(w, ints[0], ints, types[0], disp);
+            break;
+        default:
+            ret = -1;
+    }
+
+    /* derived datatypes returned by MPI_Type_get_contents must be freed */
+    for (i=0; i<nt; i++) {
+        MPI_Type_get_envelope(types[i], &ni, &na, &size, &combiner);
+        if (combiner != MPI_COMBINER_NAMED) MPI_Type_free(&types[i]);
+    }
+    free(types);
+    free(addrs);
+    free(ints);
+    return ret;
+}
+
+/*----< walk_view() >--------------------------------------------------------*/
+/* walk nbytes of the file view of filetype at displacement disp, calling fn
+ * for each contiguous block of the file accessed. Return -1 if the filetype
+ * is not supported.
+ */
+static int
+walk_view(MPI_Offset    disp,
+          MPI_Datatype  filetype,
+          MPI_Offset    nbytes,
+          int         (*fn)(MPI_Offset, MPI_Offset, void*),
+          void         *arg)
+{
+    int size, ret=0;
+    MPI_Offset tile;
+    MPI_Aint lb, extent;
+    type_walk w;
+
+    MPI_Type_size(filetype, &size);
+    MPI_Type_get_extent(filetype, &lb, &extent);
+    if (size == 0) return 0;
+
+    w.off = w.len = 0;
+    w.remain = nbytes;
+    w.fn = fn;
+    w.arg = arg;
+
+    /* the file view tiles the filetype from disp */
+    for (tile=0; w.remain > 0 && ret == 0; tile++)
+        ret = walk_type(&w, filetype, disp + tile * extent);
+
+    if (ret >= 0 && w.len > 0) ret = fn(w.off, w.len, arg);
+    return (ret < 0) ? -1 : 0;
+}
+
+/* file domains of the aggregators, and bytes each receives from a process */
+typedef struct {
+    int         naggrs;
+    int         round_robin; /* stripes assigned to aggregators in turn */
+    MPI_Offset  stripe;      /* striping unit of round_robin */
+    MPI_Offset *fd_start;    /* naggrs+1 domain boundaries, otherwise */
+    MPI_Offset  first;       /* accessed region of all processes */
+    MPI_Offset  last;
+    long long  *bytes;       /* [naggrs] bytes sent to each aggregator */
+} aggr_domains;
+
+/*----< view_extent() >------------------------------------------------------*/
+static int
+view_extent(MPI_Offset off, MPI_Offset len, void *arg)
+{
+    aggr_domains *ad = (aggr_domains*)arg;
+    if (off < ad->first) ad->first = off;
+    if (off + len - 1 > ad->last) ad->last = off + len - 1;
+    return 0;
+}
+
+/*----< domain_bytes() >-----------------------------------------------------*/
+/* split block [off, off+len) among the file domains it overlaps */
+static int
+domain_bytes(MPI_Offset off, MPI_Offset len, void *arg)
+{
+    aggr_domains *ad = (aggr_domains*)arg;
+
+    while (len > 0) {
+        int a, lo, hi;
+        MPI_Offset end;
+
+        if (ad->round_robin) {
+            a = (off / ad->stripe) % ad->naggrs;
+            end = (off / ad->stripe + 1) * ad->stripe;
+        }
+        else {
+            /* last domain whose start <= off, empty domains skipped */
+            lo = 0;
+            hi = ad->naggrs - 1;
+            while (lo < hi) {
+                int mid = (lo + hi + 1) / 2;
+                if (ad->fd_start[mid] <= off) lo = mid;
+                else hi = mid - 1;
+            }
+            a = lo;
+            end = ad->fd_start[a + 1];
+        }
+        if (end - off > len) end = off + len;
+        ad->bytes[a] += end - off;
+        len -= end - off;
+        off = end;
+    }
+    return 0;
+}
+
+/*----< get_hint() >---------------------------------------------------------*/
+/* Get the value of hint key, first from the hints in effect of the file,
+ * then from the hints given by the user. Return a description of where it
+ * was found, or NULL if in neither.
+ */
+static const char *
+get_hint(MPI_Info used, MPI_Info given, const char *key, char *value)
+{
+    int flag=0;
+
+    if (used != MPI_INFO_NULL)
+        MPI_Info_get(used, key, MPI_MAX_INFO_VAL, value, &flag);
+    if (flag) return "file info";
+    if (given != MPI_INFO_NULL)
+        MPI_Info_get(given, key, MPI_MAX_INFO_VAL, value, &flag);
+    if (flag) return "user hint";
+    return NULL;
+}
+
+/*----< bench_aggr_report() >------------------------------------------------*/
+/* Collective call. Compute the aggregators of the two-phase collective I/O
+ * of file fh and the bytes each would receive, when all processes of comm
+ * access nbytes of the file view of filetype at displacement disp, and print
+ * the aggregator-to-node mapping and the load imbalance at root.
+ *
+ * The selection of aggregators and their file domains follow ROMIO: hints
+ * cb_nodes (default: the number of compute nodes) and cb_config_list of form
+ * "*:num" or "*:*" (default: "*:1") select the first num processes of each
+ * node, node by node. The region accessed by all processes is divided evenly
+ * into cb_nodes file domains, aligned to striping_unit if set, or, if
+ * striping_factor is also set as on Lustre, its stripes are assigned to the
+ * aggregators in a round-robin fashion. The hints are read from the file
+ * info, and if not found there, e.g. with OMPIO, from the user hints info.
+ * Return the number of errors.
+ */
+int
+bench_aggr_report(MPI_File      fh,
+                  MPI_Info      info,
+                  MPI_Offset    disp,
+                  MPI_Datatype  filetype,
+                  MPI_Offset    nbytes,
+                  MPI_Comm      comm,
+                  bench_record *rec)
+{
+    int i, j, err, rank, nprocs, nnodes=0, cb_nodes=0, per_node=1, nerrs=0;
+    int len, walked, *node_of=NULL, *aggrs=NULL, *senders=NULL, *sent=NULL;
+    int *node_aggrs=NULL, *node_first=NULL;
+    char name[MPI_MAX_PROCESSOR_NAME], cb_list[MPI_MAX_INFO_VAL+1];
+    char value[MPI_MAX_INFO_VAL+1], *names=NULL;
+    const char *cb_src, *list_src, *unit_src, *factor_src;
+    long long *recv=NULL, *node_bytes=NULL, max_bytes;
+    double mean, node_mean, imbal, node_imbal;
+    long long ext[2];
+    MPI_Offset unit=0, fd_size;
+    MPI_Info used=MPI_INFO_NULL;
+    aggr_domains ad;
+
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nprocs);
+
+    ad.bytes = NULL;
+    ad.fd_start = NULL;
+
+    /* node names of all processes, numbered in order of the lowest rank */
+    MPI_Get_processor_name(name, &len);
+    if (rank == 0) {
+        names = (char*) malloc((size_t)nprocs * MPI_MAX_PROCESSOR_NAME);
+        node_of = (int*) malloc(sizeof(int) * nprocs);
+        node_first = (int*) malloc(sizeof(int) * nprocs);
+    }
+    err = MPI_Gather(name, MPI_MAX_PROCESSOR_NAME, MPI_CHAR, names,
+                     MPI_MAX_PROCESSOR_NAME, MPI_CHAR, 0, comm);
+    CHECK_MPI_ERROR("MPI_Gather")
+
+    err = MPI_File_get_info(fh, &used);
+    CHECK_MPI_ERROR("MPI_File_get_info")
+
+    cb_src     = get_hint(used, info, "cb_nodes", value);
+    if (cb_src != NULL) cb_nodes = atoi(value);
+    list_src   = get_hint(used, info, "cb_config_list", cb_list);
+    if (list_src == NULL) strcpy(cb_list, "*:1");
+    unit_src   = get_hint(used, info, "striping_unit", value);
+    if (unit_src != NULL) unit = atoll(value);
+    factor_src = get_hint(used, info, "striping_factor", value);
+
+    aggrs = (int*) malloc(sizeof(int) * nprocs);
+    if (rank == 0) {
+        for (i=0; i<nprocs; i++) {
+            for (j=0; j<nnodes; j++)
+                if (!strcmp(names + (size_t)i * MPI_MAX_PROCESSOR_NAME,
+                            names + (size_t)node_first[j] *
+                            MPI_MAX_PROCESSOR_NAME)) break;
+            if (j == nnodes) node_first[nnodes++] = i;
+            node_of[i] = j;
+        }
+
+        /* processes allowed per node by cb_config_list */
+        if (!strcmp(cb_list, "*:*"))
+            per_node = nprocs;
+        else if (!strncmp(cb_list, "*:", 2) && atoi(cb_list + 2) > 0)
+            per_node = atoi(cb_list + 2);
+        else
+            printf("Warning: cb_config_list \"%s\" is modeled as \"*:1\"\n",
+                   cb_list);
+
+        /* candidates node by node, the first per_node of each node */
+        ad.naggrs = 0;
+        for (j=0; j<nnodes; j++) {
+            int n = 0;
+            for (i=node_first[j]; i<nprocs && n<per_node; i++)
+                if (node_of[i] == j) {
+                    aggrs[ad.naggrs++] = i;
+                    n++;
+                }
+        }
+        if (cb_nodes <= 0) cb_nodes = nnodes;
+        if (cb_nodes < ad.naggrs) ad.naggrs = cb_nodes;
+    }
+    err = MPI_Bcast(&ad.naggrs, 1, MPI_INT, 0, comm);
+    CHECK_MPI_ERROR("MPI_Bcast")
+
+    /* region of the file accessed by all processes. The walk may fail on
+     * some processes only, e.g. those accessing nothing return early, so
+     * all processes skip the analysis together.
+     */
+    ad.first = LLONG_MAX;
+    ad.last  = -1;
+    walked = walk_view(disp, filetype, nbytes, view_extent, &ad);
+    err = MPI_Allreduce(MPI_IN_PLACE, &walked, 1, MPI_INT, MPI_MIN, comm);
+    CHECK_MPI_ERROR("MPI_Allreduce")
+    if (walked != 0) {
+        if (rank == 0)
+            printf("Warning: aggregator analysis skipped, filetype constructor not supported\n");
+        goto err_out;
+    }
+    ext[0] = -ad.first;
+    ext[1] = ad.last;
+    err = MPI_Allreduce(MPI_IN_PLACE, ext, 2, MPI_LONG_LONG, MPI_MAX, comm);
+    CHECK_MPI_ERROR("MPI_Allreduce")
+    ad.first = -ext[0];
+    ad.last  = ext[1];
+    if (ad.last < 0) goto err_out; /* nothing accessed */
+
+    /* file domains */
+    ad.stripe = unit;
+    ad.round_robin = (unit > 0 && factor_src != NULL);
+    ad.fd_start = (MPI_Offset*) malloc(sizeof(MPI_Offset) * (ad.naggrs + 1));
+    fd_size = (ad.last - ad.first + ad.naggrs) / ad.naggrs;
+    ad.fd_start[0] = ad.first;
+    for (i=1; i<=ad.naggrs; i++) {
+        MPI_Offset end = ad.first + i * fd_size;
+        if (unit > 0 && i < ad.naggrs) {
+            /* align to the nearest stripe boundary */
+            MPI_Offset rem = end % unit;
+            end += (rem < unit - rem) ? -rem : unit - rem;
+        }
+        if (end < ad.fd_start[i-1]) end = ad.fd_start[i-1];
+        if (end > ad.last + 1 || i == ad.naggrs) end = ad.last + 1;
+        ad.fd_start[i] = end;
+    }
+
+    /* bytes sent by this process to each aggregator */
+    ad.bytes = (long long*) calloc(ad.naggrs, sizeof(long long));
+    walk_view(disp, filetype, nbytes, domain_bytes, &ad);
+
+    sent = (int*) malloc(sizeof(int) * ad.naggrs);
+    for (i=0; i<ad.naggrs; i++) sent[i] = (ad.bytes[i] > 0);
+    if (rank == 0) {
+        recv = (long long*) malloc(sizeof(long long) * ad.naggrs);
+        senders = (int*) malloc(sizeof(int) * ad.naggrs);
+    }
+    err = MPI_Reduce(ad.bytes, recv, ad.naggrs, MPI_LONG_LONG, MPI_SUM, 0,
+                     comm);
+    CHECK_MPI_ERROR("MPI_Reduce")
+    err = MPI_Reduce(sent, senders, ad.naggrs, MPI_INT, MPI_SUM, 0, comm);
+    CHECK_MPI_ERROR("MPI_Reduce")
+
+    if (rank > 0) goto err_out;
+
+    printf("Aggregators of two-phase collective I/O, modeled after ROMIO:\n");
+    printf("    cb_nodes = %d (%s), cb_config_list = %s (%s)\n", ad.naggrs,
+           (cb_src == NULL) ? "default, number of nodes" : cb_src, cb_list,
+           (list_src == NULL) ? "default" : list_src);
+    if (ad.round_robin)
+        printf("    file domains: stripes of %lld bytes of [%lld, %lld] in round-robin\n",
+               unit, ad.first, ad.last);
+    else
+        printf("    file domains: [%lld, %lld] split evenly%s\n", ad.first,
+               ad.last, (unit > 0) ? ", aligned to striping_unit" : "");
+    printf("    aggr   rank  node                     first byte      last byte  incoming bytes senders\n");
+
+    node_aggrs = (int*) calloc(nnodes, sizeof(int));
+    node_bytes = (long long*) calloc(nnodes, sizeof(long long));
+    max_bytes = 0;
+    mean = 0.0;
+    for (i=0, j=0; i<ad.naggrs; i++) {
+        MPI_Offset lo, hi;
+        int node = node_of[aggrs[i]];
+
+        if (ad.round_robin) {
+            /* first and last stripe of aggregator i in the region */
+            MPI_Offset s = ad.first / unit, e = ad.last / unit;
+            s += ((i - s) % ad.naggrs + ad.naggrs) % ad.naggrs;
+            e -= ((e - i) % ad.naggrs + ad.naggrs) % ad.naggrs;
+            lo = (s > e) ? -1 : ((s * unit < ad.first) ? ad.first : s * unit);
+            hi = (s > e) ? -1 : (((e + 1) * unit - 1 > ad.last) ? ad.last :
+                                 (e + 1) * unit - 1);
+        }
+        else {
+            lo = ad.fd_start[i];
+            hi = ad.fd_start[i+1] - 1;
+            if (hi < lo) lo = hi = -1;
+        }
+        printf("    %4d %6d  %-20.20s %14lld %14lld %15lld %7d\n", i,
+               aggrs[i], names + (size_t)aggrs[i] * MPI_MAX_PROCESSOR_NAME,
+               lo, hi, recv[i], senders[i]);
+
+        node_aggrs[node]++;
+        node_bytes[node] += recv[i];
+        if (recv[i] > max_bytes) max_bytes = recv[i];
+        if (recv[i] == 0) j++;
+        mean += recv[i];
+    }
+    mean /= ad.naggrs;
+    imbal = (mean > 0) ? max_bytes / mean : 0.0;
+    printf("    incoming bytes per aggregator: max = %lld mean = %.1f max/mean = %.2f, %d idle\n",
+           max_bytes, mean, imbal, j);
+
+    printf("    node                  aggregators  incoming bytes\n");
+    max_bytes = 0;
+    node_mean = 0.0;
+    for (j=0; j<nnodes; j++) {
+        printf("    %-20.20s %12d %15lld\n",
+               names + (size_t)node_first[j] * MPI_MAX_PROCESSOR_NAME,
+               node_aggrs[j], node_bytes[j]);
+        if (node_bytes[j] > max_bytes) max_bytes = node_bytes[j];
+        node_mean += node_bytes[j];
+    }
+    node_mean /= nnodes;
+    node_imbal = (node_mean > 0) ? max_bytes / node_mean : 0.0;
+    printf("    incoming bytes per node: max = %lld mean = %.1f max/mean = %.2f\n",
+           max_bytes, node_mean, node_imbal);
+    for (j=0; j<nnodes; j++)
+        if (nnodes > 1 && node_aggrs[j] > (ad.naggrs + nnodes - 1) / nnodes)
+            printf("Warning: node %s runs %d of the %d aggregators\n",
+                   names + (size_t)node_first[j] * MPI_MAX_PROCESSOR_NAME,
+                   node_aggrs[j], ad.naggrs);
+
+    bench_record_int(rec, "aggr_cb_nodes", ad.naggrs);
+    bench_record_double(rec, "aggr_imbalance", imbal);
+    bench_record_double(rec, "aggr_node_imbalance", node_imbal);
+
+err_out:
+    if (used != MPI_INFO_NULL) MPI_Info_free(&used);
+    if (node_bytes != NULL) free(node_bytes);
+    if (node_aggrs != NULL) free(node_aggrs);
+    if (senders != NULL) free(senders);
+    if (recv != NULL) free(recv);
+    if (sent != NULL) free(sent);
+    if (ad.bytes != NULL) free(ad.bytes);
+    if (ad.fd_start != NULL) free(ad.fd_start);
+    if (aggrs != NULL) free(aggrs);
+    if (node_first != NULL) free(node_first);
+    if (node_of != NULL) free(node_of);
+    if (names != NULL) free(names);
+    return nerrs;
+}
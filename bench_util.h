@@ -0,0 +1,322 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Copyright (C) 2026, Northwestern University
+ * See COPYRIGHT notice in top-level directory.
+ *
+ * Common utilities shared by the benchmark programs: error checking macros
+ * and a timer that runs a number of untimed warmup runs followed by a number
+ * of timed repetitions, and reports the min/median/max/stddev of the timings
+ * across all repetitions and all processes, together with the bandwidth.
+ * The results can also be collected into a record and appended as one line
+ * of JSON to a result file, so they can be parsed by regression scripts.
+ *
+ * Typical use:
+ *     bench_timer t;
+ *     bench_timer_init(&t, "collective write", nwarmup, nreps);
+ *     for (i=0; i<nwarmup+nreps; i++) {
+ *         MPI_Barrier(MPI_COMM_WORLD);
+ *         bench_timer_start(&t);
+ *         err = MPI_File_write_all(...); ERR
+ *         bench_timer_stop(&t);
+ *     }
+ *     bench_timer_report(&t, MPI_COMM_WORLD, amount, &rec);
+ *     bench_timer_free(&t);
+ *
+ * where rec is a bench_record created by bench_record_init() and written to
+ * the result file by bench_record_write().
+ *
+ * To break an operation into phases, use one timer per phase and report them
+ * together with bench_phases_report(), which also shows the distribution of
+ * the phase timings among processes. Changes of MPI_T performance variables
+ * during the timed runs can be collected with bench_pvars_start() and
+ * bench_pvars_stop() and reported with bench_pvars_report().
+ *
+ * To sweep over a number of configurations in one run, parse the lists of
+ * values given on the command line by bench_parse_list(), add the timers of
+ * each configuration to a table by bench_sweep_add(), and print the table at
+ * the end by bench_sweep_print().
+ *
+ * MPI-IO hints can be loaded from a hint file of "key value" lines, given by
+ * command-line option '-H' of all programs, by bench_hints_load() into the
+ * info object passed to MPI_File_open() and MPI_File_set_view(). The hints in
+ * effect are then printed by bench_hints_print().
+ *
+ * User buffers in GPU device memory and in pinned host memory, used by
+ * option '-G' of the programs, are allocated by bench_mem_alloc() and copied
+ * by bench_mem_copy(), which call the CUDA or HIP runtime when built with
+ * BENCH_USE_CUDA or BENCH_USE_HIP defined, e.g. by "make ENABLE_GPU=cuda".
+ * Otherwise, only host memory is available and bench_gpu_init() fails.
+ *
+ * User buffers are initialized by bench_fill_block(), an array of 2D slabs
+ * with ghost cells, or bench_fill_pattern(), the byte pattern of
+ * tests/large_dtype.c, and the contents read back are checked by
+ * bench_verify_block(), bench_verify_rows(), and bench_verify_pattern(),
+ * which compare whole rows without branches and run in parallel when built
+ * with OpenMP, e.g. by "make ENABLE_OPENMP=yes". Instead of comparing each
+ * element, the CRC-32C checksums of the rows of each slab, computed by
+ * bench_rows_crc(), can be compared, e.g. by root with the checksums
+ * gathered from the writers, selected by option '-V crc' of the programs.
+ *
+ * The aggregators a two-phase collective write would use for a file view,
+ * their compute nodes, file domains, and the bytes each receives from the
+ * other processes are computed from the filetype and the hints cb_nodes,
+ * cb_config_list, striping_unit, and striping_factor, as ROMIO does, and
+ * printed together with the load imbalance by bench_aggr_report(), used by
+ * option '-A' of the programs.
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <mpi.h>
+
+/* check err, count it in nerrs and jump to label err_out */
+#define CHECK_MPI_ERROR(fname) \
+    if (err != MPI_SUCCESS) { \
+        bench_print_error(err, fname, __LINE__); \
+        nerrs++; \
+        goto err_out; \
+    }
+
+#define ERR CHECK_MPI_ERROR(NULL)
+
+/* check err and count it in nerrs, but continue */
+#define CHECK_ERR(func) { \
+    if (err != MPI_SUCCESS) { \
+        bench_print_error(err, #func, __LINE__); \
+        nerrs++; \
+    } \
+}
+
+/* default number of warmup runs and timed repetitions */
+#define BENCH_NWARMUP 0
+#define BENCH_NREPS   1
+
+typedef struct {
+    const char *name;     /* label used when reporting */
+    int         nwarmup;  /* number of untimed warmup runs */
+    int         nreps;    /* number of timed repetitions */
+    int         nruns;    /* number of runs completed, including warmups */
+    double      start;    /* MPI_Wtime() when the current run started */
+    double     *samples;  /* [nreps] local timings of the timed runs */
+} bench_timer;
+
+typedef struct {
+    int    nsamples;
+    double min, median, max, mean, stddev;
+} bench_stats;
+
+/* A result record of one run of a benchmark program. Only root process 0 of
+ * the communicator passed to bench_record_init() stores the contents, which
+ * are strings of JSON members accumulated by the bench_record_*() calls.
+ */
+typedef struct {
+    int   rank;     /* rank of this process in the communicator */
+    char *head;     /* program, nprocs, nnodes, MPI version, ... */
+    char *params;   /* command-line parameters */
+    char *hints;    /* MPI-IO hints in effect */
+    char *timings;  /* statistics of timers */
+    char *buckets;  /* per-bucket timings */
+    char *phases;   /* per-process distributions of phase timings */
+    char *pvars;    /* changes of MPI_T performance variables */
+} bench_record;
+
+/* default name prefixes of MPI_T performance variables to collect */
+#define BENCH_PVARS "romio,io_"
+
+/* MPI_T performance variables whose names match any of a comma-separated
+ * list of prefixes. Only counters, timers, and aggregates that are not bound
+ * to any MPI object and have a single value are collected.
+ */
+typedef struct {
+    int                 npvars;   /* number of variables collected */
+    int                 nruns;    /* number of bench_pvars_stop() calls */
+    char              **names;    /* [npvars] names of variables */
+    int                *classes;  /* [npvars] MPI_T_PVAR_CLASS_XXX */
+    MPI_Datatype       *dtypes;   /* [npvars] datatypes of values */
+    double             *begin;    /* [npvars] values at bench_pvars_start() */
+    double             *delta;    /* [npvars] accumulated changes */
+    MPI_T_pvar_session  session;
+    MPI_T_pvar_handle  *handles;  /* [npvars] */
+} bench_pvars;
+
+/* kinds of memory of user buffers */
+#define BENCH_MEM_HOST   0  /* malloc() */
+#define BENCH_MEM_DEVICE 1  /* cudaMalloc() or hipMalloc() */
+#define BENCH_MEM_PINNED 2  /* cudaMallocHost() or hipHostMalloc() */
+
+/* ways of checking the contents read back, option '-V' of the programs */
+#define BENCH_VERIFY_NONE 0  /* not checked */
+#define BENCH_VERIFY_ELEM 1  /* compare each element with its expected value */
+#define BENCH_VERIFY_CRC  2  /* compare CRC-32C checksums of the rows */
+
+/* one row of a sweep table: a timer measured for one configuration */
+typedef struct {
+    char      *engine;  /* name of the timer */
+    int        ratio;   /* every ratio processes is a receiver */
+    long long  size;    /* message size in bytes */
+    int        niters;  /* number of iterations per run */
+    double     amnt;    /* bytes accessed by all processes per run */
+    double     min;     /* min of timed runs (max of ranks) */
+    double     median;  /* median of timed runs (max of ranks) */
+} bench_sweep_row;
+
+/* table of the results of all configurations, stored at root process 0 */
+typedef struct {
+    int              nrows;
+    int              nalloc;
+    bench_sweep_row *rows;
+} bench_sweep;
+
+extern void
+bench_print_error(int err, const char *fname, int line);
+
+extern int
+bench_timer_init(bench_timer *t, const char *name, int nwarmup, int nreps);
+
+extern void
+bench_timer_start(bench_timer *t);
+
+extern double
+bench_timer_stop(bench_timer *t);
+
+extern void
+bench_timer_free(bench_timer *t);
+
+extern int
+bench_timer_reduce(const bench_timer *t, MPI_Comm comm, int root,
+                   bench_stats *op, bench_stats *ranks, double *rep_max);
+
+extern int
+bench_timer_report(const bench_timer *t, MPI_Comm comm, double amnt,
+                   bench_record *rec);
+
+extern int
+bench_phases_report(const bench_timer *t, int nphases, MPI_Comm comm,
+                    bench_record *rec);
+
+extern void
+bench_stats_compute(double *samples, int nsamples, bench_stats *st);
+
+extern double
+bench_percentile(const double *sorted, int n, double q);
+
+extern void
+bench_max_timings(double *timing, double *maxt, int n, MPI_Comm comm);
+
+extern int
+bench_record_init(bench_record *rec, MPI_Comm comm, const char *program);
+
+extern void
+bench_record_int(bench_record *rec, const char *key, long long val);
+
+extern void
+bench_record_double(bench_record *rec, const char *key, double val);
+
+extern void
+bench_record_str(bench_record *rec, const char *key, const char *val);
+
+extern int
+bench_record_hints(bench_record *rec, MPI_File fh);
+
+extern void
+bench_record_buckets(bench_record *rec, const bench_timer *t,
+                     const double *maxt, int n);
+
+extern int
+bench_record_write(bench_record *rec, const char *path);
+
+extern void
+bench_record_free(bench_record *rec);
+
+extern int
+bench_pvars_init(bench_pvars *pv, const char *prefixes);
+
+extern void
+bench_pvars_start(bench_pvars *pv);
+
+extern void
+bench_pvars_stop(bench_pvars *pv);
+
+extern int
+bench_pvars_report(const bench_pvars *pv, MPI_Comm comm, bench_record *rec);
+
+extern void
+bench_pvars_free(bench_pvars *pv);
+
+extern int
+bench_parse_list(const char *str, long long **vals);
+
+extern int
+bench_sweep_add(bench_sweep *sw, const bench_timer *t, MPI_Comm comm,
+                int ratio, long long size, int niters, double amnt);
+
+extern void
+bench_sweep_print(const bench_sweep *sw);
+
+extern void
+bench_sweep_free(bench_sweep *sw);
+
+extern double
+bench_peak_rss(MPI_Comm comm);
+
+extern int
+bench_hints_load(const char *path, MPI_Comm comm, MPI_Info *info);
+
+extern int
+bench_hints_print(MPI_File fh, MPI_Comm comm);
+
+extern int
+bench_gpu_init(MPI_Comm comm);
+
+extern void*
+bench_mem_alloc(size_t size, int kind);
+
+extern void
+bench_mem_free(void *ptr, int kind);
+
+extern int
+bench_mem_copy(void *dst, const void *src, size_t size);
+
+extern int
+bench_mem_copy2d(void *dst, size_t dpitch, const void *src, size_t spitch,
+                 size_t width, size_t height);
+
+extern int
+bench_mem_set(void *ptr, int c, size_t size, int kind);
+
+extern int
+bench_verify_mode(const char *name);
+
+extern void
+bench_fill_block(int *buf, int nslabs, int ny, int nx, int ng, int val,
+                 int ghost);
+
+extern long long
+bench_verify_block(const int *buf, int nslabs, int ny, int nx, int ng,
+                   int val, int ghost);
+
+extern long long
+bench_verify_rows(const int *buf, long long nrows, size_t stride, int nx,
+                  int val);
+
+extern void
+bench_fill_pattern(char *buf, size_t n, size_t start);
+
+extern long long
+bench_verify_pattern(const char *buf, size_t n, size_t start);
+
+extern unsigned int
+bench_crc32c(unsigned int crc, const void *buf, size_t size);
+
+extern void
+bench_rows_crc(const int *buf, int nslabs, size_t slab_stride, int ny,
+               size_t stride, int nx, unsigned int *crcs);
+
+extern int
+bench_aggr_report(MPI_File fh, MPI_Info info, MPI_Offset disp,
+                  MPI_Datatype filetype, MPI_Offset nbytes, MPI_Comm comm,
+                  bench_record *rec);
+
+#endif
@@ -6,7 +6,37 @@
  * This program shows how to set a 2D column-wise data partitioning in an MPI
  * derived data type, which is then used to set the file view. The global 2D
  * array is of size (len x number of MPI processes), where len can be set by
- * the command-line option '-l'.
+ * the command-line option '-l'. Option '-c num' gives each process num
+ * columns, making the global array of size (len x (num x nprocs)).
+ *
+ * With the column-wise partitioning, the file view of each process has one
+ * small block per row, the worst case for two-phase I/O. Command-line option
+ * '-t' adds a transposed-aggregation path, which first redistributes the
+ * array by MPI_Alltoallw() to a row-block partitioning, where each process
+ * receives from all others into a vector datatype of its row block, and then
+ * writes the contiguous row block by MPI_File_write_at_all(). The construction
+ * of the datatypes for the redistribution is not timed. The times of both
+ * paths are reported, together with the time of MPI_Alltoallw() alone, and
+ * the file contents written by each path are read back and checked.
+ *
+ * Command-line option '-L list' sweeps over the numbers of columns per
+ * process, i.e. the row lengths, and prints a table of the times of both
+ * paths and the break-even row length, where the direct write of the
+ * column-wise file view becomes as fast as the transposed path, linearly
+ * interpolated between the two row lengths in the list at which the faster
+ * path changes.
+ *
+ * Example run command and output on screen:
+ *   % mpiexec -n 4 ./column_wise -l 256 -L 1,16,256,1024,4096,16384 -N 3 -o testfile
+ *   ---- direct writes of column-wise file view vs. transposed aggregation
+ *      ncols  row_bytes   direct(ms) alltoallw(ms) transposed(ms)     faster
+ *          1         16        1.241         0.026          0.123 transposed
+ *         16        256        1.195         0.074          0.222 transposed
+ *        256       4096        1.742         0.361          0.862 transposed
+ *       1024      16384        3.097         1.009          2.504 transposed
+ *       4096      65536       19.138         3.701          8.706 transposed
+ *      16384     262144       44.656        17.327         59.199     direct
+ *     break-even row length = 147656 bytes, between 65536 and 262144
  *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
@@ -17,37 +47,285 @@
 
 #include <mpi.h>
 
-#define ERR \
-    if (err != MPI_SUCCESS) { \
-        int errorStringLen; \
-        char errorString[MPI_MAX_ERROR_STRING]; \
-        MPI_Error_string(err, errorString, &errorStringLen); \
-        printf("Error at line %d: %s\n",__LINE__,errorString); \
-        nerrs++; \
-        goto err_out; \
+#include "bench_util.h"
+
+/* medians of the timers of one configuration, at root process */
+typedef struct {
+    long long ncols;
+    double    direct, alltoallw, transposed;
+} result;
+
+/*----< check_file() >-------------------------------------------------------*/
+/* Collective call. Read back the row block rows [row_start, row_start+nrows)
+ * of the global array of gcols columns and check its contents. Return the
+ * number of errors of this process.
+ */
+static int
+check_file(MPI_File fh, long long row_start, int nrows, int gcols)
+{
+    int err, nerrs=0, rank;
+    size_t i, n = (size_t)nrows * gcols;
+    float *vbuf;
+    MPI_Status status;
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    vbuf = (float*) malloc(sizeof(float) * (n + 1));
+    err = MPI_File_set_view(fh, 0, MPI_BYTE, MPI_BYTE, "native",
+                            MPI_INFO_NULL); ERR
+    err = MPI_File_read_at_all(fh, row_start * gcols * sizeof(float), vbuf,
+                               n, MPI_FLOAT, &status); ERR
+    for (i=0; i<n; i++) {
+        float exp = (float)(row_start * gcols + i);
+        if (vbuf[i] != exp) {
+            printf("Error: rank %d file element %lld expect %.1f but got %.1f\n",
+                   rank, row_start * gcols + (long long)i, exp, vbuf[i]);
+            nerrs++;
+            break;
+        }
     }
 
+err_out:
+    free(vbuf);
+    return nerrs;
+}
+
+/*----< run_config() >-------------------------------------------------------*/
+/* write the global array of len rows and ncols columns per process by the
+ * column-wise file view and, if transpose is set, by the transposed path
+ */
+static int
+run_config(const char *filename,
+           MPI_Info    info,
+           int         len,
+           int         ncols,
+           int         transpose,
+           int         nwarmup,
+           int         nreps,
+           int         report,
+           result     *res)
+{
+    int i, j, err, nerrs=0, rank, nprocs, omode, gcols, nrows;
+    int sizes[2], subsizes[2], starts[2];
+    int *scounts=NULL, *sdispls=NULL, *rcounts=NULL, *rdispls=NULL;
+    long long *row_start=NULL;
+    float *buf=NULL, *rbuf=NULL;
+    double amnt;
+    bench_timer t_direct, t_a2a, t_trans;
+    bench_stats st;
+    MPI_Datatype fileType, *stypes=NULL, *rtypes=NULL;
+    MPI_File fh=MPI_FILE_NULL;
+    MPI_Status status;
+
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    gcols = ncols * nprocs;
+    amnt  = (double)len * gcols * sizeof(float);
+
+    bench_timer_init(&t_direct, "write_all of column-wise view", nwarmup,
+                     nreps);
+    bench_timer_init(&t_a2a, "alltoallw to row blocks", nwarmup, nreps);
+    bench_timer_init(&t_trans, "transposed alltoallw + write_at_all",
+                     nwarmup, nreps);
+
+    /* element (i, j) of the global array is i * gcols + j */
+    buf = (float*) malloc(sizeof(float) * len * ncols);
+    for (i=0; i<len; i++)
+        for (j=0; j<ncols; j++)
+            buf[i*ncols + j] = (float)((long long)i * gcols + rank * ncols + j);
+
+    /* construct filetype */
+    sizes[0]    = len;
+    sizes[1]    = gcols;
+    subsizes[0] = len;
+    subsizes[1] = ncols;
+    starts[0]   = 0;
+    starts[1]   = rank * ncols;
+
+    err = MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C,
+                                   MPI_FLOAT, &fileType); ERR
+    err = MPI_Type_commit(&fileType); ERR
+
+    /* open file and truncate it to zero sized */
+    omode = MPI_MODE_CREATE | MPI_MODE_RDWR;
+    err = MPI_File_open(MPI_COMM_WORLD, filename, omode, info, &fh); ERR
+    err = MPI_File_set_size(fh, 0); ERR
+
+    /* set the file view */
+    err = MPI_File_set_view(fh, 0, MPI_BYTE, fileType, "native", info); ERR
+    err = MPI_Type_free(&fileType); ERR
+
+    /* write to the file */
+    for (i=0; i<nwarmup+nreps; i++) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&t_direct);
+        err = MPI_File_write_all(fh, buf, len*ncols, MPI_FLOAT, &status); ERR
+        bench_timer_stop(&t_direct);
+    }
+
+    /* row blocks of the row-block partitioning */
+    row_start = (long long*) malloc(sizeof(long long) * (nprocs + 1));
+    for (i=0; i<=nprocs; i++)
+        row_start[i] = (long long)len * i / nprocs;
+    nrows = row_start[rank+1] - row_start[rank];
+
+    /* all processes stop together if any check fails */
+    nerrs += check_file(fh, row_start[rank], nrows, gcols);
+    MPI_Allreduce(MPI_IN_PLACE, &nerrs, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    if (nerrs > 0) goto err_out;
+
+    if (transpose) {
+        /* send rows of row block of process j, contiguous in buf, and
+         * receive columns of process j into a vector of the row block
+         */
+        scounts = (int*) malloc(sizeof(int) * nprocs * 4);
+        sdispls = scounts + nprocs;
+        rcounts = sdispls + nprocs;
+        rdispls = rcounts + nprocs;
+        stypes  = (MPI_Datatype*) malloc(sizeof(MPI_Datatype) * nprocs * 2);
+        rtypes  = stypes + nprocs;
+        for (j=0; j<nprocs; j++) rtypes[j] = MPI_DATATYPE_NULL;
+        for (j=0; j<nprocs; j++) {
+            scounts[j] = (row_start[j+1] - row_start[j]) * ncols;
+            sdispls[j] = row_start[j] * ncols * sizeof(float);
+            stypes[j]  = MPI_FLOAT;
+            rcounts[j] = 1;
+            rdispls[j] = j * ncols * sizeof(float);
+            err = MPI_Type_vector(nrows, ncols, gcols, MPI_FLOAT, &rtypes[j]);
+            ERR
+            err = MPI_Type_commit(&rtypes[j]); ERR
+        }
+        rbuf = (float*) malloc(sizeof(float) * ((size_t)nrows * gcols + 1));
+
+        err = MPI_File_set_size(fh, 0); ERR
+        err = MPI_File_set_view(fh, 0, MPI_BYTE, MPI_BYTE, "native", info);
+        ERR
+
+        for (i=0; i<nwarmup+nreps; i++) {
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&t_trans);
+            bench_timer_start(&t_a2a);
+            err = MPI_Alltoallw(buf, scounts, sdispls, stypes, rbuf, rcounts,
+                                rdispls, rtypes, MPI_COMM_WORLD); ERR
+            bench_timer_stop(&t_a2a);
+            err = MPI_File_write_at_all(fh, row_start[rank] * gcols *
+                                        sizeof(float), rbuf, nrows * gcols,
+                                        MPI_FLOAT, &status); ERR
+            bench_timer_stop(&t_trans);
+        }
+
+        nerrs += check_file(fh, row_start[rank], nrows, gcols);
+        MPI_Allreduce(MPI_IN_PLACE, &nerrs, 1, MPI_INT, MPI_SUM,
+                      MPI_COMM_WORLD);
+        if (nerrs > 0) goto err_out;
+
+        for (j=0; j<nprocs; j++) {
+            err = MPI_Type_free(&rtypes[j]); ERR
+        }
+    }
+
+    err = MPI_File_close(&fh); ERR
+
+    if (report) {
+        err = bench_timer_report(&t_direct, MPI_COMM_WORLD, amnt, NULL); ERR
+        if (transpose) {
+            err = bench_timer_report(&t_a2a, MPI_COMM_WORLD, amnt, NULL); ERR
+            err = bench_timer_report(&t_trans, MPI_COMM_WORLD, amnt, NULL);
+            ERR
+        }
+    }
+
+    res->ncols = ncols;
+    err = bench_timer_reduce(&t_direct, MPI_COMM_WORLD, 0, &st, NULL, NULL);
+    ERR
+    res->direct = st.median;
+    if (transpose) {
+        err = bench_timer_reduce(&t_a2a, MPI_COMM_WORLD, 0, &st, NULL, NULL);
+        ERR
+        res->alltoallw = st.median;
+        err = bench_timer_reduce(&t_trans, MPI_COMM_WORLD, 0, &st, NULL, NULL);
+        ERR
+        res->transposed = st.median;
+    }
+
+err_out:
+    /* freed above unless an error occurred */
+    if (rtypes != NULL)
+        for (j=0; j<nprocs; j++)
+            if (rtypes[j] != MPI_DATATYPE_NULL) MPI_Type_free(&rtypes[j]);
+    if (fh != MPI_FILE_NULL) MPI_File_close(&fh);
+    bench_timer_free(&t_direct);
+    bench_timer_free(&t_a2a);
+    bench_timer_free(&t_trans);
+    if (buf       != NULL) free(buf);
+    if (rbuf      != NULL) free(rbuf);
+    if (row_start != NULL) free(row_start);
+    if (scounts   != NULL) free(scounts);
+    if (stypes    != NULL) free(stypes);
+    return nerrs;
+}
+
+/*----< print_break_even() >-------------------------------------------------*/
+/* print the table of both paths and the break-even row length */
+static void
+print_break_even(const result *res, int nres, int nprocs)
+{
+    int i;
+    double d0, d1, x0, x1;
+
+    printf("---- direct writes of column-wise file view vs. transposed aggregation\n");
+    printf("  %6s %10s %12s %13s %14s %10s\n", "ncols", "row_bytes",
+           "direct(ms)", "alltoallw(ms)", "transposed(ms)", "faster");
+    for (i=0; i<nres; i++)
+        printf("  %6lld %10lld %12.3f %13.3f %14.3f %10s\n", res[i].ncols,
+               res[i].ncols * nprocs * (long long)sizeof(float),
+               res[i].direct * 1e3, res[i].alltoallw * 1e3,
+               res[i].transposed * 1e3,
+               (res[i].direct <= res[i].transposed) ? "direct" : "transposed");
+
+    for (i=1; i<nres; i++) {
+        d0 = res[i-1].direct - res[i-1].transposed;
+        d1 = res[i].direct   - res[i].transposed;
+        if ((d0 > 0.0) == (d1 > 0.0)) continue;
+        x0 = res[i-1].ncols * nprocs * sizeof(float);
+        x1 = res[i].ncols   * nprocs * sizeof(float);
+        printf("  break-even row length = %.0f bytes, between %.0f and %.0f\n",
+               x0 + (x1 - x0) * d0 / (d0 - d1), x0, x1);
+        return;
+    }
+    if (nres > 1)
+        printf("  no break-even row length in the list, %s path is faster\n",
+               (res[0].direct <= res[0].transposed) ? "direct" : "transposed");
+}
+
 /*----< usage() >------------------------------------------------------------*/
 static void usage (char *argv0) {
     char *help = "Usage: %s [OPTION]\n\
        [-h] Print this help message\n\
        [-v] Verbose mode (default: no)\n\
        [-l len] length of Y dimension (default: 10)\n\
+       [-c num] number of columns per process (default: 1)\n\
+       [-t] also write by redistributing to row blocks by MPI_Alltoallw\n\
+       [-L list] sweep over numbers of columns per process, implies -t,\n\
+                 list is comma-separated values or ranges lo:hi[:factor]\n\
+       [-W num] number of untimed warmup runs (default: %d)\n\
+       [-N num] number of timed repetitions (default: %d)\n\
+       [-H file] load MPI-IO hints from file of \"key value\" lines\n\
        [-o path] Output file path\n";
-    fprintf (stderr, help, argv0);
+    fprintf (stderr, help, argv0, BENCH_NWARMUP, BENCH_NREPS);
 }
 
 /*----< main() >------------------------------------------------------------*/
 int main(int argc, char **argv) {
     extern int optind;
     extern char *optarg;
-    char *filename;
-    int i, rank, nprocs, err, nerrs=0, verbose, omode, len;
-    int sizes[2], subsizes[2], starts[2];
-    float *buf;
-    MPI_Datatype fileType;
+    char *filename=NULL, *hints_file=NULL, *ncols_list=NULL;
+    int i, rank, nprocs, err, nerrs=0, verbose, len, ncols, transpose;
+    int nwarmup, nreps, nres;
+    long long *ncols_vals=NULL;
+    result *res=NULL;
     MPI_File fh;
-    MPI_Status status;
     MPI_Info info=MPI_INFO_NULL;
 
     MPI_Init(&argc, &argv);
@@ -56,8 +334,12 @@ int main(int argc, char **argv) {
 
     verbose = 0;
     len = 10;
+    ncols = 1;
+    transpose = 0;
+    nwarmup = BENCH_NWARMUP;
+    nreps = BENCH_NREPS;
     /* command-line arguments */
-    while ((i = getopt (argc, argv, "hvl:o:")) != EOF)
+    while ((i = getopt (argc, argv, "hvl:c:tL:W:N:o:H:")) != EOF)
         switch (i) {
             case 'v':
                 verbose = 1;
@@ -65,9 +347,28 @@ int main(int argc, char **argv) {
             case 'l':
                 len = atoi(optarg);
                 break;
+            case 'c':
+                ncols = atoi(optarg);
+                break;
+            case 't':
+                transpose = 1;
+                break;
+            case 'L':
+                ncols_list = optarg;
+                transpose = 1;
+                break;
+            case 'W':
+                nwarmup = atoi(optarg);
+                break;
+            case 'N':
+                nreps = atoi(optarg);
+                break;
             case 'o':
                 filename = strdup(optarg);
                 break;
+            case 'H':
+                hints_file = optarg;
+                break;
             case 'h':
             default:
                 if (rank == 0) usage(argv[0]);
@@ -79,39 +380,55 @@ int main(int argc, char **argv) {
         goto err_out;
     }
 
-    buf = (float*) malloc(sizeof(float) * len);
-
-    /* construct filetype */
-    sizes[0]    = len;
-    sizes[1]    = nprocs;
-    subsizes[0] = len;
-    subsizes[1] = 1;
-    starts[0]   = 0;
-    starts[1]   = rank;
+    /* a single configuration unless a list is given */
+    if (ncols_list != NULL)
+        nres = bench_parse_list(ncols_list, &ncols_vals);
+    else {
+        nres = 1;
+        ncols_vals = (long long*) malloc(sizeof(long long));
+        ncols_vals[0] = ncols;
+    }
+    if (nres <= 0) {
+        if (rank == 0)
+            printf("Error: invalid list of command-line option '-L'\n");
+        nerrs++;
+        goto err_out;
+    }
 
-    err = MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C,
-                                   MPI_FLOAT, &fileType); ERR
-    err = MPI_Type_commit(&fileType); ERR
+    /* load user I/O hints from the hint file, if given */
+    if (bench_hints_load(hints_file, MPI_COMM_WORLD, &info) != 0) goto err_out;
 
-    /* open file and truncate it to zero sized */
-    omode = MPI_MODE_CREATE | MPI_MODE_RDWR;
-    err = MPI_File_open(MPI_COMM_WORLD, filename, omode, info, &fh); ERR
-    err = MPI_File_set_size(fh, 0); ERR
-
-    /* set the file view */
-    err = MPI_File_set_view(fh, 0, MPI_BYTE, fileType, "native", info); ERR
-    err = MPI_Type_free(&fileType); ERR
+    if (hints_file != NULL) {
+        /* print the hints in effect */
+        err = MPI_File_open(MPI_COMM_WORLD, filename,
+                            MPI_MODE_CREATE | MPI_MODE_RDWR, info, &fh); ERR
+        err = bench_hints_print(fh, MPI_COMM_WORLD); ERR
+        err = MPI_File_close(&fh); ERR
+    }
 
-    /* write to the file */
-    err = MPI_File_write_all(fh, buf, len, MPI_FLOAT, &status); ERR
+    if (verbose && rank == 0) {
+        printf("number of MPI processes = %d\n", nprocs);
+        printf("number of rows          = %d\n", len);
+        printf("number of repetitions   = %d warmup, %d timed\n", nwarmup, nreps);
+    }
 
-    MPI_File_close(&fh);
+    res = (result*) calloc(nres, sizeof(result));
+    for (i=0; i<nres; i++) {
+        if (verbose && rank == 0)
+            printf("columns per process     = %lld\n", ncols_vals[i]);
+        nerrs += run_config(filename, info, len, ncols_vals[i], transpose,
+                            nwarmup, nreps, (nres == 1), res + i);
+        if (nerrs > 0) break;
+    }
 
-    free(buf);
+    if (nerrs == 0 && transpose && rank == 0)
+        print_break_even(res, nres, nprocs);
 
 err_out:
+    if (info != MPI_INFO_NULL) MPI_Info_free(&info);
+    if (filename != NULL) free(filename);
+    if (ncols_vals != NULL) free(ncols_vals);
+    if (res != NULL) free(res);
     MPI_Finalize();
-    return 0;
+    return (nerrs > 0);
 }
-
-
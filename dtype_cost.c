@@ -0,0 +1,647 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Copyright (C) 2026, Northwestern University
+ * See COPYRIGHT notice in top-level directory.
+ *
+ * This program measures the cost of constructing the fileview datatype of
+ * multiple variables, the same one built in different ways by
+ * indexed_fsize.c, hindexed_fsize.c, struct_fsize.c, nvars.c, and
+ * tests/pio_noncontig.c. Each variable is a 2D global array of MPI_BYTE
+ * partitioned among processes in a 2D block-block fashion, and the subarrays
+ * of all variables are concatenated by one of the following constructions,
+ * selected by command-line option '-t'.
+ *     indexed    - MPI_Type_indexed() of a single subarray datatype
+ *     hindexed   - MPI_Type_create_hindexed() of a single subarray datatype
+ *     struct     - MPI_Type_create_struct() of a single subarray datatype
+ *     subarrays  - MPI_Type_create_struct() of one subarray datatype created
+ *                  per variable, as of tests/pio_noncontig.c
+ *     subarray3d - one 3D subarray datatype whose most significant dimension
+ *                  is the variables, possible only when all variables are of
+ *                  the same size
+ *
+ * For each number of variables (option '-n') and number of processes (option
+ * '-P', using the first processes of MPI_COMM_WORLD), each construction is
+ * run nwarmup + nreps times by the 4 steps below, each timed separately.
+ *     build    - create the datatype, including the subarray datatypes
+ *     commit   - MPI_Type_commit()
+ *     set_view - MPI_File_set_view(), where the file view is flattened
+ *     free     - MPI_Type_free()
+ * The file is opened once per number of processes and the view is reset to
+ * MPI_BYTE after each run, untimed. The heap memory retained by commit and
+ * by set_view is obtained from mallinfo2() of glibc, the change of the bytes
+ * in use, and shown as -1 when it is not available.
+ *
+ * Root process also reports the depth of the datatype tree and the number of
+ * derived datatypes in it, found recursively by MPI_Type_get_envelope() and
+ * MPI_Type_get_contents(), and the number of contiguous segments of its file
+ * view. As the flattened representation of the MPI-IO library is not
+ * exposed, the segments are counted by unpacking a stream of nonzero bytes
+ * by the datatype into a zero-filled buffer, which merges adjacent blocks
+ * the same way flattening does. This is skipped, shown as -1, when the
+ * extent is larger than 256 MiB. All constructions must have the same type
+ * size and number of segments, otherwise an error is reported.
+ *
+ * To compile:
+ *   % mpicc -O2 dtype_cost.c bench_util.c -o dtype_cost -lm
+ *
+ * Example run command and output on screen:
+ *   % mpiexec -n 4 ./dtype_cost -n 100,1100 -N 3 -f testfile
+ *   -----------------------------------------------------------------------------------------------------------
+ *   nprocs  nvars constructor     build    commit  set_view      free heap_commit heap_view depth  nodes  segments
+ *                                (msec)    (msec)    (msec)    (msec)       (KiB)     (KiB)
+ *   -----------------------------------------------------------------------------------------------------------
+ *        4    100 indexed         0.004     0.000     0.116     0.000         0.0      25.4     2      2      1600
+ *        4    100 hindexed        0.002     0.000     0.062     0.000         0.0      25.3     2      2      1600
+ *        4    100 struct          0.003     0.000     0.069     0.000         0.0      25.3     2    101      1600
+ *        4    100 subarrays       0.066     0.002     0.126     0.000         6.3      38.2     2    101      1600
+ *        4    100 subarray3d      0.002     0.000     0.102     0.000         0.0      25.2     1      1      1600
+ *        4   1100 indexed         0.021     0.001     1.008     0.001         0.0     275.4     2      2     17600
+ *        4   1100 hindexed        0.017     0.001     1.240     0.001         0.0     275.4     2      2     17600
+ *        4   1100 struct          0.018     0.001     0.880     0.000         0.0     275.3     2   1101     17600
+ *        4   1100 subarrays       0.850     0.030     1.689     0.001        68.8     413.9     2   1101     17600
+ *        4   1100 subarray3d      0.003     0.001     0.923     0.001         0.0     275.3     1      1     17600
+ *   -----------------------------------------------------------------------------------------------------------
+ *   Timings are the medians of timed runs, each the max among processes
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>   /* getopt() */
+#include <malloc.h>   /* mallinfo2() */
+
+#include <mpi.h>
+
+#include "bench_util.h"
+
+/* max extent of a datatype whose segments are counted */
+#define MAX_SEG_EXTENT (256 * 1048576LL)
+
+#define NCTORS 5
+static const char *ctor_names[NCTORS] = {"indexed", "hindexed", "struct",
+                                         "subarrays", "subarray3d"};
+
+#define NSTEPS 4
+static const char *step_names[NSTEPS] = {"build", "commit", "set_view",
+                                         "free"};
+
+/* results of one construction, stored at root process */
+typedef struct {
+    int       nprocs;
+    int       nvars;
+    int       ctor;
+    double    median[NSTEPS];  /* median of timed runs (max of processes) */
+    double    heap_commit;     /* bytes retained by commit (max of processes) */
+    double    heap_view;       /* bytes retained by set_view */
+    int       depth;           /* depth of datatype tree */
+    long long nodes;           /* number of derived datatypes in the tree */
+    long long nsegs;           /* number of contiguous segments */
+} result;
+
+static int      verbose;
+static int      nresults;
+static result  *results;
+
+/*----< heap_in_use() >------------------------------------------------------*/
+/* return the bytes of heap memory allocated by malloc and in use, or -1 if
+ * it is not available
+ */
+static double
+heap_in_use(void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    struct mallinfo2 mi = mallinfo2();
+    return (double)mi.uordblks + (double)mi.hblkhd;
+#else
+    return -1.0;
+#endif
+}
+
+/*----< build_type() >-------------------------------------------------------*/
+/* construct the fileview datatype of nvars variables by construction ctor */
+static int
+build_type(int           ctor,
+           int           nvars,
+           int           len,
+           const int    *psizes,
+           const int    *coords,
+           MPI_Datatype *fileType)
+{
+    int i, err=MPI_SUCCESS, nerrs=0, sizes[3], subsizes[3], starts[3];
+    int *blks=NULL, *disp=NULL;
+    MPI_Aint gsize, *adisp=NULL;
+    MPI_Datatype subType, *types=NULL;
+
+    sizes[0]    = len * psizes[0];
+    sizes[1]    = len * psizes[1];
+    subsizes[0] = len;
+    subsizes[1] = len;
+    starts[0]   = len * coords[0];
+    starts[1]   = len * coords[1];
+    gsize = (MPI_Aint)sizes[0] * sizes[1];
+
+    if (nvars < 1) {
+        printf("Error: number of variables %d must be positive\n", nvars);
+        return 1;
+    }
+
+    if (ctor == 4) { /* subarray3d */
+        int sizes3[3], subsizes3[3], starts3[3];
+        sizes3[0] = subsizes3[0] = nvars;
+        starts3[0] = 0;
+        for (i=0; i<2; i++) {
+            sizes3[i+1]    = sizes[i];
+            subsizes3[i+1] = subsizes[i];
+            starts3[i+1]   = starts[i];
+        }
+        /* returns before the arrays below are allocated */
+        err = MPI_Type_create_subarray(3, sizes3, subsizes3, starts3,
+                                       MPI_ORDER_C, MPI_BYTE, fileType);
+        CHECK_ERR(MPI_Type_create_subarray)
+        return nerrs;
+    }
+
+    blks  = (int*) malloc(sizeof(int) * nvars);
+    adisp = (MPI_Aint*) malloc(sizeof(MPI_Aint) * nvars);
+    for (i=0; i<nvars; i++) {
+        blks[i]  = 1;
+        adisp[i] = gsize * i;
+    }
+
+    if (ctor == 3) { /* subarrays, one subarray datatype per variable */
+        types = (MPI_Datatype*) malloc(sizeof(MPI_Datatype) * nvars);
+        for (i=0; i<nvars; i++) {
+            err = MPI_Type_create_subarray(2, sizes, subsizes, starts,
+                                           MPI_ORDER_C, MPI_BYTE, &types[i]);
+            ERR
+        }
+        err = MPI_Type_create_struct(nvars, blks, adisp, types, fileType); ERR
+        for (i=0; i<nvars; i++) {
+            err = MPI_Type_free(&types[i]); ERR
+        }
+        goto err_out;
+    }
+
+    err = MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C,
+                                   MPI_BYTE, &subType); ERR
+
+    if (ctor == 0) { /* indexed, displacements in extents of subType */
+        disp = (int*) malloc(sizeof(int) * nvars);
+        for (i=0; i<nvars; i++) disp[i] = i;
+        err = MPI_Type_indexed(nvars, blks, disp, subType, fileType); ERR
+    }
+    else if (ctor == 1) { /* hindexed, displacements in bytes */
+        err = MPI_Type_create_hindexed(nvars, blks, adisp, subType, fileType);
+        ERR
+    }
+    else { /* struct of the same subType */
+        types = (MPI_Datatype*) malloc(sizeof(MPI_Datatype) * nvars);
+        for (i=0; i<nvars; i++) types[i] = subType;
+        err = MPI_Type_create_struct(nvars, blks, adisp, types, fileType); ERR
+    }
+    err = MPI_Type_free(&subType); ERR
+
+err_out:
+    if (blks  != NULL) free(blks);
+    if (disp  != NULL) free(disp);
+    if (adisp != NULL) free(adisp);
+    if (types != NULL) free(types);
+    return nerrs;
+}
+
+/*----< type_tree() >--------------------------------------------------------*/
+/* walk the tree of datatype dtype by MPI_Type_get_envelope() and
+ * MPI_Type_get_contents() and update its depth and number of derived
+ * datatypes
+ */
+static int
+type_tree(MPI_Datatype  dtype,
+          int           level,
+          int          *depth,
+          long long    *nodes)
+{
+    int i, err, nerrs=0, nints, naddrs, ntypes, combiner, *ints=NULL;
+    MPI_Aint *addrs=NULL;
+    MPI_Datatype *types=NULL;
+
+    err = MPI_Type_get_envelope(dtype, &nints, &naddrs, &ntypes, &combiner);
+    ERR
+    if (combiner == MPI_COMBINER_NAMED) return 0;
+
+    (*nodes)++;
+    if (level > *depth) *depth = level;
+
+    ints  = (int*) malloc(sizeof(int) * (nints + 1));
+    addrs = (MPI_Aint*) malloc(sizeof(MPI_Aint) * (naddrs + 1));
+    types = (MPI_Datatype*) malloc(sizeof(MPI_Datatype) * (ntypes + 1));
+    err = MPI_Type_get_contents(dtype, nints, naddrs, ntypes, ints, addrs,
+                                types); ERR
+
+    for (i=0; i<ntypes; i++) {
+        int ni, na, nt, comb;
+        nerrs += type_tree(types[i], level + 1, depth, nodes);
+        /* derived datatypes returned by MPI_Type_get_contents must be freed */
+        err = MPI_Type_get_envelope(types[i], &ni, &na, &nt, &comb); ERR
+        if (comb != MPI_COMBINER_NAMED) {
+            err = MPI_Type_free(&types[i]); ERR
+        }
+    }
+
+err_out:
+    if (ints  != NULL) free(ints);
+    if (addrs != NULL) free(addrs);
+    if (types != NULL) free(types);
+    return nerrs;
+}
+
+/*----< count_segments() >---------------------------------------------------*/
+/* count the contiguous segments of datatype dtype by unpacking nonzero bytes
+ * into a zero-filled buffer of its true extent. Return -1 if the extent is
+ * larger than MAX_SEG_EXTENT.
+ */
+static long long
+count_segments(MPI_Datatype dtype)
+{
+    int err, pos=0, size;
+    char *src, *dst;
+    long long i, nsegs=0;
+    MPI_Aint lb, extent;
+
+    err = MPI_Type_size(dtype, &size);
+    if (err != MPI_SUCCESS) return -1;
+    err = MPI_Type_get_true_extent(dtype, &lb, &extent);
+    if (err != MPI_SUCCESS || extent > MAX_SEG_EXTENT) return -1;
+
+    src = (char*) malloc(size + 1);
+    dst = (char*) calloc(extent + 1, 1);
+    memset(src, 0xff, size);
+
+    err = MPI_Unpack(src, size, &pos, dst - lb, 1, dtype, MPI_COMM_SELF);
+    if (err != MPI_SUCCESS)
+        nsegs = -1;
+    else {
+        for (i=0; i<extent; i++)
+            if (dst[i] != 0 && (i == 0 || dst[i-1] == 0)) nsegs++;
+    }
+
+    free(dst);
+    free(src);
+    return nsegs;
+}
+
+/*----< run_config() >-------------------------------------------------------*/
+/* run construction ctor of nvars variables on communicator comm nwarmup +
+ * nreps times and add its results into the table at root
+ */
+static int
+run_config(MPI_Comm    comm,
+           MPI_File    fh,
+           MPI_Info    info,
+           int         ctor,
+           int         nvars,
+           int         len,
+           int         nwarmup,
+           int         nreps,
+           const char *out_file)
+{
+    int i, j, err, nerrs=0, rank, nprocs, psizes[2], coords[2];
+    double heap[2], max_heap[2], mark=0.0;
+    bench_timer timers[NSTEPS];
+    bench_stats st;
+    bench_record rec;
+    MPI_Datatype fileType;
+    result r;
+
+    MPI_Comm_size(comm, &nprocs);
+    MPI_Comm_rank(comm, &rank);
+
+    psizes[0] = psizes[1] = 0;
+    err = MPI_Dims_create(nprocs, 2, psizes);
+    if (err != MPI_SUCCESS) return 1;
+    coords[0] = rank / psizes[1];
+    coords[1] = rank % psizes[1];
+
+    for (j=0; j<NSTEPS; j++)
+        bench_timer_init(&timers[j], step_names[j], nwarmup, nreps);
+
+    heap[0] = heap[1] = 0.0;
+    for (i=0; i<nwarmup+nreps; i++) {
+        MPI_Barrier(comm);
+        bench_timer_start(&timers[0]);
+        nerrs += build_type(ctor, nvars, len, psizes, coords, &fileType);
+        bench_timer_stop(&timers[0]);
+        if (nerrs > 0) goto err_out;
+
+        mark = heap_in_use();
+        bench_timer_start(&timers[1]);
+        err = MPI_Type_commit(&fileType); ERR
+        bench_timer_stop(&timers[1]);
+        if (mark >= 0) heap[0] = heap_in_use() - mark;
+
+        MPI_Barrier(comm);
+        mark = heap_in_use();
+        bench_timer_start(&timers[2]);
+        err = MPI_File_set_view(fh, 0, MPI_BYTE, fileType, "native", info);
+        ERR
+        bench_timer_stop(&timers[2]);
+        if (mark >= 0) heap[1] = heap_in_use() - mark;
+
+        bench_timer_start(&timers[3]);
+        err = MPI_Type_free(&fileType); ERR
+        bench_timer_stop(&timers[3]);
+
+        /* reset the view so the flattened file view is released */
+        err = MPI_File_set_view(fh, 0, MPI_BYTE, MPI_BYTE, "native", info);
+        ERR
+    }
+    if (mark < 0) heap[0] = heap[1] = -1.0;
+
+    memset(&r, 0, sizeof(result));
+    r.nprocs = nprocs;
+    r.nvars  = nvars;
+    r.ctor   = ctor;
+    for (j=0; j<NSTEPS; j++) {
+        err = bench_timer_reduce(&timers[j], comm, 0, &st, NULL, NULL); ERR
+        r.median[j] = st.median;
+    }
+    MPI_Reduce(heap, max_heap, 2, MPI_DOUBLE, MPI_MAX, 0, comm);
+    r.heap_commit = max_heap[0];
+    r.heap_view   = max_heap[1];
+
+    /* inspect the datatype of root process */
+    if (rank == 0) {
+        int size;
+        nerrs += build_type(ctor, nvars, len, psizes, coords, &fileType);
+        if (nerrs == 0) {
+            err = MPI_Type_commit(&fileType); ERR
+            err = MPI_Type_size(fileType, &size); ERR
+            if (size != nvars * len * len) {
+                printf("Error: %s type size %d, but expect %d\n",
+                       ctor_names[ctor], size, nvars * len * len);
+                nerrs++;
+            }
+            nerrs += type_tree(fileType, 1, &r.depth, &r.nodes);
+            r.nsegs = count_segments(fileType);
+            err = MPI_Type_free(&fileType); ERR
+        }
+
+        /* all constructions of the same nprocs and nvars must agree */
+        for (i=nresults-1; i>=0; i--) {
+            if (results[i].nprocs != nprocs || results[i].nvars != nvars)
+                break;
+            if (results[i].nsegs != r.nsegs) {
+                printf("Error: %s has %lld segments, but %s has %lld\n",
+                       ctor_names[ctor], r.nsegs,
+                       ctor_names[results[i].ctor], results[i].nsegs);
+                nerrs++;
+                break;
+            }
+        }
+
+        results = (result*) realloc(results, sizeof(result) * (nresults + 1));
+        results[nresults++] = r;
+
+        if (verbose)
+            printf("nprocs=%d nvars=%d %s: build=%.3f commit=%.3f set_view=%.3f free=%.3f msec\n",
+                   nprocs, nvars, ctor_names[ctor], r.median[0] * 1e3,
+                   r.median[1] * 1e3, r.median[2] * 1e3, r.median[3] * 1e3);
+    }
+
+    /* append the results of this construction to the result file */
+    bench_record_init(&rec, comm, "dtype_cost");
+    bench_record_int(&rec, "nvars", nvars);
+    bench_record_int(&rec, "len", len);
+    bench_record_str(&rec, "constructor", ctor_names[ctor]);
+    bench_record_int(&rec, "nwarmup", nwarmup);
+    bench_record_int(&rec, "nreps", nreps);
+    for (j=0; j<NSTEPS; j++) {
+        char key[32];
+        sprintf(key, "%s_median", step_names[j]);
+        bench_record_double(&rec, key, r.median[j]);
+    }
+    bench_record_double(&rec, "heap_commit", r.heap_commit);
+    bench_record_double(&rec, "heap_set_view", r.heap_view);
+    bench_record_int(&rec, "depth", r.depth);
+    bench_record_int(&rec, "nodes", r.nodes);
+    bench_record_int(&rec, "segments", r.nsegs);
+    err = bench_record_hints(&rec, fh); CHECK_ERR(bench_record_hints)
+    if (bench_record_write(&rec, out_file)) nerrs++;
+    bench_record_free(&rec);
+
+    /* errors of the checks above are found by root only, all processes of
+     * comm stop together
+     */
+    MPI_Allreduce(MPI_IN_PLACE, &nerrs, 1, MPI_INT, MPI_SUM, comm);
+
+err_out:
+    for (j=0; j<NSTEPS; j++) bench_timer_free(&timers[j]);
+    return nerrs;
+}
+
+/*----< print_results() >----------------------------------------------------*/
+static void
+print_results(void)
+{
+    int i;
+
+    printf("-----------------------------------------------------------------------------------------------------------\n");
+    printf("nprocs  nvars constructor     build    commit  set_view      free heap_commit heap_view depth  nodes  segments\n");
+    printf("                             (msec)    (msec)    (msec)    (msec)       (KiB)     (KiB)\n");
+    printf("-----------------------------------------------------------------------------------------------------------\n");
+    for (i=0; i<nresults; i++) {
+        result *r = results + i;
+        printf("%6d %6d %-11s %9.3f %9.3f %9.3f %9.3f %11.1f %9.1f %5d %6lld %9lld\n",
+               r->nprocs, r->nvars, ctor_names[r->ctor], r->median[0] * 1e3,
+               r->median[1] * 1e3, r->median[2] * 1e3, r->median[3] * 1e3,
+               (r->heap_commit < 0) ? -1.0 : r->heap_commit / 1024.0,
+               (r->heap_view   < 0) ? -1.0 : r->heap_view   / 1024.0,
+               r->depth, r->nodes, r->nsegs);
+    }
+    printf("-----------------------------------------------------------------------------------------------------------\n");
+    printf("Timings are the medians of timed runs, each the max among processes\n");
+}
+
+/*----< usage() >------------------------------------------------------------*/
+static void
+usage(char *argv0)
+{
+    char *help =
+    "Usage: %s [-hv | -n list | -P list | -t list | -l len | -W num | -N num |\n"
+    "       -o file | -H file] -f file_name\n"
+    "       [-h] Print this help\n"
+    "       [-v] verbose mode\n"
+    "       [-n list] numbers of variables (default: 1,10,100,1100)\n"
+    "       [-P list] numbers of processes (default: all processes)\n"
+    "       [-t list] constructions, comma-separated names of indexed,\n"
+    "                 hindexed, struct, subarrays, and subarray3d (default: all)\n"
+    "       [-l len] length of local X and Y dimension sizes (default: 16)\n"
+    "       [-W num] number of untimed warmup runs (default: %d)\n"
+    "       [-N num] number of timed repetitions (default: %d)\n"
+    "       [-o file] append results as lines of JSON to file\n"
+    "       [-H file] load MPI-IO hints from file of \"key value\" lines\n"
+    "        -f filename: file name used to set the file view\n"
+    "        list is comma-separated values or ranges lo:hi[:factor]\n";
+    fprintf(stderr, help, argv0, BENCH_NWARMUP, BENCH_NREPS);
+}
+
+/*----< main() >------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    extern int optind;
+    extern char *optarg;
+    char filename[256], *hints_file=NULL, *out_file=NULL, *tok;
+    char *nvars_list="1,10,100,1100", *nprocs_list=NULL, *ctor_list=NULL;
+    int i, j, k, rank, nprocs, err, nerrs=0, len, nwarmup, nreps;
+    int nnvars, nnprocs, nctors, ctors[NCTORS];
+    long long *nvars=NULL, *nprocs_vals=NULL;
+    MPI_Comm comm;
+    MPI_File fh;
+    MPI_Info info=MPI_INFO_NULL;
+
+    MPI_Init(&argc,&argv);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    verbose     = 0;
+    len         = 16;
+    nwarmup     = BENCH_NWARMUP;
+    nreps       = BENCH_NREPS;
+    filename[0] = '\0';
+
+    /* get command-line arguments */
+    while ((i = getopt(argc, argv, "hvn:P:t:l:W:N:o:H:f:")) != EOF)
+        switch(i) {
+            case 'v': verbose = 1;
+                      break;
+            case 'n': nvars_list = optarg;
+                      break;
+            case 'P': nprocs_list = optarg;
+                      break;
+            case 't': ctor_list = optarg;
+                      break;
+            case 'l': len = atoi(optarg);
+                      break;
+            case 'W': nwarmup = atoi(optarg);
+                      break;
+            case 'N': nreps = atoi(optarg);
+                      break;
+            case 'o': out_file = optarg;
+                      break;
+            case 'H': hints_file = optarg;
+                      break;
+            case 'f': strcpy(filename, optarg);
+                      break;
+            case 'h':
+            default:  if (rank==0) usage(argv[0]);
+                      MPI_Finalize();
+                      return 1;
+        }
+
+    if (filename[0] == '\0') {
+        if (rank==0) usage(argv[0]);
+        MPI_Finalize();
+        return 1;
+    }
+
+    /* parse the lists of configurations */
+    nnvars = bench_parse_list(nvars_list, &nvars);
+    for (i=0; i<nnvars; i++)
+        if (nvars[i] < 1) nnvars = 0;
+    if (nprocs_list != NULL)
+        nnprocs = bench_parse_list(nprocs_list, &nprocs_vals);
+    else {
+        nnprocs = 1;
+        nprocs_vals = (long long*) malloc(sizeof(long long));
+        nprocs_vals[0] = nprocs;
+    }
+    if (nnvars <= 0 || nnprocs <= 0) {
+        if (rank == 0)
+            printf("Error: invalid list of command-line option '%s'\n",
+                   (nnvars <= 0) ? "-n" : "-P");
+        nerrs++;
+        goto err_out;
+    }
+
+    if (ctor_list == NULL) {
+        nctors = NCTORS;
+        for (i=0; i<NCTORS; i++) ctors[i] = i;
+    }
+    else {
+        nctors = 0;
+        for (tok=strtok(ctor_list, ","); tok!=NULL; tok=strtok(NULL, ",")) {
+            for (i=0; i<NCTORS; i++)
+                if (!strcmp(tok, ctor_names[i])) break;
+            if (i == NCTORS || nctors == NCTORS) {
+                if (rank == 0)
+                    printf("Error: invalid construction '%s' of command-line option '-t'\n",
+                           tok);
+                nerrs++;
+                goto err_out;
+            }
+            ctors[nctors++] = i;
+        }
+    }
+
+    /* load user I/O hints from the hint file, if given */
+    if (bench_hints_load(hints_file, MPI_COMM_WORLD, &info) != 0) {
+        nerrs++;
+        goto err_out;
+    }
+
+    if (verbose && rank == 0) {
+        printf("Number of MPI processes:  %d\n", nprocs);
+        printf("Local subarray size:      %d x %d (byte)\n", len, len);
+        printf("Number of warmup runs:    %d\n", nwarmup);
+        printf("Number of timed runs:     %d\n", nreps);
+    }
+
+    for (k=0; k<nnprocs; k++) {
+        if (nprocs_vals[k] < 1 || nprocs_vals[k] > nprocs) {
+            if (rank == 0)
+                printf("Warning: skip number of processes %lld, not in [1, %d]\n",
+                       nprocs_vals[k], nprocs);
+            continue;
+        }
+
+        /* the first nprocs_vals[k] processes run, others wait */
+        err = MPI_Comm_split(MPI_COMM_WORLD,
+                             (rank < nprocs_vals[k]) ? 0 : MPI_UNDEFINED,
+                             rank, &comm); ERR
+        if (comm != MPI_COMM_NULL) {
+            err = MPI_File_open(comm, filename, MPI_MODE_CREATE | MPI_MODE_RDWR,
+                                info, &fh); ERR
+            if (hints_file != NULL && k == 0) {
+                err = bench_hints_print(fh, comm); ERR
+            }
+
+            for (i=0; i<nnvars; i++) {
+                for (j=0; j<nctors; j++) {
+                    nerrs += run_config(comm, fh, info, ctors[j], nvars[i],
+                                        len, nwarmup, nreps, out_file);
+                    if (nerrs > 0) break;
+                }
+                if (nerrs > 0) break;
+            }
+
+            err = MPI_File_close(&fh); ERR
+            MPI_Comm_free(&comm);
+        }
+        MPI_Allreduce(MPI_IN_PLACE, &nerrs, 1, MPI_INT, MPI_SUM,
+                      MPI_COMM_WORLD);
+        if (nerrs > 0) goto err_out;
+    }
+
+    if (rank == 0) print_results();
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (rank == 0) MPI_File_delete(filename, MPI_INFO_NULL);
+
+err_out:
+    if (info != MPI_INFO_NULL) MPI_Info_free(&info);
+    if (nvars != NULL) free(nvars);
+    if (nprocs_vals != NULL) free(nprocs_vals);
+    if (results != NULL) free(results);
+    MPI_Finalize();
+    return (nerrs > 0);
+}
@@ -17,44 +17,68 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h> /* getopt() */
 
 #include <mpi.h>
 
+#include "bench_util.h"
+
 #define COL 10
 #define ROW 10
 
-#define CHECK_ERR(func) { \
-    if (err != MPI_SUCCESS) { \
-        int errorStringLen; \
-        char errorString[MPI_MAX_ERROR_STRING]; \
-        MPI_Error_string(err, errorString, &errorStringLen); \
-        printf("Error at line %d: calling %s (%s)\n",__LINE__, #func, errorString); \
-    } \
+static void
+usage(char *argv0)
+{
+    char *help =
+    "Usage: %s [-h | -H file] [file_name]\n"
+    "       [-h] Print this help\n"
+    "       [-H file] load MPI-IO hints from file of \"key value\" lines\n"
+    "       [file_name] output file name (default: testfie.out)\n";
+    fprintf(stderr, help, argv0);
 }
 
-
 /*----< main() >------------------------------------------------------------*/
 int main(int argc, char **argv)
 {
-    char *filename;
-    int i, err, rank, nprocs, mode, verbose=0, psizes[2]={0,0};
+    extern int optind;
+    extern char *optarg;
+    char *filename, *hints_file=NULL;
+    int i, err, nerrs=0, rank, nprocs, mode, verbose=0, psizes[2]={0,0};
     int gsizes[2], lsizes[2], starts[2], buf[COL*ROW], io_len;
     MPI_File     fh;
     MPI_Datatype file_type;
     MPI_Status   status;
+    MPI_Info     info=MPI_INFO_NULL;
 
     MPI_Init(&argc, &argv);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
 
+    while ((i = getopt(argc, argv, "hH:")) != EOF)
+        switch(i) {
+            case 'H': hints_file = optarg;
+                      break;
+            case 'h':
+            default:  if (rank==0) usage(argv[0]);
+                      MPI_Finalize();
+                      return 1;
+        }
+
     filename = "testfie.out";
-    if (argc > 1) filename = argv[1];
+    if (argv[optind] != NULL) filename = argv[optind];
+
+    /* load user I/O hints from the hint file, if given */
+    err = bench_hints_load(hints_file, MPI_COMM_WORLD, &info);
+    if (err != 0) {
+        MPI_Finalize();
+        return 1;
+    }
 
     MPI_Barrier(MPI_COMM_WORLD);
 
     /* Creates a division of processors in a 2D Cartesian grid */
     err = MPI_Dims_create(nprocs, 2, psizes);
-    CHECK_ERR("MPI_Dims_create");
+    CHECK_ERR(MPI_Dims_create);
 
     if (verbose)
         printf("rank %2d: psizes=%2d %2d\n", rank, psizes[0],psizes[1]);
@@ -91,11 +115,11 @@ int main(int argc, char **argv)
      */
     err = MPI_Type_create_subarray(2, gsizes, lsizes, starts,
                                    MPI_ORDER_C, MPI_INT, &file_type);
-    CHECK_ERR("MPI_Type_create_subarray");
+    CHECK_ERR(MPI_Type_create_subarray);
 
     /* An MPI derived datatype must be committed before it can be used. */
     err = MPI_Type_commit(&file_type);
-    CHECK_ERR("MPI_Type_commit");
+    CHECK_ERR(MPI_Type_commit);
 
     /* Writing to the file using the 2D subarray file type -------------------*/
 
@@ -103,12 +127,18 @@ int main(int argc, char **argv)
     mode = MPI_MODE_CREATE | MPI_MODE_WRONLY;
 
     /* open to create the file */
-    err = MPI_File_open(MPI_COMM_WORLD, filename, mode, MPI_INFO_NULL, &fh);
-    CHECK_ERR("MPI_File_open");
+    err = MPI_File_open(MPI_COMM_WORLD, filename, mode, info, &fh);
+    CHECK_ERR(MPI_File_open);
+
+    /* print the hints in effect when a hint file is used */
+    if (hints_file != NULL) {
+        err = bench_hints_print(fh, MPI_COMM_WORLD);
+        CHECK_ERR(bench_hints_print);
+    }
 
     /* set the file view */
-    err = MPI_File_set_view(fh, 0, MPI_INT, file_type, "native", MPI_INFO_NULL);
-    CHECK_ERR("MPI_File_set_view");
+    err = MPI_File_set_view(fh, 0, MPI_INT, file_type, "native", info);
+    CHECK_ERR(MPI_File_set_view);
 
     /* MPI collective write
      * buf occupies a contiguous space in memory.
@@ -116,11 +146,11 @@ int main(int argc, char **argv)
      * memory address pointed by 'buf'.
      */
     err = MPI_File_write_all(fh, buf, io_len, MPI_INT, &status);
-    CHECK_ERR("MPI_File_write_all");
+    CHECK_ERR(MPI_File_write_all);
 
     /* close the file */
     err = MPI_File_close(&fh);
-    CHECK_ERR("MPI_File_close");
+    CHECK_ERR(MPI_File_close);
 
     /* Reading from the file using the 2D subarray file type -----------------*/
 
@@ -128,12 +158,12 @@ int main(int argc, char **argv)
     mode = MPI_MODE_RDONLY;
 
     /* open the same file to read */
-    err = MPI_File_open(MPI_COMM_WORLD, filename, mode, MPI_INFO_NULL, &fh);
-    CHECK_ERR("MPI_File_open");
+    err = MPI_File_open(MPI_COMM_WORLD, filename, mode, info, &fh);
+    CHECK_ERR(MPI_File_open);
 
     /* set the file view */
-    err = MPI_File_set_view(fh, 0, MPI_INT, file_type, "native", MPI_INFO_NULL);
-    CHECK_ERR("MPI_File_set_view");
+    err = MPI_File_set_view(fh, 0, MPI_INT, file_type, "native", info);
+    CHECK_ERR(MPI_File_set_view);
 
     /* initialize the contents of read buffer */
     for (i=0; i<io_len; i++)
@@ -141,7 +171,7 @@ int main(int argc, char **argv)
 
     /* MPI collective read */
     err = MPI_File_read_all(fh, buf, io_len, MPI_INT, &status);
-    CHECK_ERR("MPI_File_read_all");
+    CHECK_ERR(MPI_File_read_all);
 
     /* Check the contents for correctness */
     for (i=0; i<io_len; i++) {
@@ -154,12 +184,14 @@ int main(int argc, char **argv)
 
     /* close the file */
     err = MPI_File_close(&fh);
-    CHECK_ERR("MPI_File_close");
+    CHECK_ERR(MPI_File_close);
 
     /* free the file data type */
     err = MPI_Type_free(&file_type);
-    CHECK_ERR("MPI_Type_free");
+    CHECK_ERR(MPI_Type_free);
+
+    if (info != MPI_INFO_NULL) MPI_Info_free(&info);
 
     MPI_Finalize();
-    return 0;
+    return (nerrs > 0);
 }
@@ -18,6 +18,39 @@
  * num is the size of ghost cells on both ends of each dimension,
  * len is the size of local array, which is len x len.
  *
+ * Command-line option '-i' enables an instrumented mode, in which each run of
+ * the collective write separately times the creation of the fileview data
+ * type, and calls to MPI_File_open, MPI_File_set_view, MPI_File_write_all,
+ * and MPI_File_close, and reports the distribution of each phase among
+ * processes, together with the changes of MPI_T performance variables.
+ *
+ * Command-line option '-k num' adds a checkpoint mode, which writes num
+ * checkpoints per run, each followed by '-t sec' seconds of computation that
+ * polls the pending writes. A blocking checkpoint calls MPI_File_write_at_all()
+ * with the buffer data type. An asynchronous checkpoint copies the interior
+ * of the local array into one of two staging buffers and returns right after
+ * calling MPI_File_iwrite_at_all(), blocking only when both staging buffers
+ * are still being written. The time the application stalls per checkpoint,
+ * i.e. time-to-return, is reported for both, together with the completion
+ * time of the asynchronous checkpoints, i.e. until MPI_Wait() returns for the
+ * write request. It does not include MPI_File_sync(), which is called only
+ * at the end of each run, so the data is not necessarily durable by then.
+ * The staging buffers are allocated by malloc(), not in pinned memory.
+ *
+ * Command-line option '-G' adds a GPU buffer mode, available when built with
+ * CUDA or HIP, e.g. by "make ENABLE_GPU=cuda". The local array with ghost
+ * cells is copied into GPU device memory and written by the collective write
+ * directly from the device buffer, which requires a GPU-aware MPI library,
+ * and by staging it through pinned host memory, either the whole array with
+ * the buffer data type, or only its interior packed on the device by a
+ * strided 2D copy of the GPU runtime. The 3 ways are timed separately.
+ *
+ * Command-line option '-A' reports the aggregators the two-phase collective
+ * write would use, the compute node of each, its file domain, and the bytes
+ * it receives, computed from the fileview and the hints cb_nodes,
+ * cb_config_list, and striping_unit, e.g. set in a hint file by option '-H',
+ * together with the imbalance among aggregators and among compute nodes.
+ *
  * When using #define EXPECT(rank,x) (rank)
  * data contents in the output file
  *         0, 0, 0, 0, 1, 1, 1, 1,
@@ -64,30 +97,431 @@
 
 #include <mpi.h>
 
+#include "bench_util.h"
+
 #define EXPECT(rank,x) (rank)
 
-#define CHECK_ERR(func) { \
-    if (err != MPI_SUCCESS) { \
-        int errorStringLen; \
-        char errorString[MPI_MAX_ERROR_STRING]; \
-        MPI_Error_string(err, errorString, &errorStringLen); \
-        printf("Error at line %d: calling %s (%s)\n",__LINE__, #func, errorString); \
-        nerrs++; \
-    } \
+/* default seconds of computation after each checkpoint */
+#define COMPUTE_T 0.01
+
+/* phases of a collective write timed in the instrumented mode */
+#define NPHASES 5
+static const char *phase_names[NPHASES] = {"create_file_type",
+    "MPI_File_open", "MPI_File_set_view", "MPI_File_write_all",
+    "MPI_File_close"};
+
+/*----< instrumented_write() >-----------------------------------------------*/
+/* Run the collective write nwarmup+nreps times, each of which creates the
+ * fileview data type, opens the file, sets the file view, writes, and closes
+ * the file. A barrier is called before each phase. ptimer[NPHASES] time the
+ * phases, wtimer times the whole sequence.
+ */
+static int
+instrumented_write(const char   *filename,
+                   MPI_Info      info,
+                   MPI_Offset    off,
+                   int          *gsizes,
+                   int          *subsizes,
+                   int          *starts,
+                   int          *buf,
+                   int           ntimes,
+                   MPI_Datatype  buf_type,
+                   bench_timer  *wtimer,
+                   bench_timer  *ptimer,
+                   bench_pvars  *pvars,
+                   bench_record *rec)
+{
+    int i, err, nerrs=0, nwarmup=wtimer->nwarmup;
+    MPI_Datatype file_type;
+    MPI_File fh;
+    MPI_Status status;
+
+    for (i=0; i<nwarmup+wtimer->nreps; i++) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        if (i >= nwarmup) bench_pvars_start(pvars);
+        bench_timer_start(wtimer);
+
+        bench_timer_start(&ptimer[0]);
+        err = MPI_Type_create_subarray(2, gsizes, subsizes, starts,
+                                       MPI_ORDER_C, MPI_INT, &file_type);
+        CHECK_MPI_ERROR("MPI_Type_create_subarray")
+        err = MPI_Type_commit(&file_type);
+        CHECK_MPI_ERROR("MPI_Type_commit")
+        bench_timer_stop(&ptimer[0]);
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&ptimer[1]);
+        err = MPI_File_open(MPI_COMM_WORLD, filename,
+                            MPI_MODE_CREATE | MPI_MODE_WRONLY, info, &fh);
+        CHECK_MPI_ERROR("MPI_File_open")
+        bench_timer_stop(&ptimer[1]);
+        if (i == 0) {
+            err = bench_record_hints(rec, fh);
+            CHECK_MPI_ERROR("MPI_File_get_info")
+            if (info != MPI_INFO_NULL) {
+                err = bench_hints_print(fh, MPI_COMM_WORLD);
+                CHECK_MPI_ERROR("MPI_File_get_info")
+            }
+        }
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&ptimer[2]);
+        err = MPI_File_set_view(fh, off, MPI_BYTE, file_type, "native",
+                                info);
+        CHECK_MPI_ERROR("MPI_File_set_view")
+        bench_timer_stop(&ptimer[2]);
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&ptimer[3]);
+        err = MPI_File_write_all(fh, buf, ntimes, buf_type, &status);
+        CHECK_MPI_ERROR("MPI_File_write_all")
+        bench_timer_stop(&ptimer[3]);
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&ptimer[4]);
+        err = MPI_File_close(&fh);
+        CHECK_MPI_ERROR("MPI_File_close")
+        bench_timer_stop(&ptimer[4]);
+
+        bench_timer_stop(wtimer);
+        if (i >= nwarmup) bench_pvars_stop(pvars);
+
+        err = MPI_Type_free(&file_type);
+        CHECK_MPI_ERROR("MPI_Type_free")
+    }
+
+err_out:
+    return nerrs;
+}
+
+/*----< compute_poll() >-----------------------------------------------------*/
+/* Synthetic computation of the given seconds between two checkpoints, which
+ * polls the pending checkpoint writes reqs[2] by MPI_Test() every
+ * millisecond, as an application would do. When reqs[s] is found completed,
+ * the time since its checkpoint started, t_start[s], is stored in
+ * *t_done[s].
+ */
+static volatile double kernel_sum;
+
+static int
+compute_poll(double        seconds,
+             MPI_Request  *reqs,
+             const double *t_start,
+             double      **t_done)
+{
+    int i, s, err, flag, nerrs=0;
+    double end, next, now, work[256];
+
+    for (i=0; i<256; i++) work[i] = i;
+    end = MPI_Wtime() + seconds;
+    do {
+        next = MPI_Wtime() + 1.0e-3;
+        do {
+            for (i=0; i<256; i++) work[i] = work[i] * 0.999 + 1.0e-3;
+            now = MPI_Wtime();
+        } while (now < next && now < end);
+
+        for (s=0; s<2; s++) {
+            if (reqs[s] == MPI_REQUEST_NULL) continue;
+            err = MPI_Test(&reqs[s], &flag, MPI_STATUS_IGNORE);
+            CHECK_MPI_ERROR("MPI_Test")
+            if (flag) *t_done[s] = MPI_Wtime() - t_start[s];
+        }
+    } while (now < end);
+    kernel_sum = work[0];
+
+err_out:
+    return nerrs;
+}
+
+/*----< async_checkpoint() >-------------------------------------------------*/
+/* Write nckpts checkpoints nwarmup+nreps times, with compute_t seconds of
+ * computation after each checkpoint, in two ways:
+ *   timers[0]: MPI_File_write_at_all() of the local array with ghost cells,
+ *              which stalls the application until the write completes.
+ *   timers[1]: the interior of the local array is copied into one of two
+ *              staging buffers and written by MPI_File_iwrite_at_all(), so
+ *              the application returns right away. It blocks only when both
+ *              staging buffers are still being written.
+ * Checkpoints alternate between two slots in the file after the fileview
+ * offset, each of ntimes global arrays. A run ends with MPI_File_sync(). The
+ * per-checkpoint stall times and the async times to complete the write
+ * requests, all maximum among processes, are reported.
+ */
+static int
+async_checkpoint(MPI_File      fh,
+                 int          *buf,
+                 int           ntimes,
+                 int           len,
+                 int           nghosts,
+                 MPI_Datatype  buf_type,
+                 int           nckpts,
+                 double        compute_t,
+                 bench_timer  *timers,
+                 bench_record *rec)
+{
+    int i, j, k, c, s, err, nerrs=0, rank, nwarmup, nreps, xlen, nblocked=0;
+    int *staging[2], *src, *dst;
+    double t_start[2], *t_done[2], dummy, *stall_blk, *stall_async, *complete;
+    double *maxt;
+    const char *labels[3] = {"stall, blocking", "stall, async",
+                             "time to complete, async"};
+    const char *keys[3] = {"ckpt_stall_blocking", "ckpt_stall_async",
+                           "ckpt_complete_async"};
+    size_t count, n;
+    MPI_Offset slot_size;
+    MPI_Request reqs[2];
+    MPI_Status status;
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    nwarmup = timers[0].nwarmup;
+    nreps   = timers[0].nreps;
+    xlen    = len + 2 * nghosts;
+    count   = (size_t)len * len * ntimes;
+    slot_size = count * sizeof(int);
+
+    /* two staging buffers in pageable host memory, allocated once and
+     * reused by all checkpoints
+     */
+    staging[0] = (int*) malloc(sizeof(int) * count * 2);
+    staging[1] = staging[0] + count;
+    t_done[0] = t_done[1] = &dummy;
+
+    n = (size_t)nreps * nckpts;
+    stall_blk   = (double*) calloc(n * 4 + 1, sizeof(double));
+    stall_async = stall_blk   + n;
+    complete    = stall_async + n;
+    maxt        = complete    + n;
+
+    for (i=0; i<nwarmup+nreps; i++) {
+        /* timings of warmup runs are discarded */
+        size_t base = (size_t)((i < nwarmup) ? 0 : i - nwarmup) * nckpts;
+
+        /* blocking checkpoints */
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&timers[0]);
+        for (c=0; c<nckpts; c++) {
+            double t = MPI_Wtime();
+            err = MPI_File_write_at_all(fh, (c % 2) * slot_size, buf, ntimes,
+                                        buf_type, &status);
+            CHECK_MPI_ERROR("MPI_File_write_at_all")
+            stall_blk[base + c] = MPI_Wtime() - t;
+
+            reqs[0] = reqs[1] = MPI_REQUEST_NULL;
+            err = compute_poll(compute_t, reqs, t_start, t_done);
+            if (err != 0) {
+                nerrs++;
+                goto err_out;
+            }
+        }
+        err = MPI_File_sync(fh);
+        CHECK_MPI_ERROR("MPI_File_sync")
+        bench_timer_stop(&timers[0]);
+
+        /* double-buffered asynchronous checkpoints */
+        reqs[0] = reqs[1] = MPI_REQUEST_NULL;
+        t_done[0] = t_done[1] = &dummy;
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&timers[1]);
+        for (c=0; c<nckpts; c++) {
+            double t = MPI_Wtime();
+            s = c % 2;
+
+            /* wait only when the staging buffer is still being written */
+            if (reqs[s] != MPI_REQUEST_NULL) {
+                err = MPI_Wait(&reqs[s], &status);
+                CHECK_MPI_ERROR("MPI_Wait")
+                *t_done[s] = MPI_Wtime() - t_start[s];
+                if (i >= nwarmup) nblocked++;
+            }
+            t_start[s] = t;
+
+            /* copy the interior of the local array into staging buffer */
+            dst = staging[s];
+            for (k=0; k<ntimes; k++) {
+                src = buf + (size_t)k * xlen * xlen + nghosts * xlen + nghosts;
+                for (j=0; j<len; j++, src+=xlen, dst+=len)
+                    memcpy(dst, src, sizeof(int) * len);
+            }
+
+            err = MPI_File_iwrite_at_all(fh, s * slot_size, staging[s],
+                                         (int)count, MPI_INT, &reqs[s]);
+            CHECK_MPI_ERROR("MPI_File_iwrite_at_all")
+            stall_async[base + c] = MPI_Wtime() - t;
+            t_done[s] = &complete[base + c];
+            *t_done[s] = 0;
+
+            err = compute_poll(compute_t, reqs, t_start, t_done);
+            if (err != 0) {
+                nerrs++;
+                goto err_out;
+            }
+        }
+        for (s=0; s<2; s++) {
+            if (reqs[s] == MPI_REQUEST_NULL) continue;
+            err = MPI_Wait(&reqs[s], &status);
+            CHECK_MPI_ERROR("MPI_Wait")
+            *t_done[s] = MPI_Wtime() - t_start[s];
+        }
+        err = MPI_File_sync(fh);
+        CHECK_MPI_ERROR("MPI_File_sync")
+        bench_timer_stop(&timers[1]);
+    }
+
+    /* per-checkpoint timings are the maximum among processes */
+    MPI_Allreduce(MPI_IN_PLACE, &nblocked, 1, MPI_INT, MPI_MAX,
+                  MPI_COMM_WORLD);
+    for (k=0; k<3; k++) {
+        char key[64];
+        bench_stats st;
+
+        bench_max_timings(stall_blk + n * k, maxt, (int)n, MPI_COMM_WORLD);
+        if (rank > 0) continue;
+        bench_stats_compute(maxt, (int)n, &st);
+        if (k == 0)
+            printf("---- checkpoints: %d per run, %.4f sec computation after each\n",
+                   nckpts, compute_t);
+        printf("     %-23s min=%f median=%f max=%f mean=%f sec\n", labels[k],
+               st.min, st.median, st.max, st.mean);
+        sprintf(key, "%s_median", keys[k]);
+        bench_record_double(rec, key, st.median);
+        sprintf(key, "%s_max", keys[k]);
+        bench_record_double(rec, key, st.max);
+    }
+    if (rank == 0) {
+        printf("     async checkpoints blocked on busy staging buffers = %d of %d\n",
+               nblocked, nreps * nckpts);
+        bench_record_int(rec, "ckpt_blocked", nblocked);
+    }
+
+err_out:
+    free(staging[0]);
+    free(stall_blk);
+    return nerrs;
+}
+
+/*----< gpu_write() >--------------------------------------------------------*/
+/* Copy the local array with ghost cells into GPU device memory and write its
+ * interior in 3 ways, each timed by one of timers[3].
+ *   timers[0]: MPI_File_write_at_all() of the device buffer with the buffer
+ *              datatype, which requires a GPU-aware MPI library.
+ *   timers[1]: the device buffer is copied as a whole into a buffer of
+ *              pinned host memory, which is written with the buffer datatype.
+ *   timers[2]: the interior is packed on the device by a strided 2D copy of
+ *              the GPU runtime into a contiguous device buffer, which is
+ *              copied into a contiguous pinned buffer and written as
+ *              contiguous MPI_INTs, so only the interior crosses to the host.
+ * All write to the same file region at the fileview offset.
+ */
+static int
+gpu_write(MPI_File      fh,
+          int          *buf,
+          int           ntimes,
+          int           len,
+          int           nghosts,
+          MPI_Datatype  buf_type,
+          bench_timer  *timers)
+{
+    int i, k, err, nerrs=0, xlen, nruns, *dev=NULL, *pin=NULL;
+    int *dev_packed=NULL, *pin_packed=NULL;
+    size_t size, packed_size;
+    MPI_Status status;
+
+    nruns = timers[0].nwarmup + timers[0].nreps;
+    xlen  = len + 2 * nghosts;
+    size  = sizeof(int) * xlen * xlen * ntimes;
+    packed_size = sizeof(int) * len * len * ntimes;
+
+    dev        = (int*) bench_mem_alloc(size, BENCH_MEM_DEVICE);
+    pin        = (int*) bench_mem_alloc(size, BENCH_MEM_PINNED);
+    dev_packed = (int*) bench_mem_alloc(packed_size, BENCH_MEM_DEVICE);
+    pin_packed = (int*) bench_mem_alloc(packed_size, BENCH_MEM_PINNED);
+    if (dev == NULL || pin == NULL || dev_packed == NULL ||
+        pin_packed == NULL || bench_mem_copy(dev, buf, size) != 0) {
+        nerrs++;
+        goto err_out;
+    }
+
+    for (i=0; i<nruns; i++) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&timers[0]);
+        err = MPI_File_write_at_all(fh, 0, dev, ntimes, buf_type, &status);
+        CHECK_MPI_ERROR("MPI_File_write_at_all")
+        bench_timer_stop(&timers[0]);
+    }
+
+    for (i=0; i<nruns; i++) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&timers[1]);
+        if (bench_mem_copy(pin, dev, size) != 0) {
+            nerrs++;
+            goto err_out;
+        }
+        err = MPI_File_write_at_all(fh, 0, pin, ntimes, buf_type, &status);
+        CHECK_MPI_ERROR("MPI_File_write_at_all")
+        bench_timer_stop(&timers[1]);
+    }
+
+    for (i=0; i<nruns; i++) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&timers[2]);
+        for (k=0; k<ntimes; k++) {
+            int *src = dev + (size_t)k * xlen * xlen + nghosts * xlen + nghosts;
+            err = bench_mem_copy2d(dev_packed + (size_t)k * len * len,
+                                   sizeof(int) * len, src, sizeof(int) * xlen,
+                                   sizeof(int) * len, len);
+            if (err != 0) break;
+        }
+        if (err != 0 || bench_mem_copy(pin_packed, dev_packed, packed_size)) {
+            nerrs++;
+            goto err_out;
+        }
+        err = MPI_File_write_at_all(fh, 0, pin_packed, len * len * ntimes,
+                                    MPI_INT, &status);
+        CHECK_MPI_ERROR("MPI_File_write_at_all")
+        bench_timer_stop(&timers[2]);
+    }
+
+err_out:
+    bench_mem_free(dev, BENCH_MEM_DEVICE);
+    bench_mem_free(pin, BENCH_MEM_PINNED);
+    bench_mem_free(dev_packed, BENCH_MEM_DEVICE);
+    bench_mem_free(pin_packed, BENCH_MEM_PINNED);
+    return nerrs;
 }
 
 static void
 usage(char *argv0)
 {
     char *help =
-    "Usage: %s [-h | -q | -c num | -l len | -n num | file_name]\n"
+    "Usage: %s [-h | -q | -i | -c num | -l len | -n num | -W num | -N num | -o file | -P str | -k num | -t sec | -G | -V mode | -A | -H file | file_name]\n"
     "       [-h] Print this help\n"
     "       [-q] quiet mode\n"
+    "       [-i] instrumented mode, time each phase of collective write\n"
     "       [-l len] size of each dimension of the local array (default: 4)\n"
     "       [-c num] number of ghost cells along each dimension (default: 2) \n"
     "       [-n num] write count of buffer data type (default: 2) \n"
+    "       [-W num] number of untimed warmup runs (default: %d)\n"
+    "       [-N num] number of timed repetitions (default: %d)\n"
+    "       [-o file] append results as a line of JSON to file\n"
+    "       [-P str] comma-separated name prefixes of MPI_T performance\n"
+    "                variables reported in instrumented mode (default: %s)\n"
+    "       [-k num] also write num blocking and double-buffered asynchronous\n"
+    "                checkpoints per run, not in instrumented mode\n"
+    "       [-t sec] seconds of computation after each checkpoint (default: %g)\n"
+    "       [-G] also write from a GPU device buffer, directly and staged\n"
+    "            through pinned host memory, not in instrumented mode,\n"
+    "            requires ENABLE_GPU=cuda or hip\n"
+    "       [-V mode] root checks the file by comparing each element (elem),\n"
+    "                 by CRC-32C checksums of the rows of each process (crc),\n"
+    "                 or not (none) (default: elem)\n"
+    "       [-A] report the aggregators of the collective write, their file\n"
+    "            domains, nodes, and incoming bytes, not in instrumented mode\n"
+    "       [-H file] load MPI-IO hints from file of \"key value\" lines\n"
     "       [filename] output file name (default: testfie.out)\n";
-    fprintf(stderr, help, argv0);
+    fprintf(stderr, help, argv0, BENCH_NWARMUP, BENCH_NREPS, BENCH_PVARS,
+            COMPUTE_T);
 }
 
 /*----< main() >------------------------------------------------------------*/
@@ -95,10 +529,17 @@ int main(int argc, char **argv)
 {
     extern int optind;
     extern char *optarg;
-    char filename[256];
-    int i, j, k, x, rank, nprocs, mode, len, bufsize, ntimes, err, nerrs=0;
+    char filename[256], *out_file=NULL, *pvar_prefixes=NULL, *hints_file=NULL;
+    int i, j, k, rank, nprocs, mode, len, bufsize, ntimes, err, nerrs=0;
     int psizes[2], gsizes[2], subsizes[2], *gstarts=NULL, starts[2], nghosts;
-    int fd, sizes[2], local_rank[2], *buf=NULL, *buf_ptr, type_size, verbose;
+    int fstarts[2], instrument;
+    int fd, sizes[2], local_rank[2], *buf=NULL, type_size, verbose;
+    int nwarmup, nreps, nckpts, gpu, verify, aggr;
+    unsigned int *crcs=NULL;
+    double amnt, compute_t, vtime;
+    bench_timer wtimer, ptimer[NPHASES], ctimer[2], gtimer[3], itimer;
+    bench_record rec;
+    bench_pvars pvars;
 
     MPI_Aint lb, extent;
     MPI_File fh;
@@ -112,22 +553,56 @@ int main(int argc, char **argv)
     MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
 
     verbose = 1;
+    instrument = 0;
     nghosts = 2;
     len     = 4;
     ntimes  = 1;
     off     = 10;
+    nwarmup = BENCH_NWARMUP;
+    nreps   = BENCH_NREPS;
+    nckpts  = 0;
+    gpu     = 0;
+    aggr    = 0;
+    verify  = BENCH_VERIFY_ELEM;
+    compute_t = COMPUTE_T;
 
     /* get command-line arguments */
-    while ((i = getopt(argc, argv, "hqn:c:l:")) != EOF)
+    while ((i = getopt(argc, argv, "hqiGAn:c:l:W:N:o:P:k:t:V:H:")) != EOF)
         switch(i) {
             case 'q': verbose = 0;
                       break;
+            case 'i': instrument = 1;
+                      break;
             case 'l': len = atoi(optarg);
                       break;
             case 'c': nghosts = atoi(optarg);
                       break;
             case 'n': ntimes = atoi(optarg);
                       break;
+            case 'W': nwarmup = atoi(optarg);
+                      break;
+            case 'N': nreps = atoi(optarg);
+                      break;
+            case 'o': out_file = strdup(optarg);
+                      break;
+            case 'P': pvar_prefixes = strdup(optarg);
+                      break;
+            case 'k': nckpts = atoi(optarg);
+                      break;
+            case 't': compute_t = atof(optarg);
+                      break;
+            case 'G': gpu = 1;
+                      break;
+            case 'A': aggr = 1;
+                      break;
+            case 'V': if ((verify = bench_verify_mode(optarg)) < 0) {
+                          if (rank==0) usage(argv[0]);
+                          MPI_Finalize();
+                          return 1;
+                      }
+                      break;
+            case 'H': hints_file = optarg;
+                      break;
             case 'h':
             default:  if (rank==0) usage(argv[0]);
                       MPI_Finalize();
@@ -139,6 +614,41 @@ int main(int argc, char **argv)
     len = (len <= 0) ? 4 : len;
     nghosts = (nghosts < 0) ? 2 : nghosts;
     ntimes = (ntimes <= 0) ? 1 : ntimes;
+    if (instrument && (nckpts > 0 || gpu || aggr)) {
+        if (rank==0) usage(argv[0]);
+        MPI_Finalize();
+        return 1;
+    }
+
+    /* select the GPU device of this process */
+    if (gpu && bench_gpu_init(MPI_COMM_WORLD) != 0) {
+        MPI_Finalize();
+        return 1;
+    }
+
+    /* load user I/O hints from the hint file, if given */
+    if (bench_hints_load(hints_file, MPI_COMM_WORLD, &info) != 0) {
+        MPI_Finalize();
+        return 1;
+    }
+
+    bench_record_init(&rec, MPI_COMM_WORLD, "ghost_cell");
+    bench_record_int(&rec, "len", len);
+    bench_record_int(&rec, "nghosts", nghosts);
+    bench_record_int(&rec, "ntimes", ntimes);
+    bench_record_int(&rec, "instrument", instrument);
+    bench_record_int(&rec, "nckpts", nckpts);
+    if (nckpts > 0) bench_record_double(&rec, "compute_t", compute_t);
+    bench_record_int(&rec, "gpu", gpu);
+    bench_record_int(&rec, "aggr", aggr);
+    bench_record_str(&rec, "verify", (verify == BENCH_VERIFY_CRC) ? "crc" :
+                     (verify == BENCH_VERIFY_NONE) ? "none" : "elem");
+    bench_timer_init(&itimer, "buffer initialization", 0, 1);
+
+    /* pvars are collected only in the instrumented mode */
+    err = bench_pvars_init(&pvars, (!instrument) ? NULL :
+                           (pvar_prefixes == NULL) ? BENCH_PVARS : pvar_prefixes);
+    CHECK_ERR(MPI_T_init_thread)
 
     if (verbose && rank == 0) {
         printf("local array size         = %d %d\n", len, len);
@@ -171,6 +681,8 @@ int main(int argc, char **argv)
     starts[1]   = local_rank[1] * len;
     subsizes[0] = len;
     subsizes[1] = len;
+    fstarts[0]  = starts[0];
+    fstarts[1]  = starts[1];
     err = MPI_Type_create_subarray(2, gsizes, subsizes, starts, MPI_ORDER_C,
                                    MPI_INT, &file_type);
     CHECK_ERR(MPI_Type_create_subarray)
@@ -205,39 +717,119 @@ int main(int argc, char **argv)
     if (verbose && rank == 0)
         printf(" buf_type size=%d lb=%ld extent=%ld\n",type_size,lb,extent);
 
-    /* initialize buffer with ghost cells on both ends of each dim */
+    /* initialize buffer with ghost cells on both ends of each dim, all
+     * ghost cells are set to -8
+     */
+    bench_timer_start(&itimer);
     bufsize = (len + 2 * nghosts) * (len + 2 * nghosts);
     buf = (int *) malloc(bufsize * ntimes * sizeof(int));
-    buf_ptr = buf;
-    for (k=0; k<ntimes; k++) {
-        x = 0;
-        for (i=0; i<len+2*nghosts; i++)
-        for (j=0; j<len+2*nghosts; j++) {
-            if (nghosts <= i && i < len+nghosts &&
-                nghosts <= j && j < len+nghosts)
-                buf_ptr[i*(len+2*nghosts) + j] = EXPECT(rank, x);
-            else
-                /* set all ghost cells value to -8 */
-                buf_ptr[i*(len+2*nghosts) + j] = -8;
-        }
-        buf_ptr += bufsize;
+    bench_fill_block(buf, ntimes, len, len, nghosts, EXPECT(rank, 0), -8);
+    if (verify == BENCH_VERIFY_CRC) {
+        /* checksums of the interior of all checkpoints, gathered by root */
+        crcs = (unsigned int*) malloc(sizeof(int) * ntimes * (nprocs + 1));
+        bench_rows_crc(buf + nghosts * (len + 2 * nghosts) + nghosts, ntimes,
+                       bufsize, len, len + 2 * nghosts, len, crcs);
+        MPI_Gather(crcs, ntimes, MPI_UNSIGNED, crcs + ntimes, ntimes,
+                   MPI_UNSIGNED, 0, MPI_COMM_WORLD);
     }
+    bench_timer_stop(&itimer);
+
+    bench_timer_init(&wtimer, "collective write", nwarmup, nreps);
+    for (i=0; i<NPHASES; i++)
+        bench_timer_init(&ptimer[i], phase_names[i], nwarmup, nreps);
+    bench_timer_init(&ctimer[0], "blocking checkpoints", nwarmup, nreps);
+    bench_timer_init(&ctimer[1], "async checkpoints", nwarmup, nreps);
+    bench_timer_init(&gtimer[0], "collective write, device buffer", nwarmup,
+                     nreps);
+    bench_timer_init(&gtimer[1], "device-to-host copy + collective write",
+                     nwarmup, nreps);
+    bench_timer_init(&gtimer[2], "device pack + copy + collective write",
+                     nwarmup, nreps);
+
+    if (instrument) {
+        /* time each phase of the collective write separately */
+        nerrs += instrumented_write(filename, info, off, gsizes, subsizes, fstarts,
+                                    buf, ntimes, buf_type, &wtimer, ptimer,
+                                    &pvars, &rec);
+    }
+    else {
+        /* create the file */
+        mode = MPI_MODE_CREATE | MPI_MODE_WRONLY;
+        err = MPI_File_open(MPI_COMM_WORLD, filename, mode, info, &fh);
+        CHECK_ERR(MPI_File_open)
+
+        err = bench_record_hints(&rec, fh);
+        CHECK_ERR(MPI_File_get_info)
+        if (hints_file != NULL) {
+            err = bench_hints_print(fh, MPI_COMM_WORLD);
+            CHECK_ERR(MPI_File_get_info)
+        }
+
+        /* set the file view */
+        err = MPI_File_set_view(fh, off, MPI_BYTE, file_type, "native", info);
+        CHECK_ERR(MPI_File_set_view)
+
+        if (aggr) {
+            /* aggregators and their load of the collective write below */
+            nerrs += bench_aggr_report(fh, info, off, file_type,
+                                       (MPI_Offset)len * len * ntimes * sizeof(int),
+                                       MPI_COMM_WORLD, &rec);
+        }
+
+        /* write to the file, repeatedly to the same file region */
+        for (i=0; i<nwarmup+nreps; i++) {
+            err = MPI_File_seek(fh, 0, MPI_SEEK_SET);
+            CHECK_ERR(MPI_File_seek)
 
-    /* create the file */
-    mode = MPI_MODE_CREATE | MPI_MODE_WRONLY;
-    err = MPI_File_open(MPI_COMM_WORLD, filename, mode, info, &fh);
-    CHECK_ERR(MPI_File_open)
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&wtimer);
+            err = MPI_File_write_all(fh, buf, ntimes, buf_type, &status);
+            CHECK_ERR(MPI_File_write_all)
+            bench_timer_stop(&wtimer);
+        }
+
+        if (gpu) {
+            /* write a device buffer, directly and staged */
+            nerrs += gpu_write(fh, buf, ntimes, len, nghosts, buf_type,
+                               gtimer);
+        }
 
-    /* set the file view */
-    err = MPI_File_set_view(fh, off, MPI_BYTE, file_type, "native", info);
-    CHECK_ERR(MPI_File_set_view)
+        if (nckpts > 0) {
+            /* blocking vs. double-buffered asynchronous checkpoints */
+            nerrs += async_checkpoint(fh, buf, ntimes, len, nghosts, buf_type,
+                                      nckpts, compute_t, ctimer, &rec);
+        }
 
-    /* write to the file */
-    err = MPI_File_write_all(fh, buf, ntimes, buf_type, &status);
-    CHECK_ERR(MPI_File_write_all)
+        err = MPI_File_close(&fh);
+        CHECK_ERR(MPI_File_close)
+    }
 
-    err = MPI_File_close(&fh);
-    CHECK_ERR(MPI_File_close)
+    amnt = (double)nprocs * len * len * ntimes * sizeof(int);
+    bench_timer_report(&itimer, MPI_COMM_WORLD, amnt, &rec);
+    bench_timer_report(&wtimer, MPI_COMM_WORLD, amnt, &rec);
+    if (instrument) {
+        bench_phases_report(ptimer, NPHASES, MPI_COMM_WORLD, &rec);
+        bench_pvars_report(&pvars, MPI_COMM_WORLD, &rec);
+    }
+    if (nckpts > 0) {
+        /* amount of all checkpoints of a run */
+        bench_timer_report(&ctimer[0], MPI_COMM_WORLD, amnt * nckpts, &rec);
+        bench_timer_report(&ctimer[1], MPI_COMM_WORLD, amnt * nckpts, &rec);
+    }
+    if (gpu)
+        for (i=0; i<3; i++)
+            bench_timer_report(&gtimer[i], MPI_COMM_WORLD, amnt, &rec);
+    bench_timer_free(&wtimer);
+    bench_timer_free(&itimer);
+    for (i=0; i<NPHASES; i++)
+        bench_timer_free(&ptimer[i]);
+    for (i=0; i<2; i++)
+        bench_timer_free(&ctimer[i]);
+    for (i=0; i<3; i++)
+        bench_timer_free(&gtimer[i]);
+    bench_pvars_free(&pvars);
+    if (bench_record_write(&rec, out_file)) nerrs++;
+    bench_record_free(&rec);
 
     err = MPI_Type_free(&file_type);
     CHECK_ERR(MPI_Type_free)
@@ -269,30 +861,53 @@ int main(int argc, char **argv)
         }
     }
 
-    /* check if the contents are expected */
-    for (k=0; k<ntimes; k++) {
+    /* check if the contents are expected, element-wise or by checksums */
+    vtime = MPI_Wtime();
+    for (k=0; verify == BENCH_VERIFY_ELEM && k<ntimes; k++) {
         int p;
         for (p=0; p<nprocs; p++) {
             int local_indx = gsizes[0] * gsizes[1] * k;
+            long long e;
             local_indx += gstarts[p*2] * gsizes[1] + gstarts[p*2+1];
 
-            x = 0;
-            for (i=0; i<len; i++, local_indx += gsizes[1]) {
-                for (j=0; j<len; j++) {
-                    if (buf[local_indx + j] != EXPECT(p, x)) {
-                        printf("Error: Unexpected value %d at k=%d p=%d i=%d j=%d\n",
-                                buf[local_indx + j],k,p,i,j);
-                        nerrs++;
-                        goto err_out;
-                    }
+            e = bench_verify_rows(buf + local_indx, len, gsizes[1], len,
+                                  EXPECT(p, 0));
+            if (e >= 0) {
+                printf("Error: Unexpected value %d at k=%d p=%d i=%lld j=%lld\n",
+                        buf[local_indx + e], k, p, e / gsizes[1],
+                        e % gsizes[1]);
+                nerrs++;
+                goto err_out;
+            }
+        }
+    }
+    if (verify == BENCH_VERIFY_CRC) {
+        int p;
+        unsigned int *fcrcs = crcs;
+        for (p=0; p<nprocs; p++) {
+            bench_rows_crc(buf + gstarts[p*2] * gsizes[1] + gstarts[p*2+1],
+                           ntimes, bufsize, len, gsizes[1], len, fcrcs);
+            for (k=0; k<ntimes; k++) {
+                if (fcrcs[k] != crcs[ntimes * (p + 1) + k]) {
+                    printf("Error: checksum of k=%d p=%d expect 0x%08x but got 0x%08x\n",
+                           k, p, crcs[ntimes * (p + 1) + k], fcrcs[k]);
+                    nerrs++;
+                    goto err_out;
                 }
             }
         }
     }
+    if (verify != BENCH_VERIFY_NONE)
+        printf("Time of verification by root = %.4f sec\n",
+               MPI_Wtime() - vtime);
 
 err_out:
     free(buf);
+    if (crcs != NULL) free(crcs);
     if (gstarts != NULL) free(gstarts);
+    if (out_file != NULL) free(out_file);
+    if (pvar_prefixes != NULL) free(pvar_prefixes);
+    if (info != MPI_INFO_NULL) MPI_Info_free(&info);
 
     MPI_Finalize();
     return (nerrs > 0);
@@ -23,25 +23,18 @@
 
 #include <mpi.h>
 
-#define ERR \
-    if (err != MPI_SUCCESS) { \
-        int errorStringLen; \
-        char errorString[MPI_MAX_ERROR_STRING]; \
-        MPI_Error_string(err, errorString, &errorStringLen); \
-        printf("Error at line %d: %s\n",__LINE__,errorString); \
-        nerrs++; \
-        goto err_out; \
-    }
+#include "bench_util.h"
 
 static void
 usage(char *argv0)
 {
     char *help =
-    "Usage: %s [-hvrc | -n num | -l len ] -f file_name\n"
+    "Usage: %s [-hvrc | -n num | -l len | -H file] -f file_name\n"
     "       [-h] Print this help\n"
     "       [-v] verbose mode\n"
     "       [-n num] number of variables to be written\n"
     "       [-l len] length of local X and Y dimension sizes\n"
+    "       [-H file] load MPI-IO hints from file of \"key value\" lines\n"
     "        -f filename: output file name\n";
     fprintf(stderr, help, argv0);
 }
@@ -51,7 +44,7 @@ int main(int argc, char **argv)
 {
     extern int optind;
     extern char *optarg;
-    char filename[256], *buf;
+    char filename[256], *buf, *hints_file=NULL;
     int i, rank, nprocs, err, nerrs=0, verbose, omode, nvars, len;
     int psizes[2], sizes[2], subsizes[2], starts[2], *blks;
     MPI_Aint *disp;
@@ -70,7 +63,7 @@ int main(int argc, char **argv)
     filename[0] = '\0';
 
     /* get command-line arguments */
-    while ((i = getopt(argc, argv, "hvn:l:f:")) != EOF)
+    while ((i = getopt(argc, argv, "hvn:l:f:H:")) != EOF)
         switch(i) {
             case 'v': verbose = 1;
                       break;
@@ -80,6 +73,8 @@ int main(int argc, char **argv)
                       break;
             case 'f': strcpy(filename, optarg);
                       break;
+            case 'H': hints_file = optarg;
+                      break;
             case 'h':
             default:  if (rank==0) usage(argv[0]);
                       MPI_Finalize();
@@ -92,6 +87,12 @@ int main(int argc, char **argv)
         return 1;
     }
 
+    /* load user I/O hints from the hint file, if given */
+    if (bench_hints_load(hints_file, MPI_COMM_WORLD, &info) != 0) {
+        MPI_Finalize();
+        return 1;
+    }
+
     if (verbose && rank == 0) {
         printf("Number of MPI processes:  %d\n",nprocs);
         printf("Number of varaibles:      %d\n",nvars);
@@ -140,6 +141,9 @@ int main(int argc, char **argv)
     /* open file and truncate it to zero sized */
     omode = MPI_MODE_CREATE | MPI_MODE_RDWR;
     err = MPI_File_open(MPI_COMM_WORLD, filename, omode, info, &fh); ERR
+    if (hints_file != NULL) {
+        err = bench_hints_print(fh, MPI_COMM_WORLD); ERR
+    }
     err = MPI_File_set_size(fh, 0); ERR
 
     /* set the file view */
@@ -174,6 +178,7 @@ int main(int argc, char **argv)
     free(buf);
 
 err_out:
+    if (info != MPI_INFO_NULL) MPI_Info_free(&info);
     MPI_Finalize();
     return (nerrs > 0);
 }
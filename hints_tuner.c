@@ -0,0 +1,757 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Copyright (C) 2026, Northwestern University
+ * See COPYRIGHT notice in top-level directory.
+ *
+ * This program searches the MPI-IO hints that give the highest collective
+ * write bandwidth for the access pattern of one of the example programs, and
+ * writes the best hint set into a hint file, with one "key value" pair per
+ * line, the same format as the file pointed by environment variable
+ * ROMIO_HINTS of ROMIO.
+ *
+ * The access pattern is selected by command-line option '-p':
+ *   nvars         nvars 3D variables of 2 x len x len ints per process, each
+ *                 partitioned in a 2D block-block fashion, see nvars.c
+ *   column_wise   a 2D array of (len * len) rows and nprocs * 4 columns of
+ *                 floats, partitioned along columns, so each process writes
+ *                 a block of 4 columns per row, see column_wise.c
+ *   ghost_cell    a 2D local array of len x len ints with 2 ghost cells on
+ *                 both ends of each dimension, see ghost_cell.c
+ *   pio_noncontig a small variable followed by nvars 2D variables of len rows
+ *                 partitioned along columns, len bytes per row per process,
+ *                 from a user buffer of 2 blocks separated by a gap, see
+ *                 tests/pio_noncontig.c
+ *
+ * The hint space is the product of the candidate values of each hint key.
+ * The default space is
+ *   cb_nodes        "-", 1, 2, 4, ..., up to the number of processes
+ *   cb_buffer_size  "-", 1048576, 4194304, 16777216
+ *   romio_cb_write  "-", enable, disable
+ *   romio_ds_write  "-", enable, disable
+ *   striping_factor "-", 4, 16
+ *   striping_unit   "-", 1048576, 4194304
+ * where "-" leaves the hint unset, i.e. uses the default of the MPI library.
+ * Option '-s key=v1,v2,...' replaces the candidate values of a key or adds a
+ * new key, and can be given multiple times, e.g. '-s striping_factor=-' drops
+ * striping from the search. The hints in the hint file given by option '-H'
+ * are fixed to their values in the search.
+ *
+ * Instead of running the full grid, the search uses successive halving: a
+ * number of candidates ('-c', default 32) are sampled from the space, always
+ * including the one of all library defaults. In each round, each surviving
+ * candidate writes the pattern a number of times, starting from '-N' times,
+ * and only the fastest 1/eta of candidates ('-e', default 2) by the median
+ * time survive into the next round, in which the number of timed runs is
+ * multiplied by eta. The search ends when one candidate is left. Each timed
+ * run deletes the file, then times MPI_File_open, MPI_File_set_view,
+ * MPI_File_write_all, and MPI_File_close, so the hints applied at the file
+ * creation, such as striping, take effect.
+ *
+ * To compile:
+ *        mpicc -O2 hints_tuner.c bench_util.c -o hints_tuner -lm
+ * To run:
+ *        mpiexec -n 64 ./hints_tuner -p nvars -l 512 -n 8 -O hints.txt -f testfile
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> /* strcpy(), strdup(), strchr() */
+#include <unistd.h> /* getopt() */
+
+#include <mpi.h>
+
+#include "bench_util.h"
+
+#define ZDIMS     2   /* Z dimension of variables of pattern nvars */
+#define NGHOSTS   2   /* ghost cells of pattern ghost_cell */
+#define NCOLS     4   /* columns per process of pattern column_wise */
+#define GAP       16  /* gap in the user buffer of pattern pio_noncontig */
+#define NCANDS    32  /* default number of sampled candidates */
+#define ETA       2   /* default reduction factor of successive halving */
+#define MAX_KEYS  32
+#define MAX_VALS  64
+
+/* access patterns of the example programs */
+#define PAT_NVARS         0
+#define PAT_COLUMN_WISE   1
+#define PAT_GHOST_CELL    2
+#define PAT_PIO_NONCONTIG 3
+#define NPATTERNS         4
+static const char *pattern_names[NPATTERNS] = {"nvars", "column_wise",
+    "ghost_cell", "pio_noncontig"};
+
+/* candidate values of one hint key, "-" for leaving the hint unset */
+typedef struct {
+    char *key;
+    int   nvals;
+    char *vals[MAX_VALS];
+} hint_key;
+
+/* the requests of one process of an access pattern */
+typedef struct {
+    void         *buf;
+    int           count;     /* number of bufType in buf */
+    MPI_Datatype  bufType;
+    MPI_Datatype  fileType;
+    double        amnt;      /* bytes written by all processes */
+} pattern;
+
+static int verbose;
+
+/*----< add_key() >----------------------------------------------------------*/
+/* Set the candidate values of key to a comma-separated list, or to a single
+ * value when split is 0, replacing the existing values if key is already in
+ * the space. Return -1 on error.
+ */
+static int
+add_key(hint_key *space, int *nkeys, const char *key, const char *vals,
+        int split)
+{
+    int i;
+    char *str, *tok, *next;
+
+    for (i=0; i<*nkeys; i++)
+        if (!strcmp(space[i].key, key)) break;
+    if (i == *nkeys) {
+        if (*nkeys == MAX_KEYS) return -1;
+        space[i].key = strdup(key);
+        (*nkeys)++;
+    }
+    else {
+        while (space[i].nvals > 0) free(space[i].vals[--space[i].nvals]);
+    }
+
+    str = strdup(vals);
+    for (tok=str; tok != NULL; tok=next) {
+        next = (split) ? strchr(tok, ',') : NULL;
+        if (next != NULL) *next++ = '\0';
+        if (*tok == '\0') continue;
+        if (space[i].nvals == MAX_VALS) {
+            free(str);
+            return -1;
+        }
+        space[i].vals[space[i].nvals++] = strdup(tok);
+    }
+    free(str);
+    if (space[i].nvals == 0) space[i].vals[space[i].nvals++] = strdup("-");
+    return 0;
+}
+
+/*----< default_space() >----------------------------------------------------*/
+static void
+default_space(hint_key *space, int *nkeys, int nprocs)
+{
+    int n;
+    char vals[1024], *p=vals;
+
+    p += sprintf(p, "-");
+    for (n=1; n<nprocs; n*=2) p += sprintf(p, ",%d", n);
+    sprintf(p, ",%d", nprocs);
+
+    *nkeys = 0;
+    add_key(space, nkeys, "cb_nodes", vals, 1);
+    add_key(space, nkeys, "cb_buffer_size", "-,1048576,4194304,16777216", 1);
+    add_key(space, nkeys, "romio_cb_write", "-,enable,disable", 1);
+    add_key(space, nkeys, "romio_ds_write", "-,enable,disable", 1);
+    add_key(space, nkeys, "striping_factor", "-,4,16", 1);
+    add_key(space, nkeys, "striping_unit", "-,1048576,4194304", 1);
+}
+
+/*----< set_info() >---------------------------------------------------------*/
+/* create an info object of the hints of candidate choice[nkeys] */
+static MPI_Info
+set_info(const hint_key *space, int nkeys, const int *choice)
+{
+    int k;
+    MPI_Info info;
+
+    MPI_Info_create(&info);
+    for (k=0; k<nkeys; k++) {
+        const char *val = space[k].vals[choice[k]];
+        if (strcmp(val, "-")) MPI_Info_set(info, space[k].key, val);
+    }
+    return info;
+}
+
+/*----< print_hints() >------------------------------------------------------*/
+/* print the hints set by a candidate, as "key value" lines in the format of
+ * a hint file when lines is 1, or otherwise as "key=value" pairs in one line
+ */
+static void
+print_hints(FILE *fp, const hint_key *space, int nkeys, const int *choice,
+            int lines)
+{
+    int k, n=0;
+
+    for (k=0; k<nkeys; k++) {
+        const char *val = space[k].vals[choice[k]];
+        if (!strcmp(val, "-")) continue;
+        if (lines)
+            fprintf(fp, "%s %s\n", space[k].key, val);
+        else
+            fprintf(fp, "%s%s=%s", (n > 0) ? " " : "", space[k].key, val);
+        n++;
+    }
+    if (n == 0 && !lines) fprintf(fp, "(defaults)");
+}
+
+/*----< sample_candidates() >------------------------------------------------*/
+/* Root process 0 samples ncands distinct candidates from the space, the first
+ * of which is the one of all library defaults, and broadcasts them. When the
+ * space has no more than ncands candidates, all of them are taken. Return the
+ * number of candidates.
+ */
+static int
+sample_candidates(const hint_key *space, int nkeys, int ncands, int seed,
+                  int *cands, MPI_Comm comm)
+{
+    int i, j, k, rank, n=0;
+    long long grid=1;
+
+    MPI_Comm_rank(comm, &rank);
+
+    for (k=0; k<nkeys && grid <= ncands; k++) grid *= space[k].nvals;
+
+    if (rank == 0) {
+        /* the first candidate leaves all hints unset when "-" is a value */
+        for (k=0; k<nkeys; k++) {
+            cands[k] = 0;
+            for (j=0; j<space[k].nvals; j++)
+                if (!strcmp(space[k].vals[j], "-")) cands[k] = j;
+        }
+        n = 1;
+
+        if (grid <= ncands) {
+            /* take the full grid in mixed-radix order, skipping the first */
+            long long g;
+            for (g=0; g<grid; g++) {
+                int *c = cands + n * nkeys;
+                long long m = g;
+                for (k=0; k<nkeys; k++) {
+                    c[k] = m % space[k].nvals;
+                    m /= space[k].nvals;
+                }
+                if (memcmp(c, cands, sizeof(int) * nkeys)) n++;
+            }
+        }
+        else {
+            srand(seed);
+            while (n < ncands) {
+                int *c = cands + n * nkeys;
+                for (k=0; k<nkeys; k++) c[k] = rand() % space[k].nvals;
+                for (i=0; i<n; i++)
+                    if (!memcmp(c, cands + i * nkeys, sizeof(int) * nkeys))
+                        break;
+                if (i == n) n++;
+            }
+        }
+    }
+
+    MPI_Bcast(&n, 1, MPI_INT, 0, comm);
+    MPI_Bcast(cands, n * nkeys, MPI_INT, 0, comm);
+    return n;
+}
+
+/*----< create_pattern() >---------------------------------------------------*/
+/* construct the buffer and file types and the buffer of an access pattern */
+static int
+create_pattern(int pat, MPI_Comm comm, int len, int nvars, pattern *p)
+{
+    int i, err, nerrs=0, rank, nprocs, psizes[2], type_size;
+    int sizes[3], subsizes[3], starts[3];
+    MPI_Aint lb, extent;
+
+    MPI_Comm_size(comm, &nprocs);
+    MPI_Comm_rank(comm, &rank);
+
+    psizes[0] = psizes[1] = 0;
+    MPI_Dims_create(nprocs, 2, psizes);
+
+    p->buf      = NULL;
+    p->count    = 0;
+    p->bufType  = MPI_DATATYPE_NULL;
+    p->fileType = MPI_DATATYPE_NULL;
+
+    if (pat == PAT_NVARS) {
+        /* nvars subarrays concatenated by MPI_Type_create_hindexed() */
+        int *blks;
+        MPI_Aint *disp;
+        MPI_Datatype subType;
+
+        sizes[0]    = ZDIMS;
+        sizes[1]    = len * psizes[0];
+        sizes[2]    = len * psizes[1];
+        subsizes[0] = ZDIMS;
+        subsizes[1] = len;
+        subsizes[2] = len;
+        starts[0]   = 0;
+        starts[1]   = len * (rank / psizes[1]);
+        starts[2]   = len * (rank % psizes[1]);
+        err = MPI_Type_create_subarray(3, sizes, subsizes, starts, MPI_ORDER_C,
+                                       MPI_INT, &subType); ERR
+
+        disp = (MPI_Aint*) malloc(sizeof(MPI_Aint) * nvars);
+        blks = (int*) malloc(sizeof(int) * nvars);
+        for (i=0; i<nvars; i++) {
+            disp[i] = sizeof(int) * i * sizes[0] * sizes[1] * sizes[2];
+            blks[i] = 1;
+        }
+        err = MPI_Type_create_hindexed(nvars, blks, disp, subType,
+                                       &p->fileType);
+        free(disp);
+        free(blks);
+        MPI_Type_free(&subType);
+        ERR
+
+        p->count   = nvars * ZDIMS * len * len;
+        p->bufType = MPI_INT;
+        p->buf     = malloc(sizeof(int) * p->count);
+        for (i=0; i<p->count; i++) ((int*)p->buf)[i] = rank;
+    }
+    else if (pat == PAT_COLUMN_WISE) {
+        /* one block of NCOLS floats per row */
+        sizes[0]    = len * len;
+        sizes[1]    = NCOLS * nprocs;
+        subsizes[0] = len * len;
+        subsizes[1] = NCOLS;
+        starts[0]   = 0;
+        starts[1]   = NCOLS * rank;
+        err = MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C,
+                                       MPI_FLOAT, &p->fileType); ERR
+
+        p->count   = len * len * NCOLS;
+        p->bufType = MPI_FLOAT;
+        p->buf     = malloc(sizeof(float) * p->count);
+        for (i=0; i<p->count; i++) ((float*)p->buf)[i] = rank;
+    }
+    else if (pat == PAT_GHOST_CELL) {
+        /* 2D subarray of the global array from a local array with ghosts */
+        int xlen = len + 2 * NGHOSTS;
+
+        sizes[0]    = len * psizes[0];
+        sizes[1]    = len * psizes[1];
+        subsizes[0] = len;
+        subsizes[1] = len;
+        starts[0]   = len * (rank / psizes[1]);
+        starts[1]   = len * (rank % psizes[1]);
+        err = MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C,
+                                       MPI_INT, &p->fileType); ERR
+
+        sizes[0]  = sizes[1]  = xlen;
+        starts[0] = starts[1] = NGHOSTS;
+        err = MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C,
+                                       MPI_INT, &p->bufType); ERR
+        err = MPI_Type_commit(&p->bufType); ERR
+
+        p->count = 1;
+        p->buf   = malloc(sizeof(int) * xlen * xlen);
+        for (i=0; i<xlen*xlen; i++) ((int*)p->buf)[i] = rank;
+    }
+    else { /* PAT_PIO_NONCONTIG */
+        /* a small variable and nvars subarrays concatenated by
+         * MPI_Type_create_struct(), written from 2 blocks of the buffer
+         */
+        int *blocklen;
+        MPI_Aint *displace;
+        MPI_Datatype *subTypes;
+
+        blocklen = (int*) malloc(sizeof(int) * (nvars + 1));
+        displace = (MPI_Aint*) malloc(sizeof(MPI_Aint) * (nvars + 1));
+        subTypes = (MPI_Datatype*) malloc(sizeof(MPI_Datatype) * (nvars + 1));
+
+        blocklen[0] = len;
+        blocklen[1] = len * len * nvars;
+        displace[0] = 0;
+        displace[1] = len + GAP;
+        err = MPI_Type_create_hindexed(2, blocklen, displace, MPI_BYTE,
+                                       &p->bufType); ERR
+        err = MPI_Type_commit(&p->bufType); ERR
+
+        err = MPI_Type_contiguous(len, MPI_BYTE, &subTypes[0]); ERR
+        blocklen[0] = 1;
+        displace[0] = (MPI_Aint)len * rank;
+        for (i=1; i<=nvars; i++) {
+            sizes[0]    = len;
+            sizes[1]    = len * nprocs;
+            subsizes[0] = len;
+            subsizes[1] = len;
+            starts[0]   = 0;
+            starts[1]   = len * rank;
+            err = MPI_Type_create_subarray(2, sizes, subsizes, starts,
+                           MPI_ORDER_C, MPI_BYTE, &subTypes[i]); ERR
+            blocklen[i] = 1;
+            displace[i] = (MPI_Aint)len * nprocs
+                        + (MPI_Aint)sizes[0] * sizes[1] * (i - 1);
+        }
+        err = MPI_Type_create_struct(nvars + 1, blocklen, displace, subTypes,
+                                     &p->fileType); ERR
+        for (i=0; i<=nvars; i++) MPI_Type_free(&subTypes[i]);
+        free(subTypes);
+        free(displace);
+        free(blocklen);
+
+        p->count = 1;
+        p->buf   = calloc(len + GAP + (size_t)len * len * nvars, 1);
+    }
+    err = MPI_Type_commit(&p->fileType); ERR
+
+    err = MPI_Type_size(p->fileType, &type_size); ERR
+    err = MPI_Type_get_extent(p->fileType, &lb, &extent); ERR
+    p->amnt = (double)type_size * nprocs;
+
+    if (verbose && rank == 0)
+        printf("Pattern %s: fileType size %d extent %ld, %.2f MiB per run\n",
+               pattern_names[pat], type_size, (long)extent,
+               p->amnt / 1048576.0);
+
+err_out:
+    return nerrs;
+}
+
+/*----< free_pattern() >-----------------------------------------------------*/
+static void
+free_pattern(pattern *p)
+{
+    if (p->buf != NULL) free(p->buf);
+    if (p->fileType != MPI_DATATYPE_NULL) MPI_Type_free(&p->fileType);
+    if (p->bufType != MPI_DATATYPE_NULL && p->bufType != MPI_INT &&
+        p->bufType != MPI_FLOAT)
+        MPI_Type_free(&p->bufType);
+}
+
+/*----< run_candidate() >----------------------------------------------------*/
+/* Write the pattern nwarmup + nreps times with the hints in info. Each run
+ * deletes the file, then times open, set_view, write_all, and close. On root
+ * process 0, *median is the median time (max of ranks) of the timed runs.
+ */
+static int
+run_candidate(const pattern *p, const char *filename, MPI_Info info,
+              int nwarmup, int nreps, double *median)
+{
+    int i, err, nerrs=0, rank;
+    bench_timer t;
+    bench_stats op;
+    MPI_File fh;
+    MPI_Status status;
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    bench_timer_init(&t, "candidate", nwarmup, nreps);
+
+    for (i=0; i<nwarmup+nreps; i++) {
+        /* striping hints only take effect when creating a new file */
+        if (rank == 0) MPI_File_delete(filename, MPI_INFO_NULL);
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&t);
+        err = MPI_File_open(MPI_COMM_WORLD, filename,
+                            MPI_MODE_CREATE | MPI_MODE_WRONLY, info, &fh); ERR
+        err = MPI_File_set_view(fh, 0, MPI_BYTE, p->fileType, "native", info);
+        ERR
+        err = MPI_File_write_all(fh, p->buf, p->count, p->bufType, &status);
+        ERR
+        err = MPI_File_close(&fh); ERR
+        bench_timer_stop(&t);
+    }
+
+    err = bench_timer_reduce(&t, MPI_COMM_WORLD, 0, &op, NULL, NULL); ERR
+    if (rank == 0) *median = op.median;
+
+err_out:
+    bench_timer_free(&t);
+    return nerrs;
+}
+
+/*----< write_hint_file() >--------------------------------------------------*/
+static int
+write_hint_file(const char *path, const char *pat, int nprocs, double bw,
+                const hint_key *space, int nkeys, const int *choice)
+{
+    FILE *fp;
+
+    fp = fopen(path, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Error: failed to open hint file %s\n", path);
+        return 1;
+    }
+    fprintf(fp, "# MPI-IO hints selected by hints_tuner for pattern %s on %d processes\n",
+            pat, nprocs);
+    fprintf(fp, "# collective write bandwidth %.2f MiB/sec\n", bw);
+    print_hints(fp, space, nkeys, choice, 1);
+    fclose(fp);
+    return 0;
+}
+
+static void
+usage(char *argv0)
+{
+    char *help =
+    "Usage: %s [-hv | -p pattern | -l len | -n num | -s key=list | -c num | -e num | -S num | -W num | -N num | -O file | -o file | -H file] -f file_name\n"
+    "       [-h] Print this help\n"
+    "       [-v] verbose mode\n"
+    "       [-p pattern] access pattern: nvars, column_wise, ghost_cell, or\n"
+    "                    pio_noncontig (default: nvars)\n"
+    "       [-l len] length of local array dimensions (default: %d)\n"
+    "       [-n num] number of variables of nvars and pio_noncontig (default: %d)\n"
+    "       [-s key=list] comma-separated candidate values of a hint key, '-'\n"
+    "                     for unset, replacing the default list of the key\n"
+    "       [-c num] number of candidates sampled from the space (default: %d)\n"
+    "       [-e num] keep 1/num of candidates per round (default: %d)\n"
+    "       [-S num] seed of the sampling (default: 1)\n"
+    "       [-W num] number of untimed warmup runs per candidate per round (default: %d)\n"
+    "       [-N num] number of timed runs per candidate of the first round (default: %d)\n"
+    "       [-O file] write the best hints to file (default: hints.txt)\n"
+    "       [-o file] append results as a line of JSON to file\n"
+    "       [-H file] fix the hints in file of \"key value\" lines\n"
+    "        -f file_name: output file name\n";
+    fprintf(stderr, help, argv0, 128, 4, NCANDS, ETA, BENCH_NWARMUP,
+            BENCH_NREPS);
+}
+
+/*----< main() >------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    extern int optind;
+    extern char *optarg;
+    char filename[256], *hint_file=NULL, *out_file=NULL, *hints_file=NULL;
+    char *eq, key[MPI_MAX_INFO_KEY+1], value[MPI_MAX_INFO_VAL+1];
+    int i, j, k, err, nerrs=0, rank, nprocs, pat, len, nvars, ncands, eta;
+    int seed, nwarmup, nreps, nkeys, nalive, round, ntrials, *cands=NULL;
+    int *alive=NULL, best, dflt, flag;
+    double *times=NULL, dflt_time=0.0;
+    hint_key space[MAX_KEYS];
+    bench_record rec;
+    pattern p;
+    MPI_Info info=MPI_INFO_NULL;
+    MPI_File fh;
+
+    MPI_Init(&argc,&argv);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    verbose     = 0;
+    pat         = PAT_NVARS;
+    len         = 128;
+    nvars       = 4;
+    ncands      = NCANDS;
+    eta         = ETA;
+    seed        = 1;
+    nwarmup     = BENCH_NWARMUP;
+    nreps       = BENCH_NREPS;
+    filename[0] = '\0';
+
+    default_space(space, &nkeys, nprocs);
+
+    /* get command-line arguments */
+    while ((i = getopt(argc, argv, "hvp:l:n:s:c:e:S:W:N:O:o:f:H:")) != EOF)
+        switch(i) {
+            case 'v': verbose = 1;
+                      break;
+            case 'p': for (pat=0; pat<NPATTERNS; pat++)
+                          if (!strcmp(optarg, pattern_names[pat])) break;
+                      if (pat == NPATTERNS) {
+                          if (rank==0) usage(argv[0]);
+                          MPI_Finalize();
+                          return 1;
+                      }
+                      break;
+            case 'l': len = atoi(optarg);
+                      break;
+            case 'n': nvars = atoi(optarg);
+                      break;
+            case 's': eq = strchr(optarg, '=');
+                      if (eq != NULL) *eq = '\0';
+                      if (eq == NULL || *optarg == '\0' ||
+                          add_key(space, &nkeys, optarg, eq + 1, 1) < 0) {
+                          if (rank==0) usage(argv[0]);
+                          MPI_Finalize();
+                          return 1;
+                      }
+                      break;
+            case 'c': ncands = atoi(optarg);
+                      break;
+            case 'e': eta = atoi(optarg);
+                      break;
+            case 'S': seed = atoi(optarg);
+                      break;
+            case 'W': nwarmup = atoi(optarg);
+                      break;
+            case 'N': nreps = atoi(optarg);
+                      break;
+            case 'O': hint_file = strdup(optarg);
+                      break;
+            case 'o': out_file = strdup(optarg);
+                      break;
+            case 'f': strcpy(filename, optarg);
+                      break;
+            case 'H': hints_file = optarg;
+                      break;
+            case 'h':
+            default:  if (rank==0) usage(argv[0]);
+                      MPI_Finalize();
+                      return 1;
+        }
+
+    if (filename[0] == '\0' || len <= 0 || nvars <= 0) {
+        if (rank==0) usage(argv[0]);
+        MPI_Finalize();
+        return 1;
+    }
+    if (ncands < 1) ncands = 1;
+    if (eta < 2) eta = 2;
+    if (nreps < 1) nreps = 1;
+    if (hint_file == NULL) hint_file = strdup("hints.txt");
+
+    /* the hints in the hint file, if given, are fixed in the search */
+    if (bench_hints_load(hints_file, MPI_COMM_WORLD, &info) != 0) {
+        MPI_Finalize();
+        return 1;
+    }
+    if (info != MPI_INFO_NULL) {
+        int nfixed;
+        MPI_Info_get_nkeys(info, &nfixed);
+        for (i=0; i<nfixed; i++) {
+            MPI_Info_get_nthkey(info, i, key);
+            MPI_Info_get(info, key, MPI_MAX_INFO_VAL, value, &flag);
+            if (flag && add_key(space, &nkeys, key, value, 0) < 0) {
+                if (rank == 0) printf("Error: too many hint keys\n");
+                MPI_Finalize();
+                return 1;
+            }
+        }
+        MPI_Info_free(&info);
+    }
+
+    bench_record_init(&rec, MPI_COMM_WORLD, "hints_tuner");
+    bench_record_str(&rec, "pattern", pattern_names[pat]);
+    bench_record_int(&rec, "len", len);
+    bench_record_int(&rec, "nvars", nvars);
+    bench_record_int(&rec, "eta", eta);
+
+    nerrs = create_pattern(pat, MPI_COMM_WORLD, len, nvars, &p);
+    if (nerrs > 0) goto err_out;
+
+    cands = (int*) malloc(sizeof(int) * ncands * nkeys);
+    ncands = sample_candidates(space, nkeys, ncands, seed, cands,
+                               MPI_COMM_WORLD);
+    bench_record_int(&rec, "ncands", ncands);
+
+    if (rank == 0) {
+        printf("Pattern %s on %d processes, %.2f MiB per run\n",
+               pattern_names[pat], nprocs, p.amnt / 1048576.0);
+        printf("Hint space:\n");
+        for (k=0; k<nkeys; k++) {
+            printf("    %-20s", space[k].key);
+            for (j=0; j<space[k].nvals; j++)
+                printf(" %s", space[k].vals[j]);
+            printf("\n");
+        }
+        printf("Number of candidates sampled = %d, keep 1/%d per round\n",
+               ncands, eta);
+    }
+
+    /* successive halving: alive[nalive] are the indices of candidates */
+    alive = (int*) malloc(sizeof(int) * ncands);
+    times = (double*) malloc(sizeof(double) * ncands);
+    for (i=0; i<ncands; i++) alive[i] = i;
+    nalive  = ncands;
+    ntrials = 0;
+    dflt    = 0; /* candidate 0 is the library defaults */
+
+    for (round=0; ; round++) {
+        for (i=0; i<nalive; i++) {
+            MPI_Info info = set_info(space, nkeys, cands + alive[i] * nkeys);
+            nerrs += run_candidate(&p, filename, info, nwarmup, nreps,
+                                   &times[i]);
+            MPI_Info_free(&info);
+            if (nerrs > 0) goto err_out;
+            if (alive[i] == dflt) dflt_time = times[i];
+        }
+        ntrials += nalive * (nwarmup + nreps);
+
+        /* root ranks the candidates by time and keeps the fastest, in the
+         * order of time
+         */
+        if (rank == 0) {
+            for (i=1; i<nalive; i++) {
+                int a = alive[i];
+                double t = times[i];
+                for (j=i; j>0 && times[j-1] > t; j--) {
+                    alive[j] = alive[j-1];
+                    times[j] = times[j-1];
+                }
+                alive[j] = a;
+                times[j] = t;
+            }
+            printf("---- round %d: %d candidates, %d timed runs each\n",
+                   round, nalive, nreps);
+            for (i=0; i<nalive; i++) {
+                printf("     %s %3d: %10.6f sec %10.2f MiB/sec  ",
+                       (i < (nalive + eta - 1) / eta) ? "keep" : "drop",
+                       alive[i], times[i], p.amnt / 1048576.0 / times[i]);
+                print_hints(stdout, space, nkeys, cands + alive[i] * nkeys, 0);
+                printf("\n");
+            }
+        }
+        MPI_Bcast(alive, nalive, MPI_INT, 0, MPI_COMM_WORLD);
+        if (nalive == 1) break;
+
+        nalive = (nalive + eta - 1) / eta;
+        nreps *= eta;
+    }
+    best = alive[0];
+
+    /* print the hints in effect of the best hint set */
+    info = set_info(space, nkeys, cands + best * nkeys);
+    if (rank == 0) MPI_File_delete(filename, MPI_INFO_NULL);
+    MPI_Barrier(MPI_COMM_WORLD);
+    err = MPI_File_open(MPI_COMM_WORLD, filename,
+                        MPI_MODE_CREATE | MPI_MODE_WRONLY, info, &fh); ERR
+    err = bench_hints_print(fh, MPI_COMM_WORLD); ERR
+    err = MPI_File_close(&fh); ERR
+
+    if (rank == 0) {
+        double bw = p.amnt / 1048576.0 / times[0];
+
+        printf("Number of trial writes = %d\n", ntrials);
+        printf("Best hints: ");
+        print_hints(stdout, space, nkeys, cands + best * nkeys, 0);
+        printf("\n");
+        printf("Best collective write bandwidth = %.2f MiB/sec", bw);
+        if (dflt_time > 0.0)
+            printf(", %.2fx of library defaults (%.2f MiB/sec)",
+                   dflt_time / times[0], p.amnt / 1048576.0 / dflt_time);
+        printf("\n");
+
+        if (write_hint_file(hint_file, pattern_names[pat], nprocs, bw, space,
+                            nkeys, cands + best * nkeys)) nerrs++;
+        else
+            printf("Best hints written to %s\n", hint_file);
+
+        bench_record_int(&rec, "ntrials", ntrials);
+        bench_record_double(&rec, "best_time", times[0]);
+        bench_record_double(&rec, "default_time", dflt_time);
+        for (k=0; k<nkeys; k++)
+            bench_record_str(&rec, space[k].key,
+                             space[k].vals[cands[best * nkeys + k]]);
+    }
+    if (out_file != NULL) bench_record_write(&rec, out_file);
+
+err_out:
+    if (info != MPI_INFO_NULL) MPI_Info_free(&info);
+    free_pattern(&p);
+    if (cands != NULL) free(cands);
+    if (alive != NULL) free(alive);
+    if (times != NULL) free(times);
+    for (k=0; k<nkeys; k++) {
+        free(space[k].key);
+        for (j=0; j<space[k].nvals; j++) free(space[k].vals[j]);
+    }
+    bench_record_free(&rec);
+    if (out_file != NULL) free(out_file);
+    free(hint_file);
+
+    MPI_Finalize();
+    return (nerrs > 0);
+}
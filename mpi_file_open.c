@@ -7,24 +7,31 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h> /* getopt() */
 #include <mpi.h>
 
+#include "bench_util.h"
+
 #define LEN 10
 
-#define CHECK_ERR(func) { \
-    if (err != MPI_SUCCESS) { \
-        int errorStringLen; \
-        char errorString[MPI_MAX_ERROR_STRING]; \
-        MPI_Error_string(err, errorString, &errorStringLen); \
-        printf("Error at line %d: calling %s (%s)\n",__LINE__, #func, errorString); \
-    } \
+static void
+usage(char *argv0)
+{
+    char *help =
+    "Usage: %s [-h | -H file] [file_name]\n"
+    "       [-h] Print this help\n"
+    "       [-H file] load MPI-IO hints from file of \"key value\" lines\n"
+    "       [file_name] output file name (default: testfile.out)\n";
+    fprintf(stderr, help, argv0);
 }
 
 /*----< main() >------------------------------------------------------------*/
 int main(int argc, char **argv)
 {
-    char *filename;
-    int err, rank, nprocs, cmode, omode;
+    extern int optind;
+    extern char *optarg;
+    char *filename, *hints_file=NULL;
+    int i, err, nerrs=0, rank, nprocs, cmode, omode;
     MPI_File fh;
     MPI_Info info;
 
@@ -34,12 +41,26 @@ int main(int argc, char **argv)
     err = MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
     CHECK_ERR(MPI_Comm_size);
 
+    while ((i = getopt(argc, argv, "hH:")) != EOF)
+        switch(i) {
+            case 'H': hints_file = optarg;
+                      break;
+            case 'h':
+            default:  if (rank==0) usage(argv[0]);
+                      MPI_Finalize();
+                      return 1;
+        }
+
     filename = "testfile.out";
-    if (argc > 1) filename = argv[1];
+    if (argv[optind] != NULL) filename = argv[optind];
 
     /* Users can set customized I/O hints in info object */
     info = MPI_INFO_NULL;  /* no user I/O hint */
 
+    /* load user I/O hints from the hint file, if given */
+    err = bench_hints_load(hints_file, MPI_COMM_WORLD, &info);
+    if (err != 0) goto prog_exit;
+
     /* set file open mode */
     cmode  = MPI_MODE_CREATE; /* to create a new file */
     cmode |= MPI_MODE_WRONLY; /* with write-only permission */
@@ -48,6 +69,12 @@ int main(int argc, char **argv)
     err = MPI_File_open(MPI_COMM_WORLD, filename, cmode, info, &fh);
     CHECK_ERR(MPI_File_open to write);
 
+    /* print the hints in effect when a hint file is used */
+    if (hints_file != NULL) {
+        err = bench_hints_print(fh, MPI_COMM_WORLD);
+        CHECK_ERR(bench_hints_print);
+    }
+
     /* collectively close the file */
     err = MPI_File_close(&fh);
     CHECK_ERR(MPI_File_close);
@@ -64,6 +91,7 @@ int main(int argc, char **argv)
     CHECK_ERR(MPI_File_close);
 
 prog_exit:
+    if (info != MPI_INFO_NULL) MPI_Info_free(&info);
     MPI_Finalize();
-    return 0;
+    return (nerrs > 0);
 }
@@ -13,38 +13,69 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h> /* getopt() */
 #include <mpi.h>
 
-#define CHECK_ERR(func) { \
-    if (err != MPI_SUCCESS) { \
-        int errorStringLen; \
-        char errorString[MPI_MAX_ERROR_STRING]; \
-        MPI_Error_string(err, errorString, &errorStringLen); \
-        printf("Error at line %d: calling %s (%s)\n",__LINE__, #func, errorString); \
-    } \
+#include "bench_util.h"
+
+static void
+usage(char *argv0)
+{
+    char *help =
+    "Usage: %s [-h | -H file] [file_name]\n"
+    "       [-h] Print this help\n"
+    "       [-H file] load MPI-IO hints from file of \"key value\" lines\n"
+    "       [file_name] output file name (default: testfile.out)\n";
+    fprintf(stderr, help, argv0);
 }
 
 /*----< main() >------------------------------------------------------------*/
 int main(int argc, char **argv) {
-    char *filename;
-    int i, err, cmode, rank, buf[10];
+    extern int optind;
+    extern char *optarg;
+    char *filename, *hints_file=NULL;
+    int i, err, nerrs=0, cmode, rank, buf[10];
     MPI_Offset offset;
     MPI_File fh;
     MPI_Status status;
+    MPI_Info info=MPI_INFO_NULL;
 
     MPI_Init(&argc, &argv);
 
     err = MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     CHECK_ERR(MPI_Comm_rank);
 
+    while ((i = getopt(argc, argv, "hH:")) != EOF)
+        switch(i) {
+            case 'H': hints_file = optarg;
+                      break;
+            case 'h':
+            default:  if (rank==0) usage(argv[0]);
+                      MPI_Finalize();
+                      return 1;
+        }
+
     filename = "testfile.out";
-    if (argc > 1) filename = argv[1];
+    if (argv[optind] != NULL) filename = argv[optind];
+
+    /* load user I/O hints from the hint file, if given */
+    err = bench_hints_load(hints_file, MPI_COMM_WORLD, &info);
+    if (err != 0) {
+        MPI_Finalize();
+        return 1;
+    }
 
     /* open a file (create if the file does not exist) */
     cmode = MPI_MODE_CREATE | MPI_MODE_RDWR;
-    err = MPI_File_open(MPI_COMM_WORLD, filename, cmode, MPI_INFO_NULL, &fh);
+    err = MPI_File_open(MPI_COMM_WORLD, filename, cmode, info, &fh);
     CHECK_ERR(MPI_File_open);
 
+    /* print the hints in effect when a hint file is used */
+    if (hints_file != NULL) {
+        err = bench_hints_print(fh, MPI_COMM_WORLD);
+        CHECK_ERR(bench_hints_print);
+    }
+
     /* initialize write buffer contents */
     for (i=0; i<10; i++) buf[i] = 100 * rank + i;
 
@@ -60,7 +91,7 @@ int main(int argc, char **argv) {
      * argument. In this example, the "file view" of a process is the entire
      * file starting from its offset.
      */
-    err = MPI_File_set_view(fh, offset, MPI_INT, MPI_INT, "native", MPI_INFO_NULL);
+    err = MPI_File_set_view(fh, offset, MPI_INT, MPI_INT, "native", info);
     CHECK_ERR(MPI_File_set_view);
 
     /* Each process writes 3 integers to the file region visible to it.
@@ -80,8 +111,10 @@ int main(int argc, char **argv) {
     err = MPI_File_close(&fh);
     CHECK_ERR(MPI_File_close);
 
+    if (info != MPI_INFO_NULL) MPI_Info_free(&info);
+
     MPI_Finalize();
-    return 0;
+    return (nerrs > 0);
 }
 
 
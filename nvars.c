@@ -13,29 +13,153 @@
  * Similarly the buffer type is concatenated from multiple subarrays if ghost
  * cell option is used.
  *
+ * Command-line option '-i' enables an instrumented mode, in which each run of
+ * the collective write separately times the construction of the filetype, and
+ * calls to MPI_File_open, MPI_File_set_view, MPI_File_write_all, and
+ * MPI_File_close. A barrier is called before each phase, so the timing of a
+ * phase does not include the waiting for processes still in the previous
+ * phase. Note ROMIO flattens the filetype in MPI_File_set_view. The changes of
+ * MPI_T performance variables selected by option '-P' are also reported.
+ *
+ * Command-line option '-p' adds a pack-then-write mode, which packs the user
+ * buffer into a contiguous staging buffer by MPI_Pack() before calling the
+ * collective write. Option '-u' packs it instead by memcpy() of each row of
+ * the subarrays. The pack time is reported separately.
+ *
+ * Command-line option '-K num' adds a pipelined mode, which splits the
+ * variables into num batches and writes them by MPI_File_iwrite_at_all(),
+ * overlapping each batch with a synthetic computation of '-C sec' seconds
+ * followed by MPI_Wait(). The batches are also written by blocking
+ * MPI_File_write_at_all() without computation, and the computation is also
+ * timed alone. The hidden I/O fraction is the part of the blocking write time
+ * saved by the overlap, i.e. (T_write + T_compute - T_overlap) / T_write,
+ * using the median timings. A low fraction means the MPI library progresses
+ * the nonblocking collective write mostly inside MPI_Wait().
+ *
+ * Command-line option '-F' adds a file-per-process mode and option '-S num'
+ * adds a subfiling mode, in which groups of num consecutive processes, or of
+ * the processes on the same compute node when num is 0, found by
+ * MPI_Comm_split(), each write a subfile collectively. Process of rank r
+ * writes file file_name.r in the file-per-process mode, and the group of ID
+ * g writes subfile file_name.g in the subfiling mode. In a (sub)file, the
+ * local data of a process is stored in the variables of the (sub)file
+ * consisting of the blocks of the processes in the group, one after another
+ * in group rank order. Each timed run opens, writes, and closes the
+ * (sub)files, and is compared with the same sequence writing the shared
+ * file. An index file, file_name.index, maps the block of each process in
+ * the global variables to its subfile, offset, and stride between variables.
+ * With option '-r', each process reassembles, using the index file only,
+ * the block of the next process from the subfiles and checks its contents.
+ *
+ * Command-line option '-G' adds a GPU buffer mode, available when built with
+ * CUDA or HIP, e.g. by "make ENABLE_GPU=cuda". The user buffer is copied into
+ * GPU device memory, with the same layout including the ghost cells, and
+ * written by MPI_File_write_all() directly from the device buffer, which
+ * requires a GPU-aware MPI library. This is compared with staging through a
+ * buffer of pinned host memory, i.e. a device-to-host copy by the GPU runtime
+ * followed by MPI_File_write_all() of the pinned buffer, both timed. With
+ * option '-r', the variables are also read back into the device buffer,
+ * directly and staged by a host-to-device copy after the read, and checked.
+ *
+ * Command-line option '-T list' adds a multithreaded mode, which requests
+ * MPI_THREAD_MULTIPLE in MPI_Init_thread(). For each number of threads T in
+ * list, the variables are split into T consecutive groups, one per thread.
+ * Each thread opens the file on its own duplicate of MPI_COMM_WORLD, sets
+ * the file view of its variables, and the threads call
+ * MPI_File_write_at_all() at the same time. A run is timed from releasing
+ * the threads until all threads have returned. With option '-r', the threads
+ * also read back the variables concurrently and check them. The table at the
+ * end compares the medians with the single collective write and read of all
+ * variables. A speedup near or below 1 means the MPI library serializes the
+ * concurrent collective I/O calls of the threads of a process.
+ *
+ * Command-line option '-z codec' adds a compressed mode, using codec lz4,
+ * zstd, or zlib, which must be enabled when building, e.g. by
+ * "make ENABLE_LZ4=yes". The local data of all variables of a process is
+ * split into chunks of whole rows of about '-b size' bytes, which are
+ * compressed by '-t num' threads. The file offsets of the compressed chunks
+ * of all processes are calculated by MPI_Exscan(), and the chunks are written
+ * with a chunk index of their offsets and sizes by a single call to
+ * MPI_File_write_all() to file file_name.codec. The file consists of a header
+ * written by root, the index of each process in rank order, and the chunks
+ * of all processes in rank order. The compression, the write, and both of
+ * them are timed. With option '-r', each process reads its index and chunks,
+ * decompresses them into the user buffer by the threads, and checks the
+ * contents. Note all elements written by a process have the same value, so
+ * the compression ratio is much higher than of the data of an application.
+ *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h> /* strcpy(), strdup() */
 #include <unistd.h> /* getopt() */
+#include <limits.h> /* INT_MAX */
+#include <pthread.h>
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 #include <mpi.h>
 
-#define ERR \
-    if (err != MPI_SUCCESS) { \
-        int errorStringLen; \
-        char errorString[MPI_MAX_ERROR_STRING]; \
-        MPI_Error_string(err, errorString, &errorStringLen); \
-        printf("Error at line %d: %s\n",__LINE__,errorString); \
-        nerrs++; \
-        goto err_out; \
-    }
+#include "bench_util.h"
 
 int verbose;
 
 #define ZDIMS 2
 
+/* ways of packing the user buffer in the pack-then-write mode */
+#define PACK_NONE   0
+#define PACK_MPI    1  /* MPI_Pack() */
+#define PACK_MEMCPY 2  /* memcpy() of each row of subarrays */
+
+/* file layouts of the file-per-process and subfiling modes */
+#define LAYOUT_SHARED  0
+#define LAYOUT_FPP     1  /* file per process */
+#define LAYOUT_SUBFILE 2  /* one subfile per group of processes */
+
+/* number of columns per process of the index file */
+#define INDEX_NCOLS 8
+
+/* default seconds of computation per batch in the pipelined mode */
+#define COMPUTE_T 0.01
+
+/* codecs of the compressed mode, available when built with the library */
+#define CODEC_NONE 0
+#define CODEC_LZ4  1
+#define CODEC_ZSTD 2
+#define CODEC_ZLIB 3
+static const char *codec_names[4] = {"none", "lz4", "zstd", "zlib"};
+
+/* compression level of zstd, the fastest level */
+#define ZSTD_LEVEL 1
+
+/* default size in bytes of the chunks compressed separately */
+#define CHUNK_SIZE 65536
+
+/* header of the compressed file, ZIP_HEADER_INTS ints starting with magic */
+#define ZIP_MAGIC       0x4e56415a  /* "NVAZ" */
+#define ZIP_HEADER_INTS 8
+
+/* an entry of the chunk index of the compressed file */
+typedef struct {
+    long long offset;  /* file offset of the compressed chunk */
+    long long len;     /* compressed size in bytes */
+} chunk_entry;
+
+/* phases of a collective write timed in the instrumented mode */
+#define NPHASES 5
+static const char *phase_names[NPHASES] = {"create_fileType",
+    "MPI_File_open", "MPI_File_set_view", "MPI_File_write_all",
+    "MPI_File_close"};
+
 int create_fileType(MPI_Comm      comm,
                     int           nvars,
                     int           len,
@@ -164,22 +288,1414 @@ err_out:
     return nerrs;
 }
 
+/*----< check_var() >--------------------------------------------------------*/
+/* Check the local variable k of ZDIMS slabs with ngcells ghost cells, whose
+ * interior must be exp and ghost cells -1. Return 1 and print the first
+ * element not expected, or return 0.
+ */
+static int
+check_var(const int  *var,
+          int         k,
+          int         len,
+          int         ngcells,
+          int         exp,
+          const char *msg)
+{
+    int z, y, x, xlen = len + 2 * ngcells;
+    long long i = bench_verify_block(var, ZDIMS, len, len, ngcells, exp, -1);
+
+    if (i < 0) return 0;
+    z = i / (xlen * xlen);
+    y = (i / xlen) % xlen;
+    x = i % xlen;
+    if (y < ngcells || y >= len+ngcells || x < ngcells || x >= len+ngcells)
+        exp = -1;
+    printf("Error: %sbuf[%d][%d][%d][%d] expect %d but got %d\n", msg, k, z,
+           y, x, exp, var[i]);
+    return 1;
+}
+
+/*----< instrumented_write() >-----------------------------------------------*/
+/* Run the collective write nwarmup+nreps times, each of which creates the
+ * filetype, opens the file, sets the file view, writes, and closes the file.
+ * ptimer[NPHASES] time the phases, wtimer times the whole sequence.
+ */
+static int
+instrumented_write(const char   *filename,
+                   MPI_Info      info,
+                   int           nvars,
+                   int           len,
+                   int         **buf,
+                   int           buf_contig,
+                   int           cube,
+                   MPI_Datatype  bufType,
+                   bench_timer  *wtimer,
+                   bench_timer  *ptimer,
+                   bench_pvars  *pvars,
+                   bench_record *rec)
+{
+    int i, err, nerrs=0, nwarmup=wtimer->nwarmup;
+    MPI_Datatype fileType;
+    MPI_File fh;
+    MPI_Status status;
+
+    for (i=0; i<nwarmup+wtimer->nreps; i++) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        if (i >= nwarmup) bench_pvars_start(pvars);
+        bench_timer_start(wtimer);
+
+        bench_timer_start(&ptimer[0]);
+        err = create_fileType(MPI_COMM_WORLD, nvars, len, &fileType);
+        if (err != 0) {
+            nerrs++;
+            goto err_out;
+        }
+        bench_timer_stop(&ptimer[0]);
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&ptimer[1]);
+        err = MPI_File_open(MPI_COMM_WORLD, filename,
+                            MPI_MODE_CREATE | MPI_MODE_RDWR, info, &fh); ERR
+        bench_timer_stop(&ptimer[1]);
+        if (i == 0) {
+            err = bench_record_hints(rec, fh); ERR
+        }
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&ptimer[2]);
+        err = MPI_File_set_view(fh, 0, MPI_BYTE, fileType, "native",
+                                info); ERR
+        bench_timer_stop(&ptimer[2]);
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&ptimer[3]);
+        if (buf_contig)
+            err = MPI_File_write_all(fh, buf[0], cube*nvars, bufType, &status);
+        else
+            err = MPI_File_write_all(fh, MPI_BOTTOM, 1, bufType, &status);
+        ERR
+        bench_timer_stop(&ptimer[3]);
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&ptimer[4]);
+        err = MPI_File_close(&fh); ERR
+        bench_timer_stop(&ptimer[4]);
+
+        bench_timer_stop(wtimer);
+        if (i >= nwarmup) bench_pvars_stop(pvars);
+
+        err = MPI_Type_free(&fileType); ERR
+    }
+
+err_out:
+    return nerrs;
+}
+
+/*----< compute_kernel() >---------------------------------------------------*/
+/* Synthetic computation that keeps the CPU busy for the given seconds without
+ * making any MPI communication or I/O call, so the MPI library has no chance
+ * to progress pending nonblocking operations unless it does so internally.
+ */
+static volatile double kernel_sum;
+
+static void
+compute_kernel(double seconds)
+{
+    int i;
+    double end, work[256];
+
+    for (i=0; i<256; i++) work[i] = i;
+    end = MPI_Wtime() + seconds;
+    do {
+        for (i=0; i<256; i++) work[i] = work[i] * 0.999 + 1.0e-3;
+    } while (MPI_Wtime() < end);
+    kernel_sum = work[0];
+}
+
+/*----< pipelined_write() >--------------------------------------------------*/
+/* Split the variables into nbatches batches and write them nwarmup+nreps
+ * times in three ways, each timed by one of timers[3]:
+ *   timers[0]: MPI_File_write_at_all of each batch, without computation
+ *   timers[1]: the computation of compute_t seconds per batch, without I/O
+ *   timers[2]: MPI_File_iwrite_at_all of each batch, followed by the
+ *              computation and then MPI_Wait, to overlap the two
+ * fh has the file view of all variables, in which the data of variable v of
+ * this process starts at offset v * ZDIMS * len * len * sizeof(int).
+ */
+static int
+pipelined_write(MPI_File      fh,
+                int           nvars,
+                int           len,
+                int         **buf,
+                int           buf_contig,
+                int           cube,
+                int           ngcells,
+                int           nbatches,
+                double        compute_t,
+                bench_timer  *timers)
+{
+    int i, b, err, nerrs=0, *first, *count, nruns;
+    void **ptr;
+    MPI_Offset var_size;
+    MPI_Datatype *batchType;
+    MPI_Request req;
+    MPI_Status status;
+
+    nruns = timers[0].nwarmup + timers[0].nreps;
+    var_size = (MPI_Offset)ZDIMS * len * len * sizeof(int);
+
+    /* batch b consists of variables first[b] to first[b+1]-1 */
+    first = (int*) malloc(sizeof(int) * (nbatches + 1));
+    for (b=0; b<=nbatches; b++)
+        first[b] = (int)((long long)b * nvars / nbatches);
+
+    /* buffers, counts, and datatypes of batches, created once for all runs */
+    ptr       = (void**) malloc(sizeof(void*) * nbatches);
+    count     = (int*) malloc(sizeof(int) * nbatches);
+    batchType = (MPI_Datatype*) malloc(sizeof(MPI_Datatype) * nbatches);
+    for (b=0; b<nbatches; b++) batchType[b] = MPI_INT;
+    for (b=0; b<nbatches; b++) {
+        int nv = first[b+1] - first[b];
+        if (buf_contig || nv == 0) {
+            ptr[b]   = (nv == 0) ? buf[0] : buf[first[b]];
+            count[b] = cube * nv;
+            continue;
+        }
+        err = create_bufType(MPI_COMM_WORLD, nv, len, ngcells, buf + first[b],
+                             &batchType[b]);
+        if (err != 0) {
+            nerrs++;
+            goto err_out;
+        }
+        ptr[b]   = MPI_BOTTOM;
+        count[b] = 1;
+    }
+
+    for (i=0; i<nruns; i++) {
+        /* batches by blocking collective writes, I/O only */
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&timers[0]);
+        for (b=0; b<nbatches; b++) {
+            err = MPI_File_write_at_all(fh, first[b] * var_size, ptr[b],
+                                        count[b], batchType[b], &status);
+            ERR
+        }
+        bench_timer_stop(&timers[0]);
+
+        /* computation only */
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&timers[1]);
+        for (b=0; b<nbatches; b++)
+            compute_kernel(compute_t);
+        bench_timer_stop(&timers[1]);
+
+        /* batches by nonblocking collective writes, each overlapped with the
+         * computation of one batch
+         */
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&timers[2]);
+        for (b=0; b<nbatches; b++) {
+            err = MPI_File_iwrite_at_all(fh, first[b] * var_size, ptr[b],
+                                         count[b], batchType[b], &req);
+            ERR
+            compute_kernel(compute_t);
+            err = MPI_Wait(&req, &status); ERR
+        }
+        bench_timer_stop(&timers[2]);
+    }
+
+err_out:
+    for (b=0; b<nbatches; b++)
+        if (batchType[b] != MPI_INT) MPI_Type_free(&batchType[b]);
+    free(batchType);
+    free(count);
+    free(ptr);
+    free(first);
+    return nerrs;
+}
+
+/*----< layout_comm() >------------------------------------------------------*/
+/* Split MPI_COMM_WORLD into the groups of processes writing the same subfile:
+ * one process each in the file-per-process layout, group_size consecutive
+ * processes, or the processes on the same compute node if group_size is 0.
+ * *gid is set to the group ID, numbered from 0.
+ */
+static int
+layout_comm(int       layout,
+            int       group_size,
+            MPI_Comm *comm,
+            int      *gid)
+{
+    int err, rank, local_rank;
+    MPI_Comm node_comm, leader_comm;
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (layout == LAYOUT_FPP || group_size > 0) {
+        *gid = (layout == LAYOUT_FPP) ? rank : rank / group_size;
+        return MPI_Comm_split(MPI_COMM_WORLD, *gid, rank, comm);
+    }
+
+    /* one group per compute node, numbered by the ranks of node leaders */
+    err = MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank,
+                              MPI_INFO_NULL, &node_comm);
+    if (err != MPI_SUCCESS) return err;
+    MPI_Comm_rank(node_comm, &local_rank);
+    err = MPI_Comm_split(MPI_COMM_WORLD, (local_rank == 0) ? 0 : MPI_UNDEFINED,
+                         rank, &leader_comm);
+    if (err != MPI_SUCCESS) return err;
+    if (leader_comm != MPI_COMM_NULL) {
+        MPI_Comm_rank(leader_comm, gid);
+        MPI_Comm_free(&leader_comm);
+    }
+    MPI_Bcast(gid, 1, MPI_INT, 0, node_comm);
+    *comm = node_comm;
+    return MPI_SUCCESS;
+}
+
+/*----< layout_write() >-----------------------------------------------------*/
+/* Run nwarmup+nreps times the sequence of opening, setting the file view,
+ * writing, and closing the shared file, timed by timers[0], and the same
+ * sequence of the (sub)files of the file-per-process or subfiling layout,
+ * timed by timers[1]. Root process writes the index file, one line per
+ * process of its rank, subfile ID, offset and stride of its blocks in bytes,
+ * and the start and length of its block along the Y and X dimensions.
+ */
+static int
+layout_write(const char   *filename,
+             MPI_Info      info,
+             int           layout,
+             int           group_size,
+             int           nvars,
+             int           len,
+             int         **buf,
+             int           buf_contig,
+             int           cube,
+             MPI_Datatype  bufType,
+             MPI_Datatype  fileType,
+             bench_timer  *timers,
+             bench_record *rec)
+{
+    char path[1024];
+    int i, err, nerrs=0, rank, nprocs, gid, grank, gsize, nsubfiles;
+    int psizes[2];
+    long long blk, entry[INDEX_NCOLS], *index=NULL;
+    MPI_Offset disp;
+    MPI_Comm comm=MPI_COMM_NULL;
+    MPI_Datatype layoutType=MPI_DATATYPE_NULL;
+    MPI_File fh;
+    MPI_Status status;
+
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    err = layout_comm(layout, group_size, &comm, &gid); ERR
+    MPI_Comm_size(comm, &gsize);
+    MPI_Comm_rank(comm, &grank);
+    snprintf(path, sizeof(path), "%s.%d", filename, gid);
+
+    /* in a subfile, variable v of group rank grank is at block
+     * v * gsize + grank, where each block is the local data of a process
+     */
+    blk = (long long)ZDIMS * len * len;
+    err = MPI_Type_vector(nvars, blk, blk * gsize, MPI_INT, &layoutType); ERR
+    err = MPI_Type_commit(&layoutType); ERR
+    disp = grank * blk * sizeof(int);
+
+    /* root gathers the locations of all blocks and writes the index file */
+    psizes[0] = psizes[1] = 0;
+    MPI_Dims_create(nprocs, 2, psizes);
+    entry[0] = rank;
+    entry[1] = gid;
+    entry[2] = disp;
+    entry[3] = blk * gsize * sizeof(int);
+    entry[4] = len * (rank / psizes[1]);
+    entry[5] = len * (rank % psizes[1]);
+    entry[6] = len;
+    entry[7] = len;
+    if (rank == 0)
+        index = (long long*) malloc(sizeof(long long) * INDEX_NCOLS * nprocs);
+    err = MPI_Gather(entry, INDEX_NCOLS, MPI_LONG_LONG, index, INDEX_NCOLS,
+                     MPI_LONG_LONG, 0, MPI_COMM_WORLD); ERR
+    nsubfiles = gid + 1;
+    MPI_Allreduce(MPI_IN_PLACE, &nsubfiles, 1, MPI_INT, MPI_MAX,
+                  MPI_COMM_WORLD);
+    if (rank == 0) {
+        FILE *fp;
+        snprintf(path, sizeof(path), "%s.index", filename);
+        if ((fp = fopen(path, "w")) == NULL) {
+            printf("Error: failed to create index file %s\n", path);
+            nerrs++;
+        }
+        else {
+            int j;
+            fprintf(fp, "# subfile index of %s, subfile g is %s.g\n",
+                    filename, filename);
+            fprintf(fp, "# nprocs nsubfiles nvars zdims\n");
+            fprintf(fp, "%d %d %d %d\n", nprocs, nsubfiles, nvars, ZDIMS);
+            fprintf(fp, "# rank subfile offset stride ystart xstart ylen xlen\n");
+            for (i=0; i<nprocs; i++) {
+                for (j=0; j<INDEX_NCOLS; j++)
+                    fprintf(fp, "%lld%c", index[i*INDEX_NCOLS + j],
+                            (j < INDEX_NCOLS - 1) ? ' ' : '\n');
+            }
+            fclose(fp);
+        }
+        free(index);
+        snprintf(path, sizeof(path), "%s.%d", filename, gid);
+    }
+    MPI_Bcast(&nerrs, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (nerrs > 0) goto err_out;
+
+    if (rank == 0) {
+        printf("Number of subfiles:                  %d\n", nsubfiles);
+        printf("Processes per subfile of rank 0:     %d\n", gsize);
+    }
+    bench_record_int(rec, "nsubfiles", nsubfiles);
+
+    for (i=0; i<timers[0].nwarmup+timers[0].nreps; i++) {
+        /* the shared file */
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&timers[0]);
+        err = MPI_File_open(MPI_COMM_WORLD, filename,
+                            MPI_MODE_CREATE | MPI_MODE_RDWR, info, &fh); ERR
+        err = MPI_File_set_view(fh, 0, MPI_BYTE, fileType, "native", info);
+        ERR
+        if (buf_contig)
+            err = MPI_File_write_all(fh, buf[0], cube*nvars, bufType, &status);
+        else
+            err = MPI_File_write_all(fh, MPI_BOTTOM, 1, bufType, &status);
+        ERR
+        err = MPI_File_close(&fh); ERR
+        bench_timer_stop(&timers[0]);
+
+        /* the (sub)files */
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&timers[1]);
+        err = MPI_File_open(comm, path, MPI_MODE_CREATE | MPI_MODE_RDWR, info,
+                            &fh); ERR
+        err = MPI_File_set_view(fh, disp, MPI_BYTE, layoutType, "native",
+                                info); ERR
+        if (buf_contig)
+            err = MPI_File_write_all(fh, buf[0], cube*nvars, bufType, &status);
+        else
+            err = MPI_File_write_all(fh, MPI_BOTTOM, 1, bufType, &status);
+        ERR
+        err = MPI_File_close(&fh); ERR
+        bench_timer_stop(&timers[1]);
+    }
+
+err_out:
+    if (layoutType != MPI_DATATYPE_NULL) MPI_Type_free(&layoutType);
+    if (comm != MPI_COMM_NULL) MPI_Comm_free(&comm);
+    return nerrs;
+}
+
+/*----< layout_read() >------------------------------------------------------*/
+/* Each process reassembles the block of the next process, located in the
+ * subfiles by the index file read by root, and checks its contents. The
+ * reads are run nwarmup+nreps times, timed by timer.
+ */
+static int
+layout_read(const char   *filename,
+            int           nvars,
+            int           len,
+            int         **buf,
+            int           buf_contig,
+            int           cube,
+            int           ngcells,
+            MPI_Datatype  bufType,
+            bench_timer  *timer)
+{
+    char path[1024];
+    int i, k, err, nerrs=0, rank, nprocs, src, psizes[2];
+    long long hdr[4], entry[INDEX_NCOLS], *index=NULL;
+    MPI_Datatype layoutType=MPI_DATATYPE_NULL;
+    MPI_File fh;
+    MPI_Status status;
+
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* root reads the index file and scatters the entries */
+    if (rank == 0) {
+        FILE *fp;
+        char line[1024];
+        int n=0;
+        snprintf(path, sizeof(path), "%s.index", filename);
+        index = (long long*) malloc(sizeof(long long) * INDEX_NCOLS * nprocs);
+        if ((fp = fopen(path, "r")) == NULL) {
+            printf("Error: failed to open index file %s\n", path);
+            nerrs++;
+        }
+        else {
+            while (fgets(line, sizeof(line), fp) != NULL) {
+                long long *e;
+                if (line[0] == '#') continue;
+                if (n == 0) {
+                    if (sscanf(line, "%lld %lld %lld %lld", &hdr[0], &hdr[1],
+                               &hdr[2], &hdr[3]) != 4 || hdr[0] != nprocs)
+                        break;
+                    n++;
+                    continue;
+                }
+                if (n > nprocs) break;
+                e = index + (n - 1) * INDEX_NCOLS;
+                if (sscanf(line, "%lld %lld %lld %lld %lld %lld %lld %lld",
+                           e, e+1, e+2, e+3, e+4, e+5, e+6, e+7) != 8) break;
+                n++;
+            }
+            fclose(fp);
+            if (n != nprocs + 1) {
+                printf("Error: index file %s is not of %d processes\n", path,
+                       nprocs);
+                nerrs++;
+            }
+        }
+    }
+    MPI_Bcast(&nerrs, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (nerrs > 0) goto err_out;
+
+    /* entries are in rank order, send to each process that of the next */
+    if (rank == 0) {
+        long long *shifted = (long long*) malloc(sizeof(long long) *
+                                                 INDEX_NCOLS * nprocs);
+        for (i=0; i<nprocs; i++)
+            memcpy(shifted + i * INDEX_NCOLS,
+                   index + ((i + 1) % nprocs) * INDEX_NCOLS,
+                   sizeof(long long) * INDEX_NCOLS);
+        free(index);
+        index = shifted;
+    }
+    err = MPI_Scatter(index, INDEX_NCOLS, MPI_LONG_LONG, entry, INDEX_NCOLS,
+                      MPI_LONG_LONG, 0, MPI_COMM_WORLD); ERR
+
+    /* the entry must describe the block of the next process */
+    src = (rank + 1) % nprocs;
+    psizes[0] = psizes[1] = 0;
+    MPI_Dims_create(nprocs, 2, psizes);
+    if (entry[0] != src || entry[4] != len * (src / psizes[1]) ||
+        entry[5] != len * (src % psizes[1]) || entry[6] != len ||
+        entry[7] != len) {
+        printf("Error: rank %d index entry of rank %d does not match\n", rank,
+               src);
+        nerrs++;
+        goto err_out;
+    }
+
+    err = MPI_Type_create_hvector(nvars, ZDIMS * len * len, entry[3], MPI_INT,
+                                  &layoutType); ERR
+    err = MPI_Type_commit(&layoutType); ERR
+    snprintf(path, sizeof(path), "%s.%lld", filename, entry[1]);
+
+    for (i=0; i<timer->nwarmup+timer->nreps; i++) {
+        /* reset read buffer to all -1s */
+        for (k=0; k<nvars; k++)
+            bench_fill_block(buf[k], ZDIMS, len, len, ngcells, -1, -1);
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(timer);
+        err = MPI_File_open(MPI_COMM_SELF, path, MPI_MODE_RDONLY,
+                            MPI_INFO_NULL, &fh); ERR
+        err = MPI_File_set_view(fh, entry[2], MPI_BYTE, layoutType, "native",
+                                MPI_INFO_NULL); ERR
+        if (buf_contig)
+            err = MPI_File_read_all(fh, buf[0], cube*nvars, bufType, &status);
+        else
+            err = MPI_File_read_all(fh, MPI_BOTTOM, 1, bufType, &status);
+        ERR
+        err = MPI_File_close(&fh); ERR
+        bench_timer_stop(timer);
+    }
+
+    /* check contents of read buffer, the interior written by process src */
+    for (k=0; k<nvars; k++) {
+        if (check_var(buf[k], k, len, ngcells, src, "reassembled ")) {
+            nerrs++;
+            goto err_out;
+        }
+    }
+
+    /* restore the interior of this process for the modes run afterwards */
+    for (k=0; k<nvars; k++)
+        bench_fill_block(buf[k], ZDIMS, len, len, ngcells, rank, -1);
+
+err_out:
+    if (index != NULL) free(index);
+    if (layoutType != MPI_DATATYPE_NULL) MPI_Type_free(&layoutType);
+    return nerrs;
+}
+
+/*----< gpu_write_read() >---------------------------------------------------*/
+/* Copy the user buffer into GPU device memory and write it, and read it back
+ * if do_read, by the same collective calls on the device buffer, and staged
+ * through a buffer of pinned host memory of the same layout, copied from or
+ * to the device buffer by the GPU runtime. The file view must have been set.
+ * timers[4] time the 2 writes and the 2 reads.
+ */
+static int
+gpu_write_read(MPI_File       fh,
+               int            nvars,
+               int            len,
+               int          **buf,
+               int            cube,
+               int            ngcells,
+               int            do_read,
+               bench_timer   *timers)
+{
+    int i, k, err, nerrs=0, rank, nruns, *dev=NULL, *pin=NULL;
+    int **dbuf=NULL, **hbuf=NULL, *check=NULL;
+    size_t size;
+    MPI_Datatype dType=MPI_INT, hType=MPI_INT;
+    MPI_Status status;
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    nruns = timers[0].nwarmup + timers[0].nreps;
+    size = sizeof(int) * cube * nvars;
+
+    dev = (int*) bench_mem_alloc(size, BENCH_MEM_DEVICE);
+    pin = (int*) bench_mem_alloc(size, BENCH_MEM_PINNED);
+    if (dev == NULL || pin == NULL) {
+        nerrs++;
+        goto err_out;
+    }
+    dbuf = (int**) malloc(sizeof(int*) * nvars * 2);
+    hbuf = dbuf + nvars;
+    for (k=0; k<nvars; k++) {
+        dbuf[k] = dev + k * cube;
+        hbuf[k] = pin + k * cube;
+        if (bench_mem_copy(dbuf[k], buf[k], sizeof(int) * cube) != 0) {
+            nerrs++;
+            goto err_out;
+        }
+    }
+
+    /* buffer datatypes of the device and the pinned buffers */
+    if (ngcells > 0) {
+        err = create_bufType(MPI_COMM_WORLD, nvars, len, ngcells, dbuf, &dType);
+        if (err != 0) {
+            nerrs++;
+            goto err_out;
+        }
+        err = create_bufType(MPI_COMM_WORLD, nvars, len, ngcells, hbuf, &hType);
+        if (err != 0) {
+            nerrs++;
+            goto err_out;
+        }
+    }
+
+    for (i=0; i<nruns; i++) {
+        err = MPI_File_seek(fh, 0, MPI_SEEK_SET); ERR
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&timers[0]);
+        if (ngcells > 0)
+            err = MPI_File_write_all(fh, MPI_BOTTOM, 1, dType, &status);
+        else
+            err = MPI_File_write_all(fh, dev, cube*nvars, MPI_INT, &status);
+        ERR
+        bench_timer_stop(&timers[0]);
+    }
+
+    for (i=0; i<nruns; i++) {
+        err = MPI_File_seek(fh, 0, MPI_SEEK_SET); ERR
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&timers[1]);
+        if (bench_mem_copy(pin, dev, size) != 0) {
+            nerrs++;
+            goto err_out;
+        }
+        if (ngcells > 0)
+            err = MPI_File_write_all(fh, MPI_BOTTOM, 1, hType, &status);
+        else
+            err = MPI_File_write_all(fh, pin, cube*nvars, MPI_INT, &status);
+        ERR
+        bench_timer_stop(&timers[1]);
+    }
+
+    if (!do_read) goto err_out;
+
+    /* read into the device buffer, directly and staged, and check it */
+    check = (int*) malloc(size);
+    for (k=2; k<4; k++) {
+        if (bench_mem_set(dev, -1, size, BENCH_MEM_DEVICE) != 0 ||
+            bench_mem_set(pin, -1, size, BENCH_MEM_PINNED) != 0) {
+            nerrs++;
+            goto err_out;
+        }
+        for (i=0; i<nruns; i++) {
+            err = MPI_File_seek(fh, 0, MPI_SEEK_SET); ERR
+
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&timers[k]);
+            if (k == 2 && ngcells > 0)
+                err = MPI_File_read_all(fh, MPI_BOTTOM, 1, dType, &status);
+            else if (k == 2)
+                err = MPI_File_read_all(fh, dev, cube*nvars, MPI_INT, &status);
+            else if (ngcells > 0)
+                err = MPI_File_read_all(fh, MPI_BOTTOM, 1, hType, &status);
+            else
+                err = MPI_File_read_all(fh, pin, cube*nvars, MPI_INT, &status);
+            ERR
+            if (k == 3 && bench_mem_copy(dev, pin, size) != 0) {
+                nerrs++;
+                goto err_out;
+            }
+            bench_timer_stop(&timers[k]);
+        }
+
+        if (bench_mem_copy(check, dev, size) != 0) {
+            nerrs++;
+            goto err_out;
+        }
+        for (i=0; i<nvars; i++) {
+            if (check_var(check + i * cube, i, len, ngcells, rank,
+                          "device ")) {
+                printf("Error: in %s\n", timers[k].name);
+                nerrs++;
+                goto err_out;
+            }
+        }
+    }
+
+err_out:
+    if (dType != MPI_INT) MPI_Type_free(&dType);
+    if (hType != MPI_INT) MPI_Type_free(&hType);
+    if (check != NULL) free(check);
+    if (dbuf != NULL) free(dbuf);
+    bench_mem_free(dev, BENCH_MEM_DEVICE);
+    bench_mem_free(pin, BENCH_MEM_PINNED);
+    return nerrs;
+}
+
+/*----< codec_bound() >------------------------------------------------------*/
+/* maximum size of size bytes compressed by codec */
+static size_t
+codec_bound(int codec, size_t size)
+{
+    switch (codec) {
+#ifdef HAVE_LZ4
+        case CODEC_LZ4:  return LZ4_compressBound((int)size);
+#endif
+#ifdef HAVE_ZSTD
+        case CODEC_ZSTD: return ZSTD_compressBound(size);
+#endif
+#ifdef HAVE_ZLIB
+        case CODEC_ZLIB: return compressBound(size);
+#endif
+    }
+    (void)size; /* unused when no codec is enabled */
+    return 0;
+}
+
+/*----< codec_compress() >---------------------------------------------------*/
+/* Compress size bytes of src into dst of capacity *dst_len, which is set to
+ * the compressed size. Return 0 on success.
+ */
+static int
+codec_compress(int codec, char *dst, size_t *dst_len, const char *src,
+               size_t size)
+{
+    switch (codec) {
+#ifdef HAVE_LZ4
+        case CODEC_LZ4: {
+            int n = LZ4_compress_default(src, dst, (int)size, (int)*dst_len);
+            *dst_len = n;
+            return (n <= 0);
+        }
+#endif
+#ifdef HAVE_ZSTD
+        case CODEC_ZSTD: {
+            size_t n = ZSTD_compress(dst, *dst_len, src, size, ZSTD_LEVEL);
+            *dst_len = n;
+            return ZSTD_isError(n);
+        }
+#endif
+#ifdef HAVE_ZLIB
+        case CODEC_ZLIB: {
+            uLongf n = *dst_len;
+            int ret = compress2((Bytef*)dst, &n, (const Bytef*)src, size,
+                                Z_BEST_SPEED);
+            *dst_len = n;
+            return (ret != Z_OK);
+        }
+#endif
+    }
+    /* unused when no codec is enabled */
+    (void)dst; (void)dst_len; (void)src; (void)size;
+    return 1;
+}
+
+/*----< codec_decompress() >-------------------------------------------------*/
+/* Decompress src_len bytes of src into dst, which must become exactly size
+ * bytes. Return 0 on success.
+ */
+static int
+codec_decompress(int codec, char *dst, size_t size, const char *src,
+                 size_t src_len)
+{
+    switch (codec) {
+#ifdef HAVE_LZ4
+        case CODEC_LZ4:
+            return (LZ4_decompress_safe(src, dst, (int)src_len, (int)size) !=
+                    (int)size);
+#endif
+#ifdef HAVE_ZSTD
+        case CODEC_ZSTD:
+            return (ZSTD_decompress(dst, size, src, src_len) != size);
+#endif
+#ifdef HAVE_ZLIB
+        case CODEC_ZLIB: {
+            uLongf n = size;
+            return (uncompress((Bytef*)dst, &n, (const Bytef*)src, src_len) !=
+                    Z_OK || n != size);
+        }
+#endif
+    }
+    /* unused when no codec is enabled */
+    (void)dst; (void)size; (void)src; (void)src_len;
+    return 1;
+}
+
+/* state shared by the threads compressing or decompressing the chunks of a
+ * process in the compressed mode
+ */
+typedef struct {
+    int          codec;
+    int          nthreads;
+    int          nchunks;     /* number of chunks of this process */
+    int          chunk_rows;  /* rows of len ints per chunk, except the last */
+    int          nrows;       /* nvars * ZDIMS * len rows of this process */
+    int          len;
+    int          ngcells;
+    int        **buf;         /* user buffer of the variables */
+    char        *zbuf;        /* [nchunks] slots of slot bytes */
+    size_t       slot;        /* codec_bound() of a full chunk */
+    char        *raw;         /* [nthreads] chunks of raw rows */
+    chunk_entry *index;       /* [nchunks] file offsets and compressed sizes */
+    const char  *src;         /* compressed chunks read from the file */
+} zip_ctx;
+
+typedef struct {
+    zip_ctx *ctx;
+    int      tid;
+    int      decompress;
+    int      err;  /* number of chunks failed by the thread */
+} zip_arg;
+
+/*----< zip_chunks() >-------------------------------------------------------*/
+/* Thread tid compresses chunks tid, tid+nthreads, ... of the user buffer,
+ * first copying the rows of a chunk from the user buffer into its raw chunk,
+ * or decompresses them and copies the rows into the user buffer.
+ */
+static void*
+zip_chunks(void *arg)
+{
+    zip_arg *a = (zip_arg*) arg;
+    zip_ctx *ctx = a->ctx;
+    int tid = a->tid, decompress = a->decompress;
+    int c, r, k, z, y, last, len = ctx->len, xlen = len + 2 * ctx->ngcells;
+    size_t row = sizeof(int) * len, raw_len, zlen;
+    char *raw = ctx->raw + (size_t)tid * ctx->chunk_rows * row;
+
+    for (c=tid; c<ctx->nchunks; c+=ctx->nthreads) {
+        last = (c + 1) * ctx->chunk_rows;
+        if (last > ctx->nrows) last = ctx->nrows;
+        raw_len = (last - c * ctx->chunk_rows) * row;
+
+        if (decompress &&
+            codec_decompress(ctx->codec, raw, raw_len, ctx->src +
+                             (ctx->index[c].offset - ctx->index[0].offset),
+                             ctx->index[c].len) != 0) {
+            a->err++;
+            continue;
+        }
+
+        /* row r is row y of slab z of variable k */
+        for (r=c*ctx->chunk_rows; r<last; r++) {
+            int *ptr;
+            k = r / (ZDIMS * len);
+            z = (r / len) % ZDIMS;
+            y = r % len;
+            ptr = ctx->buf[k] + z*xlen*xlen + (y+ctx->ngcells)*xlen +
+                  ctx->ngcells;
+            if (decompress)
+                memcpy(ptr, raw + (r - c * ctx->chunk_rows) * row, row);
+            else
+                memcpy(raw + (r - c * ctx->chunk_rows) * row, ptr, row);
+        }
+
+        if (!decompress) {
+            zlen = ctx->slot;
+            if (codec_compress(ctx->codec, ctx->zbuf + c * ctx->slot, &zlen,
+                               raw, raw_len) != 0)
+                a->err++;
+            ctx->index[c].len = zlen;
+        }
+    }
+    return NULL;
+}
+
+/*----< zip_run() >----------------------------------------------------------*/
+/* compress or decompress all chunks by ctx->nthreads threads */
+static int
+zip_run(zip_ctx *ctx, pthread_t *threads, zip_arg *args, int decompress)
+{
+    int t, nerrs=0;
+
+    for (t=0; t<ctx->nthreads; t++) {
+        args[t].ctx = ctx;
+        args[t].tid = t;
+        args[t].decompress = decompress;
+        args[t].err = 0;
+    }
+    for (t=1; t<ctx->nthreads; t++)
+        if (pthread_create(&threads[t], NULL, zip_chunks, &args[t]) != 0) {
+            printf("Error: failed to create compression thread %d\n", t);
+            MPI_Abort(MPI_COMM_WORLD, -1);
+        }
+    zip_chunks(&args[0]);
+    for (t=1; t<ctx->nthreads; t++)
+        pthread_join(threads[t], NULL);
+
+    for (t=0; t<ctx->nthreads; t++)
+        nerrs += args[t].err;
+    if (nerrs > 0)
+        printf("Error: failed to %s %d chunks\n", (decompress) ? "decompress" :
+               "compress", nerrs);
+    return nerrs;
+}
+
+/*----< compressed_write_read() >--------------------------------------------*/
+/* Split the local data of all variables into chunks of chunk_rows rows of
+ * len ints, compress them by nthreads threads, and write them to file path,
+ * with the chunk index, by a single collective write. The file consists of a
+ * header, the index of nchunks entries of each process in rank order, and
+ * the compressed chunks of all processes in rank order, located by
+ * MPI_Exscan(). If do_read, the chunks are read back, decompressed into the
+ * user buffer, and checked. timers[4] time the compression, the write, both
+ * of them, and the read with decompression. *zbytes is set to the file size.
+ */
+static int
+compressed_write_read(const char   *path,
+                      MPI_Info      info,
+                      int           codec,
+                      int           nthreads,
+                      int           chunk_rows,
+                      int           nvars,
+                      int           len,
+                      int         **buf,
+                      int           ngcells,
+                      int           do_read,
+                      bench_timer  *timers,
+                      double       *zbytes)
+{
+    int i, c, err, nerrs=0, rank, nprocs, nruns, nblks, xlen;
+    int failed, zfailed=0;
+    int hdr[ZIP_HEADER_INTS], rhdr[ZIP_HEADER_INTS], *blklens=NULL;
+    long long local_len, base;
+    MPI_Aint *disps=NULL, *addrs=NULL;
+    MPI_Offset index_off;
+    MPI_Datatype fileType, memType;
+    MPI_File fh=MPI_FILE_NULL;
+    MPI_Status status;
+    pthread_t *threads=NULL;
+    zip_arg *args=NULL;
+    zip_ctx ctx;
+
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    nruns = timers[0].nwarmup + timers[0].nreps;
+    xlen = len + 2 * ngcells;
+
+    memset(&ctx, 0, sizeof(zip_ctx));
+    ctx.codec      = codec;
+    ctx.nthreads   = nthreads;
+    ctx.nrows      = nvars * ZDIMS * len;
+    ctx.chunk_rows = (chunk_rows < ctx.nrows) ? chunk_rows : ctx.nrows;
+    ctx.nchunks    = (ctx.nrows + ctx.chunk_rows - 1) / ctx.chunk_rows;
+    ctx.len        = len;
+    ctx.ngcells    = ngcells;
+    ctx.buf        = buf;
+    ctx.slot       = codec_bound(codec, sizeof(int) * ctx.chunk_rows * len);
+    ctx.zbuf       = (char*) malloc(ctx.slot * ctx.nchunks);
+    ctx.raw        = (char*) malloc(sizeof(int) * ctx.chunk_rows * len *
+                                    nthreads);
+    ctx.index      = (chunk_entry*) malloc(sizeof(chunk_entry) * ctx.nchunks);
+    threads = (pthread_t*) malloc(sizeof(pthread_t) * nthreads);
+    args    = (zip_arg*) malloc(sizeof(zip_arg) * nthreads);
+
+    /* header, index, and chunks of each process, written in one call */
+    nblks   = 2 + ctx.nchunks;
+    blklens = (int*) malloc(sizeof(int) * nblks);
+    disps   = (MPI_Aint*) malloc(sizeof(MPI_Aint) * 3);
+    addrs   = (MPI_Aint*) malloc(sizeof(MPI_Aint) * nblks);
+
+    hdr[0] = ZIP_MAGIC;
+    hdr[1] = codec;
+    hdr[2] = nprocs;
+    hdr[3] = nvars;
+    hdr[4] = len;
+    hdr[5] = ctx.nchunks;
+    hdr[6] = ctx.chunk_rows;
+    hdr[7] = 0;
+    index_off = sizeof(hdr) + sizeof(chunk_entry) * (MPI_Offset)ctx.nchunks *
+                rank;
+
+    err = MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_CREATE | MPI_MODE_RDWR,
+                        info, &fh);
+    CHECK_MPI_ERROR(path)
+    err = MPI_File_set_size(fh, 0); ERR
+
+    for (i=0; i<nruns; i++) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&timers[2]);
+        bench_timer_start(&timers[0]);
+        failed = zip_run(&ctx, threads, args, 0);
+        bench_timer_stop(&timers[0]);
+
+        bench_timer_start(&timers[1]);
+        /* chunks are stored in the order of process ranks after the index */
+        local_len = 0;
+        for (c=0; c<ctx.nchunks; c++)
+            local_len += ctx.index[c].len;
+        base = 0;
+        err = MPI_Exscan(&local_len, &base, 1, MPI_LONG_LONG, MPI_SUM,
+                         MPI_COMM_WORLD); ERR
+        if (rank == 0) base = 0;
+        if (!failed && local_len > INT_MAX) {
+            printf("Error: compressed chunks of rank %d are larger than 2 GiB\n",
+                   rank);
+            failed = 1;
+        }
+        /* all processes stop together before the collective write */
+        MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX,
+                      MPI_COMM_WORLD);
+        if (failed) {
+            nerrs++;
+            goto err_out;
+        }
+        base += sizeof(hdr) + sizeof(chunk_entry) * (long long)ctx.nchunks *
+                nprocs;
+        for (c=0; c<ctx.nchunks; c++) {
+            ctx.index[c].offset = (c == 0) ? base :
+                ctx.index[c-1].offset + ctx.index[c-1].len;
+            blklens[2+c] = ctx.index[c].len;
+            MPI_Get_address(ctx.zbuf + c * ctx.slot, &addrs[2+c]);
+        }
+
+        /* the header is written by root only */
+        blklens[0] = (rank == 0) ? sizeof(hdr) : 0;
+        blklens[1] = sizeof(chunk_entry) * ctx.nchunks;
+        MPI_Get_address(hdr, &addrs[0]);
+        MPI_Get_address(ctx.index, &addrs[1]);
+        disps[0] = 0;
+        disps[1] = index_off;
+        disps[2] = base;
+        err = MPI_Type_create_hindexed(nblks, blklens, addrs, MPI_BYTE,
+                                       &memType); ERR
+        err = MPI_Type_commit(&memType); ERR
+
+        /* the chunks are contiguous in the file */
+        blklens[2] = (int)local_len;
+        err = MPI_Type_create_hindexed(3, blklens, disps, MPI_BYTE,
+                                       &fileType); ERR
+        err = MPI_Type_commit(&fileType); ERR
+
+        err = MPI_File_set_view(fh, 0, MPI_BYTE, fileType, "native", info);
+        ERR
+        err = MPI_File_write_all(fh, MPI_BOTTOM, 1, memType, &status); ERR
+        MPI_Type_free(&memType);
+        MPI_Type_free(&fileType);
+        bench_timer_stop(&timers[1]);
+        bench_timer_stop(&timers[2]);
+    }
+    err = MPI_File_get_size(fh, &index_off); ERR
+    *zbytes = index_off;
+    err = MPI_File_set_view(fh, 0, MPI_BYTE, MPI_BYTE, "native", info); ERR
+
+    if (!do_read) goto err_out;
+
+    /* read the header, the index of this process, and its chunks */
+    for (i=0; i<nruns; i++) {
+        /* reset read buffer to all -1s */
+        for (c=0; c<nvars; c++)
+            memset(buf[c], 0xff, sizeof(int) * ZDIMS * xlen * xlen);
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&timers[3]);
+        err = MPI_File_read_at_all(fh, 0, rhdr, ZIP_HEADER_INTS, MPI_INT,
+                                   &status); ERR
+        failed = 0;
+        if (memcmp(hdr, rhdr, sizeof(hdr)) != 0) {
+            printf("Error: rank %d header of file %s does not match\n", rank,
+                   path);
+            failed = 1;
+        }
+        index_off = sizeof(hdr) + sizeof(chunk_entry) *
+                    (MPI_Offset)ctx.nchunks * rank;
+        err = MPI_File_read_at_all(fh, index_off, ctx.index,
+                                   sizeof(chunk_entry) * ctx.nchunks,
+                                   MPI_BYTE, &status); ERR
+        local_len = ctx.index[ctx.nchunks-1].offset - ctx.index[0].offset +
+                    ctx.index[ctx.nchunks-1].len;
+        if (!failed && (local_len < 0 ||
+                        local_len > (long long)(ctx.slot * ctx.nchunks))) {
+            printf("Error: rank %d index of file %s is corrupted\n", rank,
+                   path);
+            failed = 1;
+        }
+        /* all processes stop together before the collective read */
+        MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX,
+                      MPI_COMM_WORLD);
+        if (failed) {
+            nerrs++;
+            goto err_out;
+        }
+        err = MPI_File_read_at_all(fh, ctx.index[0].offset, ctx.zbuf,
+                                   (int)local_len, MPI_BYTE, &status); ERR
+        ctx.src = ctx.zbuf;
+        /* failures are counted and checked after all runs, as the next run
+         * is collective
+         */
+        zfailed += zip_run(&ctx, threads, args, 1);
+        bench_timer_stop(&timers[3]);
+    }
+    if (zfailed) {
+        nerrs++;
+        goto err_out;
+    }
+
+    /* check contents of read buffer */
+    for (c=0; c<nvars; c++) {
+        if (check_var(buf[c], c, len, ngcells, rank, "decompressed ")) {
+            nerrs++;
+            goto err_out;
+        }
+    }
+
+err_out:
+    if (fh != MPI_FILE_NULL) MPI_File_close(&fh);
+    free(blklens);
+    free(disps);
+    free(addrs);
+    free(threads);
+    free(args);
+    free(ctx.zbuf);
+    free(ctx.raw);
+    free(ctx.index);
+    return nerrs;
+}
+
+/* argument of a thread in the multithreaded mode */
+typedef struct {
+    MPI_File           fh;       /* file handle of the thread */
+    void              *buf;      /* user buffer, MPI_BOTTOM if bufType */
+    int                count;    /* number of elements of buf */
+    MPI_Datatype       bufType;  /* buffer datatype of the variables */
+    int               *rbuf;     /* contiguous buffer to read into */
+    int                rcount;   /* number of ints of rbuf */
+    int                nruns;    /* number of runs of each write and read */
+    int                do_read;  /* also read the variables */
+    int                err;      /* first MPI error of the thread */
+    pthread_barrier_t *barrier;  /* start and end of each run */
+} thread_arg;
+
+/*----< thread_io() >--------------------------------------------------------*/
+/* one collective write or read of the variables of a thread */
+static void
+thread_io(thread_arg *a, int is_read)
+{
+    MPI_Status status;
+
+    if (a->err != MPI_SUCCESS) return;
+    if (is_read)
+        a->err = MPI_File_read_at_all(a->fh, 0, a->rbuf, a->rcount, MPI_INT,
+                                      &status);
+    else
+        a->err = MPI_File_write_at_all(a->fh, 0, a->buf, a->count,
+                                       a->bufType, &status);
+}
+
+/*----< thread_main() >------------------------------------------------------*/
+/* runs of a worker thread, each between two barriers with the main thread */
+static void*
+thread_main(void *arg)
+{
+    thread_arg *a = (thread_arg*) arg;
+    int i, k;
+
+    for (k=0; k<=a->do_read; k++)
+        for (i=0; i<a->nruns; i++) {
+            pthread_barrier_wait(a->barrier);
+            thread_io(a, k);
+            pthread_barrier_wait(a->barrier);
+        }
+    return NULL;
+}
+
+/*----< threaded_write_read() >----------------------------------------------*/
+/* Split the variables among nthreads threads, each of which opens the file on
+ * its own duplicate of MPI_COMM_WORLD, sets the file view of its variables,
+ * and writes them collectively, concurrently with the other threads. The main
+ * thread is thread 0. If do_read, the threads also read back the variables
+ * into contiguous buffers and check them. timers[0] times the concurrent
+ * writes and timers[1] the concurrent reads, from the release of all threads
+ * until all of them have returned from the collective call.
+ */
+static int
+threaded_write_read(const char   *filename,
+                    MPI_Info      info,
+                    int           nthreads,
+                    int           nvars,
+                    int           len,
+                    int         **buf,
+                    int           buf_contig,
+                    int           cube,
+                    int           ngcells,
+                    int           do_read,
+                    bench_timer  *timers)
+{
+    int i, k, t, err, nerrs=0, rank, nprocs, first, nv, nruns, nthreads_run=0;
+    MPI_Offset var_size;
+    MPI_Comm *comms=NULL;
+    MPI_Datatype fileType;
+    pthread_t *threads=NULL;
+    pthread_barrier_t barrier;
+    thread_arg *args=NULL;
+
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    nruns = timers[0].nwarmup + timers[0].nreps;
+    var_size = (MPI_Offset)sizeof(int) * ZDIMS * len * len * nprocs;
+
+    comms   = (MPI_Comm*) malloc(sizeof(MPI_Comm) * nthreads);
+    threads = (pthread_t*) malloc(sizeof(pthread_t) * nthreads);
+    args    = (thread_arg*) calloc(nthreads, sizeof(thread_arg));
+    for (t=0; t<nthreads; t++) {
+        comms[t] = MPI_COMM_NULL;
+        args[t].fh = MPI_FILE_NULL;
+        args[t].bufType = MPI_INT;
+    }
+    pthread_barrier_init(&barrier, NULL, nthreads);
+
+    /* open the file and set the view of variables [first, first+nv) of each
+     * thread, collectively on the communicator of the thread
+     */
+    for (t=0; t<nthreads; t++) {
+        thread_arg *a = &args[t];
+        first = t * nvars / nthreads;
+        nv = (t + 1) * nvars / nthreads - first;
+
+        err = MPI_Comm_dup(MPI_COMM_WORLD, &comms[t]); ERR
+        err = create_fileType(comms[t], nv, len, &fileType);
+        if (err != 0) {
+            nerrs++;
+            goto err_out;
+        }
+        err = MPI_File_open(comms[t], filename, MPI_MODE_CREATE |
+                            MPI_MODE_RDWR, info, &a->fh); ERR
+        err = MPI_File_set_view(a->fh, first * var_size, MPI_BYTE, fileType,
+                                "native", info); ERR
+        err = MPI_Type_free(&fileType); ERR
+
+        if (buf_contig) {
+            a->buf   = buf[first];
+            a->count = cube * nv;
+        }
+        else {
+            err = create_bufType(comms[t], nv, len, ngcells, buf + first,
+                                 &a->bufType);
+            if (err != 0) {
+                nerrs++;
+                goto err_out;
+            }
+            a->buf   = MPI_BOTTOM;
+            a->count = 1;
+        }
+        a->rcount  = ZDIMS * len * len * nv;
+        a->rbuf    = (int*) malloc(sizeof(int) * a->rcount);
+        a->nruns   = nruns;
+        a->do_read = do_read;
+        a->err     = MPI_SUCCESS;
+        a->barrier = &barrier;
+    }
+
+    for (t=1; t<nthreads; t++) {
+        if (pthread_create(&threads[t], NULL, thread_main, &args[t]) != 0) {
+            printf("Error: rank %d failed to create thread %d\n", rank, t);
+            MPI_Abort(MPI_COMM_WORLD, -1);
+        }
+        nthreads_run++;
+    }
+
+    for (k=0; k<=do_read; k++) {
+        /* reset read buffers to all -1s */
+        for (t=0; k==1 && t<nthreads; t++)
+            bench_fill_block(args[t].rbuf, 1, 1, args[t].rcount, 0, -1, -1);
+
+        for (i=0; i<nruns; i++) {
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&timers[k]);
+            pthread_barrier_wait(&barrier);
+            thread_io(&args[0], k);
+            pthread_barrier_wait(&barrier);
+            bench_timer_stop(&timers[k]);
+        }
+    }
+
+    for (t=1; t<=nthreads_run; t++)
+        pthread_join(threads[t], NULL);
+    nthreads_run = 0;
+
+    for (t=0; t<nthreads; t++) {
+        err = args[t].err; ERR
+    }
+
+    /* check contents of the read buffers */
+    for (t=0; do_read && t<nthreads; t++) {
+        long long j = bench_verify_rows(args[t].rbuf, 1, 0, args[t].rcount,
+                                        rank);
+        if (j >= 0) {
+            printf("Error: thread %d read element %lld expect %d but got %d\n",
+                   t, j, rank, args[t].rbuf[j]);
+            nerrs++;
+            goto err_out;
+        }
+    }
+
+err_out:
+    for (t=1; t<=nthreads_run; t++)
+        pthread_join(threads[t], NULL);
+    pthread_barrier_destroy(&barrier);
+    for (t=0; t<nthreads; t++) {
+        if (args[t].fh != MPI_FILE_NULL) MPI_File_close(&args[t].fh);
+        if (args[t].bufType != MPI_INT) MPI_Type_free(&args[t].bufType);
+        if (args[t].rbuf != NULL) free(args[t].rbuf);
+        if (comms[t] != MPI_COMM_NULL) MPI_Comm_free(&comms[t]);
+    }
+    free(args);
+    free(threads);
+    free(comms);
+    return nerrs;
+}
+
+/*----< print_thread_scaling() >---------------------------------------------*/
+/* print the table of the concurrent writes and reads by the threads, with
+ * the speedups over the single collective write and read of all variables
+ */
+static void
+print_thread_scaling(const long long *nthreads,
+                     int              nthr,
+                     int              nvars,
+                     double           amnt,
+                     const double    *med,
+                     double           single_w,
+                     double           single_r,
+                     int              do_read)
+{
+    int i;
+
+    printf("---- concurrent collective I/O by threads, one file handle per thread\n");
+    printf("  %7s %11s %10s %11s %8s", "threads", "vars/thread", "write(ms)",
+           "write MiB/s", "speedup");
+    if (do_read)
+        printf(" %10s %10s %8s", "read(ms)", "read MiB/s", "speedup");
+    printf("\n");
+    printf("  %7s %11d %10.3f %11.2f %8.2f", "single", nvars, single_w * 1e3,
+           (single_w > 0) ? amnt / 1048576.0 / single_w : 0.0, 1.0);
+    if (do_read)
+        printf(" %10.3f %10.2f %8.2f", single_r * 1e3,
+               (single_r > 0) ? amnt / 1048576.0 / single_r : 0.0, 1.0);
+    printf("\n");
+    for (i=0; i<nthr; i++) {
+        double w = med[2*i], r = med[2*i+1];
+        printf("  %7lld %11.1f %10.3f %11.2f %8.2f", nthreads[i],
+               (double)nvars / nthreads[i], w * 1e3,
+               (w > 0) ? amnt / 1048576.0 / w : 0.0,
+               (w > 0) ? single_w / w : 0.0);
+        if (do_read)
+            printf(" %10.3f %10.2f %8.2f", r * 1e3,
+                   (r > 0) ? amnt / 1048576.0 / r : 0.0,
+                   (r > 0) ? single_r / r : 0.0);
+        printf("\n");
+    }
+}
+
+/*----< threads_requested() >------------------------------------------------*/
+/* Return 1 if option -T is given, scanning argv by the rules of getopt()
+ * with optstring, as the thread level must be known before MPI is
+ * initialized and the options are parsed.
+ */
+static int
+threads_requested(int argc, char **argv, const char *optstring)
+{
+    int i;
+    char *p, *opt;
+
+    for (i=1; i<argc; i++) {
+        p = argv[i];
+        if (p[0] != '-' || p[1] == '\0') continue; /* not an option */
+        if (strcmp(p, "--") == 0) break;            /* end of options */
+        for (p++; *p != '\0'; p++) {
+            if (*p == 'T') return 1;
+            opt = (*p == ':') ? NULL : strchr(optstring, *p);
+            if (opt != NULL && opt[1] == ':') {
+                /* rest of the word, or the next word, is the argument */
+                if (p[1] == '\0') i++;
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
 static void
 usage(char *argv0)
 {
     char *help =
-    "Usage: %s [-hvrc | -n num | -l len | -g num | -a num | -s num] -f file_name\n"
+    "Usage: %s [-hvrcipuF | -n num | -l len | -g num | -a num | -s num | -W num | -N num | -o file | -P str | -K num | -C sec | -S num | -G | -T list | -z codec | -b size | -t num | -V mode | -H file] -f file_name\n"
     "       [-h] Print this help\n"
     "       [-v] verbose mode\n"
     "       [-r] perform read operations after writes\n"
     "       [-c] make user buffer contiguous and no ghost cells \n"
+    "       [-i] instrumented mode, time each phase of collective write\n"
+    "       [-p] also pack the buffer by MPI_Pack before collective write\n"
+    "       [-u] also pack the buffer by memcpy before collective write\n"
     "       [-n num] number of variables to be written\n"
     "       [-l len] length of local X and Y dimension sizes\n"
     "       [-g num] number of ghost cells\n"
     "       [-a num] set cb_nodes hint\n"
     "       [-s num] set cb_buffer_size hint\n"
+    "       [-W num] number of untimed warmup runs (default: %d)\n"
+    "       [-N num] number of timed repetitions (default: %d)\n"
+    "       [-o file] append results as a line of JSON to file\n"
+    "       [-P str] comma-separated name prefixes of MPI_T performance\n"
+    "                variables reported in instrumented mode (default: %s)\n"
+    "       [-K num] also write the variables in num batches, by blocking and\n"
+    "                nonblocking collective writes overlapped with computation\n"
+    "       [-C sec] seconds of computation per batch (default: %g)\n"
+    "       [-F] also write file per process, file_name.rank\n"
+    "       [-S num] also write one subfile per num processes, or per compute\n"
+    "                node if num is 0, file_name.group\n"
+    "       [-G] also write from a GPU device buffer, directly and staged\n"
+    "            through pinned host memory, requires ENABLE_GPU=cuda or hip\n"
+    "       [-T list] also write the variables split among threads, for each\n"
+    "                 number of threads in list, e.g. 1,2,4 or 1:8, each with\n"
+    "                 its own file handle, requires MPI_THREAD_MULTIPLE\n"
+    "       [-z codec] also write the variables compressed in chunks by codec\n"
+    "                  lz4, zstd, or zlib, to file_name.codec\n"
+    "       [-b size] size of chunks compressed separately (default: %d)\n"
+    "       [-t num] number of threads compressing the chunks (default: 1)\n"
+    "       [-V mode] check the read buffer by comparing each element (elem),\n"
+    "                 by CRC-32C checksums of its rows (crc), or not (none)\n"
+    "                 (default: elem)\n"
+    "       [-H file] load MPI-IO hints from file of \"key value\" lines,\n"
+    "                 overwritten by -a and -s\n"
     "        -f filename: output file name\n";
-    fprintf(stderr, help, argv0);
+    fprintf(stderr, help, argv0, BENCH_NWARMUP, BENCH_NREPS, BENCH_PVARS,
+            COMPUTE_T, CHUNK_SIZE);
 }
 
 /*----< main() >------------------------------------------------------------*/
@@ -187,30 +1703,60 @@ int main(int argc, char **argv)
 {
     extern int optind;
     extern char *optarg;
-    char filename[256], *cb_nodes=NULL, *cb_buffer_size=NULL;
-    int i, j, k, z, cube, do_read;
+    char filename[256], *cb_nodes=NULL, *cb_buffer_size=NULL, *out_file=NULL;
+    char *pvar_prefixes=NULL, *hints_file=NULL, *threads_list=NULL;
+    char (*tnames)[64]=NULL, *codec_name=NULL, zpath[1024];
+    int i, j, k, z, cube, do_read, nwarmup, nreps, instrument;
     int err, nerrs=0, rank, nprocs, mode, nvars, len, xlen;
-    int **buf=NULL, ngcells, max_nerrs, buf_contig;
-    double timing[2], max_timing[2];
+    int **buf=NULL, ngcells, max_nerrs, buf_contig, nbatches, pack;
+    int *packed=NULL, packed_size, position, layout, group_size, gpu;
+    int nthr=0, required, provided, codec, zthreads, chunk_rows, verify;
+    unsigned int *crcs=NULL;
+    long long *nthreads=NULL, *vals, chunk_size;
+    double compute_t, zbytes=0;
+    bench_timer wtimer, rtimer, ptimer[NPHASES], btimer[3], ktimer[3];
+    bench_timer ltimer[3], gtimer[4], *ttimer=NULL, ztimer[4], itimer, vtimer;
+    bench_record rec;
+    bench_pvars pvars;
     MPI_Datatype bufType=MPI_INT, fileType;
     MPI_File fh;
     MPI_Status status;
     MPI_Info info = MPI_INFO_NULL;
+    const char *optstring = "hvrcipuFGn:l:g:a:s:f:W:N:o:P:K:C:S:T:z:b:t:V:H:";
 
-    MPI_Init(&argc,&argv);
+    /* MPI_THREAD_MULTIPLE is requested only by the multithreaded mode, so the
+     * other modes run at the default thread level of the MPI library
+     */
+    required = MPI_THREAD_SINGLE;
+    if (threads_requested(argc, argv, optstring))
+        required = MPI_THREAD_MULTIPLE;
+    MPI_Init_thread(&argc, &argv, required, &provided);
     MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
     verbose     = 0;
     do_read     = 0;
     buf_contig  = 0;
+    instrument  = 0;
+    pack        = PACK_NONE;
     nvars       = 2;     /* default number of variables */
     len         = 10;    /* default dimension size */
     ngcells     = 2;     /* number of ghost cells */
+    nbatches    = 0;     /* no pipelined writes */
+    compute_t   = COMPUTE_T;
+    layout      = LAYOUT_SHARED;
+    gpu         = 0;
+    codec       = CODEC_NONE;
+    zthreads    = 1;
+    chunk_size  = CHUNK_SIZE;
+    verify      = BENCH_VERIFY_ELEM;
+    group_size  = 0;
+    nwarmup     = BENCH_NWARMUP;
+    nreps       = BENCH_NREPS;
     filename[0] = '\0';
 
     /* get command-line arguments */
-    while ((i = getopt(argc, argv, "hvrcn:l:g:a:s:f:")) != EOF)
+    while ((i = getopt(argc, argv, optstring)) != EOF)
         switch(i) {
             case 'v': verbose = 1;
                       break;
@@ -218,6 +1764,12 @@ int main(int argc, char **argv)
                       break;
             case 'c': buf_contig = 1;
                       break;
+            case 'i': instrument = 1;
+                      break;
+            case 'p': pack = PACK_MPI;
+                      break;
+            case 'u': pack = PACK_MEMCPY;
+                      break;
             case 'n': nvars = atoi(optarg);
                       break;
             case 'l': len = atoi(optarg);
@@ -230,6 +1782,47 @@ int main(int argc, char **argv)
                       break;
             case 'f': strcpy(filename, optarg);
                       break;
+            case 'W': nwarmup = atoi(optarg);
+                      break;
+            case 'N': nreps = atoi(optarg);
+                      break;
+            case 'o': out_file = strdup(optarg);
+                      break;
+            case 'P': pvar_prefixes = strdup(optarg);
+                      break;
+            case 'K': nbatches = atoi(optarg);
+                      break;
+            case 'C': compute_t = atof(optarg);
+                      break;
+            case 'F': layout = LAYOUT_FPP;
+                      break;
+            case 'S': layout = LAYOUT_SUBFILE;
+                      group_size = atoi(optarg);
+                      break;
+            case 'G': gpu = 1;
+                      break;
+            case 'T': threads_list = optarg;
+                      break;
+            case 'z': codec_name = optarg;
+                      break;
+            case 'b': if (bench_parse_list(optarg, &vals) < 1 || vals[0] <= 0) {
+                          if (rank==0) usage(argv[0]);
+                          MPI_Finalize();
+                          return 1;
+                      }
+                      chunk_size = vals[0];
+                      free(vals);
+                      break;
+            case 't': zthreads = atoi(optarg);
+                      break;
+            case 'V': if ((verify = bench_verify_mode(optarg)) < 0) {
+                          if (rank==0) usage(argv[0]);
+                          MPI_Finalize();
+                          return 1;
+                      }
+                      break;
+            case 'H': hints_file = optarg;
+                      break;
             case 'h':
             default:  if (rank==0) usage(argv[0]);
                       MPI_Finalize();
@@ -243,9 +1836,141 @@ int main(int argc, char **argv)
     }
 
     if (buf_contig == 1) ngcells = 0;
+    if (nbatches > nvars) nbatches = nvars;
+
+    if (codec_name != NULL) {
+        /* codec of the compressed mode, which must have been built */
+        for (codec=CODEC_LZ4; codec<=CODEC_ZLIB; codec++)
+            if (strcmp(codec_name, codec_names[codec]) == 0) break;
+        if (codec > CODEC_ZLIB || zthreads <= 0) {
+            if (rank==0) usage(argv[0]);
+            MPI_Finalize();
+            return 1;
+        }
+        if (codec_bound(codec, 1) == 0) {
+            if (rank==0)
+                printf("Error: codec %s requires building with ENABLE_%s=yes\n",
+                       codec_name, (codec == CODEC_LZ4) ? "LZ4" :
+                       (codec == CODEC_ZSTD) ? "ZSTD" : "ZLIB");
+            MPI_Finalize();
+            return 1;
+        }
+    }
+    /* chunks are whole rows of the local variables */
+    chunk_rows = (chunk_size + sizeof(int) * len - 1) / (sizeof(int) * len);
+    if (chunk_rows > nvars * ZDIMS * len) chunk_rows = nvars * ZDIMS * len;
+
+    if (threads_list != NULL) {
+        /* numbers of threads of the multithreaded mode, at most nvars */
+        nthr = bench_parse_list(threads_list, &nthreads);
+        for (i=0; i<nthr; i++) {
+            if (nthreads[i] <= 0) nthr = -1;
+            else if (nthreads[i] > nvars) nthreads[i] = nvars;
+        }
+        if (nthr <= 0 || instrument) {
+            if (rank==0) usage(argv[0]);
+            MPI_Finalize();
+            return 1;
+        }
+        if (provided < MPI_THREAD_MULTIPLE) {
+            if (rank==0)
+                printf("Error: option -T requires MPI_THREAD_MULTIPLE, but the MPI library provides level %d\n",
+                       provided);
+            MPI_Finalize();
+            return 1;
+        }
+    }
+
+    bench_timer_init(&wtimer, "collective write", nwarmup, nreps);
+    bench_timer_init(&rtimer, "collective read", nwarmup, nreps);
+    for (i=0; i<NPHASES; i++)
+        bench_timer_init(&ptimer[i], phase_names[i], nwarmup, nreps);
+    bench_timer_init(&ktimer[0], (pack == PACK_MPI) ? "pack (MPI_Pack)" :
+                     "pack (memcpy)", nwarmup, nreps);
+    bench_timer_init(&ktimer[1], "collective write, packed", nwarmup, nreps);
+    bench_timer_init(&ktimer[2], "pack + collective write", nwarmup, nreps);
+    bench_timer_init(&btimer[0], "blocking batches", nwarmup, nreps);
+    bench_timer_init(&btimer[1], "compute only", nwarmup, nreps);
+    bench_timer_init(&btimer[2], "nonblocking batches + compute", nwarmup,
+                     nreps);
+    bench_timer_init(&ltimer[0], "shared file open + write + close",
+                     nwarmup, nreps);
+    bench_timer_init(&ltimer[1], (layout == LAYOUT_FPP) ?
+                     "file per process open + write + close" :
+                     "subfiles open + write + close", nwarmup, nreps);
+    bench_timer_init(&ltimer[2], "reassemble from subfiles", nwarmup, nreps);
+    bench_timer_init(&gtimer[0], "collective write, device buffer", nwarmup,
+                     nreps);
+    bench_timer_init(&gtimer[1], "device-to-host copy + collective write",
+                     nwarmup, nreps);
+    bench_timer_init(&gtimer[2], "collective read, device buffer", nwarmup,
+                     nreps);
+    bench_timer_init(&gtimer[3], "collective read + host-to-device copy",
+                     nwarmup, nreps);
+    /* initialization and check of the buffer are run once */
+    bench_timer_init(&itimer, "buffer initialization", 0, 1);
+    bench_timer_init(&vtimer, "verification", 0, 1);
+    bench_timer_init(&ztimer[0], "compression", nwarmup, nreps);
+    bench_timer_init(&ztimer[1], "collective write, compressed", nwarmup,
+                     nreps);
+    bench_timer_init(&ztimer[2], "compression + collective write", nwarmup,
+                     nreps);
+    bench_timer_init(&ztimer[3], "collective read + decompression", nwarmup,
+                     nreps);
+    if (nthr > 0) {
+        ttimer = (bench_timer*) malloc(sizeof(bench_timer) * nthr * 2);
+        tnames = (char(*)[64]) malloc(64 * nthr * 2);
+        for (i=0; i<nthr; i++) {
+            sprintf(tnames[2*i], "concurrent write, %lld threads", nthreads[i]);
+            sprintf(tnames[2*i+1], "concurrent read, %lld threads", nthreads[i]);
+            bench_timer_init(&ttimer[2*i], tnames[2*i], nwarmup, nreps);
+            bench_timer_init(&ttimer[2*i+1], tnames[2*i+1], nwarmup, nreps);
+        }
+    }
+
+    bench_record_init(&rec, MPI_COMM_WORLD, "nvars");
+    bench_record_int(&rec, "nvars", nvars);
+    bench_record_int(&rec, "len", len);
+    bench_record_int(&rec, "ngcells", ngcells);
+    bench_record_int(&rec, "buf_contig", buf_contig);
+    bench_record_int(&rec, "instrument", instrument);
+    bench_record_str(&rec, "pack", (pack == PACK_MPI) ? "MPI_Pack" :
+                     (pack == PACK_MEMCPY) ? "memcpy" : "none");
+    bench_record_int(&rec, "nbatches", nbatches);
+    if (nbatches > 0) bench_record_double(&rec, "compute_t", compute_t);
+    bench_record_str(&rec, "layout", (layout == LAYOUT_FPP) ? "fpp" :
+                     (layout == LAYOUT_SUBFILE) ? "subfile" : "shared");
+    if (layout == LAYOUT_SUBFILE)
+        bench_record_int(&rec, "subfile_procs", group_size);
+    bench_record_int(&rec, "gpu", gpu);
+    if (nthr > 0) bench_record_str(&rec, "threads", threads_list);
+    bench_record_str(&rec, "verify", (verify == BENCH_VERIFY_CRC) ? "crc" :
+                     (verify == BENCH_VERIFY_NONE) ? "none" : "elem");
+    bench_record_str(&rec, "codec", codec_names[codec]);
+    if (codec != CODEC_NONE) {
+        bench_record_int(&rec, "chunk_size", sizeof(int) * chunk_rows * len);
+        bench_record_int(&rec, "compress_threads", zthreads);
+    }
+
+    /* pvars are collected only in the instrumented mode */
+    err = bench_pvars_init(&pvars, (!instrument) ? NULL :
+                           (pvar_prefixes == NULL) ? BENCH_PVARS : pvar_prefixes);
+    ERR
+
+    /* select the GPU device of this process */
+    if (gpu && bench_gpu_init(MPI_COMM_WORLD) != 0) {
+        nerrs++;
+        goto err_out;
+    }
+
+    /* load user I/O hints from the hint file, if given */
+    if (bench_hints_load(hints_file, MPI_COMM_WORLD, &info) != 0) {
+        nerrs++;
+        goto err_out;
+    }
 
     if (cb_nodes != NULL || cb_buffer_size != NULL) {
-        MPI_Info_create(&info);
+        if (info == MPI_INFO_NULL) MPI_Info_create(&info);
         if (cb_nodes != NULL)
             MPI_Info_set(info, "cb_nodes", cb_nodes);
         if (cb_buffer_size != NULL)
@@ -285,16 +2010,17 @@ int main(int argc, char **argv)
             buf[k] = (int*) malloc(sizeof(int) * cube);
     }
 
-    /* initialize contents of buffer */
-    for (k=0; k<nvars; k++) {
-        for (i=0; i<cube; i++)
-            buf[k][i] = -1;
-
-        for (z=0; z<ZDIMS ; z++)
-            for (i=ngcells; i<len+ngcells ; i++)
-                for (j=ngcells; j<len+ngcells ; j++)
-                     buf[k][z*xlen*xlen + i*xlen+j] = rank;
+    /* initialize contents of buffer, and the checksums of the interior */
+    bench_timer_start(&itimer);
+    for (k=0; k<nvars; k++)
+        bench_fill_block(buf[k], ZDIMS, len, len, ngcells, rank, -1);
+    if (verify == BENCH_VERIFY_CRC) {
+        crcs = (unsigned int*) malloc(sizeof(int) * nvars * ZDIMS * 2);
+        for (k=0; k<nvars; k++)
+            bench_rows_crc(buf[k] + ngcells * xlen + ngcells, ZDIMS,
+                           xlen * xlen, len, xlen, len, crcs + k * ZDIMS);
     }
+    bench_timer_stop(&itimer);
 
     if (!buf_contig) {
         /* create buffer datatype */
@@ -305,68 +2031,196 @@ int main(int argc, char **argv)
         }
     }
 
+    if (instrument) {
+        /* time each phase of the collective write separately */
+        err = instrumented_write(filename, info, nvars, len, buf, buf_contig,
+                                 cube, bufType, &wtimer, ptimer, &pvars, &rec);
+        if (err != 0) {
+            nerrs++;
+            goto err_out;
+        }
+    }
+
     /* open file */
     mode = MPI_MODE_CREATE | MPI_MODE_RDWR;
     err = MPI_File_open(MPI_COMM_WORLD, filename, mode, info, &fh); ERR
+    err = bench_record_hints(&rec, fh); ERR
+    if (hints_file != NULL) {
+        err = bench_hints_print(fh, MPI_COMM_WORLD); ERR
+    }
 
     /* set the file view */
-    err = MPI_File_set_view(fh, 0, MPI_BYTE, fileType, "native", MPI_INFO_NULL);
+    err = MPI_File_set_view(fh, 0, MPI_BYTE, fileType, "native", info);
     ERR
 
-    /* write to the file */
-    MPI_Barrier(MPI_COMM_WORLD);
-    timing[0] = MPI_Wtime();
-    if (buf_contig) {
-        err = MPI_File_write_all(fh, buf[0], cube*nvars, bufType, &status);
-        ERR
+    /* write to the file, repeatedly to the same file region */
+    for (i=0; !instrument && i<nwarmup+nreps; i++) {
+        err = MPI_File_seek(fh, 0, MPI_SEEK_SET); ERR
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&wtimer);
+        if (buf_contig) {
+            err = MPI_File_write_all(fh, buf[0], cube*nvars, bufType, &status);
+            ERR
+        }
+        else {
+            err = MPI_File_write_all(fh, MPI_BOTTOM, 1, bufType, &status);
+            ERR
+        }
+        bench_timer_stop(&wtimer);
     }
-    else {
-        err = MPI_File_write_all(fh, MPI_BOTTOM, 1, bufType, &status);
-        ERR
+
+    /* pack the user buffer into a contiguous buffer and write it */
+    if (pack != PACK_NONE) {
+        packed_size = sizeof(int) * nvars * ZDIMS * len * len;
+        packed = (int*) malloc(packed_size);
+
+        for (i=0; i<nwarmup+nreps; i++) {
+            err = MPI_File_seek(fh, 0, MPI_SEEK_SET); ERR
+
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&ktimer[2]);
+            bench_timer_start(&ktimer[0]);
+            if (pack == PACK_MPI) {
+                position = 0;
+                if (buf_contig)
+                    err = MPI_Pack(buf[0], cube*nvars, bufType, packed,
+                                   packed_size, &position, MPI_COMM_WORLD);
+                else
+                    err = MPI_Pack(MPI_BOTTOM, 1, bufType, packed,
+                                   packed_size, &position, MPI_COMM_WORLD);
+                ERR
+            }
+            else {
+                int *dst = packed;
+                for (k=0; k<nvars; k++)
+                    for (z=0; z<ZDIMS; z++)
+                        for (j=ngcells; j<len+ngcells; j++) {
+                            memcpy(dst, buf[k] + z*xlen*xlen + j*xlen + ngcells,
+                                   sizeof(int) * len);
+                            dst += len;
+                        }
+            }
+            bench_timer_stop(&ktimer[0]);
+
+            bench_timer_start(&ktimer[1]);
+            err = MPI_File_write_all(fh, packed, packed_size / sizeof(int),
+                                     MPI_INT, &status); ERR
+            bench_timer_stop(&ktimer[1]);
+            bench_timer_stop(&ktimer[2]);
+        }
+        free(packed);
     }
-    timing[0] = MPI_Wtime() - timing[0];
 
-    if (!do_read) goto verify_err;
+    if (nbatches > 0) {
+        /* overlap batches of nonblocking collective writes with computation */
+        err = pipelined_write(fh, nvars, len, buf, buf_contig, cube, ngcells,
+                              nbatches, compute_t, btimer);
+        if (err != 0) {
+            nerrs++;
+            goto verify_err;
+        }
+    }
 
-    /* reset read buffer to all -1s */
-    for (k=0; k<nvars; k++) {
-        for (i=0; i<cube; i++)
-            buf[k][i] = -1;
+    if (layout != LAYOUT_SHARED) {
+        /* write file per process or subfiles, compared with shared file */
+        err = layout_write(filename, info, layout, group_size, nvars, len, buf,
+                           buf_contig, cube, bufType, fileType, ltimer, &rec);
+        if (err != 0) {
+            nerrs++;
+            goto verify_err;
+        }
+        if (do_read) {
+            err = layout_read(filename, nvars, len, buf, buf_contig, cube,
+                              ngcells, bufType, &ltimer[2]);
+            if (err != 0) {
+                nerrs++;
+                goto verify_err;
+            }
+        }
     }
 
-    /* reset file pointer */
-    err = MPI_File_seek(fh, 0, MPI_SEEK_SET); ERR
+    if (gpu) {
+        /* write and read a device buffer, directly and staged */
+        err = gpu_write_read(fh, nvars, len, buf, cube, ngcells, do_read,
+                             gtimer);
+        if (err != 0) {
+            nerrs++;
+            goto verify_err;
+        }
+    }
 
-    timing[1] = MPI_Wtime();
-    /* read from the file */
-    if (buf_contig) {
-        err = MPI_File_read_all(fh, buf[0], cube*nvars, bufType, &status);
-        ERR
+    for (i=0; i<nthr; i++) {
+        /* write and read the variables split among threads concurrently */
+        err = threaded_write_read(filename, info, nthreads[i], nvars, len, buf,
+                                  buf_contig, cube, ngcells, do_read,
+                                  &ttimer[2*i]);
+        if (err != 0) {
+            nerrs++;
+            goto verify_err;
+        }
     }
-    else {
-        err = MPI_File_read_all(fh, MPI_BOTTOM, 1, bufType, &status);
-        ERR
+
+    if (codec != CODEC_NONE) {
+        /* compress chunks of the variables and write them with the index */
+        snprintf(zpath, sizeof(zpath), "%s.%s", filename, codec_names[codec]);
+        err = compressed_write_read(zpath, info, codec, zthreads, chunk_rows,
+                                    nvars, len, buf, ngcells, do_read, ztimer,
+                                    &zbytes);
+        if (err != 0) {
+            nerrs++;
+            goto verify_err;
+        }
     }
-    timing[1] = MPI_Wtime() - timing[1];
 
-    /* check contents of read buffer */
-    for (k=0; k<nvars; k++) {
-        for (z=0; z<ZDIMS ; z++)
-            for (i=0; i<xlen ; i++)
-                for (j=0; j<xlen ; j++) {
-                    int exp = rank;
-                    if (i < ngcells || i >= len+ngcells ||
-                        j < ngcells || j >= len+ngcells)
-                        exp = -1;
-                    if (buf[k][z*xlen*xlen + i*xlen+j] != exp) {
-                        printf("Error: buf[%d][%d][%d][%d] expect %d but got %d\n",
-                               k, z, i, j, exp, buf[k][z*cube + i*xlen+j]);
-                        nerrs++;
-                        goto verify_err;
-                    }
-                }
+    if (!do_read) goto verify_err;
+
+    /* reset read buffer to all -1s */
+    for (k=0; k<nvars; k++)
+        bench_fill_block(buf[k], ZDIMS, len, len, ngcells, -1, -1);
+
+    /* read from the file */
+    for (i=0; i<nwarmup+nreps; i++) {
+        /* reset file pointer */
+        err = MPI_File_seek(fh, 0, MPI_SEEK_SET); ERR
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        bench_timer_start(&rtimer);
+        if (buf_contig) {
+            err = MPI_File_read_all(fh, buf[0], cube*nvars, bufType, &status);
+            ERR
+        }
+        else {
+            err = MPI_File_read_all(fh, MPI_BOTTOM, 1, bufType, &status);
+            ERR
+        }
+        bench_timer_stop(&rtimer);
     }
 
+    /* check contents of read buffer, element-wise or by checksums */
+    bench_timer_start(&vtimer);
+    for (k=0; verify == BENCH_VERIFY_ELEM && k<nvars; k++) {
+        if (check_var(buf[k], k, len, ngcells, rank, "")) {
+            nerrs++;
+            break;
+        }
+    }
+    for (k=0; verify == BENCH_VERIFY_CRC && k<nvars; k++) {
+        unsigned int *rcrcs = crcs + nvars * ZDIMS;
+        bench_rows_crc(buf[k] + ngcells * xlen + ngcells, ZDIMS, xlen * xlen,
+                       len, xlen, len, rcrcs + k * ZDIMS);
+        for (z=0; z<ZDIMS; z++) {
+            if (rcrcs[k * ZDIMS + z] != crcs[k * ZDIMS + z]) {
+                printf("Error: checksum of buf[%d][%d] expect 0x%08x but got 0x%08x\n",
+                       k, z, crcs[k * ZDIMS + z], rcrcs[k * ZDIMS + z]);
+                nerrs++;
+                break;
+            }
+        }
+        if (nerrs > 0) break;
+    }
+    bench_timer_stop(&vtimer);
+
 verify_err:
     if (bufType != MPI_INT)
         MPI_Type_free(&bufType);
@@ -384,32 +2238,151 @@ verify_err:
     free(buf);
 
     MPI_Allreduce(&nerrs, &max_nerrs, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
-    MPI_Reduce(timing, max_timing, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
-    if (max_nerrs == 0 && rank == 0) {
-        printf("Number of MPI processes:             %d\n", nprocs);
-        printf("Number of variables:                 %d\n", nvars);
-        printf("Size of each variables:              %d x %d (int)\n", len, len);
-        printf("User buffer is contiguous:           %s\n", (buf_contig)?"yes":"no");
-        printf("Number of ghost cells on both sizes: %d\n", ngcells);
+    if (max_nerrs == 0) {
         double amnt, amntM, amntG;
         amnt = (double)nprocs * nvars * ZDIMS * len * len * sizeof(int);
         amntM = amnt / 1048576.0;
         amntG = amnt / 1073741824.0;
-        printf("Total write amount:                  %.0f B, %.2f MB, %.2f GB\n",
-               amnt, amntM, amntG);
-        printf("Time of collective write:            %.2f sec\n", max_timing[0]);
-        printf("Write bandwidth:                     %.2f MB/sec, %.2f GB/sec\n",
-               amntM/max_timing[0], amntG/max_timing[0]);
-        if (do_read) {
-            printf("Total read amount:                   %.0f B, %.2f MB, %.2f GB\n",
+        if (rank == 0) {
+            printf("Number of MPI processes:             %d\n", nprocs);
+            printf("Number of variables:                 %d\n", nvars);
+            printf("Size of each variables:              %d x %d (int)\n", len, len);
+            printf("User buffer is contiguous:           %s\n", (buf_contig)?"yes":"no");
+            printf("Number of ghost cells on both sizes: %d\n", ngcells);
+            printf("Total write amount:                  %.0f B, %.2f MB, %.2f GB\n",
                    amnt, amntM, amntG);
-            printf("Time of collective read:             %.2f sec\n", max_timing[1]);
-            printf("Read  bandwidth:                     %.2f MB/sec, %.2f GB/sec\n",
-                   amntM/max_timing[1], amntG/max_timing[1]);
+            if (do_read)
+                printf("Total read amount:                   %.0f B, %.2f MB, %.2f GB\n",
+                       amnt, amntM, amntG);
         }
+        bench_timer_report(&itimer, MPI_COMM_WORLD, amnt, &rec);
+        if (do_read && verify != BENCH_VERIFY_NONE)
+            bench_timer_report(&vtimer, MPI_COMM_WORLD, amnt, &rec);
+        bench_timer_report(&wtimer, MPI_COMM_WORLD, amnt, &rec);
+        if (pack != PACK_NONE)
+            for (i=0; i<3; i++)
+                bench_timer_report(&ktimer[i], MPI_COMM_WORLD, amnt, &rec);
+        if (instrument) {
+            bench_phases_report(ptimer, NPHASES, MPI_COMM_WORLD, &rec);
+            bench_pvars_report(&pvars, MPI_COMM_WORLD, &rec);
+        }
+        if (nbatches > 0) {
+            bench_stats st[3];
+            bench_timer_report(&btimer[0], MPI_COMM_WORLD, amnt, &rec);
+            bench_timer_report(&btimer[1], MPI_COMM_WORLD, 0, &rec);
+            bench_timer_report(&btimer[2], MPI_COMM_WORLD, amnt, &rec);
+            for (i=0; i<3; i++)
+                bench_timer_reduce(&btimer[i], MPI_COMM_WORLD, 0, &st[i],
+                                   NULL, NULL);
+            if (rank == 0) {
+                /* part of the blocking I/O time hidden behind computation */
+                double hidden = 0;
+                if (st[0].median > 0)
+                    hidden = (st[0].median + st[1].median - st[2].median) /
+                             st[0].median;
+                if (hidden < 0) hidden = 0;
+                if (hidden > 1) hidden = 1;
+                printf("Number of batches:                   %d\n", nbatches);
+                printf("Computation per batch:               %.4f sec\n",
+                       compute_t);
+                printf("Hidden I/O fraction:                 %.2f%%\n",
+                       hidden * 100.0);
+                bench_record_double(&rec, "hidden_io_fraction", hidden);
+            }
+        }
+        if (layout != LAYOUT_SHARED) {
+            bench_stats st[2];
+            bench_timer_report(&ltimer[0], MPI_COMM_WORLD, amnt, &rec);
+            bench_timer_report(&ltimer[1], MPI_COMM_WORLD, amnt, &rec);
+            if (do_read)
+                bench_timer_report(&ltimer[2], MPI_COMM_WORLD, amnt, &rec);
+            for (i=0; i<2; i++)
+                bench_timer_reduce(&ltimer[i], MPI_COMM_WORLD, 0, &st[i],
+                                   NULL, NULL);
+            if (rank == 0 && st[1].median > 0)
+                printf("%-37s%.2f\n", (layout == LAYOUT_FPP) ?
+                       "Shared/fpp write time ratio:" :
+                       "Shared/subfile write time ratio:",
+                       st[0].median / st[1].median);
+        }
+        if (gpu)
+            for (i=0; i<((do_read) ? 4 : 2); i++)
+                bench_timer_report(&gtimer[i], MPI_COMM_WORLD, amnt, &rec);
+        if (do_read)
+            bench_timer_report(&rtimer, MPI_COMM_WORLD, amnt, &rec);
+        if (codec != CODEC_NONE) {
+            bench_stats st[2];
+            for (i=0; i<((do_read) ? 4 : 3); i++)
+                bench_timer_report(&ztimer[i], MPI_COMM_WORLD, amnt, &rec);
+            bench_timer_reduce(&wtimer, MPI_COMM_WORLD, 0, &st[0], NULL, NULL);
+            bench_timer_reduce(&ztimer[2], MPI_COMM_WORLD, 0, &st[1], NULL,
+                               NULL);
+            if (rank == 0) {
+                printf("Compression codec:                   %s, %d threads\n",
+                       codec_names[codec], zthreads);
+                printf("Chunk size:                          %zd B, %d rows\n",
+                       sizeof(int) * chunk_rows * len, chunk_rows);
+                printf("Compressed file size:                %.0f B, %.2f MB\n",
+                       zbytes, zbytes / 1048576.0);
+                printf("Compression ratio:                   %.2f\n",
+                       amnt / zbytes);
+                if (!instrument && st[0].median > 0)
+                    printf("Compressed/raw write time ratio:     %.2f\n",
+                           st[1].median / st[0].median);
+                bench_record_double(&rec, "compressed_bytes", zbytes);
+                bench_record_double(&rec, "compression_ratio", amnt / zbytes);
+            }
+        }
+        if (nthr > 0) {
+            bench_stats st, sts[2];
+            double *med = (double*) calloc(nthr * 2, sizeof(double));
+            for (i=0; i<nthr*2; i++) {
+                if (do_read || i % 2 == 0) {
+                    bench_timer_report(&ttimer[i], MPI_COMM_WORLD, amnt, &rec);
+                    bench_timer_reduce(&ttimer[i], MPI_COMM_WORLD, 0, &st,
+                                       NULL, NULL);
+                    med[i] = st.median;
+                }
+            }
+            bench_timer_reduce(&wtimer, MPI_COMM_WORLD, 0, &sts[0], NULL, NULL);
+            sts[1].median = 0;
+            if (do_read)
+                bench_timer_reduce(&rtimer, MPI_COMM_WORLD, 0, &sts[1], NULL,
+                                   NULL);
+            if (rank == 0)
+                print_thread_scaling(nthreads, nthr, nvars, amnt, med,
+                                     sts[0].median, sts[1].median, do_read);
+            free(med);
+        }
+        if (bench_record_write(&rec, out_file)) nerrs++;
     }
 
 err_out:
+    bench_timer_free(&wtimer);
+    bench_timer_free(&rtimer);
+    for (i=0; i<NPHASES; i++)
+        bench_timer_free(&ptimer[i]);
+    for (i=0; i<3; i++) {
+        bench_timer_free(&btimer[i]);
+        bench_timer_free(&ktimer[i]);
+        bench_timer_free(&ltimer[i]);
+    }
+    for (i=0; i<4; i++)
+        bench_timer_free(&gtimer[i]);
+    bench_timer_free(&itimer);
+    bench_timer_free(&vtimer);
+    for (i=0; i<4; i++)
+        bench_timer_free(&ztimer[i]);
+    if (crcs != NULL) free(crcs);
+    for (i=0; i<nthr*2; i++)
+        bench_timer_free(&ttimer[i]);
+    if (ttimer != NULL) free(ttimer);
+    if (tnames != NULL) free(tnames);
+    if (nthreads != NULL) free(nthreads);
+    bench_pvars_free(&pvars);
+    bench_record_free(&rec);
+    if (pvar_prefixes != NULL) free(pvar_prefixes);
+    if (out_file != NULL) free(out_file);
     if (cb_nodes != NULL) free(cb_nodes);
     if (cb_buffer_size != NULL) free(cb_buffer_size);
     MPI_Finalize();
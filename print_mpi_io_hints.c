@@ -10,11 +10,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h> /* getopt() */
 #include <mpi.h>
 
+#include "bench_util.h"
+
 /*
- * Compile command: mpicc -o print_mpi_io_hints print_mpi_io_hints.c
- * Run command: mpiexec -n 1 print_mpi_io_hints input_file
+ * Compile command: mpicc -o print_mpi_io_hints print_mpi_io_hints.c bench_util.c -lm
+ * Run command: mpiexec -n 1 print_mpi_io_hints [-H hints_file] input_file
  *
  * MPI File Info: nkeys = 23
  * MPI File Info: [ 0] key =              cb_buffer_size, flag = 1, valuelen = 8 value = 16777216
@@ -42,33 +45,44 @@
  * MPI File Info: [22] key =       romio_filesystem_type, flag = 1, valuelen = 10 value = CRAY ADIO:
  *  */
 
-#define CHECK_ERR(func) { \
-    if (err != MPI_SUCCESS) { \
-        int errorStringLen; \
-        char errorString[MPI_MAX_ERROR_STRING]; \
-        MPI_Error_string(err, errorString, &errorStringLen); \
-        printf("Error at line %d: calling %s (%s)\n",__LINE__, #func, errorString); \
-    } \
-}
-
 /*----< main() >------------------------------------------------------------*/
 int main(int argc, char **argv) {
-    int      i, err, rank, nkeys;
+    extern int optind;
+    extern char *optarg;
+    char     *hints_file=NULL;
+    int      i, err, nerrs=0, rank, nkeys;
     MPI_File fh;
+    MPI_Info info=MPI_INFO_NULL;
 
     MPI_Init(&argc, &argv);
     err = MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     CHECK_ERR(MPI_Comm_rank);
 
-    if (argc != 2) {
-        printf("Usage: %s filename\n",argv[0]);
+    /* option -H loads user hints from a file of "key value" lines */
+    while (nerrs == 0 && (i = getopt(argc, argv, "hH:")) != EOF)
+        switch(i) {
+            case 'H': hints_file = optarg;
+                      break;
+            case 'h':
+            default:  hints_file = NULL;
+                      nerrs++;
+        }
+
+    if (nerrs > 0 || optind != argc - 1) {
+        if (rank == 0) printf("Usage: %s [-H hints_file] filename\n",argv[0]);
+        MPI_Finalize();
+        return 1;
+    }
+
+    err = bench_hints_load(hints_file, MPI_COMM_WORLD, &info);
+    if (err != 0) {
         MPI_Finalize();
         return 1;
     }
 
     /* create a new file */
-    err = MPI_File_open(MPI_COMM_WORLD, argv[1], MPI_MODE_CREATE | MPI_MODE_RDWR,
-                        MPI_INFO_NULL, &fh);
+    err = MPI_File_open(MPI_COMM_WORLD, argv[optind],
+                        MPI_MODE_CREATE | MPI_MODE_RDWR, info, &fh);
     CHECK_ERR(MPI_File_open);
 
     if (rank == 0) {
@@ -110,6 +124,8 @@ int main(int argc, char **argv) {
     err = MPI_File_close(&fh);
     CHECK_ERR(MPI_File_close);
 
+    if (info != MPI_INFO_NULL) MPI_Info_free(&info);
+
     MPI_Finalize();
-    return 0;
+    return (nerrs > 0);
 }
@@ -0,0 +1,891 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Copyright (C) 2026, Northwestern University
+ * See COPYRIGHT notice in top-level directory.
+ *
+ * This program benchmarks reading a file written by nvars.c, ghost_cell.c,
+ * or fileview_subarray.c, selected by command-line option '-p', with a
+ * decomposition different from the one used to write it. The file consists
+ * of nvars variables stored one after another starting from file offset
+ * disp, each a 3D array of int of ZDIMS x (len * P0) x (len * P1) for
+ * nvars.c and a 2D array of (len * P0) x (len * P1) for the others, where
+ * P0 x P1 is the process grid of the writer, MPI_Dims_create() of its number
+ * of processes given by option '-w'. An array element is the rank of the
+ * writer process owning it, and for fileview_subarray.c, the rank times
+ * len * len plus the index of the element in the local array of the owner.
+ *
+ * The reader reads the variables selected by option '-V', every stride-th
+ * element along the Y and X dimensions, selected by option '-s'. The strided
+ * elements of a variable are partitioned among the reader processes in a 2D
+ * block-block fashion onto the process grid given by option '-P', or by
+ * MPI_Dims_create() of its number of processes if not given. The local
+ * elements of all selected variables are described by one filetype, an
+ * MPI_Type_create_hindexed() of a 3D strided block made of MPI_Type_vector()
+ * and MPI_Type_create_hvector(), and read into a contiguous buffer by the
+ * engines selected by option '-e'.
+ *     coll     - MPI_File_read_all()
+ *     indep    - MPI_File_read() with hint romio_ds_read set to enable, i.e.
+ *                data sieving, ignored by MPI-IO libraries other than ROMIO
+ *     mmap     - mmap() of the file and a strided gather of the local
+ *                elements by each process, bypassing MPI-IO
+ *     zerocopy - mmap() of the file and a view of the local elements in
+ *                place, i.e. a pointer into the mapping to each 2D slab of
+ *                the local elements, without copying. This is possible only
+ *                when the slab is contiguous in the file and aligned to int,
+ *                i.e. stride 1 and the process grid of the reader has one
+ *                process along X, e.g. '-P nprocs,1'. Otherwise, the process
+ *                falls back to the strided gather of engine mmap. The mapping
+ *                covers only the slabs and is populated by mmap() with flag
+ *                MAP_POPULATE, so the pages are resident when the view is
+ *                returned. As the view is valid only while mapped, its
+ *                contents are checked by an additional untimed run.
+ * The mmap engines require the file to be accessible by all processes
+ * through the POSIX interface, e.g. for post-processing on a single node.
+ * Engines coll and indep open the file on each of the communicators
+ * selected by option '-c', MPI_COMM_WORLD, the shared-memory communicator of
+ * the processes on the same compute node found by MPI_Comm_split_type(), and
+ * MPI_COMM_SELF, with the same filetype.
+ *
+ * Each timed run of an engine includes the file open and close, the setting
+ * of the file view or the mapping of the file, and the read. The buffer is
+ * filled with -1 before each run, untimed, and checked after the last run.
+ * Timings of repeated runs are those of reading from the page cache, unless
+ * the cache is dropped between runs externally.
+ *
+ * To compile:
+ *   % mpicc -O2 read_bench.c bench_util.c -o read_bench -lm
+ *
+ * Example run command and output on screen, reading the file written by
+ *   % mpiexec -n 4 ./nvars -n 4 -l 100 -f testfile
+ * using 3 processes, variables 1 and 3, and every other element:
+ *   % mpiexec -n 3 ./read_bench -w 4 -n 4 -l 100 -V 1,3 -s 2 -N 5 -f testfile
+ *   Writer:                        nvars.c, 4 processes (2 x 2)
+ *   Global variable shape:         2 x 200 x 200 (int), 4 variables
+ *   Reader process grid:           3 x 1
+ *   Variables read:                2 of 4
+ *   Stride along Y and X:          2
+ *   Processes with zero-copy view: 0 of 3
+ *   Total read amount:             160000 B, 0.15 MB, 0.00 GB
+ *   ---- collective read (read_all), MPI_COMM_WORLD: 0 warmup, 5 timed runs, 0.15 MiB per run
+ *        time (max of ranks) min=0.043497 median=0.044251 max=0.076738 stddev=0.013001 sec
+ *        time (all ranks)    min=0.043430 median=0.044118 max=0.076738 stddev=0.013014 sec
+ *        bandwidth           min=1.99 median=3.45 max=3.51 MiB/sec
+ *   ---- independent read, data sieving, MPI_COMM_WORLD: 0 warmup, 5 timed runs, 0.15 MiB per run
+ *        time (max of ranks) min=0.002426 median=0.004490 max=0.008260 stddev=0.002125 sec
+ *        time (all ranks)    min=0.002223 median=0.004481 max=0.008260 stddev=0.002147 sec
+ *        bandwidth           min=18.47 median=33.98 max=62.89 MiB/sec
+ *   ---- mmap + strided gather: 0 warmup, 5 timed runs, 0.15 MiB per run
+ *        time (max of ranks) min=0.000065 median=0.000065 max=0.000110 stddev=0.000019 sec
+ *        time (all ranks)    min=0.000061 median=0.000064 max=0.000110 stddev=0.000014 sec
+ *        bandwidth           min=1388.64 median=2339.30 max=2354.68 MiB/sec
+ *   ...
+ *
+ * Reading variables 1 and 2 of the same file with 4 processes of row blocks,
+ * so each process views its slabs in place, compared with the collective
+ * reads on MPI_COMM_SELF and on the node communicator:
+ *   % mpiexec -n 4 ./read_bench -w 4 -n 4 -l 100 -V 1,2 -P 4,1 -e coll,zerocopy -c self,node -N 5 -f testfile
+ *   ...
+ *   Processes with zero-copy view: 4 of 4
+ *   Total read amount:             640000 B, 0.61 MB, 0.00 GB
+ *   ---- collective read (read_all), MPI_COMM_SELF: 0 warmup, 5 timed runs, 0.61 MiB per run
+ *        time (max of ranks) min=0.000935 median=0.001266 max=0.001577 stddev=0.000230 sec
+ *        time (all ranks)    min=0.000147 median=0.000758 max=0.001577 stddev=0.000421 sec
+ *        bandwidth           min=387.05 median=482.10 max=652.98 MiB/sec
+ *   ---- collective read (read_all), node comm: 0 warmup, 5 timed runs, 0.61 MiB per run
+ *        time (max of ranks) min=0.001405 median=0.001895 max=0.002832 stddev=0.000482 sec
+ *        time (all ranks)    min=0.001172 median=0.001796 max=0.002832 stddev=0.000399 sec
+ *        bandwidth           min=215.53 median=322.04 max=434.49 MiB/sec
+ *   ---- mmap zero-copy view: 0 warmup, 5 timed runs, 0.61 MiB per run
+ *        time (max of ranks) min=0.000041 median=0.000050 max=0.000087 stddev=0.000017 sec
+ *        time (all ranks)    min=0.000036 median=0.000041 max=0.000087 stddev=0.000012 sec
+ *        bandwidth           min=7030.08 median=12225.12 max=14900.07 MiB/sec
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>    /* strcpy(), strtok(), strerror() */
+#include <unistd.h>    /* getopt(), sysconf(), close() */
+#include <errno.h>     /* errno */
+#include <sys/types.h> /* open() */
+#include <sys/stat.h>  /* open() */
+#include <fcntl.h>     /* open() */
+#include <sys/mman.h>  /* mmap(), munmap() */
+
+#include <mpi.h>
+
+#include "bench_util.h"
+
+/* size of Z dimension of variables written by nvars.c */
+#define ZDIMS 2
+
+/* formats of the files to read */
+#define FMT_NVARS      0  /* nvars.c */
+#define FMT_GHOST_CELL 1  /* ghost_cell.c */
+#define FMT_SUBARRAY   2  /* fileview_subarray.c */
+#define NFMTS          3
+static const char *fmt_names[NFMTS] = {"nvars", "ghost_cell",
+    "fileview_subarray"};
+
+/* read engines */
+#define ENG_COLL  0  /* MPI_File_read_all() */
+#define ENG_INDEP 1  /* MPI_File_read() with data sieving */
+#define ENG_MMAP  2  /* mmap() and strided gather */
+#define ENG_ZCOPY 3  /* mmap() and view in place */
+#define NENGINES  4
+static const char *engine_names[NENGINES] = {"coll", "indep", "mmap",
+    "zerocopy"};
+static const char *timer_names[NENGINES] = {"collective read (read_all)",
+    "independent read, data sieving", "mmap + strided gather",
+    "mmap zero-copy view"};
+
+/* communicators of engines coll and indep */
+#define COMM_WORLD 0
+#define COMM_NODE  1  /* processes on the same compute node */
+#define COMM_SELF  2
+#define NCOMMS     3
+static const char *comm_names[NCOMMS] = {"world", "node", "self"};
+static const char *comm_labels[NCOMMS] = {"MPI_COMM_WORLD", "node comm",
+    "MPI_COMM_SELF"};
+
+/* max number of timed engine and communicator pairs */
+#define MAX_RUNS (2 * NCOMMS + 2)
+
+#ifndef MAP_POPULATE
+#define MAP_POPULATE 0
+#endif
+
+static int verbose;
+
+/* geometry of the file and of the local elements read by this process */
+typedef struct {
+    int        fmt;        /* FMT_XXX */
+    int        zdims;      /* size of Z dimension of a variable */
+    int        len;        /* local Y and X size of a writer process */
+    int        wpsizes[2]; /* writer process grid */
+    int        gsizes[2];  /* global Y and X sizes of a variable */
+    int        nsel;       /* number of variables read */
+    int       *vars;       /* [nsel] IDs of variables read, increasing */
+    int        stride;     /* stride along Y and X */
+    int        starts[2];  /* first local element, in strided indices */
+    int        counts[2];  /* number of local elements along Y and X */
+    MPI_Offset disp;       /* file offset of the first variable */
+    MPI_Offset var_size;   /* size in bytes of a variable */
+    long long  nelems;     /* number of local elements of all variables */
+} geometry;
+
+/* mappings of the file holding the zero-copy views of the 2D slabs */
+typedef struct {
+    int         fd;
+    int         nmaps;  /* number of mappings of merged adjacent slabs */
+    char      **bases;  /* [nmaps] start addresses of mappings */
+    size_t     *sizes;  /* [nmaps] sizes in bytes of mappings */
+    const int **views;  /* [nsel * zdims] local slabs in the mappings */
+} zcopy_views;
+
+/*----< int_compare() >------------------------------------------------------*/
+static int
+int_compare(const void *a, const void *b)
+{
+    return (*(const int*)a > *(const int*)b) - (*(const int*)a < *(const int*)b);
+}
+
+/*----< partition() >--------------------------------------------------------*/
+/* Block partition of n elements among np processes, as even as possible */
+static void
+partition(int n, int np, int p, int *start, int *count)
+{
+    *count = n / np + ((p < n % np) ? 1 : 0);
+    *start = p * (n / np) + ((p < n % np) ? p : n % np);
+}
+
+/*----< elem_offset() >------------------------------------------------------*/
+/* File offset of local element [z][i][j] of the k-th variable read */
+static MPI_Offset
+elem_offset(const geometry *g, int k, int z, int i, int j)
+{
+    MPI_Offset y = (MPI_Offset)(g->starts[0] + i) * g->stride;
+    MPI_Offset x = (MPI_Offset)(g->starts[1] + j) * g->stride;
+
+    return g->disp + g->vars[k] * g->var_size +
+           ((z * (MPI_Offset)g->gsizes[0] + y) * g->gsizes[1] + x) * sizeof(int);
+}
+
+/*----< create_fileType() >--------------------------------------------------*/
+/* The filetype of the local elements of all variables read, whose offsets
+ * are relative to g->disp.
+ */
+static int
+create_fileType(const geometry *g, MPI_Datatype *fileType)
+{
+    int i, err, nerrs=0, *blocklens;
+    MPI_Aint *disps;
+    MPI_Datatype rowType, planeType, varType;
+
+    /* every stride-th element of a row */
+    err = MPI_Type_vector(g->counts[1], 1, g->stride, MPI_INT, &rowType);
+    ERR
+    /* every stride-th row of a plane */
+    err = MPI_Type_create_hvector(g->counts[0], 1, (MPI_Aint)g->stride *
+                                  g->gsizes[1] * sizeof(int), rowType,
+                                  &planeType);
+    ERR
+    /* all planes of a variable */
+    err = MPI_Type_create_hvector(g->zdims, 1, (MPI_Aint)g->gsizes[0] *
+                                  g->gsizes[1] * sizeof(int), planeType,
+                                  &varType);
+    ERR
+
+    blocklens = (int*) malloc(sizeof(int) * g->nsel);
+    disps = (MPI_Aint*) malloc(sizeof(MPI_Aint) * g->nsel);
+    for (i=0; i<g->nsel; i++) {
+        blocklens[i] = 1;
+        disps[i] = elem_offset(g, i, 0, 0, 0) - g->disp;
+    }
+    err = MPI_Type_create_hindexed(g->nsel, blocklens, disps, varType,
+                                   fileType);
+    free(blocklens);
+    free(disps);
+    ERR
+    err = MPI_Type_commit(fileType);
+    ERR
+
+    MPI_Type_free(&varType);
+    MPI_Type_free(&planeType);
+    MPI_Type_free(&rowType);
+
+err_out:
+    return nerrs;
+}
+
+/*----< read_mpi() >---------------------------------------------------------*/
+/* Open the file, set the file view, read the local elements collectively or
+ * independently, and close the file.
+ */
+static int
+read_mpi(MPI_Comm comm, const char *filename, MPI_Info info,
+         const geometry *g, MPI_Datatype fileType, int *buf, int collective)
+{
+    int err, nerrs=0;
+    MPI_File fh;
+    MPI_Status status;
+
+    err = MPI_File_open(comm, filename, MPI_MODE_RDONLY, info, &fh);
+    ERR
+    err = MPI_File_set_view(fh, g->disp, MPI_INT, fileType, "native", info);
+    ERR
+    if (collective)
+        err = MPI_File_read_all(fh, buf, (int)g->nelems, MPI_INT, &status);
+    else
+        err = MPI_File_read(fh, buf, (int)g->nelems, MPI_INT, &status);
+    ERR
+    err = MPI_File_close(&fh);
+    ERR
+
+err_out:
+    return nerrs;
+}
+
+/*----< read_mmap() >--------------------------------------------------------*/
+/* Map the file range of the variables read and copy the local elements into
+ * buf. This is an independent call.
+ */
+static int
+read_mmap(const char *filename, const geometry *g, int *buf)
+{
+    int fd, k, z, i, j, nerrs=0;
+    char *base;
+    size_t size;
+    off_t lo, hi;
+
+    if (g->nelems == 0) return 0;
+
+    /* map from the page containing the first variable read to the end of
+     * the last variable read
+     */
+    lo = g->disp + g->vars[0] * g->var_size;
+    lo -= lo % sysconf(_SC_PAGESIZE);
+    hi = g->disp + (g->vars[g->nsel-1] + 1) * g->var_size;
+    size = hi - lo;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        printf("Error at line %d: open %s (%s)\n", __LINE__, filename,
+               strerror(errno));
+        return 1;
+    }
+    base = (char*) mmap(NULL, size, PROT_READ, MAP_SHARED, fd, lo);
+    if (base == MAP_FAILED) {
+        printf("Error at line %d: mmap %s (%s)\n", __LINE__, filename,
+               strerror(errno));
+        close(fd);
+        return 1;
+    }
+
+    /* the file offset of an element need not be aligned to int */
+    for (k=0; k<g->nsel; k++)
+        for (z=0; z<g->zdims; z++)
+            for (i=0; i<g->counts[0]; i++) {
+                const char *row = base + (elem_offset(g, k, z, i, 0) - lo);
+                for (j=0; j<g->counts[1]; j++) {
+                    memcpy(buf, row, sizeof(int));
+                    row += g->stride * sizeof(int);
+                    buf++;
+                }
+            }
+
+    if (munmap(base, size) != 0) {
+        printf("Error at line %d: munmap %s (%s)\n", __LINE__, filename,
+               strerror(errno));
+        nerrs++;
+    }
+    close(fd);
+
+    return nerrs;
+}
+
+/*----< zcopy_possible() >---------------------------------------------------*/
+/* Whether each 2D slab of the local elements is contiguous in the file and
+ * aligned to int, so it can be viewed in place
+ */
+static int
+zcopy_possible(const geometry *g)
+{
+    return (g->nelems > 0 && g->stride == 1 && g->counts[1] == g->gsizes[1] &&
+            g->disp % sizeof(int) == 0);
+}
+
+/*----< zcopy_map() >--------------------------------------------------------*/
+/* Map the slabs of the local elements, merging the adjacent ones into one
+ * mapping, and set the views to them. This is an independent call.
+ */
+static int
+zcopy_map(const char *filename, const geometry *g, zcopy_views *zc)
+{
+    int k, z, nslabs;
+    off_t *lo, *hi, slab_size, pagesize = sysconf(_SC_PAGESIZE);
+
+    nslabs = g->nsel * g->zdims;
+    slab_size = (off_t)g->counts[0] * g->counts[1] * sizeof(int);
+
+    zc->nmaps = 0;
+    zc->bases = (char**) malloc(sizeof(char*) * nslabs);
+    zc->sizes = (size_t*) malloc(sizeof(size_t) * nslabs);
+    zc->views = (const int**) malloc(sizeof(int*) * nslabs);
+    lo = (off_t*) malloc(sizeof(off_t) * nslabs * 2);
+    hi = lo + nslabs;
+
+    /* file ranges of the mappings, from the page containing the first slab */
+    for (k=0; k<g->nsel; k++)
+        for (z=0; z<g->zdims; z++) {
+            off_t off = elem_offset(g, k, z, 0, 0);
+            if (zc->nmaps == 0 || off != hi[zc->nmaps-1]) {
+                lo[zc->nmaps] = off - off % pagesize;
+                zc->nmaps++;
+            }
+            hi[zc->nmaps-1] = off + slab_size;
+        }
+
+    zc->fd = open(filename, O_RDONLY);
+    if (zc->fd < 0) {
+        printf("Error at line %d: open %s (%s)\n", __LINE__, filename,
+               strerror(errno));
+        zc->nmaps = 0;
+        free(lo);
+        return 1;
+    }
+    for (k=0; k<zc->nmaps; k++) {
+        zc->sizes[k] = hi[k] - lo[k];
+        zc->bases[k] = (char*) mmap(NULL, zc->sizes[k], PROT_READ,
+                                    MAP_SHARED | MAP_POPULATE, zc->fd, lo[k]);
+        if (zc->bases[k] == MAP_FAILED) {
+            printf("Error at line %d: mmap %s (%s)\n", __LINE__, filename,
+                   strerror(errno));
+            zc->nmaps = k;
+            free(lo);
+            return 1;
+        }
+    }
+
+    /* views of the slabs in place */
+    for (k=0; k<nslabs; k++) {
+        off_t off = elem_offset(g, k / g->zdims, k % g->zdims, 0, 0);
+        for (z=0; hi[z] <= off; z++);
+        zc->views[k] = (const int*)(zc->bases[z] + (off - lo[z]));
+    }
+    free(lo);
+    return 0;
+}
+
+/*----< zcopy_unmap() >------------------------------------------------------*/
+static int
+zcopy_unmap(zcopy_views *zc)
+{
+    int k, nerrs=0;
+
+    for (k=0; k<zc->nmaps; k++)
+        if (munmap(zc->bases[k], zc->sizes[k]) != 0) {
+            printf("Error at line %d: munmap (%s)\n", __LINE__,
+                   strerror(errno));
+            nerrs++;
+        }
+    if (zc->fd >= 0) close(zc->fd);
+    free(zc->bases);
+    free(zc->sizes);
+    free(zc->views);
+    return nerrs;
+}
+
+/*----< expect() >-----------------------------------------------------------*/
+/* Value written to global element [y][x] of a variable */
+static int
+expect(const geometry *g, int y, int x)
+{
+    int owner = (y / g->len) * g->wpsizes[1] + x / g->len;
+
+    if (g->fmt == FMT_SUBARRAY)
+        return owner * g->len * g->len + (y % g->len) * g->len + x % g->len;
+    return owner;
+}
+
+/*----< check_slab() >-------------------------------------------------------*/
+/* Check the local elements of plane z of the k-th variable read */
+static int
+check_slab(const geometry *g, int k, int z, const int *buf, const char *engine)
+{
+    int i, j, rank;
+
+    for (i=0; i<g->counts[0]; i++)
+        for (j=0; j<g->counts[1]; j++) {
+            int y = (g->starts[0] + i) * g->stride;
+            int x = (g->starts[1] + j) * g->stride;
+            int exp = expect(g, y, x);
+            if (*buf != exp) {
+                MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+                printf("Error: rank %d engine %s var %d [%d][%d][%d] expect %d but got %d\n",
+                       rank, engine, g->vars[k], z, y, x, exp, *buf);
+                return 1;
+            }
+            buf++;
+        }
+    return 0;
+}
+
+/*----< check_buf() >--------------------------------------------------------*/
+static int
+check_buf(const geometry *g, const int *buf, const char *engine)
+{
+    int k, z;
+
+    for (k=0; k<g->nsel; k++)
+        for (z=0; z<g->zdims; z++) {
+            if (check_slab(g, k, z, buf, engine)) return 1;
+            buf += g->counts[0] * g->counts[1];
+        }
+    return 0;
+}
+
+/*----< parse_names() >----------------------------------------------------*/
+/* Parse a comma-separated list of names into their indices in names[] */
+static int
+parse_names(char *list, const char **names, int nnames, int *ids)
+{
+    int i, n=0;
+    char *tok;
+
+    for (tok=strtok(list, ","); tok!=NULL; tok=strtok(NULL, ",")) {
+        for (i=0; i<nnames; i++)
+            if (!strcmp(tok, names[i])) break;
+        if (i == nnames || n == nnames) return -1;
+        ids[n++] = i;
+    }
+    return n;
+}
+
+/*----< usage() >------------------------------------------------------------*/
+static void
+usage(char *argv0)
+{
+    char *help =
+    "Usage: %s [-hv | -p format | -w num | -n num | -l len | -d disp |\n"
+    "       -V list | -s stride | -P py,px | -e list | -c list | -W num |\n"
+    "       -N num | -o file | -H file] -f file_name\n"
+    "       [-h] Print this help\n"
+    "       [-v] verbose mode\n"
+    "       [-p format] program that wrote the file, nvars, ghost_cell, or\n"
+    "                   fileview_subarray (default: nvars)\n"
+    "       [-w num] number of processes of the writer (default: number of\n"
+    "                processes of the reader)\n"
+    "       [-n num] number of variables in the file, -n of nvars or ghost_cell\n"
+    "                (default: 2 for nvars, 1 for the others)\n"
+    "       [-l len] local X and Y dimension sizes of the writer, -l of nvars\n"
+    "                or ghost_cell (default: 10 for nvars and\n"
+    "                fileview_subarray, 4 for ghost_cell)\n"
+    "       [-d disp] file offset of the first variable (default: 10 for\n"
+    "                 ghost_cell, 0 for the others)\n"
+    "       [-V list] IDs of variables to read (default: all)\n"
+    "       [-s stride] read every stride-th element along Y and X (default: 1)\n"
+    "       [-P py,px] reader process grid (default: MPI_Dims_create)\n"
+    "       [-e list] engines, comma-separated names of coll, indep, mmap, and\n"
+    "                 zerocopy (default: all)\n"
+    "       [-c list] communicators of engines coll and indep, comma-separated\n"
+    "                 names of world, node, and self (default: world)\n"
+    "       [-W num] number of untimed warmup runs (default: %d)\n"
+    "       [-N num] number of timed repetitions (default: %d)\n"
+    "       [-o file] append results as a line of JSON to file\n"
+    "       [-H file] load MPI-IO hints from file of \"key value\" lines\n"
+    "        -f filename: input file name\n"
+    "        list is comma-separated values or ranges lo:hi[:factor]\n";
+    fprintf(stderr, help, argv0, BENCH_NWARMUP, BENCH_NREPS);
+}
+
+/*----< main() >------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    extern int optind;
+    extern char *optarg;
+    char filename[256], *hints_file=NULL, *out_file=NULL;
+    char *var_list=NULL, *engine_list=NULL, *comm_list=NULL, *grid=NULL;
+    char str[64], run_names[MAX_RUNS][64];
+    int i, j, rank, nprocs, err, nerrs=0, nwarmup, nreps, fmt, wprocs;
+    int nvars, len, stride, rpsizes[2], nengines, engines[NENGINES];
+    int ncomms, comms[NCOMMS], nruns, run_engine[MAX_RUNS], run_comm[MAX_RUNS];
+    int *buf=NULL, nsel, zcopy, nzcopy;
+    long long *sel=NULL, disp;
+    double amnt;
+    geometry g;
+    bench_timer timer[MAX_RUNS];
+    bench_record rec;
+    zcopy_views zc;
+    MPI_Offset fsize;
+    MPI_Datatype fileType=MPI_DATATYPE_NULL;
+    MPI_Comm comm[NCOMMS];
+    MPI_File fh;
+    MPI_Info info=MPI_INFO_NULL, ds_info=MPI_INFO_NULL;
+
+    MPI_Init(&argc,&argv);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    verbose     = 0;
+    fmt         = FMT_NVARS;
+    wprocs      = nprocs;
+    nvars       = -1;
+    len         = -1;
+    disp        = -1;
+    stride      = 1;
+    rpsizes[0]  = rpsizes[1] = 0;
+    nwarmup     = BENCH_NWARMUP;
+    nreps       = BENCH_NREPS;
+    filename[0] = '\0';
+    nruns       = 0;
+    g.vars      = NULL;
+    comm[COMM_WORLD] = MPI_COMM_WORLD;
+    comm[COMM_NODE]  = MPI_COMM_NULL;
+    comm[COMM_SELF]  = MPI_COMM_SELF;
+
+    /* get command-line arguments */
+    while ((i = getopt(argc, argv, "hvp:w:n:l:d:V:s:P:e:c:W:N:o:H:f:")) != EOF)
+        switch(i) {
+            case 'v': verbose = 1;
+                      break;
+            case 'p': for (fmt=0; fmt<NFMTS; fmt++)
+                          if (!strcmp(optarg, fmt_names[fmt])) break;
+                      if (fmt == NFMTS) {
+                          if (rank==0) usage(argv[0]);
+                          MPI_Finalize();
+                          return 1;
+                      }
+                      break;
+            case 'w': wprocs = atoi(optarg);
+                      break;
+            case 'n': nvars = atoi(optarg);
+                      break;
+            case 'l': len = atoi(optarg);
+                      break;
+            case 'd': disp = atoll(optarg);
+                      break;
+            case 'V': var_list = optarg;
+                      break;
+            case 's': stride = atoi(optarg);
+                      break;
+            case 'P': grid = optarg;
+                      break;
+            case 'e': engine_list = optarg;
+                      break;
+            case 'c': comm_list = optarg;
+                      break;
+            case 'W': nwarmup = atoi(optarg);
+                      break;
+            case 'N': nreps = atoi(optarg);
+                      break;
+            case 'o': out_file = optarg;
+                      break;
+            case 'H': hints_file = optarg;
+                      break;
+            case 'f': strcpy(filename, optarg);
+                      break;
+            case 'h':
+            default:  if (rank==0) usage(argv[0]);
+                      MPI_Finalize();
+                      return 1;
+        }
+
+    if (filename[0] == '\0' || wprocs <= 0 || stride <= 0) {
+        if (rank==0) usage(argv[0]);
+        MPI_Finalize();
+        return 1;
+    }
+
+    /* defaults of the writer programs */
+    if (nvars <= 0) nvars = (fmt == FMT_NVARS) ? 2 : 1;
+    if (len   <= 0) len   = (fmt == FMT_GHOST_CELL) ? 4 : 10;
+    if (disp  <  0) disp  = (fmt == FMT_GHOST_CELL) ? 10 : 0;
+
+    bench_record_init(&rec, MPI_COMM_WORLD, "read_bench");
+
+    /* geometry of the file */
+    g.fmt = fmt;
+    g.zdims = (fmt == FMT_NVARS) ? ZDIMS : 1;
+    g.len = len;
+    g.wpsizes[0] = g.wpsizes[1] = 0;
+    MPI_Dims_create(wprocs, 2, g.wpsizes);
+    g.gsizes[0] = len * g.wpsizes[0];
+    g.gsizes[1] = len * g.wpsizes[1];
+    g.var_size = (MPI_Offset)g.zdims * g.gsizes[0] * g.gsizes[1] * sizeof(int);
+    g.disp = disp;
+    g.stride = stride;
+
+    /* variables to read, sorted in increasing order for the file view */
+    if (var_list == NULL) {
+        nsel = nvars;
+        sel = (long long*) malloc(sizeof(long long) * nsel);
+        for (i=0; i<nsel; i++) sel[i] = i;
+    }
+    else
+        nsel = bench_parse_list(var_list, &sel);
+    if (nsel <= 0) {
+        if (rank == 0)
+            printf("Error: invalid list of command-line option '-V'\n");
+        nerrs++;
+        goto err_out;
+    }
+    g.vars = (int*) malloc(sizeof(int) * nsel);
+    for (i=0; i<nsel; i++) {
+        if (sel[i] < 0 || sel[i] >= nvars) {
+            if (rank == 0)
+                printf("Error: variable ID %lld of command-line option '-V' not in [0, %d)\n",
+                       sel[i], nvars);
+            nerrs++;
+            goto err_out;
+        }
+        g.vars[i] = sel[i];
+    }
+    qsort(g.vars, nsel, sizeof(int), int_compare);
+    for (g.nsel=0, i=0; i<nsel; i++)
+        if (g.nsel == 0 || g.vars[g.nsel-1] != g.vars[i])
+            g.vars[g.nsel++] = g.vars[i];
+
+    /* reader process grid */
+    if (grid != NULL &&
+        (sscanf(grid, "%d,%d", &rpsizes[0], &rpsizes[1]) != 2 ||
+         rpsizes[0] <= 0 || rpsizes[1] <= 0 ||
+         rpsizes[0] * rpsizes[1] != nprocs)) {
+        if (rank == 0)
+            printf("Error: process grid '%s' of command-line option '-P' does not match %d processes\n",
+                   grid, nprocs);
+        nerrs++;
+        goto err_out;
+    }
+    MPI_Dims_create(nprocs, 2, rpsizes);
+
+    /* partition the strided elements among reader processes */
+    partition((g.gsizes[0] + stride - 1) / stride, rpsizes[0],
+              rank / rpsizes[1], &g.starts[0], &g.counts[0]);
+    partition((g.gsizes[1] + stride - 1) / stride, rpsizes[1],
+              rank % rpsizes[1], &g.starts[1], &g.counts[1]);
+    g.nelems = (long long)g.nsel * g.zdims * g.counts[0] * g.counts[1];
+    zcopy = zcopy_possible(&g);
+    if (verbose)
+        printf("rank %2d: starts = %d %d counts = %d %d (strided) zero-copy = %s\n",
+               rank, g.starts[0], g.starts[1], g.counts[0], g.counts[1],
+               (zcopy) ? "yes" : "no");
+
+    /* engines and communicators to run */
+    if (engine_list == NULL) {
+        nengines = NENGINES;
+        for (i=0; i<NENGINES; i++) engines[i] = i;
+    }
+    else
+        nengines = parse_names(engine_list, engine_names, NENGINES, engines);
+    if (comm_list == NULL) {
+        ncomms = 1;
+        comms[0] = COMM_WORLD;
+    }
+    else
+        ncomms = parse_names(comm_list, comm_names, NCOMMS, comms);
+    if (nengines <= 0 || ncomms <= 0) {
+        if (rank == 0)
+            printf("Error: invalid list of command-line option '%s'\n",
+                   (nengines <= 0) ? "-e" : "-c");
+        nerrs++;
+        goto err_out;
+    }
+    for (i=0; i<nengines; i++) {
+        if (engines[i] == ENG_COLL || engines[i] == ENG_INDEP) {
+            for (j=0; j<ncomms; j++) {
+                run_engine[nruns] = engines[i];
+                run_comm[nruns] = comms[j];
+                snprintf(run_names[nruns], 64, "%s, %s",
+                         timer_names[engines[i]], comm_labels[comms[j]]);
+                nruns++;
+            }
+        }
+        else {
+            run_engine[nruns] = engines[i];
+            run_comm[nruns] = COMM_SELF;
+            snprintf(run_names[nruns], 64, "%s", timer_names[engines[i]]);
+            nruns++;
+        }
+    }
+    for (i=0; i<nruns; i++)
+        bench_timer_init(&timer[i], run_names[i], nwarmup, nreps);
+
+    err = MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank,
+                              MPI_INFO_NULL, &comm[COMM_NODE]);
+    ERR
+
+    /* load user I/O hints from the hint file, if given */
+    if (bench_hints_load(hints_file, MPI_COMM_WORLD, &info) != 0) {
+        nerrs++;
+        goto err_out;
+    }
+
+    /* the file must be large enough for the variables of the writer */
+    err = MPI_File_open(MPI_COMM_WORLD, filename, MPI_MODE_RDONLY, info, &fh);
+    ERR
+    err = bench_record_hints(&rec, fh);
+    ERR
+    if (hints_file != NULL) {
+        err = bench_hints_print(fh, MPI_COMM_WORLD);
+        ERR
+    }
+    err = MPI_File_get_size(fh, &fsize);
+    ERR
+    err = MPI_File_close(&fh);
+    ERR
+    if (fsize < g.disp + nvars * g.var_size) {
+        if (rank == 0)
+            printf("Error: file size %lld is less than expected %lld, check options -p -w -n -l -d\n",
+                   fsize, g.disp + nvars * g.var_size);
+        nerrs++;
+        goto err_out;
+    }
+
+    /* data sieving for the independent reads */
+    if (info == MPI_INFO_NULL)
+        MPI_Info_create(&ds_info);
+    else
+        MPI_Info_dup(info, &ds_info);
+    MPI_Info_set(ds_info, "romio_ds_read", "enable");
+
+    err = create_fileType(&g, &fileType);
+    if (err != 0) {
+        nerrs++;
+        goto err_out;
+    }
+
+    buf = (int*) malloc(sizeof(int) * (g.nelems + 1));
+
+    for (j=0; j<nruns; j++) {
+        int e = run_engine[j];
+        for (i=0; i<nwarmup+nreps; i++) {
+            long long k;
+            for (k=0; k<g.nelems; k++) buf[k] = -1;
+
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&timer[j]);
+            if (e == ENG_ZCOPY && zcopy) {
+                nerrs += zcopy_map(filename, &g, &zc);
+                nerrs += zcopy_unmap(&zc);
+            }
+            else if (e == ENG_MMAP || e == ENG_ZCOPY)
+                nerrs += read_mmap(filename, &g, buf);
+            else {
+                err = read_mpi(comm[run_comm[j]], filename,
+                               (e == ENG_INDEP) ? ds_info : info, &g,
+                               fileType, buf, (e == ENG_COLL));
+                if (err != 0) {
+                    nerrs++;
+                    goto err_out;
+                }
+            }
+            bench_timer_stop(&timer[j]);
+        }
+
+        if (e == ENG_ZCOPY && zcopy) {
+            /* check the views by an additional untimed run */
+            err = zcopy_map(filename, &g, &zc);
+            for (i=0; err == 0 && i<g.nsel*g.zdims; i++)
+                err = check_slab(&g, i / g.zdims, i % g.zdims, zc.views[i],
+                                 engine_names[e]);
+            nerrs += err + zcopy_unmap(&zc);
+        }
+        else
+            nerrs += check_buf(&g, buf, engine_names[e]);
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, &nerrs, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    if (nerrs > 0) goto err_out;
+
+    amnt = (double)g.nelems * sizeof(int);
+    MPI_Allreduce(MPI_IN_PLACE, &amnt, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(&zcopy, &nzcopy, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+    bench_record_str(&rec, "format", fmt_names[fmt]);
+    bench_record_int(&rec, "writer_nprocs", wprocs);
+    bench_record_int(&rec, "nvars", nvars);
+    bench_record_int(&rec, "len", len);
+    bench_record_int(&rec, "disp", disp);
+    bench_record_int(&rec, "nvars_read", g.nsel);
+    bench_record_int(&rec, "stride", stride);
+    snprintf(str, sizeof(str), "%d,%d", rpsizes[0], rpsizes[1]);
+    bench_record_str(&rec, "reader_grid", str);
+    bench_record_int(&rec, "zero_copy_procs", nzcopy);
+
+    if (rank == 0) {
+        printf("Writer:                        %s.c, %d processes (%d x %d)\n",
+               fmt_names[fmt], wprocs, g.wpsizes[0], g.wpsizes[1]);
+        if (fmt == FMT_NVARS)
+            printf("Global variable shape:         %d x %d x %d (int), %d variables\n",
+                   g.zdims, g.gsizes[0], g.gsizes[1], nvars);
+        else
+            printf("Global variable shape:         %d x %d (int), %d variables\n",
+                   g.gsizes[0], g.gsizes[1], nvars);
+        printf("Reader process grid:           %d x %d\n", rpsizes[0],
+               rpsizes[1]);
+        printf("Variables read:                %d of %d\n", g.nsel, nvars);
+        printf("Stride along Y and X:          %d\n", stride);
+        printf("Processes with zero-copy view: %d of %d\n", nzcopy, nprocs);
+        printf("Total read amount:             %.0f B, %.2f MB, %.2f GB\n",
+               amnt, amnt / 1048576.0, amnt / 1073741824.0);
+    }
+    for (j=0; j<nruns; j++)
+        bench_timer_report(&timer[j], MPI_COMM_WORLD, amnt, &rec);
+
+    if (bench_record_write(&rec, out_file)) nerrs++;
+
+err_out:
+    bench_record_free(&rec);
+    for (i=0; i<nruns; i++)
+        bench_timer_free(&timer[i]);
+    if (comm[COMM_NODE] != MPI_COMM_NULL) MPI_Comm_free(&comm[COMM_NODE]);
+    if (fileType != MPI_DATATYPE_NULL) MPI_Type_free(&fileType);
+    if (info != MPI_INFO_NULL) MPI_Info_free(&info);
+    if (ds_info != MPI_INFO_NULL) MPI_Info_free(&ds_info);
+    if (sel != NULL) free(sel);
+    if (g.vars != NULL) free(g.vars);
+    if (buf != NULL) free(buf);
+    MPI_Finalize();
+    return (nerrs > 0);
+}
@@ -0,0 +1,526 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Copyright (C) 2026, Northwestern University
+ * See COPYRIGHT notice in top-level directory.
+ *
+ * This program measures the pattern of a history file of a time-series
+ * simulation, which appends many small records to one file, instead of
+ * writing one snapshot. The file has the layout of the record variables of a
+ * netCDF file along its unlimited dimension: record r consists of nvars 2D
+ * variables, one after another, each a global array of 'int' partitioned
+ * among processes in a 2D block-block fashion as in nvars.c, and starts at
+ * file offset r * record_size. The subarrays of the variables of a record are
+ * concatenated into one filetype, whose extent is the record size, so the
+ * file view of consecutive records is a tiling of the filetype.
+ *
+ * Each run starts from an empty file, deleted and created as NC_CLOBBER does
+ * in tests/mpi_create_delete_loop.c, and appends '-R num' records by one of
+ * the modes below, selected by command-line option '-m list'.
+ *     keep   - the file is opened once, and each record is written by
+ *              MPI_File_set_view() to the offset of the record followed by
+ *              MPI_File_write_all(), the way netCDF libraries reset the file
+ *              view per call
+ *     reopen - the file is opened, the view set, the record written, and the
+ *              file closed for each record
+ *     batch  - the file is opened once, and '-b num' records are written by
+ *              each MPI_File_write_all() of a view set at the first record
+ *              of the batch
+ *
+ * The latency of each collective call, including the set view, and the file
+ * open and close in the reopen mode, is the max among processes. For each
+ * mode, the percentiles of the latencies of all calls of the timed runs, and
+ * the aggregate throughput of a whole run of appends are reported. To show
+ * slowdowns as the file grows, the records are also split into '-w num'
+ * consecutive windows, and the throughput of each window, computed from the
+ * sums of the latencies of its calls averaged over the timed runs, is
+ * reported together with the file size at the end of the window. At the end
+ * of each mode, the file size is checked against the number of records.
+ *
+ * To compile:
+ *   % mpicc -O2 record_append.c bench_util.c -o record_append -lm
+ *
+ * Example run command and output on screen:
+ *   % mpiexec -n 4 ./record_append -R 50 -b 8 -w 4 -N 2 -f testfile
+ *   ...
+ *   ---- batch: throughput over time (mean of 2 timed runs)
+ *             records   file size (MiB)    time (sec)       MiB/s
+ *            0-7                   0.12      0.001819       68.74
+ *            8-23                  0.38      0.003046       82.08
+ *           24-39                  0.62      0.002841       87.99
+ *           40-49                  0.78      0.001947       80.27
+ *        throughput of last window / first window = 1.17
+ *   --------------------------------------------------------------------------
+ *   mode    records/call  calls p50(msec) p90(msec) p99(msec) max(msec)    MiB/s
+ *   --------------------------------------------------------------------------
+ *   keep               1     50     0.228     0.272     0.373     0.613    49.16
+ *   reopen             1     50     0.830     1.005     1.511     2.080    17.12
+ *   batch              8      7     1.445     1.656     2.049     2.103    74.59
+ *   --------------------------------------------------------------------------
+ *   Latency of a collective call is the max among processes
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>   /* getopt() */
+
+#include <mpi.h>
+
+#include "bench_util.h"
+
+#define NMODES 3
+#define MODE_KEEP   0
+#define MODE_REOPEN 1
+#define MODE_BATCH  2
+static const char *mode_names[NMODES] = {"keep", "reopen", "batch"};
+
+/* results of one mode, stored at root process */
+typedef struct {
+    int    mode;
+    int    nper;      /* records per collective call */
+    int    ncalls;    /* collective calls per run */
+    double p50, p90, p99, max;  /* latencies of all calls of timed runs */
+    double bw;        /* MiB/s of the median run */
+} result;
+
+static int verbose;
+
+/*----< create_record_type() >-----------------------------------------------*/
+/* create the filetype of the nvars variables of one record and return the
+ * record size in bytes in rec_size
+ */
+static int
+create_record_type(MPI_Comm      comm,
+                   int           nvars,
+                   int           len,
+                   MPI_Datatype *recType,
+                   MPI_Offset   *rec_size)
+{
+    int i, err, nerrs=0, rank, nprocs, psizes[2], sizes[2], subsizes[2];
+    int starts[2], *blks=NULL;
+    MPI_Aint *disp=NULL, var_size;
+    MPI_Datatype subType;
+
+    MPI_Comm_size(comm, &nprocs);
+    MPI_Comm_rank(comm, &rank);
+
+    /* calculate number of processes along each dimension */
+    psizes[0] = psizes[1] = 0;
+    MPI_Dims_create(nprocs, 2, psizes);
+
+    sizes[0]    = len * psizes[0];
+    sizes[1]    = len * psizes[1];
+    subsizes[0] = len;
+    subsizes[1] = len;
+    starts[0]   = len * (rank / psizes[1]);
+    starts[1]   = len * (rank % psizes[1]);
+    err = MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C,
+                                   MPI_INT, &subType); ERR
+
+    /* variables of a record are stored one after another */
+    var_size = (MPI_Aint)sizeof(int) * sizes[0] * sizes[1];
+    disp = (MPI_Aint*) malloc(sizeof(MPI_Aint) * nvars);
+    blks = (int*) malloc(sizeof(int) * nvars);
+    for (i=0; i<nvars; i++) {
+        disp[i] = var_size * i;
+        blks[i] = 1;
+    }
+    err = MPI_Type_create_hindexed(nvars, blks, disp, subType, recType); ERR
+    err = MPI_Type_commit(recType); ERR
+    err = MPI_Type_free(&subType); ERR
+
+    *rec_size = (MPI_Offset)var_size * nvars;
+    if (verbose && rank == 0) {
+        printf("Each global variable is of size     %d x %d (int)\n",
+               sizes[0], sizes[1]);
+        printf("process dimension psizes:           %d %d\n", psizes[0],
+               psizes[1]);
+        printf("Record size:                        %lld bytes\n", *rec_size);
+    }
+
+err_out:
+    if (disp != NULL) free(disp);
+    if (blks != NULL) free(blks);
+    return nerrs;
+}
+
+/*----< append_records() >---------------------------------------------------*/
+/* One run of mode: create an empty file and append nrecs records, nper
+ * records per collective call. buf contains nper records of nelems ints of
+ * this process. lat[] gets the local time of each collective call.
+ */
+static int
+append_records(const char   *filename,
+               MPI_Info      info,
+               int           mode,
+               MPI_Datatype  recType,
+               MPI_Offset    rec_size,
+               int           nrecs,
+               int           nper,
+               int           nelems,
+               int          *buf,
+               double       *lat)
+{
+    int c, n, err, nerrs=0, rank, cmode, ncalls;
+    double start;
+    MPI_File fh;
+    MPI_Status status;
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    ncalls = (nrecs + nper - 1) / nper;
+    cmode = MPI_MODE_CREATE | MPI_MODE_WRONLY;
+
+    /* start from an empty file, as NC_CLOBBER */
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (rank == 0) MPI_File_delete(filename, MPI_INFO_NULL);
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    if (mode != MODE_REOPEN) {
+        err = MPI_File_open(MPI_COMM_WORLD, filename, cmode, info, &fh);
+        CHECK_MPI_ERROR("MPI_File_open")
+    }
+
+    for (c=0; c<ncalls; c++) {
+        n = (nrecs - c * nper < nper) ? nrecs - c * nper : nper;
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        start = MPI_Wtime();
+        if (mode == MODE_REOPEN) {
+            err = MPI_File_open(MPI_COMM_WORLD, filename, cmode, info, &fh);
+            CHECK_MPI_ERROR("MPI_File_open")
+        }
+
+        /* the view of n records is n tiles of the filetype */
+        err = MPI_File_set_view(fh, rec_size * c * nper, MPI_INT, recType,
+                                "native", info);
+        CHECK_MPI_ERROR("MPI_File_set_view")
+        err = MPI_File_write_all(fh, buf, n * nelems, MPI_INT, &status);
+        CHECK_MPI_ERROR("MPI_File_write_all")
+
+        if (mode == MODE_REOPEN) {
+            err = MPI_File_close(&fh);
+            CHECK_MPI_ERROR("MPI_File_close")
+        }
+        lat[c] = MPI_Wtime() - start;
+    }
+
+    if (mode != MODE_REOPEN) {
+        err = MPI_File_close(&fh);
+        CHECK_MPI_ERROR("MPI_File_close")
+    }
+
+err_out:
+    return nerrs;
+}
+
+/*----< print_windows() >----------------------------------------------------*/
+/* print the throughput of nwins consecutive windows of the calls, from the
+ * latencies maxlat[nreps][ncalls] of the timed runs, and return the ratio of
+ * the throughput of the last window to the first
+ */
+static double
+print_windows(const char   *name,
+              const double *maxlat,
+              int           nreps,
+              int           ncalls,
+              int           nper,
+              int           nrecs,
+              MPI_Offset    rec_size,
+              int           nwins)
+{
+    int w, c, r, c0, c1, r0, r1;
+    double t, bw, first=0.0, last=0.0;
+
+    if (nwins > ncalls) nwins = ncalls;
+
+    printf("---- %s: throughput over time (mean of %d timed runs)\n", name,
+           nreps);
+    printf("     %12s %17s %13s %11s\n", "records", "file size (MiB)",
+           "time (sec)", "MiB/s");
+    for (w=0; w<nwins; w++) {
+        c0 = (long long)ncalls * w / nwins;
+        c1 = (long long)ncalls * (w + 1) / nwins;
+        r0 = c0 * nper;
+        r1 = (c1 * nper < nrecs) ? c1 * nper : nrecs;
+
+        t = 0.0;
+        for (r=0; r<nreps; r++)
+            for (c=c0; c<c1; c++)
+                t += maxlat[r * ncalls + c];
+        t /= nreps;
+        bw = (t > 0.0) ? (double)(r1 - r0) * rec_size / 1048576.0 / t : 0.0;
+        if (w == 0) first = bw;
+        last = bw;
+
+        printf("     %5d-%-6d %17.2f %13.6f %11.2f\n", r0, r1 - 1,
+               (double)r1 * rec_size / 1048576.0, t, bw);
+    }
+    printf("     throughput of last window / first window = %.2f\n",
+           (first > 0.0) ? last / first : 0.0);
+    return (first > 0.0) ? last / first : 0.0;
+}
+
+/*----< usage() >------------------------------------------------------------*/
+static void
+usage(char *argv0)
+{
+    char *help =
+    "Usage: %s [-hv | -n num | -l len | -R num | -m list | -b num | -w num |\n"
+    "       -W num | -N num | -o file | -H file] -f file_name\n"
+    "       [-h] Print this help\n"
+    "       [-v] verbose mode\n"
+    "       [-n num] number of variables per record (default: 4)\n"
+    "       [-l len] length of local X and Y dimension sizes (default: 16)\n"
+    "       [-R num] number of records appended per run (default: 100)\n"
+    "       [-m list] modes, comma-separated names of keep, reopen, and batch\n"
+    "                 (default: all)\n"
+    "       [-b num] records per collective call of mode batch (default: 8)\n"
+    "       [-w num] number of windows of the throughput over time (default: 10)\n"
+    "       [-W num] number of untimed warmup runs (default: %d)\n"
+    "       [-N num] number of timed repetitions (default: %d)\n"
+    "       [-o file] append results as a line of JSON to file\n"
+    "       [-H file] load MPI-IO hints from file of \"key value\" lines\n"
+    "        -f file_name: output file name\n";
+    fprintf(stderr, help, argv0, BENCH_NWARMUP, BENCH_NREPS);
+}
+
+/*----< main() >------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    extern int optind;
+    extern char *optarg;
+    char filename[256], *hints_file=NULL, *out_file=NULL, *mode_list=NULL;
+    char *tok, key[64], name[64];
+    int i, j, m, rank, nprocs, err, nerrs=0, max_nerrs, nvars, len, nrecs;
+    int batch, nwins, nwarmup, nreps, nmodes, modes[NMODES], nelems, nper;
+    int ncalls, nresults=0, *buf=NULL;
+    double *lat=NULL, *maxlat=NULL, *sorted=NULL, ratio, median;
+    MPI_Offset rec_size=0, fsize;
+    MPI_Datatype recType=MPI_DATATYPE_NULL;
+    MPI_File fh;
+    MPI_Info info=MPI_INFO_NULL;
+    bench_timer timer;
+    bench_stats st;
+    bench_record rec;
+    result results[NMODES];
+
+    MPI_Init(&argc,&argv);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    verbose     = 0;
+    nvars       = 4;
+    len         = 16;
+    nrecs       = 100;
+    batch       = 8;
+    nwins       = 10;
+    nwarmup     = BENCH_NWARMUP;
+    nreps       = BENCH_NREPS;
+    filename[0] = '\0';
+
+    /* get command-line arguments */
+    while ((i = getopt(argc, argv, "hvn:l:R:m:b:w:W:N:o:H:f:")) != EOF)
+        switch(i) {
+            case 'v': verbose = 1;
+                      break;
+            case 'n': nvars = atoi(optarg);
+                      break;
+            case 'l': len = atoi(optarg);
+                      break;
+            case 'R': nrecs = atoi(optarg);
+                      break;
+            case 'm': mode_list = optarg;
+                      break;
+            case 'b': batch = atoi(optarg);
+                      break;
+            case 'w': nwins = atoi(optarg);
+                      break;
+            case 'W': nwarmup = atoi(optarg);
+                      break;
+            case 'N': nreps = atoi(optarg);
+                      break;
+            case 'o': out_file = optarg;
+                      break;
+            case 'H': hints_file = optarg;
+                      break;
+            case 'f': strcpy(filename, optarg);
+                      break;
+            case 'h':
+            default:  if (rank==0) usage(argv[0]);
+                      MPI_Finalize();
+                      return 1;
+        }
+
+    if (filename[0] == '\0' || nvars <= 0 || len <= 0 || nrecs <= 0 ||
+        batch <= 0 || nwins <= 0 || nreps <= 0) {
+        if (rank==0) usage(argv[0]);
+        MPI_Finalize();
+        return 1;
+    }
+    if (batch > nrecs) batch = nrecs;
+
+    if (mode_list == NULL) {
+        nmodes = NMODES;
+        for (i=0; i<NMODES; i++) modes[i] = i;
+    }
+    else {
+        nmodes = 0;
+        for (tok=strtok(mode_list, ","); tok!=NULL; tok=strtok(NULL, ",")) {
+            for (i=0; i<NMODES; i++)
+                if (!strcmp(tok, mode_names[i])) break;
+            if (i == NMODES || nmodes == NMODES) {
+                if (rank == 0)
+                    printf("Error: invalid mode '%s' of command-line option '-m'\n",
+                           tok);
+                nerrs++;
+                goto err_out;
+            }
+            modes[nmodes++] = i;
+        }
+    }
+
+    /* load user I/O hints from the hint file, if given */
+    if (bench_hints_load(hints_file, MPI_COMM_WORLD, &info) != 0) {
+        nerrs++;
+        goto err_out;
+    }
+
+    nerrs += create_record_type(MPI_COMM_WORLD, nvars, len, &recType,
+                                &rec_size);
+    if (nerrs > 0) goto err_out;
+
+    if (rank == 0) {
+        printf("Number of variables per record:     %d\n", nvars);
+        printf("Local subarray size:                %d x %d (int)\n", len, len);
+        printf("Number of records per run:          %d\n", nrecs);
+        printf("File size after a run:              %lld bytes\n",
+               rec_size * nrecs);
+    }
+
+    bench_record_init(&rec, MPI_COMM_WORLD, "record_append");
+    bench_record_int(&rec, "nvars", nvars);
+    bench_record_int(&rec, "len", len);
+    bench_record_int(&rec, "nrecs", nrecs);
+    bench_record_int(&rec, "batch", batch);
+
+    /* buffer of batch records, each the nvars subarrays of this process */
+    nelems = nvars * len * len;
+    buf = (int*) malloc(sizeof(int) * nelems * batch);
+    bench_fill_block(buf, nvars * batch, len, len, 0, rank, -1);
+
+    lat = (double*) malloc(sizeof(double) * nrecs);
+    if (rank == 0) maxlat = (double*) malloc(sizeof(double) * nreps * nrecs);
+
+    for (m=0; m<nmodes; m++) {
+        nper = (modes[m] == MODE_BATCH) ? batch : 1;
+        ncalls = (nrecs + nper - 1) / nper;
+
+        sprintf(name, "append records, %s", mode_names[modes[m]]);
+        bench_timer_init(&timer, name, nwarmup, nreps);
+        for (i=0; i<nwarmup+nreps; i++) {
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&timer);
+            nerrs += append_records(filename, info, modes[m], recType,
+                                    rec_size, nrecs, nper, nelems, buf, lat);
+            bench_timer_stop(&timer);
+            if (nerrs > 0) break;
+
+            /* latency of a call is the max among processes */
+            if (i >= nwarmup)
+                bench_max_timings(lat, (maxlat == NULL) ? NULL :
+                                  maxlat + (i - nwarmup) * ncalls, ncalls,
+                                  MPI_COMM_WORLD);
+        }
+        MPI_Allreduce(&nerrs, &max_nerrs, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+        if (max_nerrs > 0) {
+            bench_timer_free(&timer);
+            goto err_out;
+        }
+
+        /* check the file size */
+        err = MPI_File_open(MPI_COMM_WORLD, filename, MPI_MODE_RDONLY, info,
+                            &fh); ERR
+        if (m == 0) {
+            err = bench_record_hints(&rec, fh); CHECK_ERR(bench_record_hints)
+            if (hints_file != NULL) {
+                err = bench_hints_print(fh, MPI_COMM_WORLD); ERR
+            }
+        }
+        err = MPI_File_get_size(fh, &fsize); ERR
+        err = MPI_File_close(&fh); ERR
+        if (fsize != rec_size * nrecs) {
+            if (rank == 0)
+                printf("Error: mode %s expects file size %lld but got %lld\n",
+                       mode_names[modes[m]], rec_size * nrecs, fsize);
+            nerrs++;
+        }
+
+        bench_timer_report(&timer, MPI_COMM_WORLD, (double)rec_size * nrecs,
+                           &rec);
+        err = bench_timer_reduce(&timer, MPI_COMM_WORLD, 0, &st, NULL, NULL);
+        ERR
+        median = st.median;
+        bench_timer_free(&timer);
+
+        if (rank == 0) {
+            result *r = results + nresults++;
+
+            ratio = print_windows(mode_names[modes[m]], maxlat, nreps, ncalls,
+                                  nper, nrecs, rec_size, nwins);
+
+            sorted = (double*) malloc(sizeof(double) * nreps * ncalls);
+            memcpy(sorted, maxlat, sizeof(double) * nreps * ncalls);
+            bench_stats_compute(sorted, nreps * ncalls, &st);
+            r->mode   = modes[m];
+            r->nper   = nper;
+            r->ncalls = ncalls;
+            r->p50    = bench_percentile(sorted, nreps * ncalls, 0.5);
+            r->p90    = bench_percentile(sorted, nreps * ncalls, 0.9);
+            r->p99    = bench_percentile(sorted, nreps * ncalls, 0.99);
+            r->max    = st.max;
+            r->bw     = (median > 0.0) ?
+                        (double)rec_size * nrecs / 1048576.0 / median : 0.0;
+            free(sorted);
+            sorted = NULL;
+
+            sprintf(key, "%s_p50", mode_names[modes[m]]);
+            bench_record_double(&rec, key, r->p50);
+            sprintf(key, "%s_p90", mode_names[modes[m]]);
+            bench_record_double(&rec, key, r->p90);
+            sprintf(key, "%s_p99", mode_names[modes[m]]);
+            bench_record_double(&rec, key, r->p99);
+            sprintf(key, "%s_last_over_first", mode_names[modes[m]]);
+            bench_record_double(&rec, key, ratio);
+        }
+    }
+
+    if (rank == 0) {
+        printf("--------------------------------------------------------------------------\n");
+        printf("mode    records/call  calls p50(msec) p90(msec) p99(msec) max(msec)    MiB/s\n");
+        printf("--------------------------------------------------------------------------\n");
+        for (j=0; j<nresults; j++)
+            printf("%-8s %11d %6d %9.3f %9.3f %9.3f %9.3f %8.2f\n",
+                   mode_names[results[j].mode], results[j].nper,
+                   results[j].ncalls, results[j].p50 * 1e3,
+                   results[j].p90 * 1e3, results[j].p99 * 1e3,
+                   results[j].max * 1e3, results[j].bw);
+        printf("--------------------------------------------------------------------------\n");
+        printf("Latency of a collective call is the max among processes\n");
+    }
+
+    if (bench_record_write(&rec, out_file)) nerrs++;
+    bench_record_free(&rec);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (rank == 0) MPI_File_delete(filename, MPI_INFO_NULL);
+
+err_out:
+    if (recType != MPI_DATATYPE_NULL) MPI_Type_free(&recType);
+    if (info != MPI_INFO_NULL) MPI_Info_free(&info);
+    if (buf != NULL) free(buf);
+    if (lat != NULL) free(lat);
+    if (maxlat != NULL) free(maxlat);
+    MPI_Finalize();
+    return (nerrs > 0);
+}
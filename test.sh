@@ -10,7 +10,10 @@ set -e
 MPIRUN="mpiexec ${MPIRUN_OPTS} -n 4"
 
 for f in ${check_PROGRAMS} ; do
-    if test "$f" = "print_mpi_io_hints" ; then
+    if test "$f" = "read_bench" ; then
+       # reads the files written by nvars and ghost_cell, run below
+       continue
+    elif test "$f" = "print_mpi_io_hints" ; then
        OPTS="testfile"
     elif test "$f" = "indexed_fsize" ; then
        OPTS="-f testfile"
@@ -18,8 +21,18 @@ for f in ${check_PROGRAMS} ; do
        OPTS="-f testfile"
     elif test "$f" = "struct_fsize" ; then
        OPTS="-f testfile"
+    elif test "$f" = "ghost_cell" ; then
+       OPTS="-k 3 -t 0.001 -V crc -A testfile"
     elif test "$f" = "nvars" ; then
        OPTS="-r -f testfile"
+    elif test "$f" = "column_wise" ; then
+       OPTS="-l 16 -L 1,4 -N 2 -o testfile"
+    elif test "$f" = "hints_tuner" ; then
+       OPTS="-l 16 -c 8 -O testfile.hints -f testfile"
+    elif test "$f" = "dtype_cost" ; then
+       OPTS="-n 1,10 -P 1,4 -l 8 -f testfile"
+    elif test "$f" = "record_append" ; then
+       OPTS="-R 20 -b 4 -w 4 -f testfile"
     fi
     CMD="${MPIRUN} ./$f ${OPTS}"
     echo "==========================================================="
@@ -31,6 +44,49 @@ for f in ${check_PROGRAMS} ; do
     echo "==========================================================="
 done
 
+# other write modes of nvars, each run on its own
+for m in "-K 2 -C 0.001" "-S 2" "-T 1,2" ; do
+    CMD="${MPIRUN} ./nvars -r $m -f testfile"
+    echo "==========================================================="
+    echo "    $CMD"
+    echo ""
+    ${CMD}
+    echo "==========================================================="
+done
+
+# apply the hints selected by hints_tuner
+if test -f ./testfile.hints ; then
+    CMD="${MPIRUN} ./nvars -H testfile.hints -F -r -V crc -f testfile"
+    echo "==========================================================="
+    echo "    $CMD"
+    echo ""
+    ${CMD}
+    echo "==========================================================="
+fi
+
+# read with a different number of processes, a subset of variables, and a
+# stride the files written by nvars, ghost_cell, and fileview_subarray
+for w in nvars ghost_cell fileview_subarray ; do
+    if test "$w" = "nvars" ; then
+       CMD="${MPIRUN} ./nvars -n 4 -f testfile"
+       OPTS="-w 4 -n 4 -V 1,3 -s 3 -f testfile"
+    elif test "$w" = "ghost_cell" ; then
+       CMD="${MPIRUN} ./ghost_cell -q -n 2 -l 8 testfile"
+       OPTS="-p ghost_cell -w 4 -n 2 -l 8 -V 1 -s 2 -P 1,3 -f testfile"
+    else
+       CMD="${MPIRUN} ./fileview_subarray testfile"
+       OPTS="-p fileview_subarray -w 4 -P 3,1 -c world,node,self -f testfile"
+    fi
+    RCMD="mpiexec ${MPIRUN_OPTS} -n 3 ./read_bench ${OPTS}"
+    echo "==========================================================="
+    echo "    $CMD"
+    echo "    $RCMD"
+    echo ""
+    ${CMD} > /dev/null
+    ${RCMD}
+    echo "==========================================================="
+done
+
 # delete output file
-rm -f ./testfile
+rm -f ./testfile ./testfile.*
 
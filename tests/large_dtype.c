@@ -13,6 +13,21 @@
  * is 2D of size (len * psize[0]) x (len * psize[1]). Each local array is of
  * size (len - GAP)  x (len - GAP).
  *
+ * Command-line option '-p' adds a pack-then-write mode, which packs the user
+ * buffer into a contiguous staging buffer by MPI_Pack_c() before calling the
+ * collective write. Option '-u' packs it instead by memcpy() of each row of
+ * the subarrays. The pack time is reported separately. The staging buffer
+ * is written as nvars elements of a contiguous datatype, as the amount can
+ * be larger than 2 GiB.
+ *
+ * Command-line option '-s size' enables a streaming mode, which does not
+ * allocate the full-size local buffer. The request of each process is split
+ * into windows of about size bytes, e.g. 256m, each of whole rows of the
+ * subarrays. Each window is filled into a reusable pool buffer of one window
+ * and written or read at its offset in the file view. The peak resident set
+ * size, the maximum among processes, is reported in all modes, to find how
+ * small the staging memory can be before the throughput drops.
+ *
  * Example output:
  *     % mpiexec -n 2 ./a.out -f output.dat
  *     Output file name = output.dat
@@ -43,28 +58,14 @@
 #include <string.h> /* strcpy() */
 #include <unistd.h> /* getopt() */
 #include <assert.h>
+#include <limits.h> /* INT_MAX, LLONG_MAX */
 
 #include <mpi.h>
 
-#define CHECK_MPI_ERROR(fname) \
-    if (err != MPI_SUCCESS) { \
-        int errorStringLen; \
-        char errorString[MPI_MAX_ERROR_STRING]; \
-        MPI_Error_string(err, errorString, &errorStringLen); \
-        printf("Error at line %d when calling %s: %s\n",__LINE__,fname,errorString); \
-        nerrs++; \
-        goto err_out; \
-    }
+#include "bench_util.h"
 
 #define CHECK_MPIO_ERROR(fname) { \
-    if (err != MPI_SUCCESS) { \
-        int errorStringLen; \
-        char errorString[MPI_MAX_ERROR_STRING]; \
-        MPI_Error_string(err, errorString, &errorStringLen); \
-        printf("Error at line %d when calling %s: %s\n",__LINE__,fname,errorString); \
-        nerrs++; \
-        goto err_out; \
-    } \
+    CHECK_MPI_ERROR(fname) \
     else if (verbose) { \
         if (rank == 0) \
             printf("---- pass LINE %d of calling %s\n", __LINE__, fname); \
@@ -77,60 +78,232 @@
 #define GAP   1
 #define NVARS 1100
 
+/* ways of packing the user buffer in the pack-then-write mode */
+#define PACK_NONE   0
+#define PACK_MPI    1  /* MPI_Pack_c() */
+#define PACK_MEMCPY 2  /* memcpy() of each row of subarrays */
+
 int check_contents(int r_rank, int nvars, int len, int gap, char *buf, char *msg)
 {
-    size_t i, j, k, q;
+    long long r, nrows = (long long)nvars * (len - gap), bad = LLONG_MAX;
+    size_t q, row_len = len - gap;
+
+    /* check the contents of read buffer, rows in parallel */
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) reduction(min:bad)
+#endif
+    for (r=0; r<nrows; r++) {
+        size_t rq = ((r / row_len) * len + (r % row_len)) * len;
+        long long k = bench_verify_pattern(buf + rq, row_len, r_rank + rq);
+        if (k >= 0 && (long long)(rq + k) < bad) bad = rq + k;
+    }
+    if (bad == LLONG_MAX) return 0;
 
-    /* check the contents of read buffer */
-    q = 0;
-    for (i=0; i<nvars; i++) {
-        for (j=0; j<len-gap; j++) {
-            for (k=0; k<len-gap; k++) {
-                char exp = (char)((r_rank + q) % 128);
-                if (buf[q] != exp) {
-                    printf("Error: %s [i=%zd j=%zd k=%zd] expect %d but got %d\n",
-                           msg, i, j, k, exp, buf[q]);
-                    return 1;
-                }
-                q++;
+    q = bad;
+    printf("Error: %s [i=%zd j=%zd k=%zd] expect %d but got %d\n", msg,
+           q / ((size_t)len * len), (q / len) % len, q % len,
+           (char)((r_rank + q) % 128), buf[q]);
+    return 1;
+}
+
+/*----< fill_window() >------------------------------------------------------*/
+/* Fill nrows rows starting from row first of the data of this process, in
+ * the order of the file view, into pool. The contents are the same as those
+ * packed from the local buffer, of which each variable is len x len with a
+ * gap at the end of each dimension.
+ */
+static void
+fill_window(int r_rank, int len, int gap, size_t first, size_t nrows,
+            char *pool)
+{
+    long long i;
+    size_t row_len = len - gap;
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (i=first; i<first+nrows; i++) {
+        /* index in the local buffer of row i */
+        size_t q = ((i / row_len) * len + (i % row_len)) * len;
+        bench_fill_pattern(pool + (i - first) * row_len, row_len, r_rank + q);
+    }
+}
+
+/*----< check_window() >-----------------------------------------------------*/
+static int
+check_window(int r_rank, int len, int gap, size_t first, size_t nrows,
+             const char *pool)
+{
+    long long i, bad = LLONG_MAX;
+    size_t k, q, row_len = len - gap;
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) reduction(min:bad)
+#endif
+    for (i=first; i<first+nrows; i++) {
+        size_t rq = ((i / row_len) * len + (i % row_len)) * len;
+        long long e = bench_verify_pattern(pool + (i - first) * row_len,
+                                           row_len, r_rank + rq);
+        if (e >= 0 && (i - first) * (long long)row_len + e < bad)
+            bad = (i - first) * row_len + e;
+    }
+    if (bad == LLONG_MAX) return 0;
+
+    i = first + bad / row_len;
+    k = bad % row_len;
+    q = ((i / row_len) * len + (i % row_len)) * len;
+    printf("Error: streaming read [row=%lld k=%zd] expect %d but got %d\n",
+           i, k, (char)((r_rank + q + k) % 128), pool[bad]);
+    return 1;
+}
+
+/*----< streaming_io() >-----------------------------------------------------*/
+/* Write and read the request of this process in windows of about window
+ * bytes, each of whole rows of the subarrays, through a pool buffer of one
+ * window. The full-size local buffer is never allocated, so the staging
+ * memory is bounded by the window size. Each window of rows is filled into
+ * the pool, as packed from the local buffer, and accessed at its offset in
+ * the file view by MPI_File_write_at_all() or MPI_File_read_at_all().
+ */
+static int
+streaming_io(MPI_File      fh,
+             int           nvars,
+             int           len,
+             int           gap,
+             MPI_Offset    window,
+             int           do_write,
+             int           do_read,
+             int           nwarmup,
+             int           nreps,
+             double        amnt,
+             bench_record *rec)
+{
+    char *pool;
+    int r, err, nerrs=0, rank;
+    size_t w, row_len, nrows, win_rows, nwins, first, n;
+    bench_timer timer;
+    MPI_Status status;
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    row_len  = len - gap;
+    nrows    = (size_t)nvars * row_len;
+    win_rows = window / row_len;
+    if (win_rows < 1) win_rows = 1;
+    if (win_rows > nrows) win_rows = nrows;
+    if (win_rows * row_len > INT_MAX) win_rows = INT_MAX / row_len;
+    nwins = (nrows + win_rows - 1) / win_rows;
+
+    if (rank == 0) {
+        printf("Streaming window size = %zd bytes (%zd rows)\n",
+               win_rows * row_len, win_rows);
+        printf("Number of windows per process = %zd\n", nwins);
+    }
+    bench_record_int(rec, "window", win_rows * row_len);
+    bench_record_int(rec, "nwindows", nwins);
+
+    /* the reusable pool buffer of one window */
+    pool = (char*) malloc(win_rows * row_len);
+    timer.samples = NULL;
+
+    if (do_write) {
+        bench_timer_init(&timer, "streaming collective write", nwarmup,
+                         nreps);
+        for (r=0; r<nwarmup+nreps; r++) {
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&timer);
+            for (w=0; w<nwins; w++) {
+                first = w * win_rows;
+                n = (first + win_rows > nrows) ? nrows - first : win_rows;
+                fill_window(rank, len, gap, first, n, pool);
+                err = MPI_File_write_at_all(fh, first * row_len, pool,
+                                            n * row_len, MPI_BYTE, &status);
+                CHECK_MPI_ERROR("MPI_File_write_at_all");
+            }
+            bench_timer_stop(&timer);
+        }
+        bench_timer_report(&timer, MPI_COMM_WORLD, amnt, rec);
+        bench_timer_free(&timer);
+    }
+
+    if (do_read) {
+        bench_timer_init(&timer, "streaming collective read", nwarmup, nreps);
+        for (r=0; r<nwarmup+nreps; r++) {
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&timer);
+            for (w=0; w<nwins; w++) {
+                first = w * win_rows;
+                n = (first + win_rows > nrows) ? nrows - first : win_rows;
+                err = MPI_File_read_at_all(fh, first * row_len, pool,
+                                           n * row_len, MPI_BYTE, &status);
+                CHECK_MPI_ERROR("MPI_File_read_at_all");
             }
-            q += gap;
+            bench_timer_stop(&timer);
+        }
+        bench_timer_report(&timer, MPI_COMM_WORLD, amnt, rec);
+        bench_timer_free(&timer);
+
+        /* read again, untimed, to check contents of all windows */
+        for (w=0; w<nwins; w++) {
+            first = w * win_rows;
+            n = (first + win_rows > nrows) ? nrows - first : win_rows;
+            memset(pool, -1, n * row_len);
+            err = MPI_File_read_at_all(fh, first * row_len, pool, n * row_len,
+                                       MPI_BYTE, &status);
+            CHECK_MPI_ERROR("MPI_File_read_at_all");
+            if (nerrs == 0)
+                nerrs += check_window(rank, len, gap, first, n, pool);
         }
-        q += gap * len;
     }
-    return 0;
+
+err_out:
+    bench_timer_free(&timer);
+    free(pool);
+    return nerrs;
 }
 
 static void
 usage(char *argv0)
 {
     char *help =
-    "Usage: %s [-hvwr | -n num | -l num | -g num ] -f file_name\n"
+    "Usage: %s [-hvwrpu | -n num | -l num | -g num | -s size | -W num | -N num | -o file | -H file ] -f file_name\n"
     "       [-h] Print this help\n"
     "       [-v] verbose mode\n"
     "       [-w] performs write only (default: both write and read)\n"
     "       [-r] performs read  only (default: both write and read)\n"
+    "       [-p] also pack the buffer by MPI_Pack_c before collective write\n"
+    "       [-u] also pack the buffer by memcpy before collective write\n"
     "       [-n num] number of global variables (default: %d)\n"
     "       [-l num] length of dimensions X and Y each local variable (default: %d)\n"
     "       [-g num] gap at the end of each dimension (default: %d)\n"
+    "       [-s size] streaming mode with windows of size bytes, e.g. 256m\n"
+    "       [-W num] number of untimed warmup runs (default: %d)\n"
+    "       [-N num] number of timed repetitions (default: %d)\n"
+    "       [-o file] append results as a line of JSON to file\n"
+    "       [-H file] load MPI-IO hints from file of \"key value\" lines\n"
     "        -f file_name: output file name\n";
-    fprintf(stderr, help, argv0, NVARS, LEN, GAP);
+    fprintf(stderr, help, argv0, NVARS, LEN, GAP, BENCH_NWARMUP, BENCH_NREPS);
 }
 
 /*----< main() >------------------------------------------------------------*/
 int main(int argc, char **argv)
 {
-    char filename[512];
+    char filename[512], *out_file=NULL, *hints_file=NULL;
     size_t i, buf_len;
     int ret, err, nerrs=0, rank, verbose, omode, nprocs, do_read, do_write;
     int nvars, len, gap, psize[2], gsize[2], count[2], start[2];
-    char *buf;
-    double timing, max_timing;
+    int r, nwarmup, nreps, pack;
+    long long *vals;
+    char *buf, *buf2=NULL;
+    double amnt;
+    bench_timer timer, ptimer[3];
+    bench_record rec;
     MPI_File     fh;
-    MPI_Datatype subType, filetype, buftype;
+    MPI_Datatype subType, filetype, buftype, packtype;
     MPI_Status   status;
-    MPI_Offset fsize;
-    MPI_Count type_size;
+    MPI_Info     info=MPI_INFO_NULL;
+    MPI_Offset fsize, window;
+    MPI_Count type_size, position;
     int *array_of_blocklengths;
     MPI_Aint lb, extent, *array_of_displacements;
     MPI_Datatype *array_of_types;
@@ -147,10 +320,17 @@ int main(int argc, char **argv)
     do_write = 1;
     do_read  = 1;
     verbose = 0;
+    nwarmup = BENCH_NWARMUP;
+    nreps = BENCH_NREPS;
+    pack = PACK_NONE;
+    window = 0;
+    buf = NULL;
+    timer.samples = NULL;
+    for (r=0; r<3; r++) ptimer[r].samples = NULL;
     filename[0] = '\0';
 
     /* get command-line arguments */
-    while ((ret = getopt(argc, argv, "hvwrn:l:g:f:")) != EOF)
+    while ((ret = getopt(argc, argv, "hvwrpun:l:g:s:f:W:N:o:H:")) != EOF)
         switch(ret) {
             case 'v': verbose = 1;
                       break;
@@ -158,14 +338,35 @@ int main(int argc, char **argv)
                       break;
             case 'r': do_write = 0;
                       break;
+            case 'p': pack = PACK_MPI;
+                      break;
+            case 'u': pack = PACK_MEMCPY;
+                      break;
             case 'n': nvars = atoi(optarg);
                       break;
             case 'l': len = atoi(optarg);
                       break;
             case 'g': gap = atoi(optarg);
                       break;
+            case 's': if (bench_parse_list(optarg, &vals) < 1 || vals[0] <= 0) {
+                          if (rank == 0)
+                              printf("Error: invalid window size '%s'\n", optarg);
+                          MPI_Finalize();
+                          return 1;
+                      }
+                      window = vals[0];
+                      free(vals);
+                      break;
             case 'f': strcpy(filename, optarg);
                       break;
+            case 'W': nwarmup = atoi(optarg);
+                      break;
+            case 'N': nreps = atoi(optarg);
+                      break;
+            case 'o': out_file = strdup(optarg);
+                      break;
+            case 'H': hints_file = optarg;
+                      break;
             case 'h':
             default:  if (rank==0) usage(argv[0]);
                       MPI_Finalize();
@@ -178,6 +379,19 @@ int main(int argc, char **argv)
         return 1;
     }
 
+    /* load user I/O hints from the hint file, if given */
+    if (bench_hints_load(hints_file, MPI_COMM_WORLD, &info) != 0) {
+        MPI_Finalize();
+        return 1;
+    }
+
+    bench_record_init(&rec, MPI_COMM_WORLD, "large_dtype");
+    bench_record_int(&rec, "nvars", nvars);
+    bench_record_int(&rec, "len", len);
+    bench_record_int(&rec, "gap", gap);
+    bench_record_str(&rec, "pack", (pack == PACK_MPI) ? "MPI_Pack_c" :
+                     (pack == PACK_MEMCPY) ? "memcpy" : "none");
+
     array_of_blocklengths = (int*) malloc(sizeof(int) * nvars);
     array_of_displacements = (MPI_Aint*) malloc(sizeof(MPI_Aint) * nvars);
     array_of_types = (MPI_Datatype*) malloc(sizeof(MPI_Datatype) * nvars);
@@ -272,101 +486,190 @@ int main(int argc, char **argv)
     }
     fflush(stdout);
 
-    /* allocate a local buffer */
+    /* amount accessed by all processes in a blocking call */
+    amnt = (double)nprocs * nvars * (len - gap) * (len - gap);
+
+    /* allocate a local buffer, except in the streaming mode */
     buf_len = (size_t)nvars * len * len;
-    buf = (char*) malloc(buf_len);
-    for (i=0; i<buf_len; i++) buf[i] = (char)((rank + i) % 128);
+    if (window == 0) {
+        buf = (char*) malloc(buf_len);
+        bench_timer_init(&timer, "buffer initialization", 0, 1);
+        bench_timer_start(&timer);
+        bench_fill_pattern(buf, buf_len, rank);
+        bench_timer_stop(&timer);
+        bench_timer_report(&timer, MPI_COMM_WORLD, (double)nprocs * buf_len,
+                           &rec);
+        bench_timer_free(&timer);
+    }
 
     /* open to create a file */
     omode = MPI_MODE_CREATE | MPI_MODE_RDWR;
-    err = MPI_File_open(MPI_COMM_WORLD, filename, omode, MPI_INFO_NULL, &fh);
+    err = MPI_File_open(MPI_COMM_WORLD, filename, omode, info, &fh);
     CHECK_MPIO_ERROR("MPI_File_open");
 
+    err = bench_record_hints(&rec, fh);
+    CHECK_MPIO_ERROR("MPI_File_get_info");
+    if (hints_file != NULL) {
+        err = bench_hints_print(fh, MPI_COMM_WORLD);
+        CHECK_MPIO_ERROR("MPI_File_get_info");
+    }
+
     /* set the file view */
-    err = MPI_File_set_view(fh, 0, MPI_BYTE, filetype, "native", MPI_INFO_NULL);
+    err = MPI_File_set_view(fh, 0, MPI_BYTE, filetype, "native", info);
     CHECK_MPIO_ERROR("MPI_File_set_view");
 
-    if (do_write) {
-        err = MPI_File_seek(fh, 0, MPI_SEEK_SET);
-        CHECK_MPIO_ERROR("MPI_File_seek");
+    if (window > 0) {
+        /* write and read through a pool buffer of one window */
+        nerrs += streaming_io(fh, nvars, len, gap, window, do_write, do_read,
+                              nwarmup, nreps, amnt, &rec);
+        goto close_file;
+    }
 
+    if (do_write) {
         /* MPI collective write */
-        MPI_Barrier(MPI_COMM_WORLD);
-        timing = MPI_Wtime();
+        bench_timer_init(&timer, "collective write", nwarmup, nreps);
+        for (r=0; r<nwarmup+nreps; r++) {
+            err = MPI_File_seek(fh, 0, MPI_SEEK_SET);
+            CHECK_MPIO_ERROR("MPI_File_seek");
+
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&timer);
+
+            err = MPI_File_write_all(fh, buf, 1, buftype, &status);
+            CHECK_MPIO_ERROR("MPI_File_write_all");
 
-        err = MPI_File_write_all(fh, buf, 1, buftype, &status);
-        CHECK_MPIO_ERROR("MPI_File_write_all");
+            bench_timer_stop(&timer);
+        }
+        bench_timer_report(&timer, MPI_COMM_WORLD, amnt, &rec);
+        bench_timer_free(&timer);
+
+        if (pack != PACK_NONE) {
+            /* pack the user buffer into a contiguous buffer and write it */
+            size_t packed_len = (size_t)nvars * (len - gap) * (len - gap);
+
+            buf2 = (char*) malloc(packed_len);
+            err = MPI_Type_contiguous((len - gap) * (len - gap), MPI_BYTE,
+                                      &packtype);
+            CHECK_MPI_ERROR("MPI_Type_contiguous");
+            err = MPI_Type_commit(&packtype);
+            CHECK_MPI_ERROR("MPI_Type_commit");
+
+            bench_timer_init(&ptimer[0], (pack == PACK_MPI) ?
+                             "pack (MPI_Pack_c)" : "pack (memcpy)", nwarmup,
+                             nreps);
+            bench_timer_init(&ptimer[1], "collective write, packed", nwarmup,
+                             nreps);
+            bench_timer_init(&ptimer[2], "pack + collective write", nwarmup,
+                             nreps);
+            for (r=0; r<nwarmup+nreps; r++) {
+                err = MPI_File_seek(fh, 0, MPI_SEEK_SET);
+                CHECK_MPIO_ERROR("MPI_File_seek");
+
+                MPI_Barrier(MPI_COMM_WORLD);
+                bench_timer_start(&ptimer[2]);
+                bench_timer_start(&ptimer[0]);
+                if (pack == PACK_MPI) {
+                    position = 0;
+                    err = MPI_Pack_c(buf, 1, buftype, buf2, packed_len,
+                                     &position, MPI_COMM_WORLD);
+                    CHECK_MPI_ERROR("MPI_Pack_c");
+                }
+                else {
+                    char *dst = buf2;
+                    size_t j, k;
+                    for (j=0; j<nvars; j++)
+                        for (k=0; k<len-gap; k++) {
+                            memcpy(dst, buf + (j * len + k) * len, len - gap);
+                            dst += len - gap;
+                        }
+                }
+                bench_timer_stop(&ptimer[0]);
 
-        timing = MPI_Wtime() - timing;
-        MPI_Reduce(&timing, &max_timing, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
-        if (rank == 0)
-            printf("Time of              collective write = %.2f sec\n", max_timing);
-        fflush(stdout);
+                bench_timer_start(&ptimer[1]);
+                err = MPI_File_write_all(fh, buf2, nvars, packtype, &status);
+                CHECK_MPIO_ERROR("MPI_File_write_all");
+                bench_timer_stop(&ptimer[1]);
+                bench_timer_stop(&ptimer[2]);
+            }
+            for (r=0; r<3; r++) {
+                bench_timer_report(&ptimer[r], MPI_COMM_WORLD, amnt, &rec);
+                bench_timer_free(&ptimer[r]);
+            }
 
-        err = MPI_File_seek(fh, 0, MPI_SEEK_SET);
-        CHECK_MPIO_ERROR("MPI_File_seek");
+            err = MPI_Type_free(&packtype);
+            CHECK_MPI_ERROR("MPI_Type_free");
+            free(buf2);
+            buf2 = NULL;
+        }
 
         /* MPI independent write */
-        MPI_Barrier(MPI_COMM_WORLD);
-        timing = MPI_Wtime();
+        bench_timer_init(&timer, "independent write", nwarmup, nreps);
+        for (r=0; r<nwarmup+nreps; r++) {
+            err = MPI_File_seek(fh, 0, MPI_SEEK_SET);
+            CHECK_MPIO_ERROR("MPI_File_seek");
+
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&timer);
 
-        err = MPI_File_write(fh, buf, 1, buftype, &status);
-        CHECK_MPIO_ERROR("MPI_File_write");
+            err = MPI_File_write(fh, buf, 1, buftype, &status);
+            CHECK_MPIO_ERROR("MPI_File_write");
 
-        timing = MPI_Wtime() - timing;
-        MPI_Reduce(&timing, &max_timing, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
-        if (rank == 0)
-            printf("Time of             independent write = %.2f sec\n", max_timing);
-        fflush(stdout);
+            bench_timer_stop(&timer);
+        }
+        bench_timer_report(&timer, MPI_COMM_WORLD, amnt, &rec);
+        bench_timer_free(&timer);
 
         /* MPI nonblocking collective write */
-        char *buf2 = (char*) malloc(buf_len);
-        for (i=0; i<buf_len; i++) buf2[i] = (char)((rank + i) % 128);
+        buf2 = (char*) malloc(buf_len);
+        bench_fill_pattern(buf2, buf_len, rank);
 
-        err = MPI_File_seek(fh, 0, MPI_SEEK_SET);
-        CHECK_MPIO_ERROR("MPI_File_seek");
+        bench_timer_init(&timer, "nonblocking  collective write", nwarmup, nreps);
+        for (r=0; r<nwarmup+nreps; r++) {
+            err = MPI_File_seek(fh, 0, MPI_SEEK_SET);
+            CHECK_MPIO_ERROR("MPI_File_seek");
 
-        MPI_Barrier(MPI_COMM_WORLD);
-        timing = MPI_Wtime();
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&timer);
 
-        err = MPI_File_iwrite_all(fh, buf, 1, buftype, &req[0]);
-        CHECK_MPIO_ERROR("MPI_File_iwrite_all 1");
+            err = MPI_File_iwrite_all(fh, buf, 1, buftype, &req[0]);
+            CHECK_MPIO_ERROR("MPI_File_iwrite_all 1");
 
-        err = MPI_File_iwrite_all(fh, buf2, 1, buftype, &req[1]);
-        CHECK_MPIO_ERROR("MPI_File_iwrite_all 2");
+            err = MPI_File_iwrite_all(fh, buf2, 1, buftype, &req[1]);
+            CHECK_MPIO_ERROR("MPI_File_iwrite_all 2");
 
-        err = MPI_Waitall(2, req, MPI_STATUSES_IGNORE);
-        CHECK_MPIO_ERROR("MPI_Waitall");
+            err = MPI_Waitall(2, req, MPI_STATUSES_IGNORE);
+            CHECK_MPIO_ERROR("MPI_Waitall");
 
-        timing = MPI_Wtime() - timing;
-        MPI_Reduce(&timing, &max_timing, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
-        if (rank == 0)
-            printf("Time of nonblocking  collective write = %.2f sec\n", max_timing);
-        fflush(stdout);
+            bench_timer_stop(&timer);
+        }
+        bench_timer_report(&timer, MPI_COMM_WORLD, amnt * 2, &rec);
+        bench_timer_free(&timer);
 
         /* MPI nonblocking independent write */
-        err = MPI_File_seek(fh, 0, MPI_SEEK_SET);
-        CHECK_MPIO_ERROR("MPI_File_seek");
+        bench_timer_init(&timer, "nonblocking independent write", nwarmup, nreps);
+        for (r=0; r<nwarmup+nreps; r++) {
+            err = MPI_File_seek(fh, 0, MPI_SEEK_SET);
+            CHECK_MPIO_ERROR("MPI_File_seek");
 
-        MPI_Barrier(MPI_COMM_WORLD);
-        timing = MPI_Wtime();
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&timer);
 
-        err = MPI_File_iwrite(fh, buf, 1, buftype, &req[0]);
-        CHECK_MPIO_ERROR("MPI_File_iwrite 1");
+            err = MPI_File_iwrite(fh, buf, 1, buftype, &req[0]);
+            CHECK_MPIO_ERROR("MPI_File_iwrite 1");
 
-        err = MPI_File_iwrite(fh, buf2, 1, buftype, &req[1]);
-        CHECK_MPIO_ERROR("MPI_File_iwrite 2");
+            err = MPI_File_iwrite(fh, buf2, 1, buftype, &req[1]);
+            CHECK_MPIO_ERROR("MPI_File_iwrite 2");
 
-        err = MPI_Waitall(2, req, MPI_STATUSES_IGNORE);
-        CHECK_MPIO_ERROR("MPI_Waitall");
+            err = MPI_Waitall(2, req, MPI_STATUSES_IGNORE);
+            CHECK_MPIO_ERROR("MPI_Waitall");
 
-        timing = MPI_Wtime() - timing;
-        MPI_Reduce(&timing, &max_timing, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
-        if (rank == 0)
-            printf("Time of nonblocking independent write = %.2f sec\n", max_timing);
-        fflush(stdout);
+            bench_timer_stop(&timer);
+        }
+        bench_timer_report(&timer, MPI_COMM_WORLD, amnt * 2, &rec);
+        bench_timer_free(&timer);
 
         free(buf2);
+        buf2 = NULL;
     }
 
     if (do_read) {
@@ -393,74 +696,89 @@ int main(int argc, char **argv)
         CHECK_MPI_ERROR("MPI_Type_commit");
 
         /* set the file view */
-        err = MPI_File_set_view(fh, 0, MPI_BYTE, filetype, "native", MPI_INFO_NULL);
+        err = MPI_File_set_view(fh, 0, MPI_BYTE, filetype, "native", info);
         CHECK_MPIO_ERROR("MPI_File_set_view");
 
         /* reset contents of read buffer */
-        for (i=0; i<buf_len; i++) buf[i] = -1;
+        memset(buf, -1, buf_len);
 
-        MPI_Barrier(MPI_COMM_WORLD);
-        timing = MPI_Wtime();
+        /* MPI collective read */
+        bench_timer_init(&timer, "collective read", nwarmup, nreps);
+        for (r=0; r<nwarmup+nreps; r++) {
+            err = MPI_File_seek(fh, 0, MPI_SEEK_SET);
+            CHECK_MPIO_ERROR("MPI_File_seek");
 
-        err = MPI_File_read_all(fh, buf, 1, buftype, &status);
-        CHECK_MPIO_ERROR("MPI_File_read_all");
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&timer);
 
-        timing = MPI_Wtime() - timing;
-        MPI_Reduce(&timing, &max_timing, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
-        if (rank == 0)
-            printf("Time of              collective read  = %.2f sec\n", max_timing);
-        fflush(stdout);
+            err = MPI_File_read_all(fh, buf, 1, buftype, &status);
+            CHECK_MPIO_ERROR("MPI_File_read_all");
 
+            bench_timer_stop(&timer);
+        }
+        bench_timer_report(&timer, MPI_COMM_WORLD, amnt, &rec);
+        bench_timer_free(&timer);
+
+        /* time the check of the first read, outside of the I/O timings */
+        bench_timer_init(&timer, "verification", 0, 1);
+        bench_timer_start(&timer);
         err += check_contents(r_rank, nvars, len, gap, buf, "MPI_File_read_all");
+        bench_timer_stop(&timer);
+        bench_timer_report(&timer, MPI_COMM_WORLD, amnt, &rec);
+        bench_timer_free(&timer);
         if (err != 0) goto err_out;
 
-        /* MPI independent read */
-        err = MPI_File_seek(fh, 0, MPI_SEEK_SET);
-        CHECK_MPIO_ERROR("MPI_File_seek");
-
         /* reset contents of read buffer */
-        for (i=0; i<buf_len; i++) buf[i] = -1;
+        memset(buf, -1, buf_len);
+
+        /* MPI independent read */
+        bench_timer_init(&timer, "independent read", nwarmup, nreps);
+        for (r=0; r<nwarmup+nreps; r++) {
+            err = MPI_File_seek(fh, 0, MPI_SEEK_SET);
+            CHECK_MPIO_ERROR("MPI_File_seek");
 
-        MPI_Barrier(MPI_COMM_WORLD);
-        timing = MPI_Wtime();
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&timer);
 
-        err = MPI_File_read(fh, buf, 1, buftype, &status);
-        CHECK_MPIO_ERROR("MPI_File_read");
+            err = MPI_File_read(fh, buf, 1, buftype, &status);
+            CHECK_MPIO_ERROR("MPI_File_read");
 
-        timing = MPI_Wtime() - timing;
-        MPI_Reduce(&timing, &max_timing, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
-        if (rank == 0)
-            printf("Time of             independent read  = %.2f sec\n", max_timing);
-        fflush(stdout);
+            bench_timer_stop(&timer);
+        }
+        bench_timer_report(&timer, MPI_COMM_WORLD, amnt, &rec);
+        bench_timer_free(&timer);
 
         err += check_contents(r_rank, nvars, len, gap, buf, "MPI_File_read");
         if (err != 0) goto err_out;
 
-        char *buf2 = (char*) malloc(buf_len);
+        buf2 = (char*) malloc(buf_len);
 
         /* reset contents of read buffer */
-        for (i=0; i<buf_len; i++) buf[i] = buf2[i] = -1;
+        memset(buf, -1, buf_len);
+        memset(buf2, -1, buf_len);
 
         /* MPI nonblocking collective read */
-        err = MPI_File_seek(fh, 0, MPI_SEEK_SET);
-        CHECK_MPIO_ERROR("MPI_File_seek");
+        bench_timer_init(&timer, "nonblocking  collective read", nwarmup, nreps);
+        for (r=0; r<nwarmup+nreps; r++) {
+            err = MPI_File_seek(fh, 0, MPI_SEEK_SET);
+            CHECK_MPIO_ERROR("MPI_File_seek");
 
-        MPI_Barrier(MPI_COMM_WORLD);
-        timing = MPI_Wtime();
-        err = MPI_File_iread_all(fh, buf, 1, buftype, &req[0]);
-        CHECK_MPIO_ERROR("MPI_File_iread_all 1");
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&timer);
 
-        err = MPI_File_iread_all(fh, buf2, 1, buftype, &req[1]);
-        CHECK_MPIO_ERROR("MPI_File_iread_all 2");
+            err = MPI_File_iread_all(fh, buf, 1, buftype, &req[0]);
+            CHECK_MPIO_ERROR("MPI_File_iread_all 1");
 
-        err = MPI_Waitall(2, req, MPI_STATUSES_IGNORE);
-        CHECK_MPIO_ERROR("MPI_Waitall");
+            err = MPI_File_iread_all(fh, buf2, 1, buftype, &req[1]);
+            CHECK_MPIO_ERROR("MPI_File_iread_all 2");
 
-        timing = MPI_Wtime() - timing;
-        MPI_Reduce(&timing, &max_timing, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
-        if (rank == 0)
-            printf("Time of nonblocking  collective read  = %.2f sec\n", max_timing);
-        fflush(stdout);
+            err = MPI_Waitall(2, req, MPI_STATUSES_IGNORE);
+            CHECK_MPIO_ERROR("MPI_Waitall");
+
+            bench_timer_stop(&timer);
+        }
+        bench_timer_report(&timer, MPI_COMM_WORLD, amnt * 2, &rec);
+        bench_timer_free(&timer);
 
         err += check_contents(r_rank, nvars, len, gap, buf, "MPI_File_iread_all 1");
         if (err != 0) goto err_out;
@@ -468,31 +786,32 @@ int main(int argc, char **argv)
         err += check_contents(r_rank, nvars, len, gap, buf2, "MPI_File_iread_all 2");
         if (err != 0) goto err_out;
 
-        /* MPI nonblocking independent read */
-
         /* reset contents of read buffer */
-        for (i=0; i<buf_len; i++) buf[i] = buf2[i] = -1;
+        memset(buf, -1, buf_len);
+        memset(buf2, -1, buf_len);
 
-        err = MPI_File_seek(fh, 0, MPI_SEEK_SET);
-        CHECK_MPIO_ERROR("MPI_File_seek");
+        /* MPI nonblocking independent read */
+        bench_timer_init(&timer, "nonblocking independent read", nwarmup, nreps);
+        for (r=0; r<nwarmup+nreps; r++) {
+            err = MPI_File_seek(fh, 0, MPI_SEEK_SET);
+            CHECK_MPIO_ERROR("MPI_File_seek");
 
-        MPI_Barrier(MPI_COMM_WORLD);
-        timing = MPI_Wtime();
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&timer);
 
-        err = MPI_File_iread(fh, buf, 1, buftype, &req[0]);
-        CHECK_MPIO_ERROR("MPI_File_iread 1");
+            err = MPI_File_iread(fh, buf, 1, buftype, &req[0]);
+            CHECK_MPIO_ERROR("MPI_File_iread 1");
 
-        err = MPI_File_iread(fh, buf2, 1, buftype, &req[1]);
-        CHECK_MPIO_ERROR("MPI_File_iread 2");
+            err = MPI_File_iread(fh, buf2, 1, buftype, &req[1]);
+            CHECK_MPIO_ERROR("MPI_File_iread 2");
 
-        err = MPI_Waitall(2, req, MPI_STATUSES_IGNORE);
-        CHECK_MPIO_ERROR("MPI_Waitall");
+            err = MPI_Waitall(2, req, MPI_STATUSES_IGNORE);
+            CHECK_MPIO_ERROR("MPI_Waitall");
 
-        timing = MPI_Wtime() - timing;
-        MPI_Reduce(&timing, &max_timing, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
-        if (rank == 0)
-            printf("Time of nonblocking independent read  = %.2f sec\n", max_timing);
-        fflush(stdout);
+            bench_timer_stop(&timer);
+        }
+        bench_timer_report(&timer, MPI_COMM_WORLD, amnt * 2, &rec);
+        bench_timer_free(&timer);
 
         err += check_contents(r_rank, nvars, len, gap, buf, "MPI_File_iread 1");
         if (err != 0) goto err_out;
@@ -501,19 +820,37 @@ int main(int argc, char **argv)
         if (err != 0) goto err_out;
 
         free(buf2);
+        buf2 = NULL;
     }
 
+close_file:
     err = MPI_File_close(&fh);
     CHECK_MPIO_ERROR("MPI_File_close");
 
-    free(buf);
+    if (buf != NULL) free(buf);
 
     err = MPI_Type_free(&filetype);
     CHECK_MPI_ERROR("MPI_Type_free");
     err = MPI_Type_free(&buftype);
     CHECK_MPI_ERROR("MPI_Type_free");
 
+    /* peak resident set size, the maximum among processes */
+    amnt = bench_peak_rss(MPI_COMM_WORLD);
+    if (rank == 0)
+        printf("Peak resident set size (max of processes) = %.1f MiB\n",
+               amnt / 1048576.0);
+    bench_record_double(&rec, "peak_rss", amnt);
+
+    if (bench_record_write(&rec, out_file)) nerrs++;
+
 err_out:
+    bench_timer_free(&timer);
+    for (r=0; r<3; r++)
+        bench_timer_free(&ptimer[r]);
+    bench_record_free(&rec);
+    if (out_file != NULL) free(out_file);
+    if (buf2 != NULL) free(buf2);
+    if (info != MPI_INFO_NULL) MPI_Info_free(&info);
     MPI_Finalize();
     return (nerrs > 0);
 }
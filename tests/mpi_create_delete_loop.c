@@ -1,73 +1,450 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Copyright (C) 2024, Northwestern University
+ *
+ * This program stresses the file system metadata servers by a loop of file
+ * deletion, MPI_File_open() with MPI_MODE_CREATE, MPI_File_set_size(), and
+ * MPI_File_close(), mimicking the file creation of PnetCDF with NC_CLOBBER,
+ * where process 0 also writes a 512-byte file header. The latency of each
+ * operation is measured by every process calling it and collected into a
+ * histogram of logarithmic bins, 20 per decade, whose counts are summed over
+ * all processes. The mean, the 50th, 99th, and 99.9th percentiles (upper
+ * bounds of the bins), and the max latency are reported for each operation.
+ *
+ * The following configurations are run, selected by command-line options
+ * '-a' and '-d'.
+ *   Access modes (-a):
+ *     coll - shared file opened collectively by all processes on
+ *            MPI_COMM_WORLD, the way of the original reproducer
+ *     self - shared file opened by every process on MPI_COMM_SELF
+ *     fpp  - file per process, file_name.<rank>, opened on MPI_COMM_SELF
+ *   Deletion methods (-d):
+ *     unlink - unlink() of the file, by process 0 for a shared file
+ *     delete - MPI_File_delete() of the file, by process 0 for a shared file
+ * For a shared file, all processes wait for the deletion to complete before
+ * opening it. A missing file is not an error.
+ *
+ * To compile:
+ *   % mpicc -O2 -I.. mpi_create_delete_loop.c ../bench_util.c -o mpi_create_delete_loop -lm
+ *
+ * Example run command and output on screen:
+ *   % mpiexec -n 4 ./mpi_create_delete_loop -n 100 -f testfile
+ *   ---- access mode coll, deletion by unlink, 100 iterations on 4 processes
+ *   operation           count       mean        p50        p99       p999        max (msec)
+ *   delete                100      0.016      0.011      0.056      0.056      0.056
+ *   open                  400      0.657      0.708      0.891      1.079      1.079
+ *   set_size              400      0.037      0.040      0.056      0.108      0.108
+ *   close                 400      0.220      0.224      0.447      0.705      0.705
+ *   ---- access mode coll, deletion by delete, 100 iterations on 4 processes
+ *   ...
+ *   ---- access mode fpp, deletion by unlink, 100 iterations on 4 processes
+ *   operation           count       mean        p50        p99       p999        max (msec)
+ *   delete                400      0.253      0.316      0.708      0.740      0.740
+ *   open                  400      0.528      0.501      1.122      1.316      1.316
+ *   set_size              400      0.005      0.005      0.007      0.065      0.065
+ *   close                 400      0.059      0.063      0.126      0.143      0.143
+ *   ...
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>  /* errno */
 #include <string.h> /* memset(), strerror() */
-#include <unistd.h> /* unlink() */
+#include <unistd.h> /* unlink(), getopt() */
+#include <math.h>   /* log10(), pow() */
+
 #include <mpi.h>
 
-#define MAX_TRIES 100000
+#include "bench_util.h"
+
+#define MAX_TRIES 1000
+
+/* latency histogram of logarithmic bins from HIST_MIN sec, bin 0 for
+ * latencies below HIST_MIN and bin HIST_NBINS-1 for ones beyond 1000 sec
+ */
+#define HIST_MIN        1e-7
+#define HIST_PER_DECADE 20
+#define HIST_NBINS      (10 * HIST_PER_DECADE + 2)
+
+#define NOPS 4
+static const char *op_names[NOPS] = {"delete", "open", "set_size", "close"};
+
+#define NAMODES 3
+static const char *amode_names[NAMODES] = {"coll", "self", "fpp"};
+
+#define NDMODES 2
+static const char *dmode_names[NDMODES] = {"unlink", "delete"};
+
+typedef struct {
+    long long count;
+    double    sum, max;
+    long long bins[HIST_NBINS];
+} histogram;
+
+static int verbose;
+static int print_hints; /* print hints in effect after the first open */
+
+/*----< hist_add() >---------------------------------------------------------*/
+static void
+hist_add(histogram *h, double t)
+{
+    int b;
 
-#define CHECK_ERR(func) { \
-    if (err != MPI_SUCCESS) { \
-        int errorStringLen; \
-        char errorString[MPI_MAX_ERROR_STRING]; \
-        MPI_Error_string(err, errorString, &errorStringLen); \
-        if (rank == 0) \
-            printf("Error at line %d: calling %s (%s)\n",__LINE__, #func, errorString); \
-    } \
+    if (t < HIST_MIN) b = 0;
+    else {
+        b = 1 + (int)(log10(t / HIST_MIN) * HIST_PER_DECADE);
+        if (b >= HIST_NBINS) b = HIST_NBINS - 1;
+    }
+    h->bins[b]++;
+    h->count++;
+    h->sum += t;
+    if (t > h->max) h->max = t;
 }
 
-int main(int argc, char** argv) {
-    char *filename, buf[512];
-    int i, rank, nprocs, err, sys_err;
+/*----< hist_percentile() >--------------------------------------------------*/
+/* return the upper bound of the bin containing the q-th quantile, no larger
+ * than the max latency
+ */
+static double
+hist_percentile(const histogram *h, double q)
+{
+    int b;
+    long long cum=0, rank;
+    double ub;
+
+    if (h->count == 0) return 0.0;
+
+    rank = (long long)ceil(q * h->count);
+    if (rank < 1) rank = 1;
+    for (b=0; b<HIST_NBINS-1; b++) {
+        cum += h->bins[b];
+        if (cum >= rank) break;
+    }
+    ub = HIST_MIN * pow(10.0, (double)b / HIST_PER_DECADE);
+    return (ub < h->max) ? ub : h->max;
+}
+
+/*----< hist_reduce() >------------------------------------------------------*/
+/* sum the histograms of all processes into root process 0 */
+static int
+hist_reduce(histogram *h, MPI_Comm comm)
+{
+    int err, rank;
+    double max;
+    histogram sum;
+
+    MPI_Comm_rank(comm, &rank);
+
+    err = MPI_Reduce(h->bins, sum.bins, HIST_NBINS, MPI_LONG_LONG, MPI_SUM, 0,
+                     comm);
+    if (err != MPI_SUCCESS) return err;
+    err = MPI_Reduce(&h->count, &sum.count, 1, MPI_LONG_LONG, MPI_SUM, 0,
+                     comm);
+    if (err != MPI_SUCCESS) return err;
+    err = MPI_Reduce(&h->sum, &sum.sum, 1, MPI_DOUBLE, MPI_SUM, 0, comm);
+    if (err != MPI_SUCCESS) return err;
+    err = MPI_Reduce(&h->max, &max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+    if (err != MPI_SUCCESS) return err;
+    sum.max = max;
+
+    if (rank == 0) *h = sum;
+    return MPI_SUCCESS;
+}
+
+/*----< delete_file() >------------------------------------------------------*/
+/* delete file path by method dmode, ignoring a missing file */
+static int
+delete_file(int dmode, const char *path, MPI_Info info)
+{
+    int err;
+
+    if (dmode == 0) {
+        err = unlink(path);
+        if (err < 0 && errno != ENOENT) { /* ignore ENOENT: file not exist */
+            printf("Error: unlink() errno=%d (%s)\n",errno,strerror(errno));
+            return 1;
+        }
+    }
+    else {
+        err = MPI_File_delete(path, info);
+        if (err != MPI_SUCCESS) {
+            int errclass;
+            MPI_Error_class(err, &errclass);
+            if (errclass != MPI_ERR_NO_SUCH_FILE) {
+                bench_print_error(err, "MPI_File_delete", __LINE__);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/*----< run_config() >-------------------------------------------------------*/
+/* run niters iterations of access mode amode and deletion method dmode, and
+ * report the latency histograms of all operations
+ */
+static int
+run_config(int         amode,
+           int         dmode,
+           int         niters,
+           const char *filename,
+           MPI_Info    info,
+           const char *out_file)
+{
+    char path[1024], buf[512];
+    int i, j, err, nerrs=0, rank, nprocs, sys_err, writer;
+    double t;
+    histogram hist[NOPS];
+    bench_record rec;
+    MPI_Comm comm;
     MPI_Status status;
     MPI_File fh;
 
-    MPI_Init(&argc, &argv);
-    err = MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    CHECK_ERR(MPI_Comm_rank);
-    err = MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
-    CHECK_ERR(MPI_Comm_size);
+    err = MPI_Comm_rank(MPI_COMM_WORLD, &rank); ERR
+    err = MPI_Comm_size(MPI_COMM_WORLD, &nprocs); ERR
+
+    if (amode == 2) /* file per process */
+        snprintf(path, sizeof(path), "%s.%d", filename, rank);
+    else
+        snprintf(path, sizeof(path), "%s", filename);
+    comm = (amode == 0) ? MPI_COMM_WORLD : MPI_COMM_SELF;
+
+    /* process 0 writes the header of a shared file, all write their own */
+    writer = (amode == 2 || rank == 0);
 
-    filename = "testfile";
     memset(buf, 0, 512);
+    memset(hist, 0, sizeof(histogram) * NOPS);
 
-    for (i=0; i<MAX_TRIES; i++) {
+    for (i=0; i<niters; i++) {
 
         /* mimic NC_CLOBBER */
-        if (rank == 0) {
-            err = unlink(filename);
-            if (err < 0 && errno != ENOENT) { /* ignore ENOENT: file not exist */
-                printf("Error: unlink() errno=%d (%s)\n",errno,strerror(errno));
-                sys_err = -1;
-            }
-            else
-                sys_err = 0;
+        sys_err = 0;
+        if (amode == 2 || rank == 0) {
+            t = MPI_Wtime();
+            sys_err = delete_file(dmode, path, info);
+            hist_add(&hist[0], MPI_Wtime() - t);
         }
 
         /* all processes must wait here until file deletion is completed */
-        err = MPI_Bcast(&sys_err, 1, MPI_INT, 0, MPI_COMM_WORLD);
-        CHECK_ERR(MPI_Bcast);
-        if (err != MPI_SUCCESS) break; /* loop i */
+        err = MPI_Allreduce(MPI_IN_PLACE, &sys_err, 1, MPI_INT, MPI_MAX,
+                            MPI_COMM_WORLD); ERR
+        if (sys_err != 0) {
+            nerrs++;
+            goto err_out;
+        }
+
+        /* open the file in parallel */
+        t = MPI_Wtime();
+        err = MPI_File_open(comm, path, MPI_MODE_CREATE | MPI_MODE_RDWR, info,
+                            &fh); ERR
+        hist_add(&hist[1], MPI_Wtime() - t);
 
-        if (sys_err != 0) break; /* loop i */
+        if (print_hints) {
+            err = bench_hints_print(fh, MPI_COMM_WORLD); ERR
+            print_hints = 0;
+        }
 
-        /* all processes open the file in parallel */
-        err = MPI_File_open(MPI_COMM_WORLD, filename, MPI_MODE_CREATE | MPI_MODE_RDWR, MPI_INFO_NULL, &fh);
-        CHECK_ERR(MPI_File_open);
-        if (err != MPI_SUCCESS) break; /* loop i */
+        t = MPI_Wtime();
+        err = MPI_File_set_size(fh, 0); ERR
+        hist_add(&hist[2], MPI_Wtime() - t);
 
-        if (rank == 0) { /* mimic PnetCDF rank 0 writes to file header */
-            err = MPI_File_write(fh, buf, 512, MPI_BYTE, &status);
-            CHECK_ERR(MPI_File_write);
-            if (err != MPI_SUCCESS) break; /* loop i */
+        if (writer) { /* mimic PnetCDF rank 0 writes to file header */
+            err = MPI_File_write(fh, buf, 512, MPI_BYTE, &status); ERR
         }
 
-        err = MPI_File_close(&fh);
-        CHECK_ERR(MPI_File_close);
-        if (err != MPI_SUCCESS) break; /* loop i */
+        t = MPI_Wtime();
+        err = MPI_File_close(&fh); ERR
+        hist_add(&hist[3], MPI_Wtime() - t);
     }
 
+    for (j=0; j<NOPS; j++) {
+        err = hist_reduce(&hist[j], MPI_COMM_WORLD); ERR
+    }
+
+    if (rank == 0) {
+        printf("---- access mode %s, deletion by %s, %d iterations on %d processes\n",
+               amode_names[amode], dmode_names[dmode], niters, nprocs);
+        printf("operation           count       mean        p50        p99       p999        max (msec)\n");
+        for (j=0; j<NOPS; j++) {
+            histogram *h = hist + j;
+            printf("%-12s %12lld %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+                   op_names[j], h->count,
+                   (h->count > 0) ? h->sum / h->count * 1e3 : 0.0,
+                   hist_percentile(h, 0.5)   * 1e3,
+                   hist_percentile(h, 0.99)  * 1e3,
+                   hist_percentile(h, 0.999) * 1e3, h->max * 1e3);
+        }
+        if (verbose) {
+            /* print the nonempty bins of the histograms */
+            for (j=0; j<NOPS; j++) {
+                int b;
+                printf("histogram of %s latency (bin upper bound in msec: count)\n",
+                       op_names[j]);
+                for (b=0; b<HIST_NBINS; b++) {
+                    if (hist[j].bins[b] == 0) continue;
+                    printf("    %12.4f: %lld\n",
+                           HIST_MIN * pow(10.0, (double)b / HIST_PER_DECADE) * 1e3,
+                           hist[j].bins[b]);
+                }
+            }
+        }
+    }
+
+    /* append the results of this configuration to the result file */
+    err = bench_record_init(&rec, MPI_COMM_WORLD, "mpi_create_delete_loop"); ERR
+    bench_record_int(&rec, "niters", niters);
+    bench_record_str(&rec, "access_mode", amode_names[amode]);
+    bench_record_str(&rec, "delete_method", dmode_names[dmode]);
+    for (j=0; j<NOPS; j++) {
+        char key[64];
+        sprintf(key, "%s_count", op_names[j]);
+        bench_record_int(&rec, key, hist[j].count);
+        sprintf(key, "%s_mean", op_names[j]);
+        bench_record_double(&rec, key,
+                            (hist[j].count > 0) ? hist[j].sum / hist[j].count
+                                                : 0.0);
+        sprintf(key, "%s_p50", op_names[j]);
+        bench_record_double(&rec, key, hist_percentile(&hist[j], 0.5));
+        sprintf(key, "%s_p99", op_names[j]);
+        bench_record_double(&rec, key, hist_percentile(&hist[j], 0.99));
+        sprintf(key, "%s_p999", op_names[j]);
+        bench_record_double(&rec, key, hist_percentile(&hist[j], 0.999));
+        sprintf(key, "%s_max", op_names[j]);
+        bench_record_double(&rec, key, hist[j].max);
+    }
+    if (bench_record_write(&rec, out_file)) nerrs++;
+    bench_record_free(&rec);
+
+    /* remove the file(s) */
+    if (amode == 2 || rank == 0) nerrs += delete_file(dmode, path, info);
+    MPI_Barrier(MPI_COMM_WORLD);
+
+err_out:
+    return nerrs;
+}
+
+/*----< parse_names() >------------------------------------------------------*/
+/* parse a comma-separated list of names into their indices in names[] */
+static int
+parse_names(char *list, const char **names, int nnames, int *idx)
+{
+    int i, n=0;
+    char *tok;
+
+    for (tok=strtok(list, ","); tok!=NULL; tok=strtok(NULL, ",")) {
+        for (i=0; i<nnames; i++)
+            if (!strcmp(tok, names[i])) break;
+        if (i == nnames || n == nnames) return -1;
+        idx[n++] = i;
+    }
+    return n;
+}
+
+/*----< usage() >------------------------------------------------------------*/
+static void
+usage(char *argv0)
+{
+    char *help =
+    "Usage: %s [-hv | -n num | -a list | -d list | -o file | -H file] -f file_name\n"
+    "       [-h] Print this help\n"
+    "       [-v] verbose mode, also print the histograms\n"
+    "       [-n num] number of iterations (default: %d)\n"
+    "       [-a list] access modes, comma-separated names of coll, self, and\n"
+    "                 fpp (default: coll,self,fpp)\n"
+    "       [-d list] deletion methods, comma-separated names of unlink and\n"
+    "                 delete (default: unlink,delete)\n"
+    "       [-o file] append results as lines of JSON to file\n"
+    "       [-H file] load MPI-IO hints from file of \"key value\" lines\n"
+    "        -f filename: file name, with suffix .<rank> in mode fpp\n";
+    fprintf(stderr, help, argv0, MAX_TRIES);
+}
+
+/*----< main() >------------------------------------------------------------*/
+int main(int argc, char** argv) {
+    extern int optind;
+    extern char *optarg;
+    char *filename=NULL, *hints_file=NULL, *out_file=NULL;
+    char *amode_list=NULL, *dmode_list=NULL;
+    int i, j, rank, err, nerrs=0, niters;
+    int namodes, ndmodes, amodes[NAMODES], dmodes[NDMODES];
+    MPI_Info info=MPI_INFO_NULL;
+
+    MPI_Init(&argc, &argv);
+    err = MPI_Comm_rank(MPI_COMM_WORLD, &rank); ERR
+
+    verbose     = 0;
+    print_hints = 0;
+    niters      = MAX_TRIES;
+
+    /* get command-line arguments */
+    while ((i = getopt(argc, argv, "hvn:a:d:o:H:f:")) != EOF)
+        switch(i) {
+            case 'v': verbose = 1;
+                      break;
+            case 'n': niters = atoi(optarg);
+                      break;
+            case 'a': amode_list = optarg;
+                      break;
+            case 'd': dmode_list = optarg;
+                      break;
+            case 'o': out_file = optarg;
+                      break;
+            case 'H': hints_file = optarg;
+                      break;
+            case 'f': filename = optarg;
+                      break;
+            case 'h':
+            default:  if (rank==0) usage(argv[0]);
+                      MPI_Finalize();
+                      return 1;
+        }
+
+    if (filename == NULL) {
+        if (rank==0) usage(argv[0]);
+        MPI_Finalize();
+        return 1;
+    }
+
+    if (amode_list == NULL) {
+        namodes = NAMODES;
+        for (i=0; i<NAMODES; i++) amodes[i] = i;
+    }
+    else
+        namodes = parse_names(amode_list, amode_names, NAMODES, amodes);
+
+    if (dmode_list == NULL) {
+        ndmodes = NDMODES;
+        for (i=0; i<NDMODES; i++) dmodes[i] = i;
+    }
+    else
+        ndmodes = parse_names(dmode_list, dmode_names, NDMODES, dmodes);
+
+    if (namodes <= 0 || ndmodes <= 0) {
+        if (rank == 0)
+            printf("Error: invalid list of command-line option '%s'\n",
+                   (namodes <= 0) ? "-a" : "-d");
+        nerrs++;
+        goto err_out;
+    }
+
+    /* load user I/O hints from the hint file, if given */
+    if (bench_hints_load(hints_file, MPI_COMM_WORLD, &info) != 0) {
+        nerrs++;
+        goto err_out;
+    }
+    print_hints = (hints_file != NULL);
+
+    for (i=0; i<namodes; i++) {
+        for (j=0; j<ndmodes; j++) {
+            nerrs += run_config(amodes[i], dmodes[j], niters, filename, info,
+                                out_file);
+            if (nerrs > 0) goto err_out;
+        }
+    }
+
+err_out:
+    if (info != MPI_INFO_NULL) MPI_Info_free(&info);
     MPI_Finalize();
-    return 0;
+    return (nerrs > 0);
 }
@@ -5,6 +5,19 @@
  * This program tests collective write and read calls using a user buffer
  * datatype whose size is a multiple of the fileview datatype size.
  *
+ * Command-line option '-T num' adds a multi-timestep mode, which writes num
+ * timesteps of the same request, one after another in the file, as a history
+ * output does. It is run in 3 ways and the time per timestep of each is
+ * reported.
+ *     recreate - create and commit the fileview datatype, set the file view
+ *                at the displacement of the timestep, write, and free the
+ *                datatype in every timestep
+ *     set_view - keep the committed fileview datatype and set the file view
+ *                at the displacement of the timestep in every timestep
+ *     cached   - set the file view once and write each timestep by
+ *                MPI_File_write_at_all() at the offset of the timestep
+ * All timesteps are read back and checked at the end.
+ *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 #include <stdio.h>
@@ -14,38 +27,202 @@
 
 #include <mpi.h>
 
-#define ERR \
-    if (err != MPI_SUCCESS) { \
-        int errorStringLen; \
-        char errorString[MPI_MAX_ERROR_STRING]; \
-        MPI_Error_string(err, errorString, &errorStringLen); \
-        printf("Error at line %d: %s\n",__LINE__,errorString); \
-        nerrs++; \
-        goto err_out; \
-    }
+#include "bench_util.h"
 
 static void
 usage(char *argv0)
 {
     char *help =
-    "Usage: %s [-hq | -l len | -n num] -f file_name\n"
+    "Usage: %s [-hq | -l len | -n num | -T num | -H file] -f file_name\n"
     "       [-h] Print this help\n"
     "       [-q] quiet mode\n"
     "       [-l len] length of local X and Y dimension sizes\n"
     "       [-n num] number of file datatype to be written\n"
+    "       [-T num] also write num timesteps, recreating or caching the view\n"
+    "       [-H file] load MPI-IO hints from file of \"key value\" lines\n"
     "        -f filename: output file name\n";
     fprintf(stderr, help, argv0);
 }
 
+/*----< fill_buf() >---------------------------------------------------------*/
+static void
+fill_buf(int *buf, int ntimes, int len, int gap, int rank)
+{
+    size_t i, j, k=0;
+
+    for (i=0; i<ntimes; i++) {
+        for (j=0; j<len*len; j++, k++) buf[k] = (k + 17 + rank) % 2147483647;
+        k += gap;
+    }
+}
+
+/*----< check_buf() >--------------------------------------------------------*/
+static int
+check_buf(const int *buf, int ntimes, int len, int gap, int rank)
+{
+    size_t i, j, k=0;
+
+    for (i=0; i<ntimes; i++) {
+        for (j=0; j<len*len; j++, k++) {
+            int exp = (k + 17 + rank) % 2147483647;
+            if (buf[k] != exp) {
+                printf("Error: buf[%zd] expect %d but got %d\n", k, exp, buf[k]);
+                return 1;
+            }
+        }
+        k += gap;
+    }
+    return 0;
+}
+
+/*----< create_fileType() >--------------------------------------------------*/
+/* create and commit the fileview datatype, a subarray of the 2D global array
+ * partitioned in a block-block fashion
+ */
+static int
+create_fileType(int           len,
+                const int    *psizes,
+                const int    *local_rank,
+                MPI_Datatype *fileType)
+{
+    int err, nerrs=0, gsizes[2], subsizes[2], starts[2];
+
+    gsizes[0]   = len * psizes[0]; /* global array size */
+    gsizes[1]   = len * psizes[1];
+    starts[0]   = local_rank[0] * len;
+    starts[1]   = local_rank[1] * len;
+    subsizes[0] = len;
+    subsizes[1] = len;
+    err = MPI_Type_create_subarray(2, gsizes, subsizes, starts, MPI_ORDER_C,
+                                   MPI_INT, fileType);
+    ERR
+    err = MPI_Type_commit(fileType);
+    ERR
+
+err_out:
+    return nerrs;
+}
+
+/*----< write_timesteps() >--------------------------------------------------*/
+/* write nsteps timesteps, each of ntimes bufType, by the 3 ways of recreating
+ * or caching the file view, and read back and check all timesteps
+ */
+static int
+write_timesteps(MPI_File      fh,
+                MPI_Info      info,
+                int           nsteps,
+                int           len,
+                int           ntimes,
+                int           gap,
+                const int    *psizes,
+                const int    *local_rank,
+                int          *buf,
+                size_t        buf_len,
+                MPI_Datatype  bufType,
+                MPI_Datatype  fileType)
+{
+    const char *names[3] = {"recreate type and view per timestep",
+                            "set_view per timestep",
+                            "cached view, write_at_all per timestep"};
+    int i, m, err, nerrs=0, rank, nprocs;
+    double amnt, total[3], *rep_max;
+    size_t k;
+    MPI_Offset step_etypes, step_bytes;
+    MPI_Datatype stepType;
+    MPI_Status status;
+    bench_timer timers[3];
+
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* bytes written by each process and by all processes per timestep */
+    step_etypes = (MPI_Offset)ntimes * len * len * sizeof(int);
+    step_bytes  = step_etypes * nprocs;
+    amnt = (double)step_bytes;
+
+    rep_max = (double*) malloc(sizeof(double) * nsteps);
+    for (m=0; m<3; m++)
+        bench_timer_init(&timers[m], names[m], 0, nsteps);
+
+    for (m=0; m<3; m++) {
+        for (i=0; i<nsteps; i++) {
+            MPI_Offset disp = step_bytes * i;
+
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&timers[m]);
+            if (m == 0) {
+                nerrs += create_fileType(len, psizes, local_rank, &stepType);
+                if (nerrs > 0) goto err_out;
+                err = MPI_File_set_view(fh, disp, MPI_BYTE, stepType,
+                                        "native", info); ERR
+                err = MPI_File_write_all(fh, buf, ntimes, bufType, &status);
+                ERR
+                err = MPI_Type_free(&stepType); ERR
+            }
+            else if (m == 1) {
+                err = MPI_File_set_view(fh, disp, MPI_BYTE, fileType,
+                                        "native", info); ERR
+                err = MPI_File_write_all(fh, buf, ntimes, bufType, &status);
+                ERR
+            }
+            else {
+                if (i == 0) {
+                    err = MPI_File_set_view(fh, 0, MPI_BYTE, fileType,
+                                            "native", info); ERR
+                }
+                err = MPI_File_write_at_all(fh, step_etypes * i, buf, ntimes,
+                                            bufType, &status); ERR
+            }
+            bench_timer_stop(&timers[m]);
+        }
+
+        err = bench_timer_report(&timers[m], MPI_COMM_WORLD, amnt, NULL); ERR
+        err = bench_timer_reduce(&timers[m], MPI_COMM_WORLD, 0, NULL, NULL,
+                                 rep_max); ERR
+        total[m] = 0.0;
+        for (i=0; i<nsteps; i++) total[m] += rep_max[i];
+    }
+
+    if (rank == 0) {
+        printf("Total time of %d timesteps:\n", nsteps);
+        for (m=0; m<3; m++)
+            printf("    %-40s = %.4f sec (%.6f sec per timestep)\n",
+                   names[m], total[m], total[m] / nsteps);
+        if (total[0] > 0.0)
+            printf("    %-40s = %.1f%%\n", "time saved by caching the view",
+                   100.0 * (total[0] - total[2]) / total[0]);
+    }
+
+    /* read back and check all timesteps, the view is still cached */
+    for (i=0; i<nsteps; i++) {
+        for (k=0; k<buf_len; k++) buf[k] = 0;
+        err = MPI_File_read_at_all(fh, step_etypes * i, buf, ntimes, bufType,
+                                   &status); ERR
+        if (check_buf(buf, ntimes, len, gap, rank)) {
+            printf("Error: rank %d timestep %d mismatch\n", rank, i);
+            nerrs++;
+            break;
+        }
+    }
+
+    /* restore the contents of the write buffer */
+    fill_buf(buf, ntimes, len, gap, rank);
+
+err_out:
+    for (m=0; m<3; m++) bench_timer_free(&timers[m]);
+    free(rep_max);
+    return nerrs;
+}
+
 /*----< main() >------------------------------------------------------------*/
 int main(int argc, char **argv)
 {
     extern int optind;
     extern char *optarg;
-    char filename[256];
-    size_t i, j, k;
-    int err, nerrs=0, rank, nprocs, mode, verbose=1, ntimes, len;
-    int psizes[2], gsizes[2], subsizes[2], starts[2];
+    char filename[256], *hints_file=NULL;
+    size_t i;
+    int err, nerrs=0, rank, nprocs, mode, verbose=1, ntimes, len, nsteps;
+    int psizes[2], gsizes[2];
     int local_rank[2], *buf=NULL, type_size, gap, max_nerrs;
     double timing, max_timing;     
     MPI_Aint lb, extent;
@@ -59,21 +236,26 @@ int main(int argc, char **argv)
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
     ntimes = 2;
+    nsteps = 0; /* no multi-timestep mode */
     len = 100;  /* default dimension size */
     gap = 4;    /* gap between 2 blocks in bufType */
     filename[0] = '\0';
 
     /* get command-line arguments */
-    while ((i = getopt(argc, argv, "hql:n:f:")) != EOF)
+    while ((i = getopt(argc, argv, "hql:n:T:f:H:")) != EOF)
         switch(i) {
             case 'q': verbose = 0;
                       break;
             case 'n': ntimes = atoi(optarg);
                       break;
+            case 'T': nsteps = atoi(optarg);
+                      break;
             case 'l': len = atoi(optarg);
                       break;
             case 'f': strcpy(filename, optarg);
                       break;
+            case 'H': hints_file = optarg;
+                      break;
             case 'h':
             default:  if (rank==0) usage(argv[0]);
                       MPI_Finalize();
@@ -86,6 +268,12 @@ int main(int argc, char **argv)
         return 1;
     }
 
+    /* load user I/O hints from the hint file, if given */
+    if (bench_hints_load(hints_file, MPI_COMM_WORLD, &info) != 0) {
+        MPI_Finalize();
+        return 1;
+    }
+
     if (verbose && rank == 0) {
         printf("Creating a buffer datatype consisting of %d blocks\n",ntimes);
         printf("Each block is of size %d x %d (int) = %zd\n",
@@ -112,15 +300,8 @@ int main(int argc, char **argv)
     if (verbose && rank == 0)
         printf("global variable shape:     %d %d\n", gsizes[0],gsizes[1]);
 
-    starts[0]   = local_rank[0] * len;
-    starts[1]   = local_rank[1] * len;
-    subsizes[0] = len;
-    subsizes[1] = len;
-    err = MPI_Type_create_subarray(2, gsizes, subsizes, starts, MPI_ORDER_C,
-                                   MPI_INT, &fileType);
-    ERR
-    err = MPI_Type_commit(&fileType);
-    ERR
+    nerrs += create_fileType(len, psizes, local_rank, &fileType);
+    if (nerrs > 0) goto err_out;
 
     MPI_Type_size(fileType, &type_size);
     lb = 0;
@@ -141,6 +322,7 @@ int main(int argc, char **argv)
         err = MPI_Type_create_resized(contigType, 0, ub, &bufType); ERR
         MPI_Type_free(&contigType);
     }
+    err = MPI_Type_commit(&bufType); ERR
 
     /* allocate I/O buffer */
     MPI_Type_size(bufType, &type_size);
@@ -150,15 +332,14 @@ int main(int argc, char **argv)
         printf("buffer type size = %d extent = %ld\n", type_size, extent);
 
     buf = (int*) malloc(extent * ntimes * sizeof(int));
-    k = 0;
-    for (i=0; i<ntimes; i++) {
-        for (j=0; j<len*len; j++, k++) buf[k] = (k + 17 + rank) % 2147483647;
-        k += gap;
-    }
+    fill_buf(buf, ntimes, len, gap, rank);
 
     /* open file */
     mode = MPI_MODE_CREATE | MPI_MODE_RDWR;
     err = MPI_File_open(MPI_COMM_WORLD, filename, mode, info, &fh); ERR
+    if (hints_file != NULL) {
+        err = bench_hints_print(fh, MPI_COMM_WORLD); ERR
+    }
 
     /* set the file view */
     err = MPI_File_set_view(fh, 0, MPI_BYTE, fileType, "native", info);
@@ -176,19 +357,13 @@ int main(int argc, char **argv)
     timing = MPI_Wtime() - timing;
 
     /* check contents of read buffer */
-    k = 0;
-    for (i=0; i<ntimes; i++) {
-        for (j=0; j<len*len; j++, k++) {
-            int exp = (k + 17 + rank) % 2147483647;
-            if (buf[k] != exp) {
-                printf("Error: buf[%zd] expect %d but got %d\n", k, exp, buf[k]);
-                nerrs++;
-                i = ntimes;
-                break;
-            }
-        }
-        k += gap;
-    }
+    nerrs += check_buf(buf, ntimes, len, gap, rank);
+
+    /* write multiple timesteps, recreating or caching the file view */
+    if (nsteps > 0)
+        nerrs += write_timesteps(fh, info, nsteps, len, ntimes, gap, psizes,
+                                 local_rank, buf, extent * ntimes, bufType,
+                                 fileType);
 
     err = MPI_File_close(&fh); ERR
     err = MPI_Type_free(&bufType); ERR
@@ -201,6 +376,7 @@ int main(int argc, char **argv)
         printf("Time of collective write and read = %.2f sec\n", max_timing);
 
 err_out:
+    if (info != MPI_INFO_NULL) MPI_Info_free(&info);
     MPI_Finalize();
     return (nerrs > 0);
 }
@@ -10,6 +10,29 @@
  * ROMIO's subroutine ADIOI_LUSTRE_Fill_send_buffer() when the user buffer is
  * non contiguous.
  *
+ * Command-line option '-p' adds a pack-then-write mode, which packs the user
+ * buffer into a contiguous staging buffer by MPI_Pack() before writing it
+ * with a collective write. Option '-u' packs it instead by memcpy() of the 2
+ * blocks. The pack time is reported separately from the write time of the
+ * packed buffer, to show how much the library loses on the noncontiguous
+ * buffer compared with one bulk pack in the user space.
+ *
+ * Command-line option '-G' adds a GPU buffer mode, available when
+ * bench_util.c is compiled with -DBENCH_USE_CUDA or -DBENCH_USE_HIP and
+ * linked with the CUDA or HIP runtime library. The user buffer is copied
+ * into GPU device memory and written, and read back if reads are enabled,
+ * by the same collective calls on the device buffer, which requires a
+ * GPU-aware MPI library. This is compared with staging through a buffer of
+ * pinned host memory of the same layout, copied from or to the device
+ * buffer by the GPU runtime, which is included in the timings.
+ *
+ * Command-line option '-A' reports the aggregators of the collective write,
+ * selected from hints cb_nodes and cb_config_list as ROMIO does, with the
+ * compute node of each, its file domain, and the bytes it receives from the
+ * other processes through the fileview, and the imbalance among aggregators
+ * and among compute nodes. With 16 processes standing for the 16 I/O tasks
+ * of the original PIO run, this shows how the 4 aggregators share the load.
+ *
  * The performance issue is discovered when running a PIO test program using
  * Lustre. When read/write requests are large and the Lustre striping size is
  * small, then the number of calls to memcpy() can become large, hurting the
@@ -26,7 +49,7 @@
  *   User buffer consists of two separately allocated memory spaces.
  *
  * To compile:
- *   % mpicc -O2 pio_noncontig.c -o pio_noncontig
+ *   % mpicc -O2 -I.. pio_noncontig.c ../bench_util.c -o pio_noncontig -lm
  *
  * Example output of running 16 processes on a local Linux machine using UFS:
  * Note the 2 runs below differ only on whether option "-g 0" is used. Option
@@ -67,6 +90,8 @@
 
 #include <mpi.h>
 
+#include "bench_util.h"
+
 #define NVARS 64         /* Number of variables */
 #define NROWS 58         /* Number of rows in each variable */
 #define NCOLS 1048576    /* Number of rows in each variable */
@@ -74,34 +99,41 @@
 #define NCLIENTS 2048    /* Number of MPI process clients */
 #define GAP 16           /* gap size in the user buffer, mimic 2 malloc() */
 
+/* ways of packing the user buffer in the pack-then-write mode */
+#define PACK_NONE   0
+#define PACK_MPI    1  /* MPI_Pack() */
+#define PACK_MEMCPY 2  /* memcpy() of each block */
+
 #define cb_buffer_size "1048576"
 #define cb_nodes "4"
 
-#define ERR \
-    if (err != MPI_SUCCESS) { \
-        int errorStringLen; \
-        char errorString[MPI_MAX_ERROR_STRING]; \
-        MPI_Error_string(err, errorString, &errorStringLen); \
-        printf("Error at line %d: %s\n",__LINE__,errorString); \
-        nerrs++; \
-        goto err_out; \
-    }
-
 static void
 usage(char *argv0)
 {
     char *help =
-    "Usage: %s [-hvrw | -n num | -k num | -c num | -g num ] -f file_name\n"
+    "Usage: %s [-hvrwpuGA | -n num | -k num | -c num | -g num | -W num | -N num | -o file | -H file ] -f file_name\n"
     "       [-h] Print this help\n"
     "       [-v] verbose mode\n"
     "       [-w] performs write only (default: both write and read)\n"
     "       [-r] performs read  only (default: both write and read)\n"
+    "       [-p] also pack the buffer by MPI_Pack before collective write\n"
+    "       [-u] also pack the buffer by memcpy before collective write\n"
+    "       [-G] also write and read a GPU device buffer, directly and staged\n"
+    "            through pinned host memory\n"
+    "       [-A] report the aggregators of the collective write, their file\n"
+    "            domains, nodes, and incoming bytes\n"
     "       [-n num] number of global variables (default: %d)\n"
     "       [-k num] number of rows    in each global variable (default: %d)\n"
     "       [-c num] number of columns in each global variable (default: %d)\n"
     "       [-g num] gap in bytes between first 2 blocks (default: %d)\n"
+    "       [-W num] number of untimed warmup runs (default: %d)\n"
+    "       [-N num] number of timed repetitions (default: %d)\n"
+    "       [-o file] append results as a line of JSON to file\n"
+    "       [-H file] load MPI-IO hints from file of \"key value\" lines,\n"
+    "                 overwriting cb_buffer_size=%s and cb_nodes=%s\n"
     "        -f file_name: output file name\n";
-    fprintf(stderr, help, argv0, NVARS, NROWS, NCOLS, GAP);
+    fprintf(stderr, help, argv0, NVARS, NROWS, NCOLS, GAP, BENCH_NWARMUP,
+            BENCH_NREPS, cb_buffer_size, cb_nodes);
 }
 
 /*----< main() >------------------------------------------------------------*/
@@ -109,12 +141,14 @@ int main(int argc, char **argv)
 {
     extern int optind;
     extern char *optarg;
-    char filename[256];
+    char filename[256], *out_file=NULL, *hints_file=NULL;
     int i, err, nerrs=0, max_nerrs, rank, nprocs, mode, verbose=0, nvars;
     int nreqs, gap, ncols_g, nrows, ncols, *blocklen, btype_size, ftype_size;
-    int do_write, do_read;
-    char *buf;
-    double timing[2], max_timing[2];
+    int do_write, do_read, r, nwarmup, nreps, pack, position, gpu, g, aggr;
+    char *buf, *packed=NULL, *dev=NULL, *pin=NULL;
+    double amnt;
+    bench_timer wtimer, rtimer, ptimer[3], gtimer[4];
+    bench_record rec;
     MPI_Aint j, lb, *displace, buf_ext, file_ext;
     MPI_Datatype bufType, fileType, *subTypes;
     MPI_File fh;
@@ -132,10 +166,15 @@ int main(int argc, char **argv)
     gap     = GAP;
     do_write = 1;
     do_read  = 1;
+    nwarmup  = BENCH_NWARMUP;
+    nreps    = BENCH_NREPS;
+    gpu      = 0;
+    aggr     = 0;
+    pack     = PACK_NONE;
     filename[0] = '\0';
 
     /* get command-line arguments */
-    while ((i = getopt(argc, argv, "hvwrn:k:c:g:f:")) != EOF)
+    while ((i = getopt(argc, argv, "hvwrpuGAn:k:c:g:f:W:N:o:H:")) != EOF)
         switch(i) {
             case 'v': verbose = 1;
                       break;
@@ -164,8 +203,24 @@ int main(int argc, char **argv)
                       break;
             case 'r': do_write = 0;
                       break;
+            case 'p': pack = PACK_MPI;
+                      break;
+            case 'u': pack = PACK_MEMCPY;
+                      break;
+            case 'G': gpu = 1;
+                      break;
+            case 'A': aggr = 1;
+                      break;
             case 'f': strcpy(filename, optarg);
                       break;
+            case 'W': nwarmup = atoi(optarg);
+                      break;
+            case 'N': nreps = atoi(optarg);
+                      break;
+            case 'o': out_file = strdup(optarg);
+                      break;
+            case 'H': hints_file = optarg;
+                      break;
 
             case 'h':
             default:  if (rank==0) usage(argv[0]);
@@ -179,6 +234,37 @@ int main(int argc, char **argv)
         return 1;
     }
 
+    bench_timer_init(&wtimer, "collective write", nwarmup, nreps);
+    bench_timer_init(&rtimer, "collective read", nwarmup, nreps);
+    bench_timer_init(&ptimer[0], (pack == PACK_MPI) ? "pack (MPI_Pack)" :
+                     "pack (memcpy)", nwarmup, nreps);
+    bench_timer_init(&ptimer[1], "collective write, packed", nwarmup, nreps);
+    bench_timer_init(&ptimer[2], "pack + collective write", nwarmup, nreps);
+    bench_timer_init(&gtimer[0], "collective write, device buffer", nwarmup,
+                     nreps);
+    bench_timer_init(&gtimer[1], "device-to-host copy + collective write",
+                     nwarmup, nreps);
+    bench_timer_init(&gtimer[2], "collective read, device buffer", nwarmup,
+                     nreps);
+    bench_timer_init(&gtimer[3], "collective read + host-to-device copy",
+                     nwarmup, nreps);
+
+    bench_record_init(&rec, MPI_COMM_WORLD, "pio_noncontig");
+    bench_record_int(&rec, "nvars", nvars);
+    bench_record_int(&rec, "nrows", nrows);
+    bench_record_int(&rec, "ncols", ncols_g);
+    bench_record_int(&rec, "gap", gap);
+    bench_record_str(&rec, "pack", (pack == PACK_MPI) ? "MPI_Pack" :
+                     (pack == PACK_MEMCPY) ? "memcpy" : "none");
+    bench_record_int(&rec, "gpu", gpu);
+    bench_record_int(&rec, "aggr", aggr);
+
+    /* select the GPU device of this process */
+    if (gpu && bench_gpu_init(MPI_COMM_WORLD) != 0) {
+        nerrs++;
+        goto err_out;
+    }
+
     /* Calculate number of subarray requests each aggregator writes or reads.
      * Each original MPI process client forwards all its requests to one of
      * the I/O tasks. To run the original case, run 16 MPI processes.
@@ -301,20 +387,122 @@ int main(int argc, char **argv)
     MPI_Info_set(info, "cb_buffer_size", cb_buffer_size);
     MPI_Info_set(info, "cb_nodes", cb_nodes);
 
+    /* hints in the hint file, if given, overwrite the ones above */
+    if (bench_hints_load(hints_file, MPI_COMM_WORLD, &info) != 0) {
+        nerrs++;
+        goto err_out;
+    }
+
     mode = MPI_MODE_CREATE | MPI_MODE_RDWR;
     err = MPI_File_open(MPI_COMM_WORLD, filename, mode, info, &fh); ERR
+    err = bench_record_hints(&rec, fh); ERR
+    if (hints_file != NULL) {
+        err = bench_hints_print(fh, MPI_COMM_WORLD); ERR
+    }
 
-    err = MPI_File_set_view(fh, 0, MPI_BYTE, fileType, "native", MPI_INFO_NULL);
+    err = MPI_File_set_view(fh, 0, MPI_BYTE, fileType, "native", info);
     ERR
 
+    if (aggr) {
+        /* aggregators and their load of the collective write below */
+        nerrs += bench_aggr_report(fh, info, 0, fileType, ftype_size,
+                                   MPI_COMM_WORLD, &rec);
+    }
+
     MPI_Info_free(&info);
 
     /* write to the file */
     if (do_write) {
-        MPI_Barrier(MPI_COMM_WORLD);
-        timing[0] = MPI_Wtime();
-        err = MPI_File_write_at_all(fh, 0, buf, 1, bufType, &status); ERR
-        timing[0] = MPI_Wtime() - timing[0];
+        for (r=0; r<nwarmup+nreps; r++) {
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&wtimer);
+            err = MPI_File_write_at_all(fh, 0, buf, 1, bufType, &status); ERR
+            bench_timer_stop(&wtimer);
+        }
+    }
+
+    /* pack the user buffer into a contiguous buffer and write it */
+    if (do_write && pack != PACK_NONE) {
+        packed = (char*) malloc(btype_size);
+
+        for (r=0; r<nwarmup+nreps; r++) {
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&ptimer[2]);
+            bench_timer_start(&ptimer[0]);
+            if (pack == PACK_MPI) {
+                position = 0;
+                err = MPI_Pack(buf, 1, bufType, packed, btype_size, &position,
+                               MPI_COMM_WORLD); ERR
+            }
+            else {
+                memcpy(packed, buf, nrows);
+                memcpy(packed + nrows, buf + nrows + gap, btype_size - nrows);
+            }
+            bench_timer_stop(&ptimer[0]);
+
+            bench_timer_start(&ptimer[1]);
+            err = MPI_File_write_at_all(fh, 0, packed, btype_size, MPI_BYTE,
+                                        &status); ERR
+            bench_timer_stop(&ptimer[1]);
+            bench_timer_stop(&ptimer[2]);
+        }
+        free(packed);
+    }
+
+    /* write from and read into a device buffer, directly and staged */
+    if (gpu) {
+        dev = (char*) bench_mem_alloc(buf_ext, BENCH_MEM_DEVICE);
+        pin = (char*) bench_mem_alloc(buf_ext, BENCH_MEM_PINNED);
+        if (dev == NULL || pin == NULL ||
+            bench_mem_copy(dev, buf, buf_ext) != 0) {
+            nerrs++;
+            goto err_out;
+        }
+        for (g=0; do_write && g<2; g++) {
+            for (r=0; r<nwarmup+nreps; r++) {
+                MPI_Barrier(MPI_COMM_WORLD);
+                bench_timer_start(&gtimer[g]);
+                if (g == 1 && bench_mem_copy(pin, dev, buf_ext) != 0) {
+                    nerrs++;
+                    goto err_out;
+                }
+                err = MPI_File_write_at_all(fh, 0, (g == 0) ? dev : pin, 1,
+                                            bufType, &status); ERR
+                bench_timer_stop(&gtimer[g]);
+            }
+        }
+        for (g=2; do_read && g<4; g++) {
+            if (bench_mem_set(dev, -1, buf_ext, BENCH_MEM_DEVICE) != 0 ||
+                bench_mem_set(pin, -1, buf_ext, BENCH_MEM_PINNED) != 0) {
+                nerrs++;
+                goto err_out;
+            }
+            for (r=0; r<nwarmup+nreps; r++) {
+                MPI_Barrier(MPI_COMM_WORLD);
+                bench_timer_start(&gtimer[g]);
+                err = MPI_File_read_at_all(fh, 0, (g == 2) ? dev : pin, 1,
+                                           bufType, &status); ERR
+                if (g == 3 && bench_mem_copy(dev, pin, buf_ext) != 0) {
+                    nerrs++;
+                    goto err_out;
+                }
+                bench_timer_stop(&gtimer[g]);
+            }
+
+            /* contents of the device buffer must be the ones written */
+            if (bench_mem_copy(pin, dev, buf_ext) != 0) {
+                nerrs++;
+                goto err_out;
+            }
+            for (j=0; j<buf_ext; j++) {
+                if (pin[j] != buf[j]) {
+                    printf("Error: %s buf[%zd] expect %d but got %d\n",
+                           gtimer[g].name, j, buf[j], pin[j]);
+                    nerrs++;
+                    break;
+                }
+            }
+        }
     }
 
     /* read from the file */
@@ -322,10 +510,12 @@ int main(int argc, char **argv)
         /* reset contents of buffer */
         for (j=0; j<buf_ext; j++) buf[j] = -1;
 
-        MPI_Barrier(MPI_COMM_WORLD);
-        timing[1] = MPI_Wtime();
-        err = MPI_File_read_at_all(fh, 0, buf, 1, bufType, &status); ERR
-        timing[1] = MPI_Wtime() - timing[1];
+        for (r=0; r<nwarmup+nreps; r++) {
+            MPI_Barrier(MPI_COMM_WORLD);
+            bench_timer_start(&rtimer);
+            err = MPI_File_read_at_all(fh, 0, buf, 1, bufType, &status); ERR
+            bench_timer_stop(&rtimer);
+        }
 
         /* check contents of read buffer */
         for (j=0; j<nrows; j++) {
@@ -354,17 +544,36 @@ int main(int argc, char **argv)
     free(buf);
 
     MPI_Allreduce(&nerrs, &max_nerrs, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
-    MPI_Reduce(timing, max_timing, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
-    if (max_nerrs == 0 && rank == 0) {
-        printf("---------------------------------------------------------\n");
+    if (max_nerrs == 0) {
+        amnt = (double)wlen * nprocs;
+        if (rank == 0)
+            printf("---------------------------------------------------------\n");
         if (do_write)
-            printf("Time of collective write = %.2f sec\n", max_timing[0]);
+            bench_timer_report(&wtimer, MPI_COMM_WORLD, amnt, &rec);
+        if (do_write && pack != PACK_NONE)
+            for (i=0; i<3; i++)
+                bench_timer_report(&ptimer[i], MPI_COMM_WORLD, amnt, &rec);
         if (do_read)
-            printf("Time of collective read  = %.2f sec\n", max_timing[1]);
-        printf("---------------------------------------------------------\n");
+            bench_timer_report(&rtimer, MPI_COMM_WORLD, amnt, &rec);
+        for (g=0; gpu && g<4; g++)
+            if ((g < 2) ? do_write : do_read)
+                bench_timer_report(&gtimer[g], MPI_COMM_WORLD, amnt, &rec);
+        if (rank == 0)
+            printf("---------------------------------------------------------\n");
+        if (bench_record_write(&rec, out_file)) nerrs++;
     }
 
 err_out:
+    bench_timer_free(&wtimer);
+    bench_timer_free(&rtimer);
+    for (i=0; i<3; i++)
+        bench_timer_free(&ptimer[i]);
+    for (i=0; i<4; i++)
+        bench_timer_free(&gtimer[i]);
+    bench_mem_free(dev, BENCH_MEM_DEVICE);
+    bench_mem_free(pin, BENCH_MEM_PINNED);
+    bench_record_free(&rec);
+    if (out_file != NULL) free(out_file);
     MPI_Finalize();
     return (nerrs > 0);
 }